@@ -4,330 +4,618 @@
  * Main entry point and application event loop.
  */
 
-#include "core/pty.hpp"
-#include "core/terminal.hpp"
+#include "app/terminal_window.hpp"
+#include "app/view_window.hpp"
+#include "core/child_reaper.hpp"
+#include "core/history_budget.hpp"
+#include "core/instance_server.hpp"
+#include "core/link_detector.hpp"
+#include "core/remote_session.hpp"
+#include "core/session_manager.hpp"
+#include "core/terminal_server.hpp"
+#include "core/tmux_control.hpp"
 #include "platform/linux/window.hpp"
 #include "render/font.hpp"
-#include "render/renderer.hpp"
 #include "theme/theme.hpp"
 
-#include <GLFW/glfw3.h>
-
 #include <algorithm>
 #include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
 
 namespace {
 
-// Configuration constants
-constexpr int DEFAULT_WINDOW_WIDTH = 900;
-constexpr int DEFAULT_WINDOW_HEIGHT = 600;
-constexpr int DEFAULT_FONT_SIZE = 16;
-constexpr size_t PTY_READ_BUFFER_SIZE = 4096;
-
-// Common font paths to try
-const char *FONT_PATHS[] = {
-    "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
-    "/usr/share/fonts/truetype/liberation/LiberationMono-Regular.ttf",
-    "/usr/share/fonts/truetype/ubuntu/UbuntuMono-R.ttf",
-    "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
-    "/usr/share/fonts/liberation-mono/LiberationMono-Regular.ttf",
-    nullptr};
+using Clock = std::chrono::steady_clock;
+using tide::app::TerminalWindow;
 
-} // anonymous namespace
+// Configuration constants
+constexpr size_t DEFAULT_HISTORY_BUDGET_MB = 256;
+constexpr size_t PARSE_SLICE = 64 * 1024; // Bytes parsed between clock checks
+
+// Resident memory of the process, in KB
+size_t resident_kb() {
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0;
+  size_t resident = 0;
+  statm >> pages >> resident;
+  return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / 1024;
+}
 
-int main(int argc, char *argv[]) {
-  (void)argc;
-  (void)argv;
+// --server: the server run() is serving, for the signal handlers
+tide::core::TerminalServer *running_server = nullptr;
 
-  std::cout << "tide - Terminal Emulator v0.1.0" << std::endl;
-  std::cout << "================================" << std::endl;
+void stop_server(int) {
+  if (running_server) {
+    running_server->stop();
+  }
+}
 
-  // Initialize theme
-  tide::theme::Theme theme = tide::theme::get_default_theme();
-  std::cout << "[tide] Using theme: " << theme.name << std::endl;
+// A handler rather than SIG_IGN, which the shells would inherit
+void ignore_hangup(int) {}
 
-  // Create window
-  tide::platform::linux::Window window;
-  if (!window.create(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, "tide")) {
-    std::cerr << "[tide] Failed to create window" << std::endl;
-    return 1;
+// --server: keep sessions alive without a window until the last one exits
+int run_server(const std::string &path, bool io_uring,
+               const tide::theme::Theme &theme,
+               const tide::app::WindowOptions &options) {
+  tide::core::TerminalServer server;
+  if (io_uring && !server.sessions().use_io_uring()) {
+    std::cerr << "[tide] io_uring unavailable, using epoll" << std::endl;
   }
-
-  // Initialize font system
-  tide::render::Font font;
-  if (!font.init()) {
-    std::cerr << "[tide] Failed to initialize font system" << std::endl;
+  server.set_session_setup([&](tide::core::Session &session) {
+    tide::app::configure_terminal(session.terminal(), theme, options);
+  });
+  if (!server.listen(path)) {
     return 1;
   }
 
-  // Try to load a font
-  bool font_loaded = false;
-  for (int i = 0; FONT_PATHS[i] != nullptr; ++i) {
-    if (font.load(FONT_PATHS[i], DEFAULT_FONT_SIZE)) {
-      font_loaded = true;
-      break;
+  // Survive the terminal we were started from going away
+  running_server = &server;
+  std::signal(SIGINT, stop_server);
+  std::signal(SIGTERM, stop_server);
+  std::signal(SIGHUP, ignore_hangup);
+  std::cout << "[tide] Server listening on " << path << std::endl;
+  server.run();
+  running_server = nullptr;
+
+  tide::core::TerminalServer::Stats stats = server.stats();
+  std::cout << "[tide] Server parsed " << stats.output_bytes
+            << " bytes, sent " << stats.frames << " frames ("
+            << stats.frame_bytes << " bytes)" << std::endl;
+  return 0;
+}
+
+// --attach: a session of a running server. The server parses; we only
+// have its screen, so there is no local history to scroll or select.
+class AttachedSource : public tide::app::ViewSource {
+public:
+  explicit AttachedSource(tide::core::RemoteSession &remote)
+      : remote_(remote) {}
+
+  size_t poll() override {
+    remote_.flush();
+    uint64_t before = remote_.bytes_received();
+    if (!remote_.poll()) {
+      return 0;
+    }
+    return std::max<size_t>(remote_.bytes_received() - before, 1);
+  }
+  bool busy() const override { return remote_.input_pending(); }
+  bool finished() const override { return remote_.finished(); }
+  tide::core::Terminal *terminal() override { return nullptr; }
+
+  bool view(tide::core::ScreenView &out, int &cursor_col,
+            int &cursor_row) override {
+    // Nothing to draw until the snapshot arrives
+    const tide::core::RemoteScreen &screen = remote_.screen();
+    if (screen.rows() == 0) {
+      return false;
     }
+    screen.view(out);
+    cursor_col = screen.cursor_col();
+    cursor_row = screen.cursor_row();
+    return true;
   }
 
-  if (!font_loaded) {
-    std::cerr
-        << "[tide] Failed to load any font! Please install a monospace font."
-        << std::endl;
-    std::cerr << "[tide] Try: sudo apt install fonts-dejavu-core" << std::endl;
-    return 1;
+  void write(std::string_view data) override { remote_.write(data); }
+  void paste(std::string_view text) override { remote_.paste(text); }
+  void resize(int cols, int rows) override {
+    remote_.resize(cols, rows); // A full frame at the new size follows
   }
 
-  // Initialize renderer with font
-  tide::render::Renderer renderer;
-  if (!renderer.init(&font)) {
-    std::cerr << "[tide] Failed to initialize renderer" << std::endl;
+private:
+  tide::core::RemoteSession &remote_;
+};
+
+// --attach: show a session of a running server in a window; closing the
+// window detaches and leaves the session running
+int run_attached(const std::string &path, uint32_t id,
+                 const tide::theme::Theme &theme,
+                 const tide::app::WindowOptions &options) {
+  std::signal(SIGPIPE, SIG_IGN); // Writes to a vanished server fail instead
+
+  // The window outlives the session: its reader posts to the window
+  // until disconnected
+  tide::app::ViewWindow window(theme, options);
+  tide::core::RemoteSession remote;
+  if (!window.open()) {
     return 1;
   }
-  renderer.resize(window.width(), window.height());
-  renderer.set_theme(theme);
-
-  // Calculate grid size from window and font
-  int cols = renderer.grid_cols();
-  int rows = renderer.grid_rows();
-  std::cout << "[tide] Grid size: " << cols << "x" << rows << std::endl;
-
-  // Create terminal
-  tide::core::Terminal terminal(cols, rows);
-  terminal.set_theme(theme);
-
-  // Spawn PTY with shell
-  tide::core::Pty pty;
-  if (!pty.spawn()) {
-    std::cerr << "[tide] Failed to spawn PTY" << std::endl;
+  if (!remote.connect(path, id, window.cols(), window.rows(),
+                      tide::platform::linux::Window::post_empty_event)) {
+    std::cerr << "[tide] Is a server running? Start one with tide --server"
+              << std::endl;
     return 1;
   }
 
-  // Set initial PTY size
-  pty.resize(cols, rows);
+  AttachedSource source(remote);
+  window.run(source);
 
-  // Set up window callbacks
-  window.set_resize_callback([&](int width, int height) {
-    renderer.resize(width, height);
+  if (!remote.finished()) {
+    if (remote.id() != 0) {
+      std::cout << "[tide] Detached from session " << remote.id()
+                << std::endl;
+    }
+  } else if (std::optional<int> status = remote.exit_status()) {
+    std::cout << "[tide] Session " << remote.id() << " exited with status "
+              << *status << std::endl;
+  } else if (remote.id() == 0) {
+    std::cerr << "[tide] No session " << id << " on the server" << std::endl;
+  } else {
+    std::cerr << "[tide] Server closed the connection" << std::endl;
+  }
+  remote.disconnect();
+  return 0;
+}
 
-    // Recalculate grid dimensions
-    int new_cols = renderer.grid_cols();
-    int new_rows = renderer.grid_rows();
+// --tmux: each tmux pane is a tab with a terminal of its own. Switching
+// panes is local; tmux only hears about it.
+class TmuxSource : public tide::app::ViewSource {
+public:
+  explicit TmuxSource(tide::core::TmuxControl &tmux) : tmux_(tmux) {}
+
+  size_t poll() override {
+    tmux_.flush();
+    uint64_t before = tmux_.stats().control_bytes;
+    size_t bytes = 0;
+    if (tmux_.poll()) {
+      bytes = std::max<size_t>(tmux_.stats().control_bytes - before, 1);
+    }
+    // Panes keep their own history, within the process-wide budget
+    tide::core::HistoryBudget::instance().enforce();
+    if (tmux_.finished()) {
+      return bytes;
+    }
 
-    if (new_cols != terminal.cols() || new_rows != terminal.rows()) {
-      terminal.resize(new_cols, new_rows);
-      pty.resize(new_cols, new_rows);
-      std::cout << "[tide] Resized to: " << new_cols << "x" << new_rows
-                << std::endl;
+    // Follow tmux's current pane (a split, a new window, a select typed
+    // in a pane), and move off panes that closed
+    int active = tmux_.active_pane();
+    if (active != followed_ && tmux_.find_pane(active)) {
+      followed_ = active;
+      show(active);
+    } else if (!terminal() && tmux_.pane_count() > 0) {
+      show(tmux_.find_pane(active) ? active : tmux_.pane(0).id);
     }
-  });
+    return bytes;
+  }
+  bool busy() const override {
+    return tmux_.input_pending() || tmux_.output_pending();
+  }
+  bool finished() const override { return tmux_.finished(); }
 
-  // Mouse state for selection
-  bool mouse_selecting = false;
-  double last_mouse_x = 0, last_mouse_y = 0;
+  tide::core::Terminal *terminal() override {
+    tide::core::TmuxControl::Pane *pane = tmux_.find_pane(shown_);
+    return pane ? &pane->terminal : nullptr;
+  }
 
-  // Helper to convert mouse coords to cell position
-  auto mouse_to_cell = [&](double x, double y, int &col, int &row) {
-    col = static_cast<int>(x) / font.cell_width();
-    row = static_cast<int>(y) / font.cell_height();
-    col = std::clamp(col, 0, terminal.cols() - 1);
-    row = std::clamp(row, 0, terminal.rows() - 1);
-  };
+  bool view(tide::core::ScreenView &out, int &cursor_col,
+            int &cursor_row) override {
+    // Nothing to draw until tmux reports a pane
+    tide::core::Terminal *shown = terminal();
+    if (!shown) {
+      return false;
+    }
+    shown->view(out);
+    cursor_col = shown->cursor_col();
+    cursor_row = shown->cursor_row();
+    return true;
+  }
 
-  // Set up mouse button callback for selection
-  window.mouse().set_button_callback([&](int button, int action, int mods) {
-    (void)mods;
-    if (button == 0) {   // Left button
-      if (action == 1) { // Press
-        int col, row;
-        mouse_to_cell(last_mouse_x, last_mouse_y, col, row);
-        terminal.start_selection(col, row);
-        mouse_selecting = true;
-      } else if (action == 0) { // Release
-        if (mouse_selecting && terminal.selection().active) {
-          // Copy to clipboard
-          std::string text = terminal.get_selected_text();
-          if (!text.empty()) {
-            glfwSetClipboardString(nullptr, text.c_str());
-          }
-        }
-        mouse_selecting = false;
+  void write(std::string_view data) override {
+    if (shown_ >= 0) {
+      tmux_.write(shown_, data);
+    }
+  }
+  void paste(std::string_view text) override {
+    if (shown_ >= 0) {
+      tmux_.paste(shown_, text);
+    }
+  }
+  void resize(int cols, int rows) override { tmux_.resize(cols, rows); }
+
+  bool shortcut(int key) override {
+    if (key == 'T') {
+      tmux_.command("new-window");
+      return true;
+    }
+    if (key == 'W') {
+      if (shown_ >= 0) {
+        tmux_.command("kill-pane -t %" + std::to_string(shown_));
       }
+      return true;
     }
-  });
+    if ((key == 262 /* Right */ || key == 263 /* Left */) &&
+        tmux_.pane_count() > 0) {
+      size_t count = tmux_.pane_count();
+      size_t step = key == 262 ? 1 : count - 1;
+      int id = tmux_.pane((tmux_.index_of(shown_) + step) % count).id;
+      show(id);
+      tmux_.select(id);
+      followed_ = id;
+      return true;
+    }
+    return false;
+  }
+
+  bool take_switched() override { return std::exchange(switched_, false); }
+
+private:
+  tide::core::TmuxControl &tmux_;
+  // The pane on screen (a tmux %id), and the one tmux last called current
+  int shown_ = -1;
+  int followed_ = -1;
+  bool switched_ = false;
 
-  // Set up mouse motion callback
-  window.mouse().set_move_callback([&](double x, double y) {
-    last_mouse_x = x;
-    last_mouse_y = y;
-    if (mouse_selecting) {
-      int col, row;
-      mouse_to_cell(x, y, col, row);
-      terminal.update_selection(col, row);
+  void show(int id) {
+    if (id == shown_) {
+      return;
     }
-  });
+    shown_ = id;
+    switched_ = true;
+    std::cout << "[tide] Pane %" << id << " (" << tmux_.index_of(id) + 1
+              << "/" << tmux_.pane_count() << ")" << std::endl;
+  }
+};
+
+// --tmux: tmux control mode in one window; closing the window detaches
+// from the tmux session
+int run_tmux(const std::vector<std::string> &args,
+             const tide::theme::Theme &theme,
+             const tide::app::WindowOptions &options) {
+  // The window outlives tmux: its reader posts to the window until
+  // stopped
+  tide::app::ViewWindow window(theme, options);
+  tide::core::TmuxControl tmux;
+  if (!window.open()) {
+    return 1;
+  }
 
-  // Set up mouse scroll for scrollback
-  window.mouse().set_scroll_callback([&](double xoffset, double yoffset) {
-    (void)xoffset;
-    int lines = static_cast<int>(yoffset * 3); // 3 lines per scroll step
-    terminal.scroll_view(lines);
+  tmux.set_pane_setup([&](tide::core::Terminal &terminal) {
+    tide::app::configure_terminal(terminal, theme, options);
   });
+  if (!tmux.start(window.cols(), window.rows(),
+                  tide::platform::linux::Window::post_empty_event, args)) {
+    std::cerr << "[tide] Failed to start tmux" << std::endl;
+    return 1;
+  }
+
+  TmuxSource source(tmux);
+  window.run(source);
+
+  if (tmux.finished()) {
+    std::cout << "[tide] tmux exited"
+              << (tmux.exit_reason().empty() ? "" : ": ")
+              << tmux.exit_reason() << std::endl;
+  } else {
+    std::cout << "[tide] Detached from tmux" << std::endl;
+  }
+  tide::core::TmuxControl::Stats stats = tmux.stats();
+  std::cout << "[tide] tmux sent " << stats.control_bytes << " bytes ("
+            << stats.output_bytes << " of pane output, "
+            << stats.capture_bytes << " of captures)" << std::endl;
+  tmux.stop();
+  return 0;
+}
 
-  // Set up keyboard input - forward to PTY
-  window.keyboard().set_char_callback([&](unsigned int codepoint) {
-    terminal.scroll_to_bottom(); // Auto-scroll on input
-    if (codepoint < 128) {
-      char c = static_cast<char>(codepoint);
-      pty.write(&c, 1);
+// Run windows until the last one closes. With an instance path, later
+// launches ask this process for their windows (single-instance mode).
+int run_windows(const tide::app::WindowOptions &options,
+                const tide::theme::Theme &theme,
+                const tide::core::LinkDetector &links, bool io_uring,
+                const std::string &instance_path, Clock::time_point launched) {
+  // Every window's tabs are sessions of one manager: their output is
+  // parsed in parallel on one worker pool
+  tide::core::SessionManager sessions;
+  sessions.set_notify(tide::platform::linux::Window::post_empty_event);
+  if (io_uring && !sessions.use_io_uring()) {
+    std::cerr << "[tide] io_uring unavailable, using epoll" << std::endl;
+  }
+
+  // Loaded by the first window; the others share its atlas
+  tide::render::Font font;
+  std::vector<std::unique_ptr<TerminalWindow>> windows;
+  tide::core::InstanceServer instance;
+
+  // A launch waiting for the first frame of the window it asked for
+  struct PendingLaunch {
+    tide::core::InstanceServer::Request request;
+    const TerminalWindow *window;
+    size_t resident_before; // KB
+  };
+  std::vector<PendingLaunch> launches;
+
+  // New windows share GL objects with the first one still open; a launch's
+  // window starts its shells where the launch ran
+  auto open_window =
+      [&](tide::core::SpawnContext context = {}) -> TerminalWindow * {
+    auto window = std::make_unique<TerminalWindow>(sessions, font, theme,
+                                                   options, links);
+    if (!window->open(windows.empty() ? nullptr : windows.front().get(),
+                      std::move(context))) {
+      if (windows.empty()) {
+        window->window().make_current();
+        font.shutdown();
+      }
+      return nullptr;
     }
-    // TODO: Handle UTF-8 encoding for non-ASCII
-  });
+    windows.push_back(std::move(window));
+    return windows.back().get();
+  };
 
-  window.keyboard().set_key_callback(
-      [&](int key, int scancode, int action, int mods) {
-        (void)scancode;
-
-        if (action != 1 /* GLFW_PRESS */ && action != 2 /* GLFW_REPEAT */) {
-          return;
-        }
-
-        // Ctrl+C, Ctrl+D, etc.
-        if (mods & 0x0002 /* GLFW_MOD_CONTROL */) {
-          if (key >= 'A' && key <= 'Z') {
-            char ctrl_char = static_cast<char>(key - 'A' + 1);
-            pty.write(&ctrl_char, 1);
-            return;
-          }
-        }
-
-        // Arrow keys - send ANSI escape sequences
-        const char *seq = nullptr;
-        switch (key) {
-        case 262:
-          seq = "\x1b[C";
-          break; // Right
-        case 263:
-          seq = "\x1b[D";
-          break; // Left
-        case 264:
-          seq = "\x1b[B";
-          break; // Down
-        case 265:
-          seq = "\x1b[A";
-          break; // Up
-        case 268:
-          seq = "\x1b[H";
-          break; // Home
-        case 269:
-          seq = "\x1b[F";
-          break; // End
-        case 266:
-          seq = "\x1b[5~";
-          break; // Page Up
-        case 267:
-          seq = "\x1b[6~";
-          break; // Page Down
-        case 261:
-          seq = "\x1b[3~";
-          break; // Delete
-        default:
-          break;
-        }
-
-        if (seq) {
-          pty.write(seq, strlen(seq));
-          return;
-        }
-
-        // Enter key
-        if (key == 257 /* GLFW_KEY_ENTER */) {
-          char newline = '\n';
-          pty.write(&newline, 1);
-          return;
-        }
-
-        // Backspace
-        if (key == 259 /* GLFW_KEY_BACKSPACE */) {
-          char backspace = '\x7f';
-          pty.write(&backspace, 1);
-          return;
-        }
-
-        // Tab
-        if (key == 258 /* GLFW_KEY_TAB */) {
-          char tab = '\t';
-          pty.write(&tab, 1);
-          return;
-        }
-
-        // Escape
-        if (key == 256 /* GLFW_KEY_ESCAPE */) {
-          char esc = '\x1b';
-          pty.write(&esc, 1);
-          return;
-        }
-        terminal.scroll_to_bottom(); // Auto-scroll on key input
-      });
-
-  // PTY read buffer
-  char pty_buffer[PTY_READ_BUFFER_SIZE];
-
-  // Cursor blink state
-  auto last_blink_time = std::chrono::steady_clock::now();
-  bool cursor_visible = true;
-  constexpr auto BLINK_INTERVAL = std::chrono::milliseconds(500);
+  // The last window takes the shared GL objects with it, so the font goes
+  // while its context is still there (and launches stop posting to GLFW)
+  auto close_window = [&](size_t index) {
+    const TerminalWindow *window = windows[index].get();
+    for (size_t i = launches.size(); i-- > 0;) {
+      if (launches[i].window == window) {
+        tide::core::InstanceServer::drop(launches[i].request);
+        launches.erase(launches.begin() + static_cast<ptrdiff_t>(i));
+      }
+    }
+    if (windows.size() == 1) {
+      instance.close();
+      windows[index]->window().make_current();
+      font.shutdown();
+    }
+    windows.erase(windows.begin() + static_cast<ptrdiff_t>(index));
+  };
+
+  if (!open_window()) {
+    return 1;
+  }
+  std::cout << "[tide] Parsing on " << sessions.concurrency() << " threads"
+            << std::endl;
+  if (!instance_path.empty() &&
+      instance.listen(instance_path,
+                      tide::platform::linux::Window::post_empty_event)) {
+    std::cout << "[tide] Opening windows for launches on " << instance_path
+              << std::endl;
+  }
+  bool startup_reported = false;
 
   std::cout << "[tide] Entering main loop..." << std::endl;
 
   // Main event loop
-  while (!window.should_close()) {
-    // Poll window events
-    window.poll_events();
-
-    // Read from PTY (non-blocking)
-    ssize_t bytes_read = pty.read(pty_buffer, PTY_READ_BUFFER_SIZE);
-    if (bytes_read > 0) {
-      // Feed data to terminal (parses ANSI and updates grid)
-      terminal.feed(pty_buffer, static_cast<size_t>(bytes_read));
-      // Reset cursor blink on output
-      cursor_visible = true;
-      last_blink_time = std::chrono::steady_clock::now();
-    } else if (bytes_read < 0) {
-      // PTY closed or error
-      std::cout << "[tide] PTY closed, exiting..." << std::endl;
-      break;
+  while (!windows.empty()) {
+    // Sleep until input, PTY output or writability (the readers post an
+    // empty event), a launch, or what the windows wait for; don't sleep
+    // with output left unparsed or an unblocked write pending
+    auto now = Clock::now();
+    auto wake = windows.front()->wake_time(now);
+    for (const auto &window : windows) {
+      wake = std::min(wake, window->wake_time(now));
     }
-
-    // Update cursor blink
-    auto now = std::chrono::steady_clock::now();
-    if (now - last_blink_time >= BLINK_INTERVAL) {
-      cursor_visible = !cursor_visible;
-      last_blink_time = now;
+    if (sessions.output_pending() || sessions.input_pending()) {
+      wake = now;
+    }
+    tide::platform::linux::Window::wait_events(
+        std::chrono::duration<double>(wake - now).count());
+
+    // Windows for launches and for Ctrl+Shift+N
+    tide::core::InstanceServer::Request request;
+    while (instance.take(request)) {
+      size_t resident_before = resident_kb();
+      if (TerminalWindow *window = open_window(std::move(request.context))) {
+        launches.push_back({request, window, resident_before});
+      } else {
+        tide::core::InstanceServer::drop(request);
+      }
+    }
+    for (size_t i = 0, count = windows.size(); i < count; ++i) {
+      if (windows[i]->take_new_window_request()) {
+        open_window();
+      }
     }
 
-    // Hide cursor if scrolled into history
-    bool show_cursor = cursor_visible && !terminal.is_scrolled();
+    // Send this iteration's input in as few writes as possible
+    sessions.flush_input();
 
-    // Set selection check for highlighting
-    renderer.set_selection_check(
-        [&](int col, int row) { return terminal.is_selected(col, row); });
+    // Parse what the readers have buffered (parses ANSI, updates grids) in
+    // rounds of one slice per session, in parallel, until some window
+    // wants a frame or has an echo ready to show
+    now = Clock::now();
+    auto parse_deadline = windows.front()->parse_deadline(now);
+    for (const auto &window : windows) {
+      parse_deadline = std::min(parse_deadline, window->parse_deadline(now));
+    }
+    while (true) {
+      auto round_start = Clock::now();
+      bool more = sessions.parse(PARSE_SLICE);
+      now = Clock::now();
+      bool echo_ready = false;
+      for (const auto &window : windows) {
+        window->on_output(now - round_start, now);
+        echo_ready = echo_ready || window->echo_ready();
+      }
+      if (!more || now >= parse_deadline || echo_ready) {
+        break;
+      }
+    }
 
-    // Render frame with cursor
-    renderer.render(terminal.grid(), theme, terminal.cursor_col(),
-                    terminal.cursor_row(), show_cursor);
+    // Keep history within the process-wide memory budget
+    tide::core::HistoryBudget::instance().enforce();
 
-    // Swap buffers
-    window.swap_buffers();
+    // Close finished tabs and draw
+    for (size_t i = windows.size(); i-- > 0;) {
+      if (!windows[i]->update()) {
+        close_window(i);
+      }
+    }
+
+    // Tell launches their windows are up, with what they cost
+    now = Clock::now();
+    if (!startup_reported && !windows.empty() && windows.front()->presented()) {
+      std::cout << "[tide] First frame "
+                << std::chrono::duration<double, std::milli>(now - launched)
+                       .count()
+                << " ms after launch" << std::endl;
+      startup_reported = true;
+    }
+    for (size_t i = launches.size(); i-- > 0;) {
+      if (!launches[i].window->presented()) {
+        continue;
+      }
+      size_t resident = resident_kb();
+      tide::core::InstanceServer::WindowOpened opened;
+      opened.open_us = static_cast<uint32_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              now - launches[i].request.received)
+              .count());
+      opened.memory_kb = static_cast<uint32_t>(
+          resident > launches[i].resident_before
+              ? resident - launches[i].resident_before
+              : 0);
+      std::cout << "[tide] Window " << windows.size() << " opened in "
+                << static_cast<double>(opened.open_us) / 1000.0 << " ms, "
+                << opened.memory_kb << " KB" << std::endl;
+      tide::core::InstanceServer::reply(launches[i].request, opened);
+      launches.erase(launches.begin() + static_cast<ptrdiff_t>(i));
+    }
   }
 
-  // Cleanup
   std::cout << "[tide] Shutting down..." << std::endl;
-  pty.close();
-  renderer.shutdown();
-  font.shutdown();
-  window.destroy();
-
   return 0;
 }
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  auto launched = Clock::now();
+  // Before any thread starts, so every thread inherits it
+  tide::core::ChildReaper::block_child_signal();
+  tide::app::WindowOptions options;
+  bool io_uring = false;
+  bool server = false;
+  bool attach = false;
+  bool single_instance = false;
+  bool tmux = false;
+  std::vector<std::string> tmux_args;
+  uint32_t attach_id = tide::core::ATTACH_LATEST;
+  std::string socket_path;
+  size_t history_budget_mb = DEFAULT_HISTORY_BUDGET_MB;
+  tide::core::LinkDetector links;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--unlimited-scrollback") == 0) {
+      options.unlimited_scrollback = true;
+    } else if (std::strcmp(argv[i], "--replay-history") == 0) {
+      options.replay_history = true;
+    } else if (std::strcmp(argv[i], "--frame-stats") == 0) {
+      options.frame_stats = true;
+    } else if (std::strcmp(argv[i], "--predictive-echo") == 0) {
+      options.predictive_echo = true;
+    } else if (std::strcmp(argv[i], "--io-uring") == 0) {
+      io_uring = true;
+    } else if (std::strcmp(argv[i], "--single-instance") == 0) {
+      single_instance = true;
+    } else if (std::strcmp(argv[i], "--server") == 0) {
+      server = true;
+    } else if (std::strcmp(argv[i], "--attach") == 0) {
+      attach = true;
+      if (i + 1 < argc && std::strcmp(argv[i + 1], "new") == 0) {
+        attach_id = tide::core::ATTACH_NEW;
+        ++i;
+      } else if (i + 1 < argc && argv[i + 1][0] >= '1' &&
+                 argv[i + 1][0] <= '9') {
+        attach_id =
+            static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+      }
+    } else if (std::strcmp(argv[i], "--tmux") == 0) {
+      // The rest is tmux's: a session to attach, or a command to start
+      tmux = true;
+      tmux_args.assign(argv + i + 1, argv + argc);
+      break;
+    } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--history-budget") == 0 && i + 1 < argc) {
+      history_budget_mb = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--link-pattern") == 0 && i + 1 < argc) {
+      if (!links.add_pattern(argv[++i])) {
+        return 1;
+      }
+    } else {
+      std::cerr << "[tide] Unknown option: " << argv[i] << std::endl;
+      std::cerr << "Usage: tide [--unlimited-scrollback] [--replay-history] "
+                   "[--frame-stats] [--predictive-echo] [--io-uring] "
+                   "[--history-budget MB] [--link-pattern REGEX]... "
+                   "[--single-instance | --server | --attach [ID|new]] "
+                   "[--socket PATH] [--tmux [TMUX ARGS]]"
+                << std::endl;
+      return 1;
+    }
+  }
+  single_instance = single_instance && !server && !attach && !tmux;
+  if (socket_path.empty()) {
+    socket_path =
+        tide::core::default_socket_path(single_instance ? "tide-instance"
+                                                        : "tide");
+  }
+
+  // --single-instance: a running tide opens our window, with its fonts
+  // and GL objects already loaded
+  if (single_instance) {
+    tide::core::InstanceServer::WindowOpened opened;
+    if (tide::core::InstanceServer::request_window(socket_path, opened)) {
+      using Ms = std::chrono::duration<double, std::milli>;
+      std::printf("[tide] Window opened by the running tide: first frame "
+                  "after %.2f ms, %u KB more memory (%.2f ms round trip)\n",
+                  static_cast<double>(opened.open_us) / 1000.0,
+                  opened.memory_kb, Ms(Clock::now() - launched).count());
+      return 0;
+    }
+  }
+
+  // Cap history memory across every terminal in the process (0 = no cap)
+  tide::core::HistoryBudget::instance().set_limit(history_budget_mb * 1024 *
+                                                  1024);
+
+  std::cout << "tide - Terminal Emulator v0.1.0" << std::endl;
+  std::cout << "================================" << std::endl;
+
+  // Initialize theme
+  tide::theme::Theme theme = tide::theme::get_default_theme();
+  std::cout << "[tide] Using theme: " << theme.name << std::endl;
+
+  if (server) {
+    return run_server(socket_path, io_uring, theme, options);
+  }
+  if (attach) {
+    return run_attached(socket_path, attach_id, theme, options);
+  }
+  if (tmux) {
+    if (tmux_args.empty()) {
+      tmux_args = {"new-session", "-A", "-s", "tide"};
+    }
+    return run_tmux(tmux_args, theme, options);
+  }
+  return run_windows(options, theme, links, io_uring,
+                     single_instance ? socket_path : std::string(), launched);
+}
@@ -0,0 +1,653 @@
+#include "app/terminal_window.hpp"
+
+#include "core/search.hpp"
+#include "core/terminal.hpp"
+#include "core/text_export.hpp"
+#include "platform/linux/launcher.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+
+namespace tide::app {
+
+namespace {
+
+// Configuration constants
+constexpr int DEFAULT_WINDOW_WIDTH = 900;
+constexpr int DEFAULT_WINDOW_HEIGHT = 600;
+constexpr const char *DEFAULT_WINDOW_TITLE = "tide";
+constexpr int DEFAULT_FONT_SIZE = 16;
+constexpr size_t SCROLLBACK_RESIDENT_LIMIT = 64 * 1024 * 1024;
+constexpr auto LINK_SCAN_BUDGET = std::chrono::milliseconds(2); // Per frame
+
+// Common font paths to try
+const char *FONT_PATHS[] = {
+    "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+    "/usr/share/fonts/truetype/liberation/LiberationMono-Regular.ttf",
+    "/usr/share/fonts/truetype/ubuntu/UbuntuMono-R.ttf",
+    "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+    "/usr/share/fonts/liberation-mono/LiberationMono-Regular.ttf",
+    nullptr};
+
+void print_echo_stats(const core::PredictiveEcho::Stats &stats,
+                      std::chrono::steady_clock::duration echo_time) {
+  std::printf("[tide] Predicted %llu keys: %llu confirmed, %llu rolled back "
+              "| echo time %.1f ms\n",
+              static_cast<unsigned long long>(stats.predicted),
+              static_cast<unsigned long long>(stats.confirmed),
+              static_cast<unsigned long long>(stats.rolled_back),
+              std::chrono::duration<double, std::milli>(echo_time).count());
+}
+
+} // anonymous namespace
+
+void print_frame_stats(const core::FrameScheduler::Stats &stats,
+                       std::chrono::steady_clock::duration period) {
+  using Ms = std::chrono::duration<double, std::milli>;
+  auto per = [](std::chrono::steady_clock::duration total, uint64_t count) {
+    return count == 0 ? 0.0 : Ms(total).count() / static_cast<double>(count);
+  };
+  std::printf("[tide] %llu frames (%llu held) | per frame: parse %.2f ms, "
+              "render %.2f ms, present %.2f ms | echo latency avg %.2f ms, "
+              "max %.2f ms | %.1f MB/s\n",
+              static_cast<unsigned long long>(stats.frames),
+              static_cast<unsigned long long>(stats.held),
+              per(stats.parse, stats.frames), per(stats.render, stats.frames),
+              per(stats.present, stats.frames),
+              per(stats.latency, stats.echoes), Ms(stats.max_latency).count(),
+              static_cast<double>(stats.bytes) / 1e6 /
+                  std::chrono::duration<double>(period).count());
+}
+
+const char *key_sequence(int key) {
+  switch (key) {
+  case 262:
+    return "\x1b[C"; // Right
+  case 263:
+    return "\x1b[D"; // Left
+  case 264:
+    return "\x1b[B"; // Down
+  case 265:
+    return "\x1b[A"; // Up
+  case 268:
+    return "\x1b[H"; // Home
+  case 269:
+    return "\x1b[F"; // End
+  case 266:
+    return "\x1b[5~"; // Page Up
+  case 267:
+    return "\x1b[6~"; // Page Down
+  case 261:
+    return "\x1b[3~"; // Delete
+  case 257:
+    return "\n"; // Enter
+  case 259:
+    return "\x7f"; // Backspace
+  case 258:
+    return "\t"; // Tab
+  case 256:
+    return "\x1b"; // Escape
+  default:
+    return nullptr;
+  }
+}
+
+void scroll_view(core::Terminal &terminal, float &scroll_pixels, double steps,
+                 int cell_height) {
+  auto cell_h = static_cast<float>(cell_height);
+  scroll_pixels += static_cast<float>(steps * 3) * cell_h;
+  int lines = static_cast<int>(std::floor(scroll_pixels / cell_h));
+  scroll_pixels -= static_cast<float>(lines) * cell_h;
+
+  int expected = terminal.scroll_offset() + lines;
+  terminal.scroll_view(lines);
+  if (terminal.scroll_offset() != expected ||
+      terminal.scroll_offset() == terminal.max_scroll()) {
+    scroll_pixels = 0.0f; // Hit either end: nothing left to reveal
+  }
+}
+
+void cell_at(const core::Terminal &terminal, const render::Font &font,
+             float scroll_pixels, double x, double y, int &col, int &row) {
+  col = static_cast<int>(x) / font.cell_width();
+  row = static_cast<int>(std::floor((y - scroll_pixels) / font.cell_height()));
+  col = std::clamp(col, 0, terminal.cols() - 1);
+  row = std::clamp(row, 0, terminal.rows() - 1);
+}
+
+void show_title(platform::linux::Window &window, std::string &shown,
+                const core::Terminal *terminal) {
+  const char *title = terminal && !terminal->title().empty()
+                          ? terminal->title().c_str()
+                          : DEFAULT_WINDOW_TITLE;
+  if (shown != title) {
+    shown = title;
+    window.set_title(shown);
+  }
+}
+
+void configure_terminal(core::Terminal &terminal, const theme::Theme &theme,
+                        const WindowOptions &options) {
+  terminal.set_theme(theme);
+  if (options.unlimited_scrollback &&
+      !terminal.set_unlimited_scrollback(SCROLLBACK_RESIDENT_LIMIT)) {
+    std::cerr << "[tide] Unlimited scrollback unavailable, using default limit"
+              << std::endl;
+  }
+  if (options.replay_history) {
+    terminal.set_history_mode(core::HistoryMode::Replay);
+  }
+}
+
+bool init_graphics(platform::linux::Window &window, render::Font &font,
+                   render::Renderer &renderer, const theme::Theme &theme,
+                   const platform::linux::Window *share,
+                   const render::Renderer *share_renderer) {
+  // Create window
+  if (!window.create(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT,
+                     DEFAULT_WINDOW_TITLE, share)) {
+    std::cerr << "[tide] Failed to create window" << std::endl;
+    return false;
+  }
+
+  // The first window loads the font; later ones share its atlas
+  if (!font.is_loaded()) {
+    // Initialize font system
+    if (!font.init()) {
+      std::cerr << "[tide] Failed to initialize font system" << std::endl;
+      return false;
+    }
+
+    // Try to load a font
+    bool font_loaded = false;
+    for (int i = 0; FONT_PATHS[i] != nullptr; ++i) {
+      if (font.load(FONT_PATHS[i], DEFAULT_FONT_SIZE)) {
+        font_loaded = true;
+        break;
+      }
+    }
+
+    if (!font_loaded) {
+      std::cerr
+          << "[tide] Failed to load any font! Please install a monospace font."
+          << std::endl;
+      std::cerr << "[tide] Try: sudo apt install fonts-dejavu-core"
+                << std::endl;
+      return false;
+    }
+  }
+
+  // Initialize renderer with font
+  if (!renderer.init(&font, share_renderer)) {
+    std::cerr << "[tide] Failed to initialize renderer" << std::endl;
+    return false;
+  }
+  renderer.resize(window.width(), window.height());
+  renderer.set_theme(theme);
+  return true;
+}
+
+TerminalWindow::TerminalWindow(core::SessionManager &sessions,
+                               render::Font &font, const theme::Theme &theme,
+                               const WindowOptions &options,
+                               const core::LinkDetector &links)
+    : sessions_(sessions), font_(font), theme_(theme), options_(options),
+      links_(links) {}
+
+bool TerminalWindow::open(const TerminalWindow *share,
+                          core::SpawnContext context) {
+  if (!init_graphics(window_, font_, renderer_, theme_,
+                     share ? &share->window_ : nullptr,
+                     share ? &share->renderer_ : nullptr)) {
+    return false;
+  }
+
+  // Calculate grid size from window and font
+  int cols = renderer_.grid_cols();
+  int rows = renderer_.grid_rows();
+  std::cout << "[tide] Grid size: " << cols << "x" << rows << std::endl;
+
+  context_ = std::move(context);
+  active_ = open_session(cols, rows);
+  if (!active_) {
+    std::cerr << "[tide] Failed to spawn PTY" << std::endl;
+    return false;
+  }
+
+  install_callbacks();
+  last_blink_time_ = Clock::now();
+  last_stats_time_ = last_blink_time_;
+  return true;
+}
+
+void TerminalWindow::close() {
+  // Readers post to the windows until stopped
+  for (core::Session *session : tabs_) {
+    sessions_.close(session);
+  }
+  tabs_.clear();
+  active_ = nullptr;
+  window_.make_current();
+  renderer_.shutdown();
+  window_.destroy();
+}
+
+core::Session *TerminalWindow::open_session(int cols, int rows) {
+  core::Session *session = sessions_.create(cols, rows, {}, context_);
+  if (!session) {
+    return nullptr;
+  }
+  configure_terminal(session->terminal(), theme_, options_);
+  tabs_.push_back(session);
+  return session;
+}
+
+void TerminalWindow::show_session(core::Session *session) {
+  if (active_ && session != active_) {
+    active_->terminal().set_active(false);
+  }
+  active_ = session;
+  active_->terminal().set_active(focused_);
+  echo_.reset(); // Predictions were for the other tab
+  renderer_.invalidate(); // Row keys from another terminal mean nothing
+  links_.clear();
+  mouse_selecting_ = false;
+  scroll_pixels_ = 0.0f;
+  needs_redraw_ = true;
+  std::cout << "[tide] Tab " << tab_index(active_) + 1 << "/" << tabs_.size()
+            << std::endl;
+}
+
+void TerminalWindow::close_session(core::Session *session) {
+  // Closing the last tab closes the window instead
+  if (tabs_.size() == 1) {
+    window_.request_close();
+    return;
+  }
+  size_t index = tab_index(session);
+  bool was_active = session == active_;
+  if (was_active) {
+    active_ = nullptr; // Freed below
+  }
+  tabs_.erase(tabs_.begin() + static_cast<ptrdiff_t>(index));
+  sessions_.close(session);
+  if (was_active) {
+    show_session(tabs_[std::min(index, tabs_.size() - 1)]);
+  }
+}
+
+size_t TerminalWindow::tab_index(const core::Session *session) const {
+  return static_cast<size_t>(std::find(tabs_.begin(), tabs_.end(), session) -
+                             tabs_.begin());
+}
+
+void TerminalWindow::send_input(const char *data, size_t size) {
+  // Typed input: the frame waits for the child's echo, unless the view
+  // has to jump back to the live screen first, or the echo is predicted
+  auto now = Clock::now();
+  if (options_.predictive_echo &&
+      echo_.on_input(active_->terminal(), data, size, now)) {
+    needs_redraw_ = true;
+  }
+  active_->writer().write(data, size);
+  scheduler_.on_input(now);
+}
+
+void TerminalWindow::snap_to_bottom() {
+  if (active_->terminal().is_scrolled() || scroll_pixels_ != 0.0f) {
+    active_->terminal().scroll_to_bottom();
+    scroll_pixels_ = 0.0f;
+    needs_redraw_ = true;
+  }
+}
+
+void TerminalWindow::install_callbacks() {
+  window_.set_resize_callback([this](int width, int height) {
+    renderer_.resize(width, height);
+    needs_redraw_ = true;
+
+    // Recalculate grid dimensions
+    int new_cols = renderer_.grid_cols();
+    int new_rows = renderer_.grid_rows();
+
+    if (new_cols != active_->terminal().cols() ||
+        new_rows != active_->terminal().rows()) {
+      for (core::Session *session : tabs_) {
+        session->resize(new_cols, new_rows);
+      }
+      std::cout << "[tide] Resized to: " << new_cols << "x" << new_rows
+                << std::endl;
+    }
+  });
+
+  // Unfocused and background terminals give up history memory first
+  window_.set_focus_callback([this](bool focused) {
+    focused_ = focused;
+    active_->terminal().set_active(focused);
+  });
+  window_.set_refresh_callback([this] { needs_redraw_ = true; });
+
+  // Set up mouse button callback for selection
+  window_.mouse().set_button_callback([this](int button, int action, int mods) {
+    if (button == 0) {   // Left button
+      if (action == 1) { // Press
+        int col, row;
+        cell_at(active_->terminal(), font_, scroll_pixels_, last_mouse_x_,
+                last_mouse_y_, col, row);
+
+        // Ctrl+click opens a link
+        if (mods & 0x0002 /* GLFW_MOD_CONTROL */) {
+          if (const core::Link *link =
+                  links_.link_at(active_->terminal(), col, row)) {
+            platform::linux::open_external(link->target);
+            return;
+          }
+        }
+
+        active_->terminal().start_selection(col, row);
+        mouse_selecting_ = true;
+        needs_redraw_ = true;
+      } else if (action == 0) { // Release
+        if (mouse_selecting_ && active_->terminal().selection().active) {
+          // Copy to clipboard
+          std::string text = active_->terminal().get_selected_text();
+          if (!text.empty()) {
+            glfwSetClipboardString(nullptr, text.c_str());
+          }
+        }
+        mouse_selecting_ = false;
+      }
+    }
+  });
+
+  // Set up mouse motion callback
+  window_.mouse().set_move_callback([this](double x, double y) {
+    last_mouse_x_ = x;
+    last_mouse_y_ = y;
+    if (mouse_selecting_) {
+      int col, row;
+      cell_at(active_->terminal(), font_, scroll_pixels_, x, y, col, row);
+      active_->terminal().update_selection(col, row);
+      needs_redraw_ = true;
+    }
+  });
+
+  // Set up mouse scroll for scrollback
+  window_.mouse().set_scroll_callback([this](double xoffset, double yoffset) {
+    (void)xoffset;
+    scroll_view(active_->terminal(), scroll_pixels_, yoffset,
+                font_.cell_height());
+    needs_redraw_ = true;
+  });
+
+  // Set up keyboard input - forward to PTY
+  window_.keyboard().set_char_callback([this](unsigned int codepoint) {
+    snap_to_bottom(); // Auto-scroll on input
+    if (codepoint < 128) {
+      char c = static_cast<char>(codepoint);
+      send_input(&c, 1);
+    }
+    // TODO: Handle UTF-8 encoding for non-ASCII
+  });
+
+  window_.keyboard().set_key_callback(
+      [this](int key, int scancode, int action, int mods) {
+        (void)scancode;
+        on_key(key, action, mods);
+      });
+}
+
+void TerminalWindow::on_key(int key, int action, int mods) {
+  if (action != 1 /* GLFW_PRESS */ && action != 2 /* GLFW_REPEAT */) {
+    return;
+  }
+
+  // Ctrl+Shift: windows, tabs and shell integration shortcuts
+  if ((mods & 0x0003) == 0x0003 /* GLFW_MOD_CONTROL | GLFW_MOD_SHIFT */) {
+    if (key == 'N') {
+      new_window_requested_ = true; // Opened by the owner's loop
+      return;
+    }
+    if (key == 'T') {
+      if (core::Session *session = open_session(active_->terminal().cols(),
+                                                active_->terminal().rows())) {
+        show_session(session);
+      }
+      return;
+    }
+    if (key == 'W') {
+      close_session(active_);
+      return;
+    }
+    if (key == 262 /* Right */ || key == 263 /* Left */) {
+      size_t count = tabs_.size();
+      size_t step = key == 262 ? 1 : count - 1;
+      show_session(tabs_[(tab_index(active_) + step) % count]);
+      return;
+    }
+    if (key == 265 /* Up */ || key == 264 /* Down */) {
+      active_->terminal().jump_to_prompt(key == 265 ? -1 : 1);
+      scroll_pixels_ = 0.0f;
+      needs_redraw_ = true;
+      return;
+    }
+    if (key == 'F') {
+      find_selection();
+      return;
+    }
+    if (key == 'V') {
+      // Paste, streamed to the child as fast as it reads
+      if (const char *text = glfwGetClipboardString(nullptr)) {
+        snap_to_bottom();
+        echo_.reset();
+        needs_redraw_ = true;
+        active_->writer().paste(text, active_->terminal().bracketed_paste());
+      }
+      return;
+    }
+    if (key == 'O') {
+      // Copy the last command's output
+      core::TextRange range;
+      if (active_->terminal().last_command_output(range)) {
+        std::string text;
+        core::StringSink sink(text);
+        core::export_text(active_->terminal(), range, sink);
+        glfwSetClipboardString(nullptr, text.c_str());
+      }
+      return;
+    }
+  }
+
+  // Ctrl+C, Ctrl+D, etc.
+  if (mods & 0x0002 /* GLFW_MOD_CONTROL */) {
+    if (key >= 'A' && key <= 'Z') {
+      char ctrl_char = static_cast<char>(key - 'A' + 1);
+      send_input(&ctrl_char, 1);
+      return;
+    }
+  }
+
+  // Arrows, Enter, Backspace, Tab, Escape...
+  if (const char *seq = key_sequence(key)) {
+    send_input(seq, strlen(seq));
+    return;
+  }
+  snap_to_bottom(); // Auto-scroll on key input
+}
+
+void TerminalWindow::find_selection() {
+  core::Terminal &terminal = active_->terminal();
+  core::SearchQuery query;
+  query.pattern = terminal.get_selected_text();
+  if (query.pattern.empty() ||
+      query.pattern.find('\n') != std::string::npos) {
+    return;
+  }
+
+  // The next match up from the selection, which is a match after a find
+  core::Terminal::Selection selection = terminal.selection();
+  selection.normalize();
+  std::vector<core::SearchMatch> matches =
+      core::search(terminal, query, std::numeric_limits<size_t>::max(),
+                   &sessions_.pool());
+  auto match = std::find_if(
+      matches.begin(), matches.end(), [&](const core::SearchMatch &m) {
+        return m.line < selection.start_line ||
+               (m.line == selection.start_line &&
+                m.start_col < selection.start_col);
+      });
+  if (match == matches.end()) {
+    return;
+  }
+
+  terminal.scroll_to_line(match->line);
+  int row = static_cast<int>(match->line - terminal.line_at_row(0));
+  terminal.start_selection(match->start_col, row);
+  terminal.update_selection(match->end_col - 1, row); // Inclusive end
+  scroll_pixels_ = 0.0f;
+  needs_redraw_ = true;
+}
+
+TerminalWindow::Clock::time_point
+TerminalWindow::wake_time(Clock::time_point now) const {
+  auto wake = last_blink_time_ + CURSOR_BLINK_INTERVAL;
+  if (needs_redraw_) {
+    wake = std::min(wake, scheduler_.next_frame(now));
+  }
+  if (link_scan_pending_) {
+    wake = now;
+  }
+  return std::min(wake, echo_.deadline()); // A prediction to give up on
+}
+
+void TerminalWindow::on_output(Clock::duration round, Clock::time_point now) {
+  scheduler_.on_output(active_->parsed(), round, now);
+  bytes_read_ += active_->parsed();
+}
+
+bool TerminalWindow::take_new_window_request() {
+  bool requested = new_window_requested_;
+  new_window_requested_ = false;
+  return requested;
+}
+
+bool TerminalWindow::update() {
+  size_t bytes_read = bytes_read_;
+  bytes_read_ = 0;
+  if (bytes_read > 0) {
+    // Reset cursor blink on output
+    cursor_visible_ = true;
+    last_blink_time_ = Clock::now();
+    needs_redraw_ = true;
+  }
+
+  // Log how a finished session's shell exited
+  auto report_exit = [](core::Session *session) {
+    if (std::optional<int> status = session->exit_status()) {
+      std::cout << "[tide] Session " << session->id() << " exited with status "
+                << *status << std::endl;
+    }
+  };
+
+  // Close tabs whose shell exited, down to the last one
+  for (size_t i = tabs_.size(); i-- > 0 && tabs_.size() > 1;) {
+    if (tabs_[i]->finished()) {
+      report_exit(tabs_[i]);
+      close_session(tabs_[i]);
+    }
+  }
+  if (active_->finished()) {
+    // PTY closed or error
+    report_exit(active_);
+    std::cout << "[tide] PTY closed, closing the window" << std::endl;
+    return false;
+  }
+  if (window_.should_close()) {
+    return false;
+  }
+
+  // Update cursor blink
+  auto now = Clock::now();
+  if (now - last_blink_time_ >= CURSOR_BLINK_INTERVAL) {
+    cursor_visible_ = !cursor_visible_;
+    last_blink_time_ = now;
+    needs_redraw_ = true;
+  }
+
+  // Confirm predictions against the echo parsed so far
+  if (echo_.update(active_->terminal(), now)) {
+    needs_redraw_ = true;
+  }
+
+  // During a flood, frames are capped and the time goes to parsing
+  if (needs_redraw_ && scheduler_.should_present(now)) {
+    needs_redraw_ = false;
+    render();
+    now = Clock::now();
+  }
+
+  if (options_.frame_stats &&
+      now - last_stats_time_ >= std::chrono::seconds(1)) {
+    print_frame_stats(scheduler_.take_stats(), now - last_stats_time_);
+    if (options_.predictive_echo) {
+      print_echo_stats(echo_.take_stats(), echo_.echo_time());
+    }
+    last_stats_time_ = now;
+  }
+
+  // Look for links only while output is idle, never during a flood, and
+  // redraw only if the scan found something new on screen
+  core::Terminal &terminal = active_->terminal();
+  link_scan_pending_ = false;
+  if (bytes_read == 0 && !scheduler_.flooding(now)) {
+    link_scan_pending_ =
+        !links_.update(terminal, Clock::now() + LINK_SCAN_BUDGET);
+    links_.spans(terminal, scanned_link_spans_);
+    needs_redraw_ = needs_redraw_ || scanned_link_spans_ != link_spans_;
+  }
+  return true;
+}
+
+void TerminalWindow::render() {
+  core::Terminal &terminal = active_->terminal();
+  window_.make_current();
+  show_title(window_, title_, &terminal); // The active tab names the window
+
+  // Hide cursor if scrolled into history, or if the application hid it
+  bool show_cursor = cursor_visible_ && terminal.cursor_shown() &&
+                     !terminal.is_scrolled();
+
+  // Selection highlight for the rows on screen
+  terminal.selection_spans(selection_spans_);
+  renderer_.set_selection(selection_spans_);
+  links_.spans(terminal, link_spans_);
+  renderer_.set_links(link_spans_);
+  renderer_.set_scroll_pixels(scroll_pixels_);
+
+  // Render frame with cursor
+  auto render_start = Clock::now();
+  terminal.view(screen_);
+  int cursor_col = terminal.cursor_col();
+  int cursor_row = terminal.cursor_row();
+  if (!terminal.is_scrolled()) {
+    echo_.overlay(screen_, cursor_col, cursor_row);
+  }
+  renderer_.render(screen_, theme_, cursor_col, cursor_row, show_cursor);
+
+  // Swap buffers
+  auto present_start = Clock::now();
+  window_.swap_buffers();
+  auto now = Clock::now();
+  scheduler_.presented(present_start - render_start, now - present_start, now);
+  presented_ = true;
+}
+
+} // namespace tide::app
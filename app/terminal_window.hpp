@@ -0,0 +1,224 @@
+#pragma once
+
+#include "core/frame_scheduler.hpp"
+#include "core/link_detector.hpp"
+#include "core/predictive_echo.hpp"
+#include "core/screen_view.hpp"
+#include "core/session_manager.hpp"
+#include "platform/linux/window.hpp"
+#include "render/font.hpp"
+#include "render/renderer.hpp"
+#include "theme/theme.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace tide::app {
+
+/**
+ * How new sessions and windows are set up, from the command line.
+ */
+struct WindowOptions {
+  bool unlimited_scrollback = false;
+  bool replay_history = false;
+  bool frame_stats = false;
+  bool predictive_echo = false; // Draw typing before a slow echo arrives
+};
+
+constexpr auto CURSOR_BLINK_INTERVAL = std::chrono::milliseconds(500);
+
+/**
+ * Escape sequence (or control character) for a special key, or nullptr.
+ */
+const char *key_sequence(int key);
+
+/**
+ * Scroll a terminal's view by mouse wheel steps of 3 lines. Fractional
+ * steps (touchpads) accumulate in `scroll_pixels`, the part of a row the
+ * view is shifted down, which resets at either end of the history.
+ */
+void scroll_view(core::Terminal &terminal, float &scroll_pixels, double steps,
+                 int cell_height);
+
+/**
+ * The cell under a window position, clamped to the screen.
+ */
+void cell_at(const core::Terminal &terminal, const render::Font &font,
+             float scroll_pixels, double x, double y, int &col, int &row);
+
+/**
+ * Show a terminal's title (OSC 0/2) in the title bar, or the default one
+ * without a terminal or title. `shown` is the title last set, so that an
+ * unchanged title costs nothing.
+ */
+void show_title(platform::linux::Window &window, std::string &shown,
+                const core::Terminal *terminal);
+
+/**
+ * Print --frame-stats totals taken over `period`.
+ */
+void print_frame_stats(const core::FrameScheduler::Stats &stats,
+                       std::chrono::steady_clock::duration period);
+
+/**
+ * Apply the command-line options to a new session's terminal.
+ */
+void configure_terminal(core::Terminal &terminal, const theme::Theme &theme,
+                        const WindowOptions &options);
+
+/**
+ * Create a window and a renderer for it, loading the font first if it is
+ * not yet (its atlas goes into the new window's context).
+ * @param share An open window, and its renderer, to share GL objects with
+ *              (optional)
+ */
+bool init_graphics(platform::linux::Window &window, render::Font &font,
+                   render::Renderer &renderer, const theme::Theme &theme,
+                   const platform::linux::Window *share = nullptr,
+                   const render::Renderer *share_renderer = nullptr);
+
+/**
+ * A terminal window: its tabs, renderer, frame pacing and input handling.
+ *
+ * Windows of one process share the font and its atlas, the renderer's
+ * shader program and vertices (their contexts share objects), and the
+ * SessionManager, so every window's sessions are parsed in the same
+ * parallel rounds. The owner runs one loop for all of them: sleep until
+ * the earliest wake_time(), flush input, parse in rounds (reporting each
+ * round to every window through on_output()), then update() each window.
+ */
+class TerminalWindow {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  TerminalWindow(core::SessionManager &sessions, render::Font &font,
+                 const theme::Theme &theme, const WindowOptions &options,
+                 const core::LinkDetector &links);
+  ~TerminalWindow() { close(); }
+
+  // Non-copyable (the window's callbacks point into us)
+  TerminalWindow(const TerminalWindow &) = delete;
+  TerminalWindow &operator=(const TerminalWindow &) = delete;
+
+  /**
+   * Create the window with a shell in its first tab. The font is loaded
+   * here if it is not yet.
+   * @param share An open window to share GL objects with (optional)
+   * @param context Where the window's shells start (a launch's directory
+   *                and environment; optional)
+   * @return false if the window or its shell could not start
+   */
+  bool open(const TerminalWindow *share = nullptr,
+            core::SpawnContext context = {});
+
+  /**
+   * Close every tab and destroy the window. Releases GL objects, so the
+   * window's context is made current.
+   */
+  void close();
+
+  /**
+   * When the loop must wake for this window (cursor blink, a held frame,
+   * or now for an unfinished link scan).
+   */
+  [[nodiscard]] Clock::time_point wake_time(Clock::time_point now) const;
+
+  /**
+   * Until when this window lets output be parsed before it wants a frame.
+   */
+  [[nodiscard]] Clock::time_point parse_deadline(Clock::time_point now) const {
+    return scheduler_.parse_deadline(now);
+  }
+
+  /**
+   * Account one parse round (see FrameScheduler::on_output()).
+   */
+  void on_output(Clock::duration round, Clock::time_point now);
+
+  /**
+   * An echo of typed input is ready to show: stop parsing for a frame.
+   */
+  [[nodiscard]] bool echo_ready() const { return scheduler_.echo_ready(); }
+
+  /**
+   * After the parse rounds: close tabs whose shell exited, draw a frame if
+   * one is due, and look for links.
+   * @return false once the window should go (closed by the user, or its
+   *         last shell exited)
+   */
+  bool update();
+
+  /**
+   * Ctrl+Shift+N was pressed since the last call.
+   */
+  bool take_new_window_request();
+
+  /**
+   * The first frame is on screen.
+   */
+  [[nodiscard]] bool presented() const { return presented_; }
+
+  platform::linux::Window &window() { return window_; }
+
+private:
+  core::SessionManager &sessions_;
+  render::Font &font_;
+  const theme::Theme &theme_;
+  const WindowOptions &options_;
+
+  platform::linux::Window window_;
+  render::Renderer renderer_;
+  core::FrameScheduler scheduler_;
+  core::LinkDetector links_;
+  core::PredictiveEcho echo_; // For the tab on screen
+  core::SpawnContext context_; // Where new tabs start
+
+  std::vector<core::Session *> tabs_; // Ours, of the shared manager
+  core::Session *active_ = nullptr;   // The tab on screen
+
+  // The loop sleeps until something changes; whatever changes the screen
+  // sets this, and the scheduler picks the iteration that draws it
+  bool needs_redraw_ = true;
+  bool presented_ = false;
+  std::string title_; // In the title bar
+  bool new_window_requested_ = false;
+  bool focused_ = true;
+  size_t bytes_read_ = 0; // On screen, this iteration
+
+  // Mouse state for selection
+  bool mouse_selecting_ = false;
+  double last_mouse_x_ = 0, last_mouse_y_ = 0;
+
+  // Smooth scrolling: part of a row the view is shifted down, in pixels
+  float scroll_pixels_ = 0.0f;
+
+  // Cursor blink state
+  Clock::time_point last_blink_time_;
+  bool cursor_visible_ = true;
+
+  // Selected columns per screen row, refreshed every frame
+  std::vector<core::ColumnSpan> selection_spans_;
+  std::vector<std::vector<core::ColumnSpan>> link_spans_;
+  std::vector<std::vector<core::ColumnSpan>> scanned_link_spans_;
+  core::ScreenView screen_;
+
+  // Set while the link scan ran out of budget and should resume at once
+  bool link_scan_pending_ = false;
+
+  // --frame-stats: phase timings, once a second
+  Clock::time_point last_stats_time_;
+
+  core::Session *open_session(int cols, int rows);
+  void show_session(core::Session *session);
+  void close_session(core::Session *session);
+  [[nodiscard]] size_t tab_index(const core::Session *session) const;
+  void send_input(const char *data, size_t size);
+  void snap_to_bottom();
+  void install_callbacks();
+  void on_key(int key, int action, int mods);
+  void find_selection(); // Ctrl+Shift+F: the selected text, further up
+  void render();
+};
+
+} // namespace tide::app
@@ -0,0 +1,245 @@
+#include "app/view_window.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <string>
+
+namespace tide::app {
+
+ViewWindow::ViewWindow(const theme::Theme &theme, const WindowOptions &options)
+    : theme_(theme), options_(options) {}
+
+bool ViewWindow::open() {
+  if (!init_graphics(window_, font_, renderer_, theme_)) {
+    return false;
+  }
+  cols_ = renderer_.grid_cols();
+  rows_ = renderer_.grid_rows();
+  install_callbacks();
+  last_blink_time_ = Clock::now();
+  last_stats_time_ = last_blink_time_;
+  return true;
+}
+
+void ViewWindow::close() {
+  window_.make_current();
+  renderer_.shutdown();
+  font_.shutdown();
+  window_.destroy();
+}
+
+void ViewWindow::run(ViewSource &source) {
+  source_ = &source;
+
+  while (!window_.should_close()) {
+    // Sleep until input, output (the source's reader posts an empty
+    // event), the cursor blink, or a held frame
+    auto now = Clock::now();
+    auto wake = last_blink_time_ + CURSOR_BLINK_INTERVAL;
+    if (needs_redraw_) {
+      wake = std::min(wake, scheduler_.next_frame(now));
+    }
+    if (source.busy()) {
+      wake = now;
+    }
+    platform::linux::Window::wait_events(
+        std::chrono::duration<double>(wake - now).count());
+
+    auto poll_start = Clock::now();
+    size_t bytes = source.poll();
+    now = Clock::now();
+    scheduler_.on_output(bytes, now - poll_start, now);
+    if (bytes > 0) {
+      // Reset cursor blink on output
+      cursor_visible_ = true;
+      last_blink_time_ = now;
+      needs_redraw_ = true;
+    }
+    if (source.finished()) {
+      break;
+    }
+    if (source.take_switched()) {
+      renderer_.invalidate(); // Row keys from another terminal mean nothing
+      mouse_selecting_ = false;
+      scroll_pixels_ = 0.0f;
+      needs_redraw_ = true;
+    }
+
+    if (now - last_blink_time_ >= CURSOR_BLINK_INTERVAL) {
+      cursor_visible_ = !cursor_visible_;
+      last_blink_time_ = now;
+      needs_redraw_ = true;
+    }
+
+    // During a flood, frames are capped and the time goes to the source
+    if (needs_redraw_ && scheduler_.should_present(now)) {
+      render();
+      now = Clock::now();
+    }
+
+    if (options_.frame_stats &&
+        now - last_stats_time_ >= std::chrono::seconds(1)) {
+      print_frame_stats(scheduler_.take_stats(), now - last_stats_time_);
+      last_stats_time_ = now;
+    }
+  }
+  source_ = nullptr;
+}
+
+void ViewWindow::send_input(std::string_view data) {
+  // Typed input: the frame waits for the echo, unless the view has to
+  // jump back to the live screen first
+  snap_to_bottom();
+  source_->write(data);
+  scheduler_.on_input(Clock::now());
+}
+
+void ViewWindow::snap_to_bottom() {
+  core::Terminal *terminal = source_->terminal();
+  if (terminal && (terminal->is_scrolled() || scroll_pixels_ != 0.0f)) {
+    terminal->scroll_to_bottom();
+    scroll_pixels_ = 0.0f;
+    needs_redraw_ = true;
+  }
+}
+
+void ViewWindow::install_callbacks() {
+  window_.set_resize_callback([this](int width, int height) {
+    renderer_.resize(width, height);
+    needs_redraw_ = true;
+    if (renderer_.grid_cols() != cols_ || renderer_.grid_rows() != rows_) {
+      cols_ = renderer_.grid_cols();
+      rows_ = renderer_.grid_rows();
+      if (source_) {
+        source_->resize(cols_, rows_);
+      }
+    }
+  });
+  window_.set_refresh_callback([this] { needs_redraw_ = true; });
+
+  // Selection, on sources with a terminal of their own
+  window_.mouse().set_button_callback([this](int button, int action, int) {
+    core::Terminal *terminal = source_ ? source_->terminal() : nullptr;
+    if (button != 0 /* Left */ || !terminal) {
+      return;
+    }
+    if (action == 1 /* Press */) {
+      int col, row;
+      cell_at(*terminal, font_, scroll_pixels_, last_mouse_x_, last_mouse_y_,
+              col, row);
+      terminal->start_selection(col, row);
+      mouse_selecting_ = true;
+      needs_redraw_ = true;
+    } else if (action == 0 /* Release */) {
+      if (mouse_selecting_ && terminal->selection().active) {
+        std::string text = terminal->get_selected_text();
+        if (!text.empty()) {
+          glfwSetClipboardString(nullptr, text.c_str());
+        }
+      }
+      mouse_selecting_ = false;
+    }
+  });
+
+  window_.mouse().set_move_callback([this](double x, double y) {
+    last_mouse_x_ = x;
+    last_mouse_y_ = y;
+    core::Terminal *terminal = source_ ? source_->terminal() : nullptr;
+    if (mouse_selecting_ && terminal) {
+      int col, row;
+      cell_at(*terminal, font_, scroll_pixels_, x, y, col, row);
+      terminal->update_selection(col, row);
+      needs_redraw_ = true;
+    }
+  });
+
+  window_.mouse().set_scroll_callback([this](double xoffset, double yoffset) {
+    (void)xoffset;
+    if (core::Terminal *terminal = source_ ? source_->terminal() : nullptr) {
+      scroll_view(*terminal, scroll_pixels_, yoffset, font_.cell_height());
+      needs_redraw_ = true;
+    }
+  });
+
+  window_.keyboard().set_char_callback([this](unsigned int codepoint) {
+    if (source_ && codepoint < 128) {
+      char c = static_cast<char>(codepoint);
+      send_input(std::string_view(&c, 1));
+    }
+  });
+
+  window_.keyboard().set_key_callback(
+      [this](int key, int scancode, int action, int mods) {
+        (void)scancode;
+        if (source_) {
+          on_key(key, action, mods);
+        }
+      });
+}
+
+void ViewWindow::on_key(int key, int action, int mods) {
+  if (action != 1 /* GLFW_PRESS */ && action != 2 /* GLFW_REPEAT */) {
+    return;
+  }
+
+  if ((mods & 0x0003) == 0x0003 /* GLFW_MOD_CONTROL | GLFW_MOD_SHIFT */) {
+    if (source_->shortcut(key)) {
+      return;
+    }
+    if (key == 'W') {
+      window_.request_close(); // Detach
+      return;
+    }
+    if (key == 'V') {
+      if (const char *text = glfwGetClipboardString(nullptr)) {
+        snap_to_bottom();
+        source_->paste(text);
+      }
+      return;
+    }
+  }
+
+  // Ctrl+C, Ctrl+D, etc.
+  if ((mods & 0x0002 /* GLFW_MOD_CONTROL */) && key >= 'A' && key <= 'Z') {
+    char ctrl_char = static_cast<char>(key - 'A' + 1);
+    send_input(std::string_view(&ctrl_char, 1));
+    return;
+  }
+
+  // Arrows, Enter, Backspace, Tab, Escape...
+  if (const char *seq = key_sequence(key)) {
+    send_input(seq);
+  }
+}
+
+void ViewWindow::render() {
+  needs_redraw_ = false;
+  auto render_start = Clock::now();
+  int cursor_col = 0;
+  int cursor_row = 0;
+  if (!source_->view(screen_, cursor_col, cursor_row)) {
+    return; // Nothing to draw until the source has a screen
+  }
+
+  // Hide cursor if scrolled into history, or if the application hid it
+  core::Terminal *terminal = source_->terminal();
+  show_title(window_, title_, terminal);
+  bool hidden = terminal && (terminal->is_scrolled() ||
+                             !terminal->cursor_shown());
+  selection_spans_.clear();
+  if (terminal) {
+    terminal->selection_spans(selection_spans_);
+  }
+  renderer_.set_selection(selection_spans_);
+  renderer_.set_scroll_pixels(terminal ? scroll_pixels_ : 0.0f);
+  renderer_.render(screen_, theme_, cursor_col, cursor_row,
+                   cursor_visible_ && !hidden);
+
+  auto present_start = Clock::now();
+  window_.swap_buffers();
+  auto now = Clock::now();
+  scheduler_.presented(present_start - render_start, now - present_start, now);
+}
+
+} // namespace tide::app
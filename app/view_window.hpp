@@ -0,0 +1,159 @@
+#pragma once
+
+#include "app/terminal_window.hpp"
+#include "core/frame_scheduler.hpp"
+#include "core/screen_view.hpp"
+#include "core/terminal.hpp"
+#include "platform/linux/window.hpp"
+#include "render/font.hpp"
+#include "render/renderer.hpp"
+#include "theme/theme.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tide::app {
+
+/**
+ * What a ViewWindow shows and types into when the terminals are not ours
+ * to parse: a session of `tide --server` (--attach), or the panes of tmux
+ * in control mode (--tmux). Called on the window's thread only.
+ */
+class ViewSource {
+public:
+  virtual ~ViewSource() = default;
+
+  /**
+   * Send queued input and apply what arrived.
+   * @return Bytes of output applied, 0 if the screen did not change
+   */
+  virtual size_t poll() = 0;
+
+  /**
+   * Input is queued or output is waiting: the window must not sleep.
+   */
+  [[nodiscard]] virtual bool busy() const = 0;
+
+  /**
+   * The other end is gone; the window closes.
+   */
+  [[nodiscard]] virtual bool finished() const = 0;
+
+  /**
+   * The terminal on screen, for scrollback and selection; nullptr if the
+   * source only has a screen (or nothing to show yet).
+   */
+  virtual core::Terminal *terminal() = 0;
+
+  /**
+   * Show the screen and its cursor.
+   * @return false if there is nothing to show yet
+   */
+  virtual bool view(core::ScreenView &out, int &cursor_col,
+                    int &cursor_row) = 0;
+
+  virtual void write(std::string_view data) = 0;
+  virtual void paste(std::string_view text) = 0;
+  virtual void resize(int cols, int rows) = 0;
+
+  /**
+   * A Ctrl+Shift shortcut the window does not handle itself.
+   * @return false to let the window handle it (W closes the window)
+   */
+  virtual bool shortcut(int key) {
+    (void)key;
+    return false;
+  }
+
+  /**
+   * Another terminal went on screen since the last call.
+   */
+  virtual bool take_switched() { return false; }
+};
+
+/**
+ * A window onto a ViewSource: the front end of --attach and --tmux.
+ *
+ * Frames are paced by a FrameScheduler as in TerminalWindow, and when the
+ * source has a terminal of its own the view scrolls smoothly through its
+ * history and selects text to copy. The window runs its own loop, one
+ * window per process, with its own font.
+ */
+class ViewWindow {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  ViewWindow(const theme::Theme &theme, const WindowOptions &options);
+  ~ViewWindow() { close(); }
+
+  // Non-copyable (the window's callbacks point into us)
+  ViewWindow(const ViewWindow &) = delete;
+  ViewWindow &operator=(const ViewWindow &) = delete;
+
+  /**
+   * Create the window and load the font.
+   */
+  bool open();
+
+  /**
+   * Release GL objects and destroy the window. The source must have
+   * stopped posting to it.
+   */
+  void close();
+
+  /**
+   * Grid size of the window, for starting the source.
+   */
+  [[nodiscard]] int cols() const { return renderer_.grid_cols(); }
+  [[nodiscard]] int rows() const { return renderer_.grid_rows(); }
+
+  /**
+   * Show `source` until it finishes or the window is closed.
+   */
+  void run(ViewSource &source);
+
+private:
+  const theme::Theme &theme_;
+  const WindowOptions &options_;
+
+  platform::linux::Window window_;
+  render::Font font_;
+  render::Renderer renderer_;
+  core::FrameScheduler scheduler_;
+  ViewSource *source_ = nullptr; // While run()
+  int cols_ = 0;
+  int rows_ = 0;
+
+  bool needs_redraw_ = true;
+
+  // Mouse state for selection
+  bool mouse_selecting_ = false;
+  double last_mouse_x_ = 0, last_mouse_y_ = 0;
+
+  // Smooth scrolling: part of a row the view is shifted down, in pixels
+  float scroll_pixels_ = 0.0f;
+
+  // Cursor blink state
+  Clock::time_point last_blink_time_;
+  bool cursor_visible_ = true;
+
+  // Selected columns per screen row, refreshed every frame
+  std::vector<core::ColumnSpan> selection_spans_;
+  core::ScreenView screen_;
+
+  std::string title_; // In the title bar
+
+  // --frame-stats: phase timings, once a second
+  Clock::time_point last_stats_time_;
+
+  void install_callbacks();
+  void on_key(int key, int action, int mods);
+  void send_input(std::string_view data);
+  void snap_to_bottom();
+  void render();
+};
+
+} // namespace tide::app
@@ -0,0 +1,257 @@
+/**
+ * Predictive echo benchmark.
+ *
+ * Runs shells behind a relay that delays their I/O like a distant ssh
+ * host, types into them through a PredictiveEcho, and reports how many
+ * keys were drawn at once instead of one echo time later, and how many
+ * predictions were confirmed or rolled back:
+ *   - prompt:      a line-reading loop whose PTY echoes what is typed,
+ *                  typed faster than the echo returns, with application
+ *                  cursor keys on as readline leaves them; everything
+ *                  should be predicted and confirmed,
+ *   - password:    `stty -echo`; nothing echoes, so nothing may be shown,
+ *   - full-screen: an application on the alternate screen; no predictions,
+ *   - garbled:     letters echo upper-cased; the wrong predictions are
+ *                  rolled back until prediction turns itself off.
+ *
+ * The relay is this program: `echo_bench --relay MS COMMAND...` runs
+ * COMMAND on a PTY of its own and forwards both ways MS ms late, so an
+ * echo takes 2 * MS. It works by hand too, e.g. run
+ * `echo_bench --relay 100 bash` in `tide --predictive-echo`.
+ *
+ * Usage: echo_bench [delay_ms]
+ *        echo_bench --relay MS COMMAND...
+ */
+
+#include "core/predictive_echo.hpp"
+#include "core/session.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+#include <pty.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Ms = std::chrono::duration<double, std::milli>;
+
+// Bytes on their way through the relay
+struct Chunk {
+  Clock::time_point due;
+  std::string data;
+};
+
+// Write what is due; return when the next chunk is
+Clock::time_point deliver(std::deque<Chunk> &queue, int fd,
+                          Clock::time_point now) {
+  while (!queue.empty() && queue.front().due <= now) {
+    const std::string &data = queue.front().data;
+    for (size_t done = 0; done < data.size();) {
+      ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+      if (n <= 0) {
+        break;
+      }
+      done += static_cast<size_t>(n);
+    }
+    queue.pop_front();
+  }
+  return queue.empty() ? Clock::time_point::max() : queue.front().due;
+}
+
+// --relay: the command on a PTY of ours, stdin raw (as ssh leaves the
+// local terminal), and everything `delay` late in both directions
+int relay(std::chrono::milliseconds delay, char **command) {
+  winsize size{};
+  ioctl(STDIN_FILENO, TIOCGWINSZ, &size);
+  termios saved{};
+  bool tty = tcgetattr(STDIN_FILENO, &saved) == 0;
+  if (tty) {
+    termios raw = saved;
+    cfmakeraw(&raw);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+  }
+
+  int master = -1;
+  pid_t pid = forkpty(&master, nullptr, nullptr,
+                      size.ws_col > 0 ? &size : nullptr);
+  if (pid < 0) {
+    return 1;
+  }
+  if (pid == 0) {
+    execvp(command[0], command);
+    _exit(127);
+  }
+
+  std::deque<Chunk> to_child;
+  std::deque<Chunk> to_parent;
+  bool child_open = true;
+  char buffer[4096];
+  while (child_open || !to_parent.empty()) {
+    auto now = Clock::now();
+    auto next = std::min(deliver(to_child, master, now),
+                         deliver(to_parent, STDOUT_FILENO, now));
+    int timeout = -1; // Nothing queued: sleep until there is input
+    if (next != Clock::time_point::max()) {
+      timeout = std::max(
+          static_cast<int>(
+              std::chrono::ceil<std::chrono::milliseconds>(next - now)
+                  .count()),
+          0);
+    }
+    pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {master, POLLIN, 0}};
+    if (::poll(fds, child_open ? 2 : 0, timeout) < 0) {
+      continue;
+    }
+    now = Clock::now();
+    if (fds[0].revents) {
+      ssize_t n = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+      if (n <= 0) {
+        break; // Hung up on
+      }
+      to_child.push_back({now + delay, std::string(buffer, n)});
+    }
+    if (fds[1].revents) {
+      ssize_t n = ::read(master, buffer, sizeof(buffer));
+      if (n <= 0) {
+        child_open = false;
+      } else {
+        to_parent.push_back({now + delay, std::string(buffer, n)});
+      }
+    }
+  }
+
+  ::close(master);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (tty) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+struct Result {
+  int keys = 0;
+  int drawn_at_once = 0; // Keys whose prediction was on screen at once
+  tide::core::PredictiveEcho::Stats stats;
+};
+
+// Parse and check predictions until `until`
+void pump(tide::core::Session &session, tide::core::PredictiveEcho &echo,
+          Clock::time_point until) {
+  do {
+    session.writer().flush();
+    session.parse(SIZE_MAX);
+    echo.update(session.terminal(), Clock::now());
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  } while (Clock::now() < until);
+}
+
+// Run `script` behind the relay, wait for its first output, then type
+// `keys` one every `interval`
+Result run(const char *name, const std::string &script, int delay_ms,
+           tide::core::PredictiveEcho &echo, const std::string &keys,
+           std::chrono::milliseconds interval) {
+  tide::core::Session session(1, 80, 24);
+  Result result;
+  std::string delay = std::to_string(delay_ms);
+  if (!session.start([] {}, {"/proc/self/exe", "--relay", delay, "sh", "-c",
+                             script})) {
+    std::printf("FAIL %s: relay did not start\n", name);
+    return result;
+  }
+  auto deadline = Clock::now() + std::chrono::seconds(5);
+  while (session.terminal().cursor_row() == 0 && Clock::now() < deadline) {
+    pump(session, echo, Clock::now());
+  }
+  echo.reset();
+  echo.take_stats();
+
+  for (char key : keys) {
+    auto now = Clock::now();
+    size_t shown = echo.shown();
+    echo.on_input(session.terminal(), &key, 1, now);
+    result.drawn_at_once += echo.shown() > shown ? 1 : 0;
+    session.writer().write(&key, 1);
+    ++result.keys;
+    pump(session, echo, now + interval);
+  }
+  pump(session, echo,
+       Clock::now() + std::chrono::milliseconds(2 * delay_ms + 300));
+  result.stats = echo.take_stats();
+
+  std::printf("%-12s %3d keys: %3d drawn at once, %3llu predicted, "
+              "%3llu confirmed, %2llu rolled back | echo time %.0f ms\n",
+              name, result.keys, result.drawn_at_once,
+              static_cast<unsigned long long>(result.stats.predicted),
+              static_cast<unsigned long long>(result.stats.confirmed),
+              static_cast<unsigned long long>(result.stats.rolled_back),
+              Ms(echo.echo_time()).count());
+  return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  if (argc > 3 && std::strcmp(argv[1], "--relay") == 0) {
+    return relay(std::chrono::milliseconds(std::atoi(argv[2])), argv + 3);
+  }
+  int delay_ms = argc > 1 ? std::atoi(argv[1]) : 60;
+  auto fast = std::chrono::milliseconds(std::max(delay_ms / 2, 10));
+  auto slow = std::chrono::milliseconds(4 * delay_ms);
+  int failures = 0;
+  auto check = [&](bool ok, const char *what) {
+    if (!ok) {
+      std::printf("FAIL %s\n", what);
+      ++failures;
+    }
+  };
+
+  tide::core::PredictiveEcho echo;
+  std::printf("Echo through a relay: %d ms each way\n", delay_ms);
+
+  // Typing runs ahead of a slow echo: each line starts an epoch, so its
+  // first keys stay hidden until one echoes, and the rest are drawn at once
+  Result prompt = run(
+      "prompt",
+      "printf 'ready\\n\\033[?1h'; while read -r line; do :; done",
+      delay_ms, echo, "echo hello world\rls -la /tmp\rgit status --short\r",
+      fast);
+  check(prompt.stats.rolled_back == 0, "prompt: predictions rolled back");
+  check(prompt.drawn_at_once * 2 >= prompt.keys,
+        "prompt: too few keys drawn at once");
+  check(echo.echo_time() >= std::chrono::milliseconds(2 * delay_ms),
+        "prompt: echo time below the relay's round trip");
+
+  Result password =
+      run("password", "echo ready; stty -echo; read -r secret", delay_ms,
+          echo, "hunter2hunter2\r", fast);
+  check(password.drawn_at_once == 0, "password: a prediction was drawn");
+
+  Result full_screen = run(
+      "full-screen",
+      "printf 'ready\\n\\033[?1049h'; stty -echo; read -r command", delay_ms,
+      echo, "jjjkkk:wq\r", fast);
+  check(full_screen.stats.predicted == 0,
+        "full-screen: keys were predicted");
+
+  // Slow enough that every echo arrives before the next key
+  Result garbled = run(
+      "garbled",
+      "echo ready; stty -echo -icanon min 1; "
+      "while :; do dd bs=1 count=1 2>/dev/null | tr a-z A-Z; done",
+      delay_ms, echo, "12a34b56c78d90e", slow);
+  check(garbled.stats.rolled_back ==
+            static_cast<uint64_t>(tide::core::PredictiveEcho::FAILURE_LIMIT),
+        "garbled: prediction did not turn off after repeated failures");
+  return failures;
+}
@@ -0,0 +1,197 @@
+/**
+ * Frame pacing benchmark.
+ *
+ * Runs the main loop's I/O, parse and frame logic against a real PTY, with
+ * a simulated 60 Hz vsync swap (a frame is shown at the next vsync; a swap
+ * blocks while the previous frame is still queued), and compares drawing
+ * every changed iteration after parsing everything buffered (the old loop)
+ * with FrameScheduler pacing:
+ *   - flood: parse throughput while a child floods output,
+ *   - echo:  keypress-to-present latency for keys echoed by the PTY.
+ *
+ * Usage: frame_bench [megabytes]
+ */
+
+#include "core/frame_scheduler.hpp"
+#include "core/pty.hpp"
+#include "core/pty_reader.hpp"
+#include "core/pty_writer.hpp"
+#include "core/screen_view.hpp"
+#include "core/terminal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using tide::core::FrameScheduler;
+
+constexpr int COLS = 120;
+constexpr int ROWS = 40;
+constexpr auto VSYNC = std::chrono::microseconds(16667);
+constexpr auto KEY_INTERVAL = std::chrono::milliseconds(103); // Drifts past vsync
+constexpr int KEYS = 30;
+constexpr size_t PARSE_SLICE = 64 * 1024;
+
+/**
+ * Stand-in for glfwWaitEventsTimeout() plus glfwPostEmptyEvent().
+ */
+class Waker {
+public:
+  void post() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    posted_ = true;
+    cv_.notify_one();
+  }
+
+  void wait_until(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_until(lock, deadline, [this] { return posted_; });
+    posted_ = false;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool posted_ = false;
+};
+
+struct Result {
+  double seconds = 0.0;
+  FrameScheduler::Stats stats;
+};
+
+Result run(const std::vector<std::string> &command, bool typing,
+           bool scheduled) {
+  tide::core::Pty pty;
+  if (!pty.spawn(command)) {
+    std::exit(1);
+  }
+
+  Waker waker;
+  tide::core::PtyReader reader;
+  reader.set_notify([&] { waker.post(); });
+  reader.start(pty.master_fd());
+  tide::core::PtyWriter writer(pty.master_fd());
+  writer.set_wait_writable([&] { reader.notify_when_writable(); });
+
+  tide::core::Terminal terminal(COLS, ROWS);
+  tide::core::ScreenView screen;
+  FrameScheduler scheduler;
+  bool needs_redraw = true;
+  int keys = 0;
+  auto start = Clock::now();
+  auto next_key = start + KEY_INTERVAL;
+  auto never = Clock::time_point::max();
+  Clock::time_point shown{}; // When the last swapped frame reaches the screen
+  auto feed = [&](const char *data, size_t size) {
+    terminal.feed(data, size);
+  };
+
+  while (!reader.finished() && (!typing || keys <= KEYS)) {
+    auto now = Clock::now();
+    auto wake = typing ? next_key : never;
+    if (needs_redraw) {
+      wake = std::min(wake, scheduled ? scheduler.next_frame(now) : now);
+    }
+    if (scheduled && reader.buffered() > 0) {
+      wake = now;
+    }
+    waker.wait_until(wake);
+
+    now = Clock::now();
+    if (typing && now >= next_key) {
+      writer.write("a", 1);
+      scheduler.on_input(now);
+      needs_redraw = needs_redraw || !scheduled; // The old loop redrew
+      next_key += KEY_INTERVAL;
+      ++keys;
+    }
+    if (writer.pending()) {
+      writer.flush();
+    }
+
+    size_t bytes = 0;
+    if (scheduled) {
+      auto deadline = scheduler.parse_deadline(now);
+      while (true) {
+        auto slice_start = Clock::now();
+        size_t parsed = reader.drain(feed, PARSE_SLICE);
+        now = Clock::now();
+        scheduler.on_output(parsed, now - slice_start, now);
+        bytes += parsed;
+        if (parsed < PARSE_SLICE || now >= deadline ||
+            scheduler.echo_ready()) {
+          break;
+        }
+      }
+    } else {
+      auto parse_start = Clock::now();
+      bytes = reader.drain(feed);
+      now = Clock::now();
+      scheduler.on_output(bytes, now - parse_start, now);
+    }
+    needs_redraw = needs_redraw || bytes > 0;
+
+    if (needs_redraw && (!scheduled || scheduler.should_present(now))) {
+      needs_redraw = false;
+      auto render_start = Clock::now();
+      terminal.view(screen);
+
+      // Wait out the frame still queued, then queue this one
+      auto present_start = Clock::now();
+      std::this_thread::sleep_until(shown);
+      now = Clock::now();
+      shown = start + ((now - start) / VSYNC + 1) * VSYNC;
+      scheduler.presented(present_start - render_start, now - present_start,
+                          shown);
+    }
+  }
+
+  Result result;
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  reader.stop();
+  pty.close();
+  result.stats = scheduler.take_stats();
+  return result;
+}
+
+double ms(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50;
+  std::string flood = "yes 'building object file_0042.cpp.o' | head -c " +
+                      std::to_string(megabytes * 1000000);
+
+  for (bool scheduled : {false, true}) {
+    const char *name = scheduled ? "scheduled" : "every change";
+
+    Result result = run({"sh", "-c", flood}, false, scheduled);
+    std::printf("%-13s flood: %6.1f MB/s, %llu frames\n", name,
+                static_cast<double>(result.stats.bytes) / 1e6 /
+                    result.seconds,
+                static_cast<unsigned long long>(result.stats.frames));
+
+    result = run({"cat"}, true, scheduled);
+    uint64_t echoes = result.stats.echoes;
+    std::printf("%-13s echo:  avg %5.2f ms, max %5.2f ms (%llu keys)\n", name,
+                echoes == 0 ? 0.0
+                            : ms(result.stats.latency) /
+                                  static_cast<double>(echoes),
+                ms(result.stats.max_latency),
+                static_cast<unsigned long long>(echoes));
+  }
+  return 0;
+}
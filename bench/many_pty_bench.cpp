@@ -0,0 +1,149 @@
+/**
+ * Many-PTY read backend benchmark.
+ *
+ * Runs many chatty children at once (a shell loop printing one short line
+ * per write, like a parallel build) and drains them all, first with a
+ * PtyReader thread per PTY (epoll), then with one shared PtyUring. Reports
+ * reader-side syscalls and process CPU time per megabyte for each.
+ *
+ * Usage: many_pty_bench [ptys] [lines each]
+ */
+
+#include "core/pty.hpp"
+#include "core/pty_reader.hpp"
+#include "core/pty_uring.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+namespace {
+
+struct Result {
+  uint64_t bytes = 0;
+  uint64_t syscalls = 0;
+  uint64_t reads = 0;
+  double seconds = 0.0;
+  double cpu = 0.0; // User plus system seconds, all our threads
+};
+
+double cpu_seconds() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  auto seconds = [](const timeval &time) {
+    return static_cast<double>(time.tv_sec) +
+           static_cast<double>(time.tv_usec) / 1e6;
+  };
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+bool run(size_t count, const std::string &script, tide::core::PtyUring *uring,
+         Result &result) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool posted = false;
+  auto post = [&] {
+    std::lock_guard<std::mutex> lock(mutex);
+    posted = true;
+    cv.notify_one();
+  };
+
+  std::vector<std::unique_ptr<tide::core::Pty>> ptys;
+  std::vector<std::unique_ptr<tide::core::PtyReader>> readers;
+  for (size_t i = 0; i < count; ++i) {
+    ptys.push_back(std::make_unique<tide::core::Pty>());
+    readers.push_back(std::make_unique<tide::core::PtyReader>());
+    if (!ptys.back()->spawn({"sh", "-c", script})) {
+      return false;
+    }
+    readers.back()->set_notify(post);
+  }
+
+  double cpu_start = cpu_seconds();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    if (!readers[i]->start(ptys[i]->master_fd(), uring)) {
+      return false;
+    }
+  }
+
+  auto discard = [](const char *, size_t) {};
+  size_t running = count;
+  while (running > 0) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return posted; });
+      posted = false;
+    }
+    running = 0;
+    for (auto &reader : readers) {
+      result.bytes += reader->drain(discard);
+      running += !reader->finished();
+    }
+  }
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  result.cpu = cpu_seconds() - cpu_start;
+
+  for (size_t i = 0; i < count; ++i) {
+    tide::core::PtyReader::Stats stats = readers[i]->stats();
+    readers[i]->stop();
+    ptys[i]->close();
+    result.reads += stats.reads;
+    result.syscalls += stats.reads + stats.waits;
+  }
+  if (uring) {
+    // Reads and polls ride along in io_uring_enter()
+    tide::core::PtyUring::Stats stats = uring->stats();
+    result.syscalls = stats.enters + stats.wakes;
+  }
+  return true;
+}
+
+void print(const char *name, const Result &result) {
+  double mb = static_cast<double>(result.bytes) / 1e6;
+  std::printf("%-9s %6.1f MB in %5.2f s: %7.1f syscalls/MB, "
+              "%6.1f ms CPU/MB, %llu reads\n",
+              name, mb, result.seconds,
+              static_cast<double>(result.syscalls) / mb,
+              result.cpu * 1e3 / mb,
+              static_cast<unsigned long long>(result.reads));
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 48;
+  size_t lines = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000;
+  std::string script = "i=0; while [ $i -lt " + std::to_string(lines) +
+                       " ]; do echo \"[$i] CXX src/module_$i.o ok\"; "
+                       "i=$((i+1)); done";
+
+  Result epoll;
+  if (!run(count, script, nullptr, epoll)) {
+    std::fprintf(stderr, "spawn failed\n");
+    return 1;
+  }
+  std::printf("%zu PTYs, %zu lines each\n", count, lines);
+  print("epoll", epoll);
+
+  std::unique_ptr<tide::core::PtyUring> uring = tide::core::PtyUring::create();
+  if (!uring) {
+    std::printf("io_uring  unavailable\n");
+    return 0;
+  }
+  Result ring;
+  if (!run(count, script, uring.get(), ring)) {
+    std::fprintf(stderr, "spawn failed\n");
+    return 1;
+  }
+  print("io_uring", ring);
+  return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * PTY read throughput and syscall benchmark.
+ *
+ * Streams generated output through a real PTY and reports throughput and
+ * syscalls per megabyte, either through PtyReader (epoll, read until EAGAIN,
+ * adaptive read sizes) or with the old main loop: one zero-timeout select()
+ * plus one 4 KB read() per frame. The old loop is frame-paced, so it runs for
+ * at most LEGACY_SECONDS and its throughput is bounded by the frame rate.
+ *
+ * Usage: pty_bench [megabytes] [--legacy]
+ */
+
+#include "core/pty.hpp"
+#include "core/pty_reader.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/select.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+constexpr auto FRAME = std::chrono::milliseconds(16);
+constexpr size_t LEGACY_READ_SIZE = 4096;
+constexpr double LEGACY_SECONDS = 10.0;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+  bool legacy = argc > 2 && std::string(argv[2]) == "--legacy";
+
+  tide::core::Pty pty;
+  std::string script = "yes 'building object file_0042.cpp.o' | head -c " +
+                       std::to_string(megabytes * 1000000);
+  if (!pty.spawn({"sh", "-c", script})) {
+    std::fprintf(stderr, "spawn failed\n");
+    return 1;
+  }
+
+  uint64_t bytes = 0;
+  uint64_t syscalls = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  if (legacy) {
+    // What the main loop used to do: the frame sleep stands in for the
+    // vsync-blocked buffer swap that paced it
+    char buffer[LEGACY_READ_SIZE];
+    int fd = pty.master_fd();
+    while (seconds_since(start) < LEGACY_SECONDS) {
+      std::this_thread::sleep_for(FRAME);
+      fd_set read_fds;
+      FD_ZERO(&read_fds);
+      FD_SET(fd, &read_fds);
+      timeval timeout = {0, 0};
+      int ready = select(fd + 1, &read_fds, nullptr, nullptr, &timeout);
+      ++syscalls;
+      if (ready <= 0) {
+        continue;
+      }
+      ssize_t n = ::read(fd, buffer, sizeof(buffer));
+      ++syscalls;
+      if (n > 0) {
+        bytes += static_cast<uint64_t>(n);
+      } else if (n < 0 && errno == EAGAIN) {
+        continue;
+      } else {
+        break;
+      }
+    }
+  } else {
+    // Drain once per frame, like the main loop
+    tide::core::PtyReader reader;
+    reader.start(pty.master_fd());
+    while (!reader.finished()) {
+      std::this_thread::sleep_for(FRAME);
+      reader.drain([](const char *, size_t) {});
+    }
+    reader.stop();
+    tide::core::PtyReader::Stats stats = reader.stats();
+    bytes = stats.bytes;
+    syscalls = stats.reads + stats.waits;
+    std::printf("reads:               %llu\n",
+                static_cast<unsigned long long>(stats.reads));
+    std::printf("epoll waits:         %llu\n",
+                static_cast<unsigned long long>(stats.waits));
+  }
+
+  double elapsed = seconds_since(start);
+  std::printf("bytes:               %.1f MB\n",
+              static_cast<double>(bytes) / 1e6);
+  std::printf("throughput:          %.1f MB/s\n",
+              static_cast<double>(bytes) / 1e6 / elapsed);
+  std::printf("syscalls per MB:     %.1f\n",
+              bytes == 0 ? 0.0
+                         : static_cast<double>(syscalls) * 1e6 /
+                               static_cast<double>(bytes));
+
+  pty.close();
+  return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * Attached-window bandwidth benchmark.
+ *
+ * Feeds typical output into a terminal in the chunks that would arrive
+ * between two frames, encodes a frame after each chunk as `tide --server`
+ * does for an attached window, and compares the frame bytes with the raw
+ * PTY bytes (what forwarding the output stream would send):
+ *   - typing:  a shell echoing keystrokes, one frame per key,
+ *   - tail:    a log growing by one line per frame,
+ *   - flood:   a build log at full speed, 64 KB per frame,
+ *   - top:     a full-screen monitor repainting every row each refresh,
+ *   - scroll:  an editor scrolling a region by one line per frame.
+ * Every frame is applied to a RemoteScreen and checked against the terminal.
+ *
+ * Usage: remote_bench [cols] [rows]
+ */
+
+#include "core/screen_diff.hpp"
+#include "core/terminal.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Chunks = std::vector<std::string>;
+
+struct Result {
+  uint64_t raw = 0;
+  uint64_t frames = 0;
+  uint64_t frame_bytes = 0;
+  double encode_us = 0.0; // Per frame
+  bool ok = true;
+};
+
+bool same_screen(const tide::core::Terminal &terminal,
+                 const tide::core::RemoteScreen &screen) {
+  tide::core::ScreenView view;
+  terminal.view(view);
+  if (screen.cols() != view.cols() || screen.rows() != view.rows() ||
+      screen.cursor_col() != terminal.cursor_col() ||
+      screen.cursor_row() != terminal.cursor_row()) {
+    return false;
+  }
+  for (int row = 0; row < view.rows(); ++row) {
+    for (int col = 0; col < view.cols(); ++col) {
+      if (!(screen.row(row)[col] == view.at(col, row))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+Result run(int cols, int rows, const Chunks &chunks) {
+  Result result;
+  tide::core::Terminal terminal(cols, rows);
+  tide::core::ScreenEncoder encoder;
+  tide::core::RemoteScreen screen;
+  std::vector<uint8_t> out;
+  Clock::duration encoding{};
+
+  for (const std::string &chunk : chunks) {
+    terminal.feed(chunk.data(), chunk.size());
+    result.raw += chunk.size();
+
+    out.clear();
+    auto start = Clock::now();
+    bool sent = encoder.encode(terminal, out);
+    encoding += Clock::now() - start;
+    if (!sent) {
+      continue;
+    }
+    ++result.frames;
+    result.frame_bytes += out.size();
+    // Skip the message header, as the window does
+    constexpr size_t HEADER = 5;
+    if (!screen.apply(out.data() + HEADER, out.size() - HEADER) ||
+        !same_screen(terminal, screen)) {
+      result.ok = false;
+    }
+  }
+  result.encode_us =
+      result.frames == 0
+          ? 0.0
+          : std::chrono::duration<double, std::micro>(encoding).count() /
+                static_cast<double>(result.frames);
+  return result;
+}
+
+const char *PROMPT = "\x1b[32muser@host\x1b[0m:\x1b[34m~/src/tide\x1b[0m$ ";
+
+Chunks typing() {
+  const char *commands[] = {"git status --short", "ls -la core",
+                            "make -j8 2>&1 | tail", "vim core/terminal.cpp"};
+  Chunks chunks;
+  for (int i = 0; i < 200; ++i) {
+    chunks.emplace_back(PROMPT);
+    for (const char *c = commands[i % 4]; *c; ++c) {
+      chunks.emplace_back(1, *c);
+    }
+    chunks.emplace_back("\r\n");
+    chunks.emplace_back(" M core/terminal.cpp\r\n M core/screen_diff.cpp\r\n"
+                        "?? bench/remote_bench.cpp\r\n");
+  }
+  return chunks;
+}
+
+Chunks tail() {
+  Chunks chunks;
+  for (int i = 0; i < 5000; ++i) {
+    chunks.push_back("2026-10-18T12:00:" + std::to_string(10 + i % 50) +
+                     " \x1b[36mINFO\x1b[0m request " + std::to_string(i) +
+                     " GET /api/v1/items 200 " + std::to_string(i % 97) +
+                     "ms\r\n");
+  }
+  return chunks;
+}
+
+Chunks flood() {
+  std::string stream;
+  for (int i = 0; stream.size() < 16 * 1024 * 1024; ++i) {
+    stream += "[" + std::to_string(i) + "] CXX src/module_" +
+              std::to_string(i) + ".o ok\r\n";
+  }
+  Chunks chunks;
+  for (size_t offset = 0; offset < stream.size(); offset += 64 * 1024) {
+    chunks.push_back(stream.substr(offset, 64 * 1024));
+  }
+  return chunks;
+}
+
+Chunks top(int rows) {
+  Chunks chunks;
+  for (int refresh = 0; refresh < 500; ++refresh) {
+    std::string frame = "\x1b[H\x1b[7m  PID USER      %CPU %MEM COMMAND"
+                        "\x1b[K\x1b[0m\r\n";
+    for (int row = 1; row < rows - 1; ++row) {
+      // A few processes change between refreshes
+      int cpu = row <= 3 ? (refresh * 7 + row * 13) % 100 : row % 5;
+      frame += "\x1b[" + std::to_string(row + 1) + ";1H" +
+               std::to_string(1000 + row) + " user      " +
+               std::to_string(cpu) + ".0  1.2 process-" +
+               std::to_string(row) + "\x1b[K";
+    }
+    frame += "\x1b[" + std::to_string(rows) + ";1H\x1b[1mtasks: " +
+             std::to_string(rows - 2) + "\x1b[0m\x1b[K";
+    chunks.push_back(frame);
+  }
+  return chunks;
+}
+
+Chunks scroll(int rows) {
+  Chunks chunks;
+  chunks.push_back("\x1b[2J\x1b[1;" + std::to_string(rows - 1) + "r");
+  for (int line = 0; line < 3000; ++line) {
+    chunks.push_back("\x1b[" + std::to_string(rows - 1) + ";1H\n" +
+                     "\x1b[33m" + std::to_string(line) +
+                     "\x1b[0m  void Terminal::feed(const char *data, size_t "
+                     "size) {" +
+                     "\x1b[" + std::to_string(rows) + ";1H\x1b[7m" +
+                     "terminal.cpp " + std::to_string(line) + "\x1b[0m\x1b[K");
+  }
+  return chunks;
+}
+
+void print(const char *name, const Result &result) {
+  std::printf("%-7s %9.1f KB raw, %9.1f KB in %6llu frames: %6.1f%% of raw, "
+              "%5.1f us/frame%s\n",
+              name, static_cast<double>(result.raw) / 1024.0,
+              static_cast<double>(result.frame_bytes) / 1024.0,
+              static_cast<unsigned long long>(result.frames),
+              100.0 * static_cast<double>(result.frame_bytes) /
+                  static_cast<double>(result.raw),
+              result.encode_us, result.ok ? "" : "  MISMATCH");
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  int cols = argc > 1 ? std::atoi(argv[1]) : 120;
+  int rows = argc > 2 ? std::atoi(argv[2]) : 40;
+  std::printf("%dx%d\n", cols, rows);
+
+  bool ok = true;
+  auto bench = [&](const char *name, const Chunks &chunks) {
+    Result result = run(cols, rows, chunks);
+    print(name, result);
+    ok = ok && result.ok;
+  };
+  bench("typing", typing());
+  bench("tail", tail());
+  bench("flood", flood());
+  bench("top", top(rows));
+  bench("scroll", scroll(rows));
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+/**
+ * Scrollback memory and scroll-latency benchmark.
+ *
+ * Feeds build-log style output through a Terminal and reports history memory
+ * plus the cost of jumping the view into cold history. First checks that
+ * history pushed around a compact() (as HistoryBudget does), and repeated
+ * rows shared through compressed and spilled pages, read back intact, and
+ * that prompt marks go with replay history trimmed by the budget.
+ *
+ * Usage: scrollback_bench [lines] [--spill | --replay]
+ */
+
+#include "core/terminal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int COLS = 120;
+constexpr int ROWS = 40;
+
+size_t resident_bytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0, resident = 0;
+  statm >> pages >> resident;
+  return resident * 4096;
+}
+
+std::string log_line(size_t i) {
+  if (i % 7 == 0) {
+    return "src/module_" + std::to_string(i % 97) +
+           ".cpp:42:7: \x1b[1;35mwarning:\x1b[0m unused variable 'tmp' "
+           "[-Wunused-variable]\r\n";
+  }
+  return "\x1b[32m[" + std::to_string(i % 1000) +
+         "/1000]\x1b[0m Building CXX object "
+         "core/CMakeFiles/tide.dir/file_" +
+         std::to_string(i) + ".cpp.o\r\n";
+}
+
+// Push rows numbered `i % period` into `history`, starting at `first`
+void push_rows(tide::core::Scrollback &history, size_t first, size_t count,
+               size_t period = SIZE_MAX) {
+  std::vector<tide::core::Cell> row(COLS);
+  for (size_t i = first; i < first + count; ++i) {
+    std::string text = "row " + std::to_string(i % period);
+    std::fill(row.begin(), row.end(), tide::core::Cell{});
+    for (size_t col = 0; col < text.size(); ++col) {
+      row[col].codepoint = static_cast<char32_t>(text[col]);
+    }
+    history.push(row.data(), COLS);
+  }
+}
+
+// Rows of `history` that do not read back as pushed by push_rows()
+size_t count_wrong(const tide::core::Scrollback &history, size_t period) {
+  size_t wrong = 0;
+  for (size_t i = 0; i < history.size(); ++i) {
+    std::string expected = "row " + std::to_string(i % period);
+    const std::vector<char32_t> &text = history.line(i).text();
+    if (!std::equal(text.begin(), text.end(), expected.begin(),
+                    expected.end())) {
+      wrong++;
+    }
+  }
+  return wrong;
+}
+
+// Pages compacted early must not be compressed again when they leave the
+// hot window: every row reads back, and the accounting returns to zero
+bool check_compact() {
+  constexpr size_t BEFORE = 16 * tide::core::Scrollback::PAGE_LINES + 1;
+  constexpr size_t AFTER = 8 * tide::core::Scrollback::PAGE_LINES;
+  tide::core::Scrollback history(tide::core::Scrollback::UNLIMITED);
+  push_rows(history, 0, BEFORE);
+  history.compact();
+  push_rows(history, BEFORE, AFTER);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  push_rows(history, BEFORE + AFTER, 1); // Folds in the background results
+
+  size_t lost = count_wrong(history, SIZE_MAX);
+  if (lost > 0) {
+    std::printf("FAIL compact: %zu rows read back wrong\n", lost);
+  }
+
+  history.set_max_lines(0);
+  auto stats = history.stats();
+  if (stats.compressed_bytes != 0 || stats.raw_cold_bytes != 0) {
+    std::printf("FAIL compact: %zu compressed, %zu raw bytes left over\n",
+                stats.compressed_bytes, stats.raw_cold_bytes);
+    return false;
+  }
+  return lost == 0;
+}
+
+// Repeated rows are stored once and read back from every tier; dropping
+// the history releases every reference
+bool check_shared() {
+  constexpr size_t LINES = 32 * tide::core::Scrollback::PAGE_LINES;
+  constexpr size_t PERIOD = 100;
+  tide::core::Scrollback history(tide::core::Scrollback::UNLIMITED);
+  if (!history.enable_spill(0)) {
+    return true; // No spill file here; compact() covers the cold tier
+  }
+  push_rows(history, 0, LINES, PERIOD);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  push_rows(history, LINES, 1, PERIOD);
+
+  auto stats = history.stats();
+  bool ok = true;
+  // A few rows may collide in the store's table of recent hashes
+  if (stats.shared_rows < PERIOD * 9 / 10 || stats.shared_rows > PERIOD ||
+      stats.spilled_pages == 0) {
+    std::printf("FAIL shared: %zu rows stored, %zu pages spilled\n",
+                stats.shared_rows, stats.spilled_pages);
+    ok = false;
+  }
+  if (size_t wrong = count_wrong(history, PERIOD)) {
+    std::printf("FAIL shared: %zu rows read back wrong\n", wrong);
+    ok = false;
+  }
+
+  history.set_max_lines(0);
+  stats = history.stats();
+  if (stats.shared_rows != 0 || stats.shared_lines != 0) {
+    std::printf("FAIL shared: %zu rows, %zu references left over\n",
+                stats.shared_rows, stats.shared_lines);
+    ok = false;
+  }
+  return ok;
+}
+
+// Replay history trimmed by the budget takes its prompt marks along
+bool check_replay_marks() {
+  tide::core::Terminal terminal(COLS, ROWS);
+  terminal.set_history_mode(tide::core::HistoryMode::Replay);
+  auto prompts = [&terminal](size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      std::string line = "\x1b]133;A\x07$ make\r\n" + log_line(i);
+      terminal.feed(line.data(), line.size());
+    }
+  };
+  prompts(20000);
+
+  tide::core::HistoryBudget &budget = tide::core::HistoryBudget::instance();
+  size_t limit = budget.limit();
+  budget.set_limit(1); // Everything but the newest segment goes
+  budget.enforce();
+  budget.set_limit(limit);
+  prompts(1);
+
+  const tide::core::PromptMarks &marks = terminal.prompt_marks();
+  std::optional<tide::core::PromptMark> oldest =
+      marks.next(tide::core::MarkKind::PromptStart, 0);
+  if (terminal.history_base() == 0 || !oldest ||
+      oldest->line < terminal.history_base() ||
+      marks.size() > terminal.history_size() + ROWS) {
+    std::printf("FAIL replay marks: %zu marks for %zu lines from %llu\n",
+                marks.size(), terminal.history_size(),
+                static_cast<unsigned long long>(terminal.history_base()));
+    return false;
+  }
+  return true;
+}
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  size_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  std::string mode = argc > 2 ? argv[2] : "";
+  if (!check_compact() || !check_shared() || !check_replay_marks()) {
+    return 1;
+  }
+
+  size_t rss_before = resident_bytes();
+
+  tide::core::Terminal terminal(COLS, ROWS);
+  terminal.set_scrollback_limit(lines);
+  if (mode == "--spill" &&
+      !terminal.set_unlimited_scrollback(8 * 1024 * 1024)) {
+    std::fprintf(stderr, "spill file unavailable\n");
+    return 1;
+  }
+  if (mode == "--replay") {
+    terminal.set_history_mode(tide::core::HistoryMode::Replay);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < lines; ++i) {
+    std::string line = log_line(i);
+    terminal.feed(line.data(), line.size());
+  }
+  double feed_ms = ms_since(start);
+
+  // Let the background worker finish compressing, then fold the results in
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  terminal.feed("\r\n", 2);
+
+  size_t history_lines = terminal.history_size();
+  size_t uncompressed =
+      history_lines * (COLS * sizeof(tide::core::Cell) + 3 * sizeof(void *));
+
+  std::printf("lines:               %zu\n", history_lines);
+  std::printf("feed:                %.0f ms\n", feed_ms);
+  std::printf("full cell rows:      %.1f MB\n", uncompressed / 1e6);
+  std::printf("history memory:      %.1f MB\n",
+              terminal.history_memory_usage() / 1e6);
+
+  if (mode == "--replay") {
+    const auto &replay = terminal.replay_history();
+    std::printf("  raw stream:        %.1f MB, %zu checkpoints\n",
+                replay.bytes() / 1e6, replay.checkpoints().size());
+  } else {
+    auto stats = terminal.scrollback().stats();
+    std::printf("  hot:               %.1f MB (%zu lines)\n",
+                stats.hot_bytes / 1e6, stats.hot_rows);
+    std::printf(
+        "  compressed:        %.1f MB (from %.1f MB, %zu/%zu pages)\n",
+        stats.compressed_bytes / 1e6, stats.raw_cold_bytes / 1e6,
+        stats.cold_pages, stats.pages);
+    std::printf("  spilled to file:   %.1f MB (%zu pages)\n",
+                stats.spilled_bytes / 1e6, stats.spilled_pages);
+    std::printf("  shared rows:       %.1f MB (%zu rows for %zu lines), "
+                "dedup %.2fx\n",
+                stats.shared_bytes / 1e6, stats.shared_rows,
+                stats.shared_lines, stats.dedup_ratio());
+  }
+  std::printf("process RSS growth:  %.1f MB\n",
+              (resident_bytes() - rss_before) / 1e6);
+
+  // Jump into random cold positions and render a full screen
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> pos(ROWS, terminal.max_scroll());
+  std::vector<double> jump_ms;
+  for (int i = 0; i < 200; ++i) {
+    terminal.scroll_to_bottom();
+    auto t0 = std::chrono::steady_clock::now();
+    terminal.scroll_view(pos(rng));
+    for (int row = 0; row < ROWS; ++row) {
+      (void)terminal.get_visible_row(row);
+    }
+    jump_ms.push_back(ms_since(t0));
+  }
+  std::sort(jump_ms.begin(), jump_ms.end());
+
+  // Continuous wheel scrolling upward, 3 lines per step
+  terminal.scroll_to_bottom();
+  std::vector<double> step_ms;
+  for (int i = 0; i < 20000 && terminal.scroll_offset() < terminal.max_scroll();
+       ++i) {
+    auto t0 = std::chrono::steady_clock::now();
+    terminal.scroll_view(3);
+    for (int row = 0; row < ROWS; ++row) {
+      (void)terminal.get_visible_row(row);
+    }
+    step_ms.push_back(ms_since(t0));
+  }
+  std::sort(step_ms.begin(), step_ms.end());
+
+  auto pct = [](const std::vector<double> &v, double p) {
+    return v[static_cast<size_t>(p * (v.size() - 1))];
+  };
+  std::printf("random jump:         p50 %.3f ms  p99 %.3f ms\n",
+              pct(jump_ms, 0.5), pct(jump_ms, 0.99));
+  std::printf("wheel step:          p50 %.3f ms  p99 %.3f ms\n",
+              pct(step_ms, 0.5), pct(step_ms, 0.99));
+  return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * Parallel session parsing benchmark.
+ *
+ * Runs several sessions flooding output at once and parses them the way the
+ * main loop does, in SessionManager rounds, reporting combined throughput
+ * and how evenly the parse work was shared. First checks that closing one
+ * tab hangs up its shell while a newer tab is still running.
+ *
+ * Usage: session_bench [sessions] [megabytes each] [--serial]
+ */
+
+#include "core/session_manager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int COLS = 120;
+constexpr int ROWS = 40;
+constexpr size_t PARSE_SLICE = 64 * 1024;
+
+// A later tab's shell must not inherit an earlier tab's PTY master, or
+// closing the earlier tab never hangs up its shell
+bool check_close() {
+  tide::core::SessionManager sessions(0);
+  tide::core::Session *first = sessions.create(COLS, ROWS, {"cat"});
+  tide::core::Session *second = sessions.create(COLS, ROWS, {"cat"});
+  if (!first || !second) {
+    return false;
+  }
+  if (first->pty().pid_fd() < 0) {
+    return true; // No pidfds to watch the child with
+  }
+
+  // Outlives the session, whose pidfd goes to the reaper
+  pollfd exited = {fcntl(first->pty().pid_fd(), F_DUPFD_CLOEXEC, 0), POLLIN,
+                   0};
+  sessions.close(first);
+  bool ok = ::poll(&exited, 1, 2000) == 1;
+  ::close(exited.fd);
+  if (!ok) {
+    std::printf("FAIL close: the closed tab's shell is still running\n");
+  }
+  sessions.close_all();
+  return ok;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8;
+  size_t megabytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10;
+  bool serial = argc > 3 && std::string(argv[3]) == "--serial";
+  if (!check_close()) {
+    return 1;
+  }
+
+  tide::core::SessionManager sessions(
+      serial ? 0 : tide::core::WorkerPool::default_threads());
+  std::string script = "yes 'tail: app.log: 2024-01-01 12:00:00 INFO ok' | "
+                       "head -c " +
+                       std::to_string(megabytes * 1000000);
+  for (size_t i = 0; i < count; ++i) {
+    if (!sessions.create(COLS, ROWS, {"sh", "-c", script})) {
+      return 1;
+    }
+  }
+
+  // Parse until every child has exited, tracking each session's share
+  std::vector<uint64_t> parsed(count, 0);
+  std::vector<uint64_t> rounds_busy(count, 0);
+  uint64_t rounds = 0;
+  auto start = std::chrono::steady_clock::now();
+  bool running = true;
+  while (running) {
+    sessions.parse(PARSE_SLICE);
+    ++rounds;
+    running = false;
+    for (size_t i = 0; i < sessions.size(); ++i) {
+      tide::core::Session *session = sessions.at(i);
+      parsed[i] += session->parsed();
+      rounds_busy[i] += session->parsed() > 0;
+      running = running || !session->finished();
+    }
+  }
+  double elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  uint64_t total = 0;
+  for (uint64_t bytes : parsed) {
+    total += bytes;
+  }
+  auto [least, most] = std::minmax_element(parsed.begin(), parsed.end());
+  std::printf("sessions:            %zu\n", count);
+  std::printf("parse threads:       %zu\n", sessions.concurrency());
+  std::printf("rounds:              %llu\n",
+              static_cast<unsigned long long>(rounds));
+  std::printf("throughput:          %.1f MB/s\n",
+              static_cast<double>(total) / 1e6 / elapsed);
+  std::printf("per session:         %.1f - %.1f MB\n",
+              static_cast<double>(*least) / 1e6,
+              static_cast<double>(*most) / 1e6);
+  sessions.close_all();
+  return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ * tmux pane switch benchmark.
+ *
+ * Starts a private tmux server with a few windows of colored output, then
+ * switches between them the two ways tide can run tmux:
+ *   - plain:   a tmux client on a PTY (tmux inside tide); every switch is
+ *              a full repaint of the pane that tide has to parse again,
+ *   - control: tmux -CC through TmuxControl; each pane already lives in
+ *              its own terminal, so a switch only sends tmux the select
+ *              commands and reads back their replies.
+ * Counts the bytes tmux sends per switch, and checks that every pane's
+ * terminal holds its output after attaching in control mode.
+ *
+ * Usage: tmux_bench [windows] [switches]
+ */
+
+#include "core/pty.hpp"
+#include "core/tmux_control.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int COLS = 80;
+constexpr int ROWS = 24;
+constexpr int LINES = 500; // Per window
+constexpr auto QUIET = std::chrono::milliseconds(150); // End of a reply
+
+std::string tmux(const std::string &socket) {
+  return "tmux -L " + socket + " -f /dev/null ";
+}
+
+// Bytes a plain client prints until it has been quiet for QUIET
+size_t read_until_quiet(tide::core::Pty &pty) {
+  size_t total = 0;
+  char buffer[65536];
+  while (true) {
+    pollfd ready{pty.master_fd(), POLLIN, 0};
+    if (::poll(&ready, 1, static_cast<int>(QUIET.count())) <= 0) {
+      return total;
+    }
+    ssize_t n = pty.read(buffer, sizeof(buffer));
+    if (n < 0) {
+      return total;
+    }
+    total += static_cast<size_t>(n);
+  }
+}
+
+// Poll until `done` or the timeout
+template <typename F>
+bool pump(tide::core::TmuxControl &control, F done, int timeout_ms = 5000) {
+  auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (Clock::now() < deadline) {
+    control.flush();
+    control.poll();
+    if (done()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return false;
+}
+
+// Bytes tmux sends in control mode until it has been quiet for QUIET
+uint64_t control_until_quiet(tide::core::TmuxControl &control) {
+  uint64_t before = control.stats().control_bytes;
+  uint64_t last = before;
+  auto quiet_since = Clock::now();
+  while (Clock::now() - quiet_since < QUIET) {
+    control.flush();
+    control.poll();
+    if (control.stats().control_bytes != last) {
+      last = control.stats().control_bytes;
+      quiet_since = Clock::now();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return last - before;
+}
+
+// Kills the private tmux server (and its panes) on every way out of main()
+struct ServerGuard {
+  std::string socket;
+  ~ServerGuard() { std::system((tmux(socket) + "kill-server").c_str()); }
+};
+
+bool shows(const tide::core::Terminal &terminal, const std::string &text) {
+  for (int row = 0; row < terminal.rows(); ++row) {
+    std::string line;
+    const tide::core::Cell *cells = terminal.get_visible_row(row);
+    for (int col = 0; col < terminal.cols(); ++col) {
+      char32_t cp = cells[col].codepoint;
+      line += cp < 128 ? static_cast<char>(cp) : '?';
+    }
+    if (line.find(text) != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+  int windows = argc > 1 ? std::atoi(argv[1]) : 4;
+  int switches = argc > 2 ? std::atoi(argv[2]) : 20;
+  std::string socket = "tide-bench-" + std::to_string(getpid());
+  ServerGuard server{socket};
+
+  // Each window prints a screenful of colored lines and waits
+  for (int w = 0; w < windows; ++w) {
+    std::string script =
+        "'awk \"BEGIN { for (i = 0; i < " + std::to_string(LINES) +
+        "; i++) printf \\\"\\\\033[3%dm%05d window " + std::to_string(w) +
+        " the quick brown fox jumps over the lazy dog\\\\033[0m\\\\n\\\", "
+        "i % 8, i }\"; exec sleep 100000'";
+    std::string command =
+        tmux(socket) +
+        (w == 0 ? "new-session -d -x " + std::to_string(COLS) + " -y " +
+                      std::to_string(ROWS) + " "
+                : "new-window -d ") +
+        script;
+    if (std::system(command.c_str()) != 0) {
+      std::fprintf(stderr, "tmux failed to start\n");
+      return 1;
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  int failures = 0;
+
+  // Plain client: next-window (C-b n) repaints the whole screen
+  {
+    tide::core::Pty pty;
+    if (!pty.spawn({"tmux", "-L", socket, "-f", "/dev/null", "attach"})) {
+      return 1;
+    }
+    pty.resize(COLS, ROWS);
+    size_t attach = read_until_quiet(pty);
+    size_t total = 0;
+    for (int i = 0; i < switches; ++i) {
+      pty.write("\x02n", 2);
+      total += read_until_quiet(pty);
+    }
+    std::printf("plain tmux:   attach %6zu bytes, %6.0f bytes per switch\n",
+                attach, static_cast<double>(total) / switches);
+  }
+
+  // Control mode: panes are terminals of ours; switching selects only
+  {
+    tide::core::TmuxControl control;
+    auto start = Clock::now();
+    if (!control.start(COLS, ROWS, [] {},
+                       {"-L", socket, "-f", "/dev/null", "attach"})) {
+      return 1;
+    }
+    auto synced = [&] {
+      if (control.pane_count() != static_cast<size_t>(windows)) {
+        return false;
+      }
+      for (size_t i = 0; i < control.pane_count(); ++i) {
+        if (!control.pane(i).synced) {
+          return false;
+        }
+      }
+      return true;
+    };
+    if (!pump(control, synced)) {
+      std::printf("FAIL panes never synced (%zu of %d)\n",
+                  control.pane_count(), windows);
+      return 1;
+    }
+    double attach_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+    control_until_quiet(control);
+    tide::core::TmuxControl::Stats attached = control.stats();
+
+    // Every pane shows its last line, history went to our scrollback
+    for (size_t i = 0; i < control.pane_count(); ++i) {
+      const tide::core::TmuxControl::Pane &pane = control.pane(i);
+      char last[64];
+      std::snprintf(last, sizeof(last), "%05d window", LINES - 1);
+      if (!shows(pane.terminal, last) ||
+          pane.terminal.history_size() + 2 < static_cast<size_t>(LINES) -
+                                                 static_cast<size_t>(ROWS)) {
+        std::printf("FAIL pane %%%d: missing output (history %zu)\n", pane.id,
+                    pane.terminal.history_size());
+        ++failures;
+      }
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < switches; ++i) {
+      const auto &next = control.pane((i + 1) % control.pane_count());
+      control.select(next.id);
+      total += control_until_quiet(control);
+      if (control.active_pane() != next.id) {
+        std::printf("FAIL switch to %%%d not confirmed\n", next.id);
+        ++failures;
+        break;
+      }
+    }
+    std::printf("control mode: attach %6llu bytes, %6.0f bytes per switch "
+                "(%.1f ms to sync %d panes, %llu bytes of captures)\n",
+                static_cast<unsigned long long>(attached.control_bytes),
+                static_cast<double>(total) / switches, attach_ms, windows,
+                static_cast<unsigned long long>(attached.capture_bytes));
+
+    // Input reaches the pane, and its window closing removes it
+    int first = control.pane(0).id;
+    control.write(first, "\x03"); // Stops sleep, which ends the pane
+    if (!pump(control, [&] { return control.find_pane(first) == nullptr; })) {
+      std::printf("FAIL pane did not close after its command ended\n");
+      ++failures;
+    }
+  }
+
+  return failures;
+}
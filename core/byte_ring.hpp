@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Single-producer/single-consumer byte ring.
+ *
+ * One thread writes and another reads without locks: each side owns one
+ * free-running position and publishes it with a release store. The capacity
+ * is a power of two, so positions wrap by masking. Both sides work on
+ * contiguous regions of the buffer directly, so bytes are never copied
+ * through an intermediate buffer.
+ */
+class ByteRing {
+public:
+  /**
+   * @param capacity Rounded up to a power of two
+   */
+  explicit ByteRing(size_t capacity)
+      : buffer_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+        mask_(buffer_.size() - 1) {}
+
+  // Non-copyable
+  ByteRing(const ByteRing &) = delete;
+  ByteRing &operator=(const ByteRing &) = delete;
+
+  [[nodiscard]] size_t capacity() const { return buffer_.size(); }
+
+  /**
+   * Bytes buffered (exact on the consumer side, a lower bound elsewhere).
+   */
+  [[nodiscard]] size_t size() const {
+    return static_cast<size_t>(tail_.load(std::memory_order_acquire) -
+                               head_.load(std::memory_order_acquire));
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+  [[nodiscard]] bool full() const { return size() == capacity(); }
+
+  // Producer side
+  /**
+   * Contiguous free space at the write position.
+   * @param size Set to the writable length (0 if full)
+   */
+  char *write_region(size_t &size) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    size_t offset = static_cast<size_t>(tail) & mask_;
+    size = std::min(capacity() - static_cast<size_t>(tail - head),
+                    capacity() - offset);
+    return buffer_.data() + offset;
+  }
+
+  /**
+   * Publish `n` bytes written into the last write_region().
+   */
+  void commit(size_t n) {
+    tail_.store(tail_.load(std::memory_order_relaxed) + n,
+                std::memory_order_release);
+  }
+
+  // Consumer side
+  /**
+   * Contiguous buffered bytes at the read position.
+   * @param size Set to the readable length (0 if empty)
+   */
+  const char *read_region(size_t &size) const {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    size_t offset = static_cast<size_t>(head) & mask_;
+    size = std::min(static_cast<size_t>(tail - head), capacity() - offset);
+    return buffer_.data() + offset;
+  }
+
+  /**
+   * Release `n` bytes from the last read_region() back to the producer.
+   */
+  void consume(size_t n) {
+    head_.store(head_.load(std::memory_order_relaxed) + n,
+                std::memory_order_release);
+  }
+
+private:
+  std::vector<char> buffer_;
+  size_t mask_;
+  alignas(64) std::atomic<uint64_t> head_{0}; // Consumer position
+  alignas(64) std::atomic<uint64_t> tail_{0}; // Producer position
+};
+
+} // namespace tide::core
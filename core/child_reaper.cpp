@@ -0,0 +1,181 @@
+#include "core/child_reaper.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace tide::core {
+
+namespace {
+
+// epoll data of the reaper's own descriptors; pidfds carry pid << 32 | fd,
+// and pids never reach the top bits
+constexpr uint64_t WAKE_EVENT = UINT64_MAX;
+constexpr uint64_t SIGNAL_EVENT = UINT64_MAX - 1;
+
+sigset_t child_signal() {
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGCHLD);
+  return set;
+}
+
+} // anonymous namespace
+
+ChildReaper &ChildReaper::instance() {
+  static ChildReaper reaper;
+  return reaper;
+}
+
+void ChildReaper::block_child_signal() {
+  sigset_t set = child_signal();
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+}
+
+ChildReaper::~ChildReaper() {
+  if (thread_.joinable()) {
+    uint64_t one = 1;
+    (void)!::write(wake_fd_, &one, sizeof(one));
+    thread_.join();
+  }
+  // Children still running are reparented to init when we exit
+  if (wake_fd_ >= 0) {
+    ::close(wake_fd_);
+  }
+  if (signal_fd_ >= 0) {
+    ::close(signal_fd_);
+  }
+  if (epoll_fd_ >= 0) {
+    ::close(epoll_fd_);
+  }
+}
+
+bool ChildReaper::adopt(pid_t pid, int pid_fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!thread_.joinable() && !start_locked()) {
+    if (pid_fd >= 0) {
+      ::close(pid_fd);
+    }
+    return false;
+  }
+
+  if (pid_fd >= 0) {
+    // Level-triggered: a child that exited already is reaped right away
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = (static_cast<uint64_t>(pid) << 32) |
+                     static_cast<uint32_t>(pid_fd);
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, pid_fd, &event) == 0) {
+      ++pending_;
+      return true;
+    }
+    std::cerr << "[tide] Failed to watch child " << pid << ": "
+              << std::strerror(errno) << std::endl;
+    ::close(pid_fd);
+  }
+
+  // No pidfd to watch: reap it on SIGCHLD
+  if (signal_fd_ < 0) {
+    return false;
+  }
+  waiting_.push_back(pid);
+  ++pending_;
+  reap_waiting_locked(); // It may have exited already
+  return true;
+}
+
+size_t ChildReaper::pending() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_;
+}
+
+bool ChildReaper::start_locked() {
+  if (epoll_fd_ < 0) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event wake_event{};
+    wake_event.events = EPOLLIN;
+    wake_event.data.u64 = WAKE_EVENT;
+    if (epoll_fd_ < 0 || wake_fd_ < 0 ||
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event) < 0) {
+      std::cerr << "[tide] Failed to set up child reaper: "
+                << std::strerror(errno) << std::endl;
+      return false;
+    }
+
+    // Without it only children with a pidfd can be reaped
+    sigset_t set = child_signal();
+    signal_fd_ = signalfd(-1, &set, SFD_CLOEXEC | SFD_NONBLOCK);
+    epoll_event signal_event{};
+    signal_event.events = EPOLLIN;
+    signal_event.data.u64 = SIGNAL_EVENT;
+    if (signal_fd_ < 0 || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, signal_fd_,
+                                    &signal_event) < 0) {
+      std::cerr << "[tide] Failed to watch SIGCHLD: " << std::strerror(errno)
+                << std::endl;
+      if (signal_fd_ >= 0) {
+        ::close(signal_fd_);
+        signal_fd_ = -1;
+      }
+    }
+  }
+  thread_ = std::thread(&ChildReaper::run, this);
+  return true;
+}
+
+void ChildReaper::run() {
+  while (true) {
+    epoll_event events[16];
+    int count = epoll_wait(epoll_fd_, events, 16, -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "[tide] Child reaper epoll_wait failed: "
+                << std::strerror(errno) << std::endl;
+      return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+      uint64_t data = events[i].data.u64;
+      if (data == WAKE_EVENT) {
+        return; // Destruction
+      }
+      if (data == SIGNAL_EVENT) {
+        // Signals coalesce, so any of the waiting children may have exited
+        signalfd_siginfo info;
+        while (::read(signal_fd_, &info, sizeof(info)) > 0) {
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        reap_waiting_locked();
+        continue;
+      }
+      auto pid = static_cast<pid_t>(data >> 32);
+      auto pid_fd = static_cast<int>(data & UINT32_MAX);
+      int status = 0;
+      if (waitpid(pid, &status, WNOHANG) == 0) {
+        continue; // Spurious; still running
+      }
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, pid_fd, nullptr);
+      ::close(pid_fd);
+      std::lock_guard<std::mutex> lock(mutex_);
+      --pending_;
+    }
+  }
+}
+
+void ChildReaper::reap_waiting_locked() {
+  // Nonzero: reaped, or no longer ours to wait for
+  size_t reaped = std::erase_if(
+      waiting_, [](pid_t pid) { return waitpid(pid, nullptr, WNOHANG) != 0; });
+  pending_ -= reaped;
+}
+
+} // namespace tide::core
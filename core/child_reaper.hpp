@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Process-wide reaper for children whose Pty closed before they exited.
+ *
+ * Closing the master hangs up the child, but it exits some time later;
+ * nobody is left to collect its status, so it would stay a zombie. The
+ * reaper adopts its pidfd and reaps it when that becomes readable, on a
+ * thread that sleeps in epoll_wait while nothing is pending.
+ *
+ * Children without a pidfd (before Linux 5.3) are reaped with WNOHANG
+ * whenever SIGCHLD arrives on a signalfd in the same epoll set. That only
+ * works while SIGCHLD is blocked in every thread: call block_child_signal()
+ * before the first thread starts.
+ */
+class ChildReaper {
+public:
+  static ChildReaper &instance();
+
+  /**
+   * Block SIGCHLD in the calling thread (and the threads it starts later),
+   * so it is left for the reaper's signalfd. Children must unblock it
+   * before exec.
+   */
+  static void block_child_signal();
+
+  ~ChildReaper();
+
+  // Non-copyable
+  ChildReaper(const ChildReaper &) = delete;
+  ChildReaper &operator=(const ChildReaper &) = delete;
+
+  /**
+   * Reap `pid` once it exits. Takes ownership of `pid_fd`; without one (-1,
+   * before Linux 5.3) it is reaped on SIGCHLD instead.
+   * @return false if it could not be watched (the child may stay a zombie)
+   */
+  bool adopt(pid_t pid, int pid_fd);
+
+  /**
+   * Children adopted but not yet reaped.
+   */
+  [[nodiscard]] size_t pending() const;
+
+private:
+  mutable std::mutex mutex_;
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1; // eventfd that interrupts epoll_wait() on destruction
+  int signal_fd_ = -1; // SIGCHLD, for children without a pidfd
+  std::vector<pid_t> waiting_; // Adopted without a pidfd
+  std::thread thread_; // Started by the first adopt()
+  size_t pending_ = 0;
+
+  ChildReaper() = default;
+
+  bool start_locked();
+  void reap_waiting_locked();
+  void run();
+};
+
+} // namespace tide::core
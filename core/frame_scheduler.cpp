@@ -0,0 +1,94 @@
+#include "core/frame_scheduler.hpp"
+
+#include <algorithm>
+
+namespace tide::core {
+
+void FrameScheduler::on_input(Clock::time_point now) {
+  if (!input_pending_ || now - input_time_ > ECHO_TIMEOUT) {
+    input_time_ = now; // Latency runs from the oldest keypress shown
+    echo_ready_ = false;
+  }
+  input_pending_ = true;
+}
+
+void FrameScheduler::on_output(size_t bytes, Clock::duration parse_time,
+                               Clock::time_point now) {
+  stats_.parse += parse_time;
+  if (bytes == 0) {
+    return;
+  }
+  stats_.bytes += bytes;
+
+  if (input_pending_) {
+    if (now - input_time_ <= ECHO_TIMEOUT) {
+      echo_ready_ = true;
+    } else {
+      input_pending_ = false; // No echo came; this output is unrelated
+    }
+  }
+
+  // Rate over whole windows; a long pause makes the next window slow
+  auto elapsed = now - window_start_;
+  if (elapsed >= RATE_WINDOW) {
+    rate_ = static_cast<double>(window_bytes_) /
+            std::chrono::duration<double>(elapsed).count();
+    window_start_ = now;
+    window_bytes_ = 0;
+  }
+  window_bytes_ += bytes;
+  last_output_ = now;
+}
+
+bool FrameScheduler::flooding(Clock::time_point now) const {
+  return rate_ >= FLOOD_RATE && now - last_output_ < RATE_WINDOW;
+}
+
+bool FrameScheduler::should_present(Clock::time_point now) {
+  if (echo_ready_ || now >= next_frame(now)) {
+    return true;
+  }
+  ++stats_.held;
+  return false;
+}
+
+FrameScheduler::Clock::time_point
+FrameScheduler::next_frame(Clock::time_point now) const {
+  if (!flooding(now)) {
+    return now;
+  }
+  return last_present_ + FLOOD_FRAME_INTERVAL;
+}
+
+FrameScheduler::Clock::time_point
+FrameScheduler::parse_deadline(Clock::time_point now) const {
+  if (flooding(now)) {
+    return std::max(now, next_frame(now));
+  }
+  return now + PARSE_BUDGET;
+}
+
+void FrameScheduler::presented(Clock::duration render_time,
+                               Clock::duration present_time,
+                               Clock::time_point now) {
+  ++stats_.frames;
+  stats_.render += render_time;
+  stats_.present += present_time;
+  if (echo_ready_) {
+    auto latency = now - input_time_;
+    ++stats_.echoes;
+    stats_.latency += latency;
+    stats_.max_latency = std::max(stats_.max_latency, latency);
+    input_pending_ = false;
+    echo_ready_ = false;
+  }
+  last_present_ = now;
+}
+
+FrameScheduler::Stats FrameScheduler::take_stats() {
+  Stats stats = stats_;
+  stats_ = Stats{};
+  return stats;
+}
+
+} // namespace tide::core
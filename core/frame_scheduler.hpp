@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace tide::core {
+
+/**
+ * Decides when the main loop presents a frame, so parsing and rendering do
+ * not split every loop iteration evenly.
+ *
+ *   - Idle: nothing changed, nothing is drawn.
+ *   - Interactive: a changed screen is drawn at once. After a keypress the
+ *     frame carrying its echo is drawn the moment the echo is parsed, even
+ *     during a flood.
+ *   - Flood: while output arrives faster than FLOOD_RATE, frames are capped
+ *     at FLOOD_FRAME_INTERVAL and the time in between goes to parsing.
+ *     Outside floods, parsing yields to drawing after PARSE_BUDGET, so a
+ *     large burst cannot delay a frame for long either.
+ *
+ * The scheduler only keeps time; the loop reports output, input and
+ * presented frames, and asks should_present() and next_frame().
+ */
+class FrameScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr double FLOOD_RATE = 1024.0 * 1024.0; // Bytes per second
+  static constexpr auto FLOOD_FRAME_INTERVAL = std::chrono::milliseconds(33);
+  static constexpr auto RATE_WINDOW = std::chrono::milliseconds(100);
+  static constexpr auto ECHO_TIMEOUT = std::chrono::milliseconds(250);
+  static constexpr auto PARSE_BUDGET = std::chrono::milliseconds(8);
+
+  /**
+   * Per-phase totals since the last take_stats().
+   */
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t held = 0;  // Iterations with a changed screen left undrawn
+    uint64_t bytes = 0; // Output parsed
+    Clock::duration parse{};
+    Clock::duration render{};
+    Clock::duration present{};
+    uint64_t echoes = 0; // Keypresses whose echo was presented
+    Clock::duration latency{}; // Sum of keypress-to-present times
+    Clock::duration max_latency{};
+  };
+
+  /**
+   * Input was sent to the child; its echo is presented without delay.
+   */
+  void on_input(Clock::time_point now);
+
+  /**
+   * Output was parsed this iteration.
+   */
+  void on_output(size_t bytes, Clock::duration parse_time,
+                 Clock::time_point now);
+
+  /**
+   * Check if output is arriving faster than FLOOD_RATE.
+   */
+  [[nodiscard]] bool flooding(Clock::time_point now) const;
+
+  /**
+   * Check if the echo of a keypress has been parsed but not presented;
+   * parsing should stop so it can be drawn.
+   */
+  [[nodiscard]] bool echo_ready() const { return echo_ready_; }
+
+  /**
+   * How long parsing that starts at `now` may run before drawing: until
+   * the capped frame is due during a flood, else PARSE_BUDGET.
+   */
+  [[nodiscard]] Clock::time_point parse_deadline(Clock::time_point now) const;
+
+  /**
+   * Check if a changed screen should be drawn now. Counts a held frame
+   * when not.
+   */
+  bool should_present(Clock::time_point now);
+
+  /**
+   * When a changed screen that should_present() held back becomes due.
+   */
+  [[nodiscard]] Clock::time_point next_frame(Clock::time_point now) const;
+
+  /**
+   * A frame was drawn and presented.
+   * @param render_time Building and uploading the frame
+   * @param present_time Swapping buffers
+   * @param now After the swap
+   */
+  void presented(Clock::duration render_time, Clock::duration present_time,
+                 Clock::time_point now);
+
+  /**
+   * Return and reset the totals.
+   */
+  Stats take_stats();
+
+private:
+  Clock::time_point last_present_{};
+  Clock::time_point last_output_{};
+  Clock::time_point window_start_{};
+  uint64_t window_bytes_ = 0;
+  double rate_ = 0.0; // Bytes per second over the last full window
+
+  Clock::time_point input_time_{}; // Oldest keypress not yet presented
+  bool input_pending_ = false;
+  bool echo_ready_ = false; // Output parsed since that keypress
+
+  Stats stats_;
+};
+
+} // namespace tide::core
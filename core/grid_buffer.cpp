@@ -7,7 +7,9 @@
 namespace tide::core {
 
 GridBuffer::GridBuffer(int cols, int rows)
-    : cols_(cols), rows_(rows), cells_(static_cast<size_t>(cols * rows)) {
+    : cols_(cols), rows_(rows), cells_(static_cast<size_t>(cols * rows)),
+      wrapped_(static_cast<size_t>(rows)),
+      generations_(static_cast<size_t>(rows)) {
   clear();
 }
 
@@ -39,10 +41,19 @@ void GridBuffer::resize(int new_cols, int new_rows) {
   cols_ = new_cols;
   rows_ = new_rows;
   cells_ = std::move(new_cells);
+  wrapped_.resize(static_cast<size_t>(new_rows));
+  generations_.resize(static_cast<size_t>(new_rows));
+  for (int row = 0; row < rows_; ++row) {
+    touch(row);
+  }
 }
 
 void GridBuffer::clear(const Cell &cell) {
   std::fill(cells_.begin(), cells_.end(), cell);
+  std::fill(wrapped_.begin(), wrapped_.end(), 0);
+  for (int row = 0; row < rows_; ++row) {
+    touch(row);
+  }
 }
 
 void GridBuffer::clear_row(int row, const Cell &cell) {
@@ -53,12 +64,53 @@ void GridBuffer::clear_row(int row, const Cell &cell) {
   auto start = cells_.begin() + index(0, row);
   auto end = start + cols_;
   std::fill(start, end, cell);
+  wrapped_[static_cast<size_t>(row)] = 0;
+  touch(row);
+}
+
+void GridBuffer::scroll_up(int n, const Cell &blank) {
+  n = std::clamp(n, 0, rows_);
+  if (n == 0) {
+    return;
+  }
+
+  // Rows are contiguous, so this is one block move
+  std::copy(cells_.begin() + index(0, n), cells_.end(), cells_.begin());
+  std::copy(wrapped_.begin() + n, wrapped_.end(), wrapped_.begin());
+  std::copy(generations_.begin() + n, generations_.end(),
+            generations_.begin());
+  for (int row = rows_ - n; row < rows_; ++row) {
+    clear_row(row, blank);
+  }
+}
+
+void GridBuffer::scroll_down(int n, const Cell &blank) {
+  n = std::clamp(n, 0, rows_);
+  if (n == 0) {
+    return;
+  }
+
+  std::copy_backward(cells_.begin(), cells_.end() - index(0, n),
+                     cells_.end());
+  std::copy_backward(wrapped_.begin(), wrapped_.end() - n, wrapped_.end());
+  std::copy_backward(generations_.begin(), generations_.end() - n,
+                     generations_.end());
+  for (int row = 0; row < n; ++row) {
+    clear_row(row, blank);
+  }
+}
+
+void GridBuffer::set_wrapped(int row, bool wrapped) {
+  if (row >= 0 && row < rows_) {
+    wrapped_[static_cast<size_t>(row)] = wrapped;
+  }
 }
 
 Cell &GridBuffer::at(int col, int row) {
   if (!valid(col, row)) {
     throw std::out_of_range("GridBuffer::at: position out of range");
   }
+  touch(row); // Caller may write through the reference
   return cells_[index(col, row)];
 }
 
@@ -72,12 +124,14 @@ const Cell &GridBuffer::at(int col, int row) const {
 void GridBuffer::set(int col, int row, const Cell &cell) {
   if (valid(col, row)) {
     cells_[index(col, row)] = cell;
+    touch(row);
   }
 }
 
 void GridBuffer::set_char(int col, int row, char32_t codepoint) {
   if (valid(col, row)) {
     cells_[index(col, row)].codepoint = codepoint;
+    touch(row);
   }
 }
 
@@ -27,6 +27,23 @@ struct Cell {
   Cell() = default;
   Cell(char32_t cp, theme::Color fg, theme::Color bg)
       : codepoint(cp), foreground(fg), background(bg) {}
+
+  bool operator==(const Cell &other) const = default;
+};
+
+/**
+ * Half-open range of columns on one row.
+ */
+struct ColumnSpan {
+  int start = 0;
+  int end = 0; // Exclusive
+
+  [[nodiscard]] bool empty() const { return start >= end; }
+  [[nodiscard]] bool contains(int col) const {
+    return col >= start && col < end;
+  }
+
+  bool operator==(const ColumnSpan &) const = default;
 };
 
 /**
@@ -58,10 +75,38 @@ public:
   void clear(const Cell &cell = Cell{});
 
   /**
-   * Clear a specific row.
+   * Clear a specific row (also resets its wrapped flag).
    */
   void clear_row(int row, const Cell &cell = Cell{});
 
+  /**
+   * Move all rows up by `n`, filling the bottom with `blank`.
+   */
+  void scroll_up(int n, const Cell &blank = Cell{});
+
+  /**
+   * Move all rows down by `n`, filling the top with `blank`.
+   */
+  void scroll_down(int n, const Cell &blank = Cell{});
+
+  /**
+   * Whether a row was ended by autowrap, i.e. continues on the next row.
+   */
+  [[nodiscard]] bool wrapped(int row) const {
+    return row >= 0 && row < rows_ && wrapped_[static_cast<size_t>(row)];
+  }
+  void set_wrapped(int row, bool wrapped);
+
+  /**
+   * Content generation of a row. Every change to a row gives it a new value
+   * that no other row has had, and the value moves with the row when the
+   * grid scrolls, so it can key per-row caches. Non-const at() counts as a
+   * change.
+   */
+  [[nodiscard]] uint64_t generation(int row) const {
+    return generations_[static_cast<size_t>(row)];
+  }
+
   /**
    * Get a cell at the specified position.
    * @return Reference to the cell
@@ -83,13 +128,18 @@ public:
   [[nodiscard]] int cols() const { return cols_; }
   [[nodiscard]] int rows() const { return rows_; }
 
-  // TODO: Add scrollback buffer support
-  // TODO: Add dirty region tracking for efficient rendering
 
 private:
   int cols_;
   int rows_;
   std::vector<Cell> cells_;
+  std::vector<uint8_t> wrapped_; // One flag per row
+  std::vector<uint64_t> generations_;
+  uint64_t next_generation_ = 0;
+
+  void touch(int row) {
+    generations_[static_cast<size_t>(row)] = ++next_generation_;
+  }
 
   [[nodiscard]] size_t index(int col, int row) const {
     return static_cast<size_t>(row * cols_ + col);
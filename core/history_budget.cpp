@@ -0,0 +1,115 @@
+#include "core/history_budget.hpp"
+
+#include <algorithm>
+
+namespace tide::core {
+
+HistoryBudget &HistoryBudget::instance() {
+  static HistoryBudget budget;
+  return budget;
+}
+
+void HistoryBudget::set_limit(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  limit_ = bytes;
+}
+
+size_t HistoryBudget::limit() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return limit_;
+}
+
+size_t HistoryBudget::total() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_locked();
+}
+
+size_t HistoryBudget::total_locked() const {
+  size_t total = 0;
+  for (const BudgetedHistory *member : members_) {
+    total += member->memory_usage();
+  }
+  return total;
+}
+
+size_t HistoryBudget::enforce() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (limit_ == 0) {
+    return 0;
+  }
+
+  size_t total = total_locked();
+  if (total <= limit_) {
+    return 0;
+  }
+  size_t start = total;
+
+  // Background sessions first, then the biggest consumers
+  std::vector<BudgetedHistory *> order = members_;
+  std::stable_sort(order.begin(), order.end(),
+                   [](const BudgetedHistory *a, const BudgetedHistory *b) {
+                     if (a->active() != b->active()) {
+                       return !a->active();
+                     }
+                     return a->memory_usage() > b->memory_usage();
+                   });
+
+  for (BudgetedHistory *member : order) {
+    total -= member->drop_cache();
+    if (total <= limit_) {
+      return start - total;
+    }
+  }
+
+  for (BudgetedHistory *member : order) {
+    total -= member->compact();
+    if (total <= limit_) {
+      return start - total;
+    }
+  }
+
+  for (BudgetedHistory *member : order) {
+    size_t excess = total - limit_;
+    size_t usage = member->memory_usage();
+    total -= member->trim_to(usage > excess ? usage - excess : 0);
+    if (total <= limit_) {
+      break;
+    }
+  }
+
+  return start - total;
+}
+
+std::vector<HistoryBudget::Usage> HistoryBudget::usage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Usage> result;
+  result.reserve(members_.size());
+
+  for (const BudgetedHistory *member : members_) {
+    Usage usage;
+    usage.name = member->name();
+    usage.active = member->active();
+    usage.bytes = member->memory_usage();
+    member->report(usage);
+    result.push_back(std::move(usage));
+  }
+  return result;
+}
+
+void HistoryBudget::attach(BudgetedHistory *member) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  members_.push_back(member);
+}
+
+void HistoryBudget::detach(BudgetedHistory *member) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::erase(members_, member);
+}
+
+BudgetedHistory::BudgetedHistory() { HistoryBudget::instance().attach(this); }
+
+BudgetedHistory::~BudgetedHistory() {
+  HistoryBudget::instance().detach(this);
+}
+
+} // namespace tide::core
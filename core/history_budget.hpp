@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+class BudgetedHistory;
+
+/**
+ * Process-wide accountant for scrollback memory.
+ *
+ * Every history store (Scrollback, ReplayHistory) registers itself on
+ * construction. enforce() brings the
+ * combined resident history of all sessions under the byte limit, taking
+ * from background sessions before active ones:
+ *   1. drop decompressed page caches,
+ *   2. compress hot pages (inactive sessions first),
+ *   3. trim the oldest history (inactive sessions first, largest first).
+ *
+ * enforce() mutates other sessions' history, so it must be called from the
+ * thread that owns all terminals while none of them is parsing (the main
+ * loop does this once per frame).
+ */
+class HistoryBudget {
+public:
+  /**
+   * Per-session memory usage.
+   */
+  struct Usage {
+    std::string name;
+    bool active = false;
+    size_t lines = 0;
+    size_t bytes = 0;         // Resident history bytes
+    size_t spilled_bytes = 0; // Bytes living in a spill file
+    uint64_t trimmed_lines = 0; // Lines dropped to honor the budget
+  };
+
+  static HistoryBudget &instance();
+
+  /**
+   * Set the combined resident byte limit (0 = unlimited).
+   */
+  void set_limit(size_t bytes);
+
+  [[nodiscard]] size_t limit() const;
+
+  /**
+   * Combined resident history bytes of all sessions.
+   */
+  [[nodiscard]] size_t total() const;
+
+  /**
+   * Reclaim memory until total() is within the limit.
+   * @return Bytes reclaimed
+   */
+  size_t enforce();
+
+  /**
+   * Snapshot of every registered session.
+   */
+  [[nodiscard]] std::vector<Usage> usage() const;
+
+private:
+  friend class BudgetedHistory;
+
+  mutable std::mutex mutex_;
+  std::vector<BudgetedHistory *> members_;
+  size_t limit_ = 0;
+
+  HistoryBudget() = default;
+
+  void attach(BudgetedHistory *member);
+  void detach(BudgetedHistory *member);
+  size_t total_locked() const;
+};
+
+/**
+ * A history store the HistoryBudget reclaims memory from. Registers
+ * itself for its whole lifetime.
+ */
+class BudgetedHistory {
+public:
+  BudgetedHistory();
+  virtual ~BudgetedHistory();
+
+  // Non-copyable (the budget holds a pointer)
+  BudgetedHistory(const BudgetedHistory &) = delete;
+  BudgetedHistory &operator=(const BudgetedHistory &) = delete;
+
+  /**
+   * Label and activity flag reported to the HistoryBudget.
+   * Inactive (background) sessions are reclaimed first.
+   */
+  void set_name(std::string name) { name_ = std::move(name); }
+  void set_active(bool active) { active_ = active; }
+  [[nodiscard]] const std::string &name() const { return name_; }
+  [[nodiscard]] bool active() const { return active_; }
+
+  /**
+   * Resident bytes.
+   */
+  [[nodiscard]] virtual size_t memory_usage() const = 0;
+
+  /**
+   * Free what is rebuilt on demand.
+   * @return Bytes freed
+   */
+  virtual size_t drop_cache() = 0;
+
+  /**
+   * Shrink resident memory without losing history.
+   * @return Bytes freed
+   */
+  virtual size_t compact() = 0;
+
+  /**
+   * Drop the oldest history until resident memory is at most
+   * `target_bytes`.
+   * @return Bytes freed
+   */
+  virtual size_t trim_to(size_t target_bytes) = 0;
+
+  /**
+   * Fill in lines, spilled bytes and trimmed lines.
+   */
+  virtual void report(HistoryBudget::Usage &usage) const = 0;
+
+private:
+  std::string name_;
+  bool active_ = true;
+};
+
+} // namespace tide::core
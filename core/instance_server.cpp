@@ -0,0 +1,236 @@
+#include "core/instance_server.hpp"
+
+#include "core/remote_protocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace tide::core {
+
+namespace {
+
+// Wait up to `timeout_ms` for the next whole message on a blocking socket
+bool read_message(int fd, MessageReader &reader, Message &message,
+                  int timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(timeout_ms);
+  char buffer[256];
+  while (!reader.next(message)) {
+    if (reader.failed()) {
+      return false;
+    }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    pollfd ready{fd, POLLIN, 0};
+    if (left.count() <= 0 ||
+        poll(&ready, 1, static_cast<int>(left.count())) <= 0) {
+      return false;
+    }
+    ssize_t n = ::read(fd, buffer, sizeof(buffer));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    reader.feed(buffer, static_cast<size_t>(n));
+  }
+  return true;
+}
+
+// Read an OPEN_WINDOW payload
+bool parse_request(const Message &message, SpawnContext &context) {
+  const uint8_t *p = message.data;
+  const uint8_t *end = message.data + message.size;
+  uint32_t count = 0;
+  if (!get_string(p, end, context.cwd) || !get_varint(p, end, count) ||
+      count > std::size(InstanceServer::LAUNCH_ENV)) {
+    return false;
+  }
+  context.env.resize(count);
+  for (std::string &var : context.env) {
+    if (!get_string(p, end, var)) {
+      return false;
+    }
+    // Only the variables a launch passes on
+    std::string name = var.substr(0, var.find('='));
+    if (std::find(std::begin(InstanceServer::LAUNCH_ENV),
+                  std::end(InstanceServer::LAUNCH_ENV),
+                  name) == std::end(InstanceServer::LAUNCH_ENV)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+InstanceServer::~InstanceServer() { close(); }
+
+bool InstanceServer::listen(const std::string &path, Notify notify) {
+  int fd = listen_socket(path);
+  if (fd < 0) {
+    return false;
+  }
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wake_fd_ < 0) {
+    std::cerr << "[tide] Failed to create eventfd: " << std::strerror(errno)
+              << std::endl;
+    ::close(fd);
+    ::unlink(path.c_str());
+    return false;
+  }
+  listen_fd_ = fd;
+  path_ = path;
+  notify_ = std::move(notify);
+  thread_ = std::thread([this] { run(); });
+  return true;
+}
+
+void InstanceServer::close() {
+  if (thread_.joinable()) {
+    uint64_t one = 1;
+    (void)!::write(wake_fd_, &one, sizeof(one));
+    thread_.join();
+  }
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    ::unlink(path_.c_str());
+    listen_fd_ = -1;
+  }
+  if (wake_fd_ >= 0) {
+    ::close(wake_fd_);
+    wake_fd_ = -1;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Request &request : requests_) {
+    drop(request);
+  }
+  requests_.clear();
+}
+
+bool InstanceServer::take(Request &request) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (requests_.empty()) {
+    return false;
+  }
+  request = requests_.front();
+  requests_.pop_front();
+  return true;
+}
+
+void InstanceServer::reply(Request &request, const WindowOpened &opened) {
+  std::vector<uint8_t> payload;
+  put_u32(payload, opened.open_us);
+  put_u32(payload, opened.memory_kb);
+  std::vector<uint8_t> message;
+  append_message(message, MessageType::WINDOW_OPENED, payload.data(),
+                 payload.size());
+  // A few bytes into an empty socket buffer: this does not block
+  (void)!::send(request.fd, message.data(), message.size(), MSG_NOSIGNAL);
+  drop(request);
+}
+
+void InstanceServer::drop(Request &request) {
+  if (request.fd >= 0) {
+    ::close(request.fd);
+    request.fd = -1;
+  }
+}
+
+void InstanceServer::run() {
+  pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "[tide] Instance socket poll failed: "
+                << std::strerror(errno) << std::endl;
+      return;
+    }
+    if (fds[1].revents) {
+      return; // close()
+    }
+
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue; // Gone before we got to it, or EAGAIN
+    }
+    if (!same_user(fd)) {
+      std::cerr << "[tide] Refused a launch of another user" << std::endl;
+      ::close(fd);
+      continue;
+    }
+
+    // Launches write their request right after connecting
+    MessageReader reader;
+    Message message{};
+    Request request{fd, Clock::now(), {}};
+    if (!read_message(fd, reader, message, REQUEST_TIMEOUT_MS) ||
+        message.type != MessageType::OPEN_WINDOW ||
+        !parse_request(message, request.context)) {
+      ::close(fd);
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requests_.push_back(std::move(request));
+    }
+    if (notify_) {
+      notify_();
+    }
+  }
+}
+
+bool InstanceServer::request_window(const std::string &path,
+                                    WindowOpened &opened) {
+  int fd = connect_socket(path);
+  if (fd < 0) {
+    return false; // No instance yet (or a stale socket): we are the first
+  }
+
+  // Our directory and environment, for the window's shell
+  std::vector<uint8_t> payload;
+  char cwd[PATH_MAX];
+  put_string(payload, getcwd(cwd, sizeof(cwd)) ? cwd : "");
+  put_varint(payload, static_cast<uint32_t>(std::size(LAUNCH_ENV)));
+  for (const char *name : LAUNCH_ENV) {
+    const char *value = std::getenv(name);
+    put_string(payload, value ? std::string(name) + "=" + value : name);
+  }
+
+  std::vector<uint8_t> request;
+  append_message(request, MessageType::OPEN_WINDOW, payload.data(),
+                 payload.size());
+  MessageReader reader;
+  Message message{};
+  bool answered =
+      ::send(fd, request.data(), request.size(), MSG_NOSIGNAL) ==
+          static_cast<ssize_t>(request.size()) &&
+      read_message(fd, reader, message, REPLY_TIMEOUT_MS) &&
+      message.type == MessageType::WINDOW_OPENED;
+  ::close(fd);
+  if (!answered) {
+    std::cerr << "[tide] The running tide did not open a window" << std::endl;
+    return false;
+  }
+
+  const uint8_t *p = message.data;
+  const uint8_t *end = message.data + message.size;
+  get_u32(p, end, opened.open_us);
+  get_u32(p, end, opened.memory_kb);
+  return true;
+}
+
+} // namespace tide::core
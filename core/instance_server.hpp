@@ -0,0 +1,113 @@
+#pragma once
+
+#include "core/pty.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tide::core {
+
+/**
+ * Single-instance mode: the first tide listens on a socket, and later
+ * launches ask it for a window instead of starting GLFW, FreeType and the
+ * renderer from scratch (see request_window()).
+ *
+ * A thread accepts launches and reads their OPEN_WINDOW; the window thread
+ * takes() requests, opens a window each and reply()s once its first frame
+ * is on screen. A launch that gets no reply opens a window itself.
+ *
+ * The window's shell starts in the launch's working directory, with the
+ * launch's values of the LAUNCH_ENV variables (display, agent socket,
+ * locale), as it would have in a window of its own.
+ */
+class InstanceServer {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Notify = std::function<void()>;
+
+  /**
+   * A launch waiting for its window.
+   */
+  struct Request {
+    int fd = -1;
+    Clock::time_point received;
+    SpawnContext context; // Where the launch ran
+  };
+
+  /**
+   * What a launch hears back.
+   */
+  struct WindowOpened {
+    uint32_t open_us = 0;   // From the request to the first frame
+    uint32_t memory_kb = 0; // Resident memory the window added
+  };
+
+  InstanceServer() = default;
+  ~InstanceServer();
+
+  // Non-copyable
+  InstanceServer(const InstanceServer &) = delete;
+  InstanceServer &operator=(const InstanceServer &) = delete;
+
+  /**
+   * Listen on `path` and start accepting launches.
+   * @param notify Called on the accepting thread when a request arrives
+   * @return false if the socket is taken or could not be created
+   */
+  bool listen(const std::string &path, Notify notify);
+
+  /**
+   * Stop accepting and remove the socket. Requests not yet answered are
+   * dropped, so those launches open windows of their own.
+   */
+  void close();
+
+  /**
+   * Take the next request, if any.
+   */
+  bool take(Request &request);
+
+  /**
+   * Tell a launch its window is up, and close its connection.
+   */
+  static void reply(Request &request, const WindowOpened &opened);
+
+  /**
+   * Give up on a request without replying.
+   */
+  static void drop(Request &request);
+
+  /**
+   * Environment variables a launch passes on to its window's shell.
+   */
+  static constexpr const char *LAUNCH_ENV[] = {
+      "DISPLAY", "WAYLAND_DISPLAY", "XAUTHORITY", "SSH_AUTH_SOCK",
+      "COLORTERM", "LANG",          "LC_ALL",     "LC_CTYPE"};
+
+  /**
+   * Launch side: ask the tide listening on `path` to open a window.
+   * @return false if none answered; this process should open one itself
+   */
+  static bool request_window(const std::string &path, WindowOpened &opened);
+
+private:
+  static constexpr int REQUEST_TIMEOUT_MS = 1000;  // For OPEN_WINDOW
+  static constexpr int REPLY_TIMEOUT_MS = 10000;   // For WINDOW_OPENED
+
+  int listen_fd_ = -1;
+  int wake_fd_ = -1; // eventfd that interrupts poll() on close()
+  std::string path_;
+  Notify notify_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::deque<Request> requests_;
+
+  void run();
+};
+
+} // namespace tide::core
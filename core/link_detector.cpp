@@ -0,0 +1,330 @@
+#include "core/link_detector.hpp"
+
+#include "core/terminal.hpp"
+#include "core/utf8.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace tide::core {
+
+namespace {
+
+constexpr const char *URL_SCHEMES[] = {"http", "https", "ftp", "sftp",
+                                       "ssh",  "git",   "file"};
+constexpr int MAX_NUMBER = 100000000; // Line/column numbers stop growing here
+
+bool is_alpha(char32_t c) {
+  return (c >= U'a' && c <= U'z') || (c >= U'A' && c <= U'Z');
+}
+
+bool is_digit(char32_t c) { return c >= U'0' && c <= U'9'; }
+
+bool is_url_char(char32_t c) {
+  if (c <= U' ' || c == 0x7F) {
+    return false;
+  }
+  switch (c) {
+  case U'"':
+  case U'\'':
+  case U'<':
+  case U'>':
+  case U'`':
+  case U'{':
+  case U'}':
+  case U'|':
+  case U'\\':
+  case U'^':
+    return false;
+  default:
+    return true; // Including non-ASCII, for IRIs
+  }
+}
+
+bool is_path_char(char32_t c) {
+  return is_alpha(c) || is_digit(c) || c == U'.' || c == U'/' || c == U'_' ||
+         c == U'-' || c == U'~' || c == U'+';
+}
+
+bool is_known_scheme(const char32_t *text, size_t size) {
+  for (const char *scheme : URL_SCHEMES) {
+    if (std::strlen(scheme) != size) {
+      continue;
+    }
+    size_t i = 0;
+    while (i < size && (text[i] | 0x20) == static_cast<char32_t>(scheme[i])) {
+      ++i;
+    }
+    if (i == size) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string to_utf8(const char32_t *text, size_t size) {
+  std::string out;
+  out.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    append_utf8(out, text[i]);
+  }
+  return out;
+}
+
+bool overlaps(const std::vector<Link> &links, ColumnSpan span) {
+  for (const Link &link : links) {
+    if (span.start < link.span.end && link.span.start < span.end) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int parse_number(const char32_t *text, size_t size, size_t &pos) {
+  int value = 0;
+  for (; pos < size && is_digit(text[pos]); ++pos) {
+    if (value < MAX_NUMBER) {
+      value = value * 10 + static_cast<int>(text[pos] - U'0');
+    }
+  }
+  return value;
+}
+
+void find_urls(const char32_t *text, size_t size, std::vector<Link> &out) {
+  for (size_t i = 0; i + 3 < size; ++i) {
+    if (text[i] != U':' || text[i + 1] != U'/' || text[i + 2] != U'/') {
+      continue;
+    }
+    size_t start = i;
+    while (start > 0 && is_alpha(text[start - 1])) {
+      --start;
+    }
+    if (!is_known_scheme(text + start, i - start)) {
+      continue;
+    }
+
+    size_t end = i + 3;
+    int opens = 0;
+    int closes = 0;
+    for (; end < size && is_url_char(text[end]); ++end) {
+      opens += text[end] == U'(';
+      closes += text[end] == U')';
+    }
+
+    // Sentence punctuation and unbalanced closing parens are not part of it
+    while (end > i + 3) {
+      char32_t c = text[end - 1];
+      if (c == U')' && closes > opens) {
+        --closes;
+      } else if (c > 0x7F || !std::strchr(".,:;!?", static_cast<int>(c))) {
+        break;
+      }
+      --end;
+    }
+    if (end == i + 3) {
+      continue; // Scheme only
+    }
+
+    Link link;
+    link.kind = LinkKind::Url;
+    link.span = {static_cast<int>(start), static_cast<int>(end)};
+    link.target = to_utf8(text + start, end - start);
+    out.push_back(std::move(link));
+    i = end - 1;
+  }
+}
+
+void find_locations(const char32_t *text, size_t size,
+                    std::vector<Link> &out) {
+  for (size_t i = 1; i + 1 < size; ++i) {
+    if (text[i] != U':' || !is_digit(text[i + 1])) {
+      continue;
+    }
+    size_t start = i;
+    while (start > 0 && is_path_char(text[start - 1])) {
+      --start;
+    }
+
+    // Must look like a file (rules out times and ratios like 12:30)
+    bool letter = false;
+    bool separator = false;
+    for (size_t k = start; k < i; ++k) {
+      letter = letter || is_alpha(text[k]);
+      separator = separator || text[k] == U'.' || text[k] == U'/';
+    }
+    if (!letter || !separator) {
+      continue;
+    }
+
+    size_t end = i + 1;
+    int line = parse_number(text, size, end);
+    int column = 0;
+    if (end + 1 < size && text[end] == U':' && is_digit(text[end + 1])) {
+      ++end;
+      column = parse_number(text, size, end);
+    }
+    if (end < size && (is_alpha(text[end]) || text[end] == U'/')) {
+      continue; // host:port/path, or not a number after all
+    }
+
+    ColumnSpan span{static_cast<int>(start), static_cast<int>(end)};
+    if (line == 0 || overlaps(out, span)) {
+      continue;
+    }
+
+    Link link;
+    link.kind = LinkKind::FileLocation;
+    link.span = span;
+    link.target = to_utf8(text + start, i - start);
+    link.line = line;
+    link.column = column;
+    out.push_back(std::move(link));
+    i = end - 1;
+  }
+}
+
+} // anonymous namespace
+
+bool LinkDetector::add_pattern(const std::string &pattern) {
+  try {
+    patterns_.emplace_back(pattern, std::regex::ECMAScript |
+                                        std::regex::optimize);
+  } catch (const std::regex_error &e) {
+    std::cerr << "[tide] Invalid link pattern '" << pattern
+              << "': " << e.what() << std::endl;
+    return false;
+  }
+  cache_.clear(); // Cached rows were scanned without it
+  return true;
+}
+
+void LinkDetector::scan(const char32_t *text, size_t size,
+                        std::vector<Link> &out) const {
+  out.clear();
+  while (size > 0 && (text[size - 1] == U' ' || text[size - 1] == 0)) {
+    --size;
+  }
+  if (size == 0) {
+    return;
+  }
+
+  find_urls(text, size, out);
+  find_locations(text, size, out);
+
+  if (patterns_.empty()) {
+    return;
+  }
+
+  // Match on UTF-8, mapping byte offsets back to columns
+  std::string utf8;
+  std::vector<int> col_of;
+  utf8.reserve(size);
+  col_of.reserve(size + 1);
+  for (size_t col = 0; col < size; ++col) {
+    size_t before = utf8.size();
+    append_utf8(utf8, text[col]);
+    col_of.insert(col_of.end(), utf8.size() - before, static_cast<int>(col));
+  }
+  col_of.push_back(static_cast<int>(size));
+
+  for (const std::regex &pattern : patterns_) {
+    auto begin = std::sregex_iterator(utf8.begin(), utf8.end(), pattern);
+    for (auto it = begin; it != std::sregex_iterator(); ++it) {
+      if (it->length() == 0) {
+        continue;
+      }
+      auto pos = static_cast<size_t>(it->position());
+      auto len = static_cast<size_t>(it->length());
+      ColumnSpan span{col_of[pos], col_of[pos + len]};
+      if (overlaps(out, span)) {
+        continue;
+      }
+
+      Link link;
+      link.kind = LinkKind::Custom;
+      link.span = span;
+      link.target = it->str();
+      out.push_back(std::move(link));
+    }
+  }
+}
+
+bool LinkDetector::update(const Terminal &terminal,
+                          Clock::time_point deadline) {
+  int rows = terminal.rows();
+  auto cols = static_cast<size_t>(terminal.cols());
+  bool complete = true;
+
+  for (int row = 0; row < rows; ++row) {
+    uint64_t key = terminal.visible_row_key(row);
+    if (cache_.count(key) != 0) {
+      continue;
+    }
+    if (Clock::now() >= deadline) {
+      complete = false;
+      break;
+    }
+
+    std::vector<Link> links;
+    if (const Cell *cells = terminal.get_visible_row(row)) {
+      text_.resize(cols);
+      for (size_t col = 0; col < cols; ++col) {
+        text_[col] = cells[col].codepoint;
+      }
+      scan(text_.data(), cols, links);
+    }
+    cache_.emplace(key, std::move(links));
+  }
+
+  // Forget rows that changed or scrolled out of view
+  if (cache_.size() > static_cast<size_t>(rows) * 2) {
+    std::unordered_map<uint64_t, std::vector<Link>> visible;
+    for (int row = 0; row < rows; ++row) {
+      auto it = cache_.find(terminal.visible_row_key(row));
+      if (it != cache_.end()) {
+        visible.insert(std::move(*it));
+      }
+    }
+    cache_.swap(visible);
+  }
+  return complete;
+}
+
+const std::vector<Link> *LinkDetector::links(const Terminal &terminal,
+                                             int visual_row) const {
+  if (visual_row < 0 || visual_row >= terminal.rows()) {
+    return nullptr;
+  }
+  auto it = cache_.find(terminal.visible_row_key(visual_row));
+  return it != cache_.end() ? &it->second : nullptr;
+}
+
+const Link *LinkDetector::link_at(const Terminal &terminal, int col,
+                                  int visual_row) const {
+  const std::vector<Link> *row = links(terminal, visual_row);
+  if (row == nullptr) {
+    return nullptr;
+  }
+  for (const Link &link : *row) {
+    if (link.span.contains(col)) {
+      return &link;
+    }
+  }
+  return nullptr;
+}
+
+void LinkDetector::spans(const Terminal &terminal,
+                         std::vector<std::vector<ColumnSpan>> &out) const {
+  out.resize(static_cast<size_t>(terminal.rows()));
+  for (int row = 0; row < terminal.rows(); ++row) {
+    auto &row_spans = out[static_cast<size_t>(row)];
+    row_spans.clear();
+    if (const std::vector<Link> *links = this->links(terminal, row)) {
+      for (const Link &link : *links) {
+        row_spans.push_back(link.span);
+      }
+    }
+  }
+}
+
+} // namespace tide::core
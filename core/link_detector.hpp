@@ -0,0 +1,93 @@
+#pragma once
+
+#include "core/grid_buffer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tide::core {
+
+class Terminal;
+
+enum class LinkKind : uint8_t {
+  Url,          // scheme://...
+  FileLocation, // path:line[:col], as printed by compilers and grep -n
+  Custom,       // Matched a user pattern
+};
+
+/**
+ * A clickable region on one row.
+ */
+struct Link {
+  LinkKind kind = LinkKind::Url;
+  ColumnSpan span;
+  std::string target; // URL, file path, or the matched text
+  int line = 0;       // FileLocation only
+  int column = 0;     // FileLocation only; 0 if not given
+};
+
+/**
+ * Finds URLs, file:line references and user-defined patterns on the visible
+ * rows.
+ *
+ * Results are cached per row under Terminal::visible_row_key(), so only rows
+ * whose content changed are scanned again, and scanning stops at a deadline
+ * so it can be spread over idle time. Lookups never scan: rows not yet
+ * scanned simply have no links.
+ */
+class LinkDetector {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Add a user hint pattern (ECMAScript regex, matched per row).
+   * @return false if the pattern does not compile
+   */
+  bool add_pattern(const std::string &pattern);
+
+  /**
+   * Scan visible rows that have no cached result, until `deadline`.
+   * @return true if every visible row is up to date
+   */
+  bool update(const Terminal &terminal, Clock::time_point deadline);
+
+  /**
+   * Links on a screen row, or nullptr if the row has not been scanned since
+   * it last changed.
+   */
+  [[nodiscard]] const std::vector<Link> *links(const Terminal &terminal,
+                                               int visual_row) const;
+
+  /**
+   * Link under a cell, or nullptr.
+   */
+  [[nodiscard]] const Link *link_at(const Terminal &terminal, int col,
+                                    int visual_row) const;
+
+  /**
+   * Underlined columns of every screen row, for the renderer.
+   */
+  void spans(const Terminal &terminal,
+             std::vector<std::vector<ColumnSpan>> &out) const;
+
+  /**
+   * Drop all cached results (e.g. after switching history mode).
+   */
+  void clear() { cache_.clear(); }
+
+  /**
+   * Find links in one row of text.
+   */
+  void scan(const char32_t *text, size_t size, std::vector<Link> &out) const;
+
+private:
+  std::vector<std::regex> patterns_;
+  std::unordered_map<uint64_t, std::vector<Link>> cache_;
+  std::vector<char32_t> text_; // Scratch row
+};
+
+} // namespace tide::core
@@ -0,0 +1,181 @@
+#include "core/lz4.hpp"
+
+#include <cstring>
+
+namespace tide::core {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5; // Block must end with literals
+constexpr size_t MATCH_FIND_LIMIT = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 12;
+
+uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint32_t hash_sequence(uint32_t seq) {
+  return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Write a length that continues past a 4-bit token nibble
+uint8_t *write_length(uint8_t *op, size_t len) {
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = static_cast<uint8_t>(len);
+  return op;
+}
+
+uint8_t *write_sequence(uint8_t *op, const uint8_t *literals, size_t lit_len,
+                        size_t offset, size_t match_len, bool has_match) {
+  uint8_t *token = op++;
+  *token = static_cast<uint8_t>((lit_len >= 15 ? 15 : lit_len) << 4);
+  if (lit_len >= 15) {
+    op = write_length(op, lit_len - 15);
+  }
+  if (lit_len > 0) {
+    std::memcpy(op, literals, lit_len);
+    op += lit_len;
+  }
+
+  if (has_match) {
+    *op++ = static_cast<uint8_t>(offset & 0xFF);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    size_t code = match_len - MIN_MATCH;
+    *token |= static_cast<uint8_t>(code >= 15 ? 15 : code);
+    if (code >= 15) {
+      op = write_length(op, code - 15);
+    }
+  }
+  return op;
+}
+
+// Read a length continuation; returns false on truncated input
+bool read_length(const uint8_t *&ip, const uint8_t *end, size_t &len) {
+  uint8_t b;
+  do {
+    if (ip >= end) {
+      return false;
+    }
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+  return true;
+}
+
+} // anonymous namespace
+
+void lz4_compress(const uint8_t *src, size_t size, std::vector<uint8_t> &out) {
+  out.resize(lz4_compress_bound(size));
+  uint8_t *op = out.data();
+
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  const uint8_t *end = src + size;
+
+  if (size > MATCH_FIND_LIMIT) {
+    const uint8_t *match_limit = end - MATCH_FIND_LIMIT;
+    const uint8_t *extend_limit = end - LAST_LITERALS;
+    uint32_t table[1 << HASH_BITS] = {};
+
+    while (ip < match_limit) {
+      uint32_t seq = read32(ip);
+      uint32_t h = hash_sequence(seq);
+      const uint8_t *ref = src + table[h];
+      table[h] = static_cast<uint32_t>(ip - src);
+
+      if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET ||
+          read32(ref) != seq) {
+        ++ip;
+        continue;
+      }
+
+      const uint8_t *mp = ip + MIN_MATCH;
+      const uint8_t *rp = ref + MIN_MATCH;
+      while (mp < extend_limit && *mp == *rp) {
+        ++mp;
+        ++rp;
+      }
+
+      op = write_sequence(op, anchor, static_cast<size_t>(ip - anchor),
+                          static_cast<size_t>(ip - ref),
+                          static_cast<size_t>(mp - ip), true);
+      ip = anchor = mp;
+    }
+  }
+
+  // Trailing literals
+  op = write_sequence(op, anchor, static_cast<size_t>(end - anchor), 0, 0,
+                      false);
+  out.resize(static_cast<size_t>(op - out.data()));
+}
+
+bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                    size_t dst_size) {
+  const uint8_t *ip = src;
+  const uint8_t *end = src + size;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + dst_size;
+
+  while (ip < end) {
+    uint8_t token = *ip++;
+
+    size_t lit_len = token >> 4;
+    if (lit_len == 15 && !read_length(ip, end, lit_len)) {
+      return false;
+    }
+    if (lit_len > static_cast<size_t>(end - ip) ||
+        lit_len > static_cast<size_t>(op_end - op)) {
+      return false;
+    }
+    if (lit_len > 0) {
+      std::memcpy(op, ip, lit_len);
+      ip += lit_len;
+      op += lit_len;
+    }
+
+    if (ip == end) {
+      break; // Last sequence has no match
+    }
+
+    if (end - ip < 2) {
+      return false;
+    }
+    size_t offset =
+        static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+      return false;
+    }
+
+    size_t match_len = token & 0x0F;
+    if (match_len == 15 && !read_length(ip, end, match_len)) {
+      return false;
+    }
+    match_len += MIN_MATCH;
+    if (match_len > static_cast<size_t>(op_end - op)) {
+      return false;
+    }
+
+    const uint8_t *ref = op - offset;
+    if (offset >= match_len) {
+      std::memcpy(op, ref, match_len);
+      op += match_len;
+    } else {
+      // Overlapping copy repeats the last `offset` bytes
+      for (size_t i = 0; i < match_len; ++i) {
+        *op++ = ref[i];
+      }
+    }
+  }
+
+  return op == op_end;
+}
+
+} // namespace tide::core
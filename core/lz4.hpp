@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Minimal LZ4 block-format codec used for cold scrollback pages.
+ *
+ * Output is a plain LZ4 block (no frame header), so it can be swapped for
+ * liblz4 without changing stored data. The compressor is a single-pass greedy
+ * matcher; it favors speed over ratio.
+ */
+
+/**
+ * Worst-case compressed size for an input of `size` bytes.
+ */
+[[nodiscard]] constexpr size_t lz4_compress_bound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+/**
+ * Compress a buffer.
+ * @param src Input bytes
+ * @param size Number of input bytes
+ * @param out Replaced with the compressed block
+ */
+void lz4_compress(const uint8_t *src, size_t size, std::vector<uint8_t> &out);
+
+/**
+ * Decompress a block produced by lz4_compress().
+ * @param src Compressed block
+ * @param size Size of the compressed block
+ * @param dst Output buffer
+ * @param dst_size Exact decompressed size
+ * @return true if the block was valid and filled `dst` exactly
+ */
+bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                    size_t dst_size);
+
+} // namespace tide::core
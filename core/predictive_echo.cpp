@@ -0,0 +1,191 @@
+#include "core/predictive_echo.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace tide::core {
+
+bool PredictiveEcho::on_input(const Terminal &terminal, const char *data,
+                              size_t size, Clock::time_point now) {
+  size_t was_shown = shown();
+  uint64_t generation = generation_;
+  bool enabled = now >= disabled_until_ && !terminal.full_screen_app();
+  if (!enabled && !predictions_.empty()) {
+    predictions_.clear();
+    ++generation_;
+  }
+
+  // With nothing unechoed the cursor is where the next key lands
+  bool known = anchored_;
+  if (predictions_.empty() && now >= resync_at_) {
+    known = true;
+    next_col_ = terminal.cursor_col();
+    next_row_ = terminal.cursor_row();
+  }
+  resync_at_ = now + srtt_ + srtt_ / 2; // This key's echo is back by then
+  anchored_ = false;
+
+  bool text = enabled;
+  for (size_t i = 0; i < size && text; ++i) {
+    text = data[i] >= 0x20 && data[i] < 0x7f;
+  }
+  if (!text) {
+    // Enter moves to the next row (unless it scrolls); anything else
+    // goes where the application takes it. Either way a new epoch.
+    ++epoch_;
+    if (enabled && known && size == 1 && data[0] == '\r' &&
+        next_row_ + 1 < terminal.rows()) {
+      anchored_ = true;
+      next_col_ = 0;
+      ++next_row_;
+    }
+    return generation_ != generation && was_shown > 0;
+  }
+
+  if (known && next_col_ + static_cast<int>(size) <= terminal.cols()) {
+    for (size_t i = 0; i < size; ++i) {
+      predictions_.push_back({next_col_++, next_row_,
+                              static_cast<char32_t>(data[i]), now, epoch_});
+      ++stats_.predicted;
+      ++generation_;
+    }
+    anchored_ = true;
+  } // Wrapping is not predicted
+  return generation_ != generation && (was_shown > 0 || shown() > 0);
+}
+
+void PredictiveEcho::reset() {
+  predictions_.clear();
+  ++epoch_;
+  anchored_ = false;
+  ++generation_;
+}
+
+bool PredictiveEcho::update(const Terminal &terminal, Clock::time_point now) {
+  size_t was_shown = shown();
+  uint64_t generation = generation_;
+  if (terminal.full_screen_app() && !predictions_.empty()) {
+    reset();
+  }
+
+  // The echo moves the cursor past each prediction in turn
+  while (!predictions_.empty()) {
+    const Prediction &prediction = predictions_.front();
+    if (prediction.col >= terminal.cols() ||
+        prediction.row >= terminal.rows()) {
+      rollback(now); // Resized under it
+      break;
+    }
+    int cursor_row = terminal.cursor_row();
+    if (cursor_row < prediction.row ||
+        (cursor_row == prediction.row &&
+         terminal.cursor_col() <= prediction.col)) {
+      break; // Not echoed yet
+    }
+    if (terminal.grid().at(prediction.col, prediction.row).codepoint !=
+        prediction.codepoint) {
+      rollback(now);
+      break;
+    }
+    Clock::duration sample = now - prediction.sent;
+    srtt_ = srtt_ == Clock::duration::zero() ? sample
+                                              : (7 * srtt_ + sample) / 8;
+    confirmed_epoch_ = std::max(confirmed_epoch_, prediction.epoch);
+    ++stats_.confirmed;
+    predictions_.erase(predictions_.begin());
+    ++generation_;
+  }
+
+  if (!predictions_.empty() && now >= deadline()) {
+    rollback(now); // No echo: not a shell prompt after all
+  }
+  return generation_ != generation && (was_shown > 0 || shown() > 0);
+}
+
+PredictiveEcho::Clock::time_point PredictiveEcho::deadline() const {
+  if (predictions_.empty()) {
+    return Clock::time_point::max();
+  }
+  return predictions_.front().sent + timeout();
+}
+
+size_t PredictiveEcho::shown() const {
+  if (srtt_ < SHOW_RTT) {
+    return 0;
+  }
+  // Epochs only grow along the queue
+  size_t count = 0;
+  while (count < predictions_.size() &&
+         predictions_[count].epoch <= confirmed_epoch_) {
+    ++count;
+  }
+  return count;
+}
+
+void PredictiveEcho::overlay(ScreenView &view, int &cursor_col,
+                             int &cursor_row) {
+  size_t count = shown();
+  // Predictions run left to right, so each row is copied once
+  size_t used = 0;
+  int current = -1;
+  for (size_t i = 0; i < count; ++i) {
+    const Prediction &prediction = predictions_[i];
+    if (prediction.row >= view.rows() || prediction.col >= view.cols()) {
+      continue;
+    }
+    if (prediction.row != current) {
+      if (used == rows_.size()) {
+        rows_.emplace_back();
+      }
+      std::vector<Cell> &copy = rows_[used++];
+      const Cell *cells = view.row(prediction.row);
+      copy.assign(cells, cells + view.cols());
+      uint64_t key = (view.key(prediction.row) * 0x9e3779b97f4a7c15ULL) ^
+                     generation_;
+      view.set_row(prediction.row, copy.data(),
+                   OVERLAY_ROW_KEY | (key & (OVERLAY_ROW_KEY - 1)));
+      current = prediction.row;
+    }
+    // Cells have no underline yet, so predictions look like the echo
+    rows_[used - 1][static_cast<size_t>(prediction.col)].codepoint =
+        prediction.codepoint;
+    cursor_col = std::min(prediction.col + 1, view.cols() - 1);
+    cursor_row = prediction.row;
+  }
+}
+
+PredictiveEcho::Stats PredictiveEcho::take_stats() {
+  Stats stats = stats_;
+  stats_ = Stats{};
+  return stats;
+}
+
+PredictiveEcho::Clock::duration PredictiveEcho::timeout() const {
+  return std::max<Clock::duration>(MIN_TIMEOUT, 3 * srtt_);
+}
+
+void PredictiveEcho::rollback(Clock::time_point now) {
+  // Hidden predictions cost nothing when wrong; shown ones flickered
+  if (shown() > 0) {
+    ++stats_.rolled_back;
+    if (failures_ == 0 || now - first_failure_ >= RETRY_AFTER) {
+      failures_ = 0;
+      first_failure_ = now;
+    }
+    if (++failures_ >= FAILURE_LIMIT) {
+      disabled_until_ = now + RETRY_AFTER;
+      failures_ = 0;
+      std::cerr << "[tide] Predictions kept failing, local echo off for "
+                << std::chrono::duration_cast<std::chrono::seconds>(
+                       RETRY_AFTER)
+                       .count()
+                << " s" << std::endl;
+    }
+  }
+  predictions_.clear();
+  ++epoch_;
+  anchored_ = false;
+  ++generation_;
+}
+
+} // namespace tide::core
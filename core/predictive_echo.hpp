@@ -0,0 +1,133 @@
+#pragma once
+
+#include "core/screen_view.hpp"
+#include "core/terminal.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Predictive local echo (as in mosh) for shells behind a slow link, such
+ * as ssh to a distant host: typed characters are drawn at once as a
+ * tentative overlay, and the real echo, once parsed, confirms or rolls
+ * them back.
+ *
+ * Only printable characters are predicted, each after the one before or
+ * at the start of the next row after Enter. Enter and any other key
+ * (Backspace, control keys, escapes) start a new epoch, whose predictions
+ * stay hidden until one of them is confirmed: the next prompt may not
+ * echo at all (a password). After a key other than Enter the cursor is
+ * wherever the application puts it, so prediction waits for its echo.
+ * Nothing is drawn while echoes take less than SHOW_RTT, so a local shell
+ * looks as it always did.
+ *
+ * A prediction is confirmed once the cursor has moved past its cell and
+ * the cell holds the typed character; it is wrong if the cursor moved past
+ * and the cell holds something else, or if no echo came within a few echo
+ * times. Full-screen applications (see Terminal::full_screen_app()) get no
+ * predictions, and FAILURE_LIMIT wrong ones drawn within RETRY_AFTER turn
+ * prediction off for RETRY_AFTER.
+ *
+ * Owner thread only: call on_input() as keys are sent and update() after
+ * parsing, and overlay() the predictions on the view being drawn.
+ */
+class PredictiveEcho {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr auto SHOW_RTT = std::chrono::milliseconds(20);
+  static constexpr auto MIN_TIMEOUT = std::chrono::milliseconds(250);
+  static constexpr int FAILURE_LIMIT = 3;
+  static constexpr auto RETRY_AFTER = std::chrono::seconds(30);
+
+  /**
+   * Counts since the last take_stats().
+   */
+  struct Stats {
+    uint64_t predicted = 0;   // Characters predicted
+    uint64_t confirmed = 0;   // Predictions the echo matched
+    uint64_t rolled_back = 0; // Shown predictions the echo contradicted
+  };
+
+  /**
+   * Keys about to be sent to the child.
+   * @return true if the overlay changed
+   */
+  bool on_input(const Terminal &terminal, const char *data, size_t size,
+                Clock::time_point now);
+
+  /**
+   * Drop every prediction (a paste, another tab).
+   */
+  void reset();
+
+  /**
+   * Check the predictions against the terminal after parsing, and give up
+   * on those whose echo is overdue.
+   * @return true if the overlay changed
+   */
+  bool update(const Terminal &terminal, Clock::time_point now);
+
+  /**
+   * When update() must run to give up on a prediction, or
+   * Clock::time_point::max() with none pending.
+   */
+  [[nodiscard]] Clock::time_point deadline() const;
+
+  /**
+   * How many predictions are drawn.
+   */
+  [[nodiscard]] size_t shown() const;
+
+  /**
+   * Draw the predictions over `view` (the terminal's live screen) and move
+   * the cursor after them. The view points into our copies of the changed
+   * rows until the next call.
+   */
+  void overlay(ScreenView &view, int &cursor_col, int &cursor_row);
+
+  /**
+   * Smoothed time from a keypress to its echo being parsed.
+   */
+  [[nodiscard]] Clock::duration echo_time() const { return srtt_; }
+
+  Stats take_stats();
+
+private:
+  // Overlaid rows get keys of their own, so renderers redraw them
+  static constexpr uint64_t OVERLAY_ROW_KEY = 1ULL << 62;
+
+  struct Prediction {
+    int col;
+    int row;
+    char32_t codepoint;
+    Clock::time_point sent;
+    uint64_t epoch;
+  };
+
+  std::vector<Prediction> predictions_;
+  uint64_t epoch_ = 1;
+  uint64_t confirmed_epoch_ = 0; // Predictions up to this epoch are drawn
+  // Where the next key lands while earlier keys are unechoed; without an
+  // anchor, keys sent before `resync_at_` are not predicted
+  bool anchored_ = false;
+  int next_col_ = 0;
+  int next_row_ = 0;
+  Clock::time_point resync_at_;
+  Clock::duration srtt_{}; // Zero until the first confirmation
+  int failures_ = 0;       // Wrong shown predictions since first_failure_
+  Clock::time_point first_failure_;
+  Clock::time_point disabled_until_;
+  uint64_t generation_ = 0; // Bumped whenever predictions change
+  std::vector<std::vector<Cell>> rows_;
+  Stats stats_;
+
+  [[nodiscard]] Clock::duration timeout() const;
+  void rollback(Clock::time_point now);
+};
+
+} // namespace tide::core
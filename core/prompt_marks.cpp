@@ -0,0 +1,117 @@
+#include "core/prompt_marks.hpp"
+
+#include <algorithm>
+#include <climits>
+
+namespace tide::core {
+
+namespace {
+
+bool before(const PromptMark &a, uint64_t line, int col) {
+  return a.line < line || (a.line == line && a.col < col);
+}
+
+} // anonymous namespace
+
+void PromptMarks::add(const PromptMark &mark) {
+  for (size_t k = 0; k < KIND_COUNT; ++k) {
+    std::deque<PromptMark> &marks = marks_[k];
+    while (!marks.empty() && !before(marks.back(), mark.line, mark.col) &&
+           (marks.back().line != mark.line || marks.back().col != mark.col ||
+            marks.back().kind == mark.kind)) {
+      marks.pop_back();
+    }
+  }
+  marks_[static_cast<size_t>(mark.kind)].push_back(mark);
+}
+
+void PromptMarks::trim(uint64_t first_line) {
+  for (std::deque<PromptMark> &marks : marks_) {
+    while (!marks.empty() && marks.front().line < first_line) {
+      marks.pop_front();
+    }
+  }
+}
+
+void PromptMarks::clear() {
+  for (std::deque<PromptMark> &marks : marks_) {
+    marks.clear();
+  }
+}
+
+std::optional<PromptMark> PromptMarks::previous(MarkKind kind,
+                                                uint64_t line) const {
+  const std::deque<PromptMark> &marks = of(kind);
+  auto it = std::lower_bound(
+      marks.begin(), marks.end(), line,
+      [](const PromptMark &m, uint64_t l) { return m.line < l; });
+  if (it == marks.begin()) {
+    return std::nullopt;
+  }
+  return *std::prev(it);
+}
+
+std::optional<PromptMark> PromptMarks::next(MarkKind kind,
+                                            uint64_t line) const {
+  const std::deque<PromptMark> &marks = of(kind);
+  auto it = std::upper_bound(
+      marks.begin(), marks.end(), line,
+      [](uint64_t l, const PromptMark &m) { return l < m.line; });
+  if (it == marks.end()) {
+    return std::nullopt;
+  }
+  return *it;
+}
+
+std::optional<PromptMark> PromptMarks::last(MarkKind kind) const {
+  const std::deque<PromptMark> &marks = of(kind);
+  if (marks.empty()) {
+    return std::nullopt;
+  }
+  return marks.back();
+}
+
+bool PromptMarks::last_output(uint64_t end_line, TextRange &range) const {
+  std::optional<PromptMark> start = last(MarkKind::OutputStart);
+  if (!start) {
+    return false;
+  }
+
+  // The output ends where the command end or the next prompt was marked
+  std::optional<PromptMark> end;
+  for (MarkKind kind : {MarkKind::CommandEnd, MarkKind::PromptStart}) {
+    const std::deque<PromptMark> &marks = of(kind);
+    auto it = std::lower_bound(marks.begin(), marks.end(), *start,
+                               [](const PromptMark &m, const PromptMark &s) {
+                                 return before(m, s.line, s.col);
+                               });
+    if (it != marks.end() && (!end || before(*it, end->line, end->col))) {
+      end = *it;
+    }
+  }
+
+  range.start_line = start->line;
+  range.start_col = start->col;
+  if (!end) {
+    range.end_line = end_line;
+    range.end_col = INT_MAX;
+  } else if (end->col == 0 && end->line > start->line) {
+    // Marked at the start of a line: the output ended on the line above
+    range.end_line = end->line - 1;
+    range.end_col = INT_MAX;
+  } else {
+    range.end_line = end->line;
+    range.end_col = end->col;
+  }
+  return true;
+}
+
+size_t PromptMarks::size() const {
+  size_t total = 0;
+  for (const std::deque<PromptMark> &marks : marks_) {
+    total += marks.size();
+  }
+  return total;
+}
+
+} // namespace tide::core
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "core/text_export.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace tide::core {
+
+/**
+ * Shell integration mark kinds (OSC 133 A/B/C/D).
+ */
+enum class MarkKind : uint8_t {
+  PromptStart,  // A: prompt is about to be drawn
+  CommandStart, // B: prompt done, user input begins
+  OutputStart,  // C: command accepted, output begins
+  CommandEnd,   // D: command finished (optionally with exit code)
+};
+
+/**
+ * A mark at an absolute position (see Terminal::history_base()).
+ */
+struct PromptMark {
+  uint64_t line = 0;
+  int col = 0;
+  MarkKind kind = MarkKind::PromptStart;
+  int exit_code = -1; // CommandEnd only; -1 if not reported
+};
+
+/**
+ * Sorted index of semantic prompt marks.
+ *
+ * Each kind is kept in its own deque ordered by position, so neighbour
+ * lookups are binary searches. Marks are appended as output arrives and
+ * dropped from the front as history is trimmed.
+ */
+class PromptMarks {
+public:
+  static constexpr size_t KIND_COUNT = 4;
+
+  /**
+   * Record a mark. Marks after its position (and a mark of the same kind at
+   * the same position) are discarded first: that part of the screen has
+   * been redrawn.
+   */
+  void add(const PromptMark &mark);
+
+  /**
+   * Forget marks on lines before `first_line`.
+   */
+  void trim(uint64_t first_line);
+
+  void clear();
+
+  /**
+   * Nearest mark of a kind strictly before / after a line.
+   */
+  [[nodiscard]] std::optional<PromptMark> previous(MarkKind kind,
+                                                   uint64_t line) const;
+  [[nodiscard]] std::optional<PromptMark> next(MarkKind kind,
+                                               uint64_t line) const;
+
+  /**
+   * Most recent mark of a kind.
+   */
+  [[nodiscard]] std::optional<PromptMark> last(MarkKind kind) const;
+
+  /**
+   * Output of the most recent command that produced output: from its
+   * OutputStart up to the following CommandEnd or PromptStart, or to
+   * `end_line` if the command is still running.
+   * @return false if no command output is known
+   */
+  bool last_output(uint64_t end_line, TextRange &range) const;
+
+  [[nodiscard]] size_t size() const;
+
+private:
+  std::array<std::deque<PromptMark>, KIND_COUNT> marks_;
+
+  [[nodiscard]] const std::deque<PromptMark> &of(MarkKind kind) const {
+    return marks_[static_cast<size_t>(kind)];
+  }
+};
+
+} // namespace tide::core
@@ -1,15 +1,19 @@
 #include "core/pty.hpp"
 
+#include "core/child_reaper.hpp"
+
+#include <cerrno>
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <pty.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
-
 namespace tide::core {
 
 Pty::Pty() = default;
@@ -17,9 +21,12 @@ Pty::Pty() = default;
 Pty::~Pty() { close(); }
 
 Pty::Pty(Pty &&other) noexcept
-    : master_fd_(other.master_fd_), child_pid_(other.child_pid_) {
+    : master_fd_(other.master_fd_), child_pid_(other.child_pid_),
+      pid_fd_(other.pid_fd_), exit_status_(other.exit_status_) {
   other.master_fd_ = -1;
   other.child_pid_ = -1;
+  other.pid_fd_ = -1;
+  other.exit_status_ = -1;
 }
 
 Pty &Pty::operator=(Pty &&other) noexcept {
@@ -27,19 +34,40 @@ Pty &Pty::operator=(Pty &&other) noexcept {
     close();
     master_fd_ = other.master_fd_;
     child_pid_ = other.child_pid_;
+    pid_fd_ = other.pid_fd_;
+    exit_status_ = other.exit_status_;
     other.master_fd_ = -1;
     other.child_pid_ = -1;
+    other.pid_fd_ = -1;
+    other.exit_status_ = -1;
   }
   return *this;
 }
 
-bool Pty::spawn() {
+bool Pty::spawn(const SpawnContext &context) {
   // Get shell from environment, fallback to /bin/bash
   const char *shell = std::getenv("SHELL");
   if (!shell || shell[0] == '\0') {
     shell = "/bin/bash";
   }
 
+  // Execute shell as login shell
+  return spawn({shell, "-l"}, context);
+}
+
+bool Pty::spawn(const std::vector<std::string> &command,
+                const SpawnContext &context) {
+  if (command.empty()) {
+    return false;
+  }
+
+  // Build argv before forking
+  std::vector<char *> argv;
+  for (const std::string &arg : command) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
   // Create PTY and fork
   pid_t pid = forkpty(&master_fd_, nullptr, nullptr, nullptr);
 
@@ -54,8 +82,25 @@ bool Pty::spawn() {
     // TODO: Set up environment variables for terminal type
     setenv("TERM", "xterm-256color", 1);
 
-    // Execute shell as login shell
-    execlp(shell, shell, "-l", nullptr);
+    for (const std::string &var : context.env) {
+      size_t eq = var.find('=');
+      if (eq == std::string::npos) {
+        unsetenv(var.c_str());
+      } else {
+        setenv(var.substr(0, eq).c_str(), var.c_str() + eq + 1, 1);
+      }
+    }
+    if (!context.cwd.empty() && chdir(context.cwd.c_str()) < 0) {
+      std::cerr << "[tide] Failed to enter " << context.cwd << ": "
+                << std::strerror(errno) << std::endl;
+    }
+
+    // SIGCHLD is blocked for the reaper; the shell needs its own
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, nullptr);
+
+    execvp(argv[0], argv.data());
 
     // If exec fails, exit child
     std::cerr << "[tide] exec failed: " << std::strerror(errno) << std::endl;
@@ -64,8 +109,26 @@ bool Pty::spawn() {
 
   // Parent process
   child_pid_ = pid;
-  std::cout << "[tide] Spawned shell: " << shell << " (pid: " << pid << ")"
-            << std::endl;
+  exit_status_ = -1;
+  // Readable once the child exits, so its exit is an event rather than
+  // something to poll for (always close-on-exec)
+  pid_fd_ = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+  std::cout << "[tide] Spawned: " << command[0] << " (pid: " << pid
+            << ")" << std::endl;
+
+  // Never block on the master; readers wait for readiness instead
+  int flags = fcntl(master_fd_, F_GETFL);
+  if (flags < 0 || fcntl(master_fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+    std::cerr << "[tide] Failed to make PTY non-blocking: "
+              << std::strerror(errno) << std::endl;
+  }
+
+  // Keep the master out of later tabs' shells: a child holding it would
+  // keep this tab's shell from ever seeing the hangup when it closes
+  if (fcntl(master_fd_, F_SETFD, FD_CLOEXEC) < 0) {
+    std::cerr << "[tide] Failed to set close-on-exec on PTY: "
+              << std::strerror(errno) << std::endl;
+  }
 
   return true;
 }
@@ -75,32 +138,11 @@ ssize_t Pty::read(char *buffer, size_t max_size) {
     return -1;
   }
 
-  // Use select() for non-blocking check
-  fd_set read_fds;
-  FD_ZERO(&read_fds);
-  FD_SET(master_fd_, &read_fds);
-
-  struct timeval timeout = {0, 0}; // Immediate return
-
-  int result = select(master_fd_ + 1, &read_fds, nullptr, nullptr, &timeout);
-
-  if (result < 0) {
-    if (errno == EINTR) {
-      return 0; // Interrupted, try again later
-    }
-    return -1;
-  }
-
-  if (result == 0) {
-    return 0; // No data available
-  }
-
-  // Data available, read it
   ssize_t bytes_read = ::read(master_fd_, buffer, max_size);
 
   if (bytes_read < 0) {
-    if (errno == EAGAIN || errno == EWOULDBLOCK) {
-      return 0;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return 0; // No data available
     }
     return -1;
   }
@@ -113,7 +155,21 @@ ssize_t Pty::write(const char *data, size_t size) {
     return -1;
   }
 
-  return ::write(master_fd_, data, size);
+  size_t written = 0;
+  while (written < size) {
+    ssize_t n = ::write(master_fd_, data + written, size - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break; // Child is not reading; PtyWriter queues the rest
+      }
+      return written > 0 ? static_cast<ssize_t>(written) : -1;
+    }
+    written += static_cast<size_t>(n);
+  }
+  return static_cast<ssize_t>(written);
 }
 
 void Pty::resize(int cols, int rows) {
@@ -135,16 +191,38 @@ void Pty::resize(int cols, int rows) {
   }
 }
 
+bool Pty::reap() {
+  if (child_pid_ <= 0) {
+    return exited();
+  }
+  int status = 0;
+  pid_t result = waitpid(child_pid_, &status, WNOHANG);
+  if (result == 0) {
+    return false; // Still running
+  }
+  if (result < 0) {
+    status = 0; // Reaped elsewhere; the status is lost
+  }
+  exit_status_ = WIFSIGNALED(status) ? 128 + WTERMSIG(status)
+                                     : WEXITSTATUS(status);
+  child_pid_ = -1;
+  if (pid_fd_ >= 0) {
+    ::close(pid_fd_);
+    pid_fd_ = -1;
+  }
+  return true;
+}
+
 void Pty::close() {
   if (master_fd_ >= 0) {
-    ::close(master_fd_);
+    ::close(master_fd_); // Hangs up the child
     master_fd_ = -1;
   }
 
-  if (child_pid_ > 0) {
-    // Wait for child to avoid zombie process
-    int status;
-    waitpid(child_pid_, &status, WNOHANG);
+  if (child_pid_ > 0 && !reap()) {
+    // Still running: reap it when it exits rather than leave a zombie
+    ChildReaper::instance().adopt(child_pid_, pid_fd_);
+    pid_fd_ = -1;
     child_pid_ = -1;
   }
 }
@@ -1,9 +1,19 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace tide::core {
 
+/**
+ * Where a child starts when that is not where tide runs, as for a window a
+ * single-instance launch asked for.
+ */
+struct SpawnContext {
+  std::string cwd;              // Empty: tide's own
+  std::vector<std::string> env; // "NAME=value" to set, or "NAME" to unset
+};
+
 /**
  * PTY (Pseudo-Terminal) handler for spawning and communicating with a shell.
  * Uses Linux forkpty() to create a pseudo-terminal pair.
@@ -24,12 +34,22 @@ public:
   /**
    * Spawn a shell process attached to the PTY.
    * Uses $SHELL environment variable, falls back to /bin/bash.
+   * @param context Directory and environment to start in (optional)
+   * @return true if spawn succeeded
+   */
+  bool spawn(const SpawnContext &context = {});
+
+  /**
+   * Spawn a command attached to the PTY.
+   * @param command Program (looked up in PATH) and its arguments
+   * @param context Directory and environment to start in (optional)
    * @return true if spawn succeeded
    */
-  bool spawn();
+  bool spawn(const std::vector<std::string> &command,
+             const SpawnContext &context = {});
 
   /**
-   * Read available data from the PTY (non-blocking).
+   * Read available data from the PTY (the master is non-blocking).
    * @param buffer Output buffer to read into
    * @param max_size Maximum bytes to read
    * @return Number of bytes read, 0 if nothing available, -1 on error
@@ -37,10 +57,11 @@ public:
   ssize_t read(char *buffer, size_t max_size);
 
   /**
-   * Write data to the PTY (sends to shell's stdin).
+   * Write data to the PTY (sends to shell's stdin) without blocking.
    * @param data Data to write
    * @param size Size of data
-   * @return Number of bytes written, -1 on error
+   * @return Number of bytes written, short (or 0) if the child is not
+   *         reading, -1 on error
    */
   ssize_t write(const char *data, size_t size);
 
@@ -52,7 +73,26 @@ public:
   void resize(int cols, int rows);
 
   /**
-   * Close the PTY and terminate the child process.
+   * Collect the child's exit status if it has exited, without waiting.
+   * pid_fd() becomes readable when this would succeed.
+   * @return true once the child has been reaped
+   */
+  bool reap();
+
+  /**
+   * True once reap() has collected the child's status.
+   */
+  [[nodiscard]] bool exited() const { return exit_status_ >= 0; }
+
+  /**
+   * The child's exit code, or 128 + signal number if a signal killed it
+   * (like $? in a shell); -1 until exited().
+   */
+  [[nodiscard]] int exit_status() const { return exit_status_; }
+
+  /**
+   * Close the PTY, hanging up the child. A child that has not exited yet
+   * is handed to the ChildReaper rather than waited for.
    */
   void close();
 
@@ -66,9 +106,17 @@ public:
    */
   [[nodiscard]] int master_fd() const { return master_fd_; }
 
+  /**
+   * A pidfd for the child, readable once it exits (-1 before Linux 5.3,
+   * where exit is only seen as EOF on the master).
+   */
+  [[nodiscard]] int pid_fd() const { return pid_fd_; }
+
 private:
   int master_fd_ = -1;   // Master side of the PTY
-  pid_t child_pid_ = -1; // Child process ID
+  pid_t child_pid_ = -1; // Child process ID, until reaped
+  int pid_fd_ = -1;
+  int exit_status_ = -1;
 };
 
 } // namespace tide::core
@@ -0,0 +1,297 @@
+#include "core/pty_reader.hpp"
+
+#include "core/pty_uring.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace tide::core {
+
+PtyReader::PtyReader(size_t capacity) : ring_(capacity) {}
+
+PtyReader::~PtyReader() { stop(); }
+
+bool PtyReader::start(int fd, PtyUring *uring) {
+  if (thread_.joinable() || uring_ || fd < 0) {
+    return false;
+  }
+
+  if (uring) {
+    fd_ = fd;
+    read_size_ = MIN_READ;
+    closed_.store(false);
+    exited_.store(false);
+    notified_.store(false);
+    stalled_.store(false);
+    if (!uring->add(this)) {
+      fd_ = -1;
+      return false;
+    }
+    uring_ = uring;
+    return true;
+  }
+
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  // Writability is watched on a separate descriptor for the same file, so
+  // it can be armed one-shot without touching the edge-triggered reads
+  out_fd_ = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  epoll_event pty_event{};
+  pty_event.events = EPOLLIN | EPOLLET;
+  pty_event.data.fd = fd;
+  epoll_event wake_event{};
+  wake_event.events = EPOLLIN;
+  wake_event.data.fd = wake_fd_;
+  epoll_event out_event{};
+  out_event.events = EPOLLONESHOT; // Disarmed until notify_when_writable()
+  out_event.data.fd = out_fd_;
+  epoll_event exit_event{};
+  exit_event.events = EPOLLIN | EPOLLONESHOT; // A child exits once
+  exit_event.data.fd = exit_fd_;
+  if (wake_fd_ < 0 || epoll_fd_ < 0 || out_fd_ < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &pty_event) < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event) < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, out_fd_, &out_event) < 0 ||
+      (exit_fd_ >= 0 &&
+       epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, exit_fd_, &exit_event) < 0)) {
+    std::cerr << "[tide] Failed to set up PTY polling: "
+              << std::strerror(errno) << std::endl;
+    close_fds();
+    return false;
+  }
+
+  fd_ = fd;
+  read_size_ = MIN_READ;
+  stopping_.store(false);
+  closed_.store(false);
+  exited_.store(false);
+  notified_.store(false);
+  thread_ = std::thread(&PtyReader::run, this);
+  return true;
+}
+
+void PtyReader::stop() {
+  if (uring_) {
+    uring_->remove(this); // Returns once nothing is in flight for us
+    uring_ = nullptr;
+    fd_ = -1;
+    return;
+  }
+  if (!thread_.joinable()) {
+    return;
+  }
+
+  stopping_.store(true, std::memory_order_release);
+  uint64_t one = 1;
+  (void)!::write(wake_fd_, &one, sizeof(one)); // Interrupt epoll_wait()
+  signal_space();                              // Or a wait for room
+  thread_.join();
+
+  close_fds();
+  fd_ = -1;
+}
+
+void PtyReader::close_fds() {
+  if (wake_fd_ >= 0) {
+    ::close(wake_fd_);
+    wake_fd_ = -1;
+  }
+  if (epoll_fd_ >= 0) {
+    ::close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+  if (out_fd_ >= 0) {
+    ::close(out_fd_);
+    out_fd_ = -1;
+  }
+}
+
+void PtyReader::notify_when_writable() {
+  if (uring_) {
+    uring_->watch_writable(this);
+    return;
+  }
+  epoll_event out_event{};
+  out_event.events = EPOLLOUT | EPOLLONESHOT;
+  out_event.data.fd = out_fd_;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, out_fd_, &out_event) < 0) {
+    std::cerr << "[tide] Failed to watch PTY for writing: "
+              << std::strerror(errno) << std::endl;
+  }
+}
+
+size_t PtyReader::drain(const Sink &sink, size_t limit) {
+  // Re-arm before sizing the budget: bytes committed after this are either
+  // in the budget or notify again. The exchange pairs with the one in
+  // notify(), so a commit it suppressed is visible to size().
+  notified_.exchange(false, std::memory_order_acq_rel);
+  size_t budget = std::min(ring_.size(), limit);
+  size_t total = 0;
+
+  while (total < budget) {
+    size_t size = 0;
+    const char *data = ring_.read_region(size);
+    size = std::min(size, budget - total);
+    if (size == 0) {
+      break;
+    }
+    sink(data, size);
+    ring_.consume(size);
+    signal_space();
+    total += size;
+  }
+  return total;
+}
+
+void PtyReader::signal_space() {
+  if (uring_) {
+    // Only a stalled io_uring reader is waiting for room. The fence pairs
+    // with the one in PtyUring: it sees our room, or we see its flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (stalled_.load(std::memory_order_relaxed) &&
+        stalled_.exchange(false, std::memory_order_acq_rel)) {
+      uring_->resume(this);
+    }
+    return;
+  }
+  space_signal_.fetch_add(1, std::memory_order_release);
+  space_signal_.notify_one();
+}
+
+void PtyReader::notify() {
+  if (notify_ && !notified_.exchange(true, std::memory_order_acq_rel)) {
+    notify_();
+  }
+}
+
+void PtyReader::report_exit() {
+  exited_.store(true, std::memory_order_release);
+  if (notify_) {
+    notify_(); // Always: the consumer must see finished()
+  }
+}
+
+void PtyReader::run() {
+  // Edge-triggered: after a wakeup, read until EAGAIN before waiting again.
+  // Start as readable in case output arrived before registration.
+  bool readable = true;
+  bool exiting = false; // Child exited; report it once its output is read
+  std::chrono::steady_clock::time_point drain_end;
+
+  while (!stopping_.load(std::memory_order_acquire)) {
+    if (exiting && std::chrono::steady_clock::now() >= drain_end) {
+      exiting = false;
+      report_exit(); // Keep reading whatever background jobs print
+    }
+    if (!readable) {
+      int timeout = -1;
+      if (exiting) {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(
+            drain_end - std::chrono::steady_clock::now());
+        timeout = static_cast<int>(std::max<int64_t>(left.count(), 0));
+      }
+      epoll_event events[4];
+      int count = epoll_wait(epoll_fd_, events, 4, timeout);
+      waits_.fetch_add(1, std::memory_order_relaxed);
+      if (count < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::cerr << "[tide] PTY epoll_wait failed: " << std::strerror(errno)
+                  << std::endl;
+        break;
+      }
+      for (int i = 0; i < count; ++i) {
+        if (events[i].data.fd == wake_fd_) {
+          return; // stop()
+        }
+        if (events[i].data.fd == out_fd_) {
+          if (notify_) {
+            notify_(); // Room to write: the writer flushes again
+          }
+          continue;
+        }
+        if (events[i].data.fd == exit_fd_) {
+          exiting = true; // Read what it wrote before exiting first
+          drain_end = std::chrono::steady_clock::now() +
+                      std::chrono::milliseconds(EXIT_DRAIN_MS);
+        }
+        readable = true; // Input, or hangup (the read reports it)
+      }
+      continue;
+    }
+
+    // Load the signal before checking for room, so a drain in between
+    // changes it and the wait returns at once
+    uint32_t seen = space_signal_.load(std::memory_order_acquire);
+    size_t room = 0;
+    char *dst = ring_.write_region(room);
+    if (room == 0) {
+      space_signal_.wait(seen, std::memory_order_acquire);
+      continue;
+    }
+
+    size_t request = std::min(room, read_size_);
+    ssize_t n = ::read(fd_, dst, request);
+    reads_.fetch_add(1, std::memory_order_relaxed);
+    if (n > 0) {
+      ring_.commit(static_cast<size_t>(n));
+      bytes_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+      notify();
+      if (static_cast<size_t>(n) == request) {
+        read_size_ = std::min(read_size_ * 2, MAX_READ); // More is waiting
+      }
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      readable = false;
+      read_size_ = std::max(read_size_ / 2, MIN_READ); // Burst is over
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    break; // EOF, or EIO once the child has exited
+  }
+
+  closed_.store(true, std::memory_order_release);
+  if (notify_) {
+    notify_(); // Always: the consumer must see finished()
+  }
+
+  // The PTY usually closes just before the child exits: keep watching the
+  // exit fd, so the consumer hears of the exit without polling for it
+  if (exiting) {
+    report_exit();
+    return;
+  }
+  if (exit_fd_ < 0 || child_exited()) {
+    return;
+  }
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd_, nullptr);
+  while (!stopping_.load(std::memory_order_acquire)) {
+    epoll_event events[4];
+    int count = epoll_wait(epoll_fd_, events, 4, -1);
+    if (count < 0 && errno != EINTR) {
+      return;
+    }
+    for (int i = 0; i < count; ++i) {
+      if (events[i].data.fd == wake_fd_) {
+        return; // stop()
+      }
+      if (events[i].data.fd == exit_fd_) {
+        report_exit();
+        return;
+      }
+    }
+  }
+}
+
+} // namespace tide::core
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "core/byte_ring.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace tide::core {
+
+class PtyUring;
+
+/**
+ * Drains a non-blocking PTY master on a background thread into a ByteRing.
+ *
+ * The thread sleeps in epoll_wait (edge-triggered) and, once woken, reads
+ * straight into the ring until EAGAIN. Each read asks for up to an adaptive
+ * size that doubles while reads come back full (a flood) and halves when the
+ * burst ends, so floods take few large reads while interactive output stays
+ * small. When the ring is full the thread stops reading until the consumer
+ * catches up, so the kernel's PTY buffer fills and the child blocks:
+ * backpressure instead of unbounded memory. The consumer takes everything
+ * buffered with drain(), and can sleep in between: set_notify() tells it
+ * when there is something to drain.
+ *
+ * Given the child's pidfd, the reader also watches for its exit: the output
+ * it left behind is read, and then finished() turns true even if a
+ * background job still holds the PTY open.
+ *
+ * Alternatively a shared PtyUring does the reading for many readers on one
+ * thread; the ring, notifications and backpressure work the same.
+ */
+class PtyReader {
+public:
+  using Sink = std::function<void(const char *data, size_t size)>;
+  using Notify = std::function<void()>;
+
+  static constexpr size_t DEFAULT_CAPACITY = 1024 * 1024;
+  static constexpr size_t MIN_READ = 16 * 1024;
+  static constexpr size_t MAX_READ = 1024 * 1024;
+
+  // After the child exits, output is read for this long before the exit is
+  // reported (unless the PTY closes first): its last writes may still be
+  // on their way to the master
+  static constexpr int EXIT_DRAIN_MS = 20;
+
+  /**
+   * Counters for judging syscall cost.
+   */
+  struct Stats {
+    uint64_t bytes = 0;
+    uint64_t reads = 0; // read() calls, including the final EAGAIN
+    uint64_t waits = 0; // epoll_wait() calls
+
+    [[nodiscard]] double syscalls_per_mb() const {
+      return bytes == 0 ? 0.0
+                        : static_cast<double>(reads + waits) * 1e6 /
+                              static_cast<double>(bytes);
+    }
+  };
+
+  explicit PtyReader(size_t capacity = DEFAULT_CAPACITY);
+  ~PtyReader();
+
+  // Non-copyable
+  PtyReader(const PtyReader &) = delete;
+  PtyReader &operator=(const PtyReader &) = delete;
+
+  /**
+   * Call `notify` on the reader thread when bytes arrive for a consumer
+   * that has drained everything it was told about, and when the PTY
+   * closes. A flood notifies once per drain() rather than once per read.
+   * Set before start().
+   */
+  void set_notify(Notify notify) { notify_ = std::move(notify); }
+
+  /**
+   * Also watch `pid_fd` (see Pty::pid_fd(); not owned, -1 for none) and
+   * report child_exited() once it is readable and the output before it
+   * has been read; notifies like a close. Set before start().
+   */
+  void set_exit_fd(int pid_fd) { exit_fd_ = pid_fd; }
+
+  /**
+   * Call the notify callback once, when the PTY next has room for writing
+   * (see PtyWriter). Any thread; the thread must be running.
+   */
+  void notify_when_writable();
+
+  /**
+   * Start reading `fd` (not owned; must outlive stop()), on our own thread
+   * or, when `uring` is given, on the shared io_uring thread.
+   * @return false if reading could not be set up
+   */
+  bool start(int fd, PtyUring *uring = nullptr);
+
+  /**
+   * Stop reading (joining our thread, or leaving the io_uring). Buffered
+   * bytes stay available to drain().
+   */
+  void stop();
+
+  /**
+   * Hand everything buffered when called, up to `limit` bytes, to `sink`
+   * (consumer thread only). Bytes arriving meanwhile wait for the next
+   * call, so a flood cannot hold the caller here indefinitely.
+   * @return Number of bytes handed over
+   */
+  size_t drain(const Sink &sink, size_t limit = SIZE_MAX);
+
+  /**
+   * Bytes waiting for drain() (consumer thread).
+   */
+  [[nodiscard]] size_t buffered() const { return ring_.size(); }
+
+  /**
+   * True once the child has exited or the PTY has closed, and every byte
+   * read from it has been drained.
+   */
+  [[nodiscard]] bool finished() const {
+    return (closed_.load(std::memory_order_acquire) || child_exited()) &&
+           ring_.empty();
+  }
+
+  /**
+   * True once the exit fd reported the child's exit (the Pty can reap it).
+   */
+  [[nodiscard]] bool child_exited() const {
+    return exited_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] Stats stats() const {
+    return {bytes_.load(std::memory_order_relaxed),
+            reads_.load(std::memory_order_relaxed),
+            waits_.load(std::memory_order_relaxed)};
+  }
+
+private:
+  friend class PtyUring;
+
+  ByteRing ring_;
+  int fd_ = -1;
+  int wake_fd_ = -1;  // eventfd that interrupts epoll_wait() on stop()
+  int epoll_fd_ = -1;
+  int out_fd_ = -1;   // dup of fd_, registered one-shot for EPOLLOUT
+  int exit_fd_ = -1;  // pidfd, registered one-shot for EPOLLIN
+  size_t read_size_ = MIN_READ; // Reader thread only
+  std::thread thread_;
+  PtyUring *uring_ = nullptr;      // Reading for us instead of thread_
+  std::atomic<bool> stalled_{false}; // io_uring stopped reading: ring full
+  Notify notify_;
+  std::atomic<bool> notified_{false}; // Set by notify, cleared by drain()
+  std::atomic<bool> stopping_{false};
+  std::atomic<bool> closed_{false};
+  std::atomic<bool> exited_{false};
+  std::atomic<uint32_t> space_signal_{0}; // Bumped whenever room is freed
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> reads_{0};
+  std::atomic<uint64_t> waits_{0};
+
+  void run();
+  void signal_space();
+  void notify();
+  void report_exit();
+  void close_fds();
+};
+
+} // namespace tide::core
@@ -0,0 +1,594 @@
+#include "core/pty_uring.hpp"
+
+#include "core/pty_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace tide::core {
+
+namespace {
+
+// Multishot poll arrived in Linux 5.13, with resource tags
+constexpr unsigned REQUIRED_FEATURES =
+    IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RSRC_TAGS;
+
+/**
+ * Fill a zeroed SQE.
+ */
+void prepare(io_uring_sqe &sqe, uint8_t opcode, int fd, uint64_t addr,
+             uint32_t len, uint64_t user_data) {
+  sqe.opcode = opcode;
+  sqe.fd = fd;
+  sqe.addr = addr;
+  sqe.len = len;
+  sqe.user_data = user_data;
+}
+
+// Output of an exited child is read for this long before its exit is
+// reported; the kernel copies it when the timeout is submitted
+const __kernel_timespec EXIT_DRAIN = {
+    0, PtyReader::EXIT_DRAIN_MS * 1000 * 1000};
+
+unsigned load_acquire(unsigned *shared) {
+  return std::atomic_ref<unsigned>(*shared).load(std::memory_order_acquire);
+}
+
+void store_release(unsigned *shared, unsigned value) {
+  std::atomic_ref<unsigned>(*shared).store(value, std::memory_order_release);
+}
+
+} // anonymous namespace
+
+std::unique_ptr<PtyUring> PtyUring::create(unsigned entries) {
+  // Every master can have a multishot poll posting completions while its
+  // read completes, so leave the CQ plenty of room
+  io_uring_params params{};
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+  int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (fd < 0) {
+    std::cerr << "[tide] io_uring_setup failed: " << std::strerror(errno)
+              << std::endl;
+    return nullptr;
+  }
+  if ((params.features & REQUIRED_FEATURES) != REQUIRED_FEATURES) {
+    std::cerr << "[tide] io_uring lacks multishot poll (needs Linux 5.13)"
+              << std::endl;
+    ::close(fd);
+    return nullptr;
+  }
+
+  std::unique_ptr<PtyUring> uring(new PtyUring());
+  uring->ring_fd_ = fd;
+  if (!uring->map_queues(params)) {
+    return nullptr;
+  }
+  uring->wake_fd_ = eventfd(0, EFD_CLOEXEC);
+  if (uring->wake_fd_ < 0) {
+    std::cerr << "[tide] Failed to create io_uring wake fd: "
+              << std::strerror(errno) << std::endl;
+    return nullptr;
+  }
+  uring->thread_ = std::thread(&PtyUring::run, uring.get());
+  return uring;
+}
+
+PtyUring::~PtyUring() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    uint64_t one = 1;
+    (void)!::write(wake_fd_, &one, sizeof(one));
+    thread_.join();
+  }
+
+  if (queues_.sqes) {
+    munmap(queues_.sqes, queues_.sqes_size);
+  }
+  if (queues_.ring) {
+    munmap(queues_.ring, queues_.ring_size);
+  }
+  if (wake_fd_ >= 0) {
+    ::close(wake_fd_);
+  }
+  if (ring_fd_ >= 0) {
+    ::close(ring_fd_);
+  }
+}
+
+bool PtyUring::map_queues(const io_uring_params &params) {
+  Queues &queues = queues_;
+  queues.ring_size =
+      std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+               params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  void *ring = mmap(nullptr, queues.ring_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ring == MAP_FAILED) {
+    std::cerr << "[tide] Failed to map io_uring: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+  queues.ring = ring;
+
+  queues.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, queues.sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    std::cerr << "[tide] Failed to map io_uring SQEs: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+  queues.sqes = static_cast<io_uring_sqe *>(sqes);
+
+  // One mapping holds both rings (IORING_FEAT_SINGLE_MMAP)
+  char *base = static_cast<char *>(ring);
+  auto field = [base](uint32_t offset) {
+    return reinterpret_cast<unsigned *>(base + offset);
+  };
+  queues.sq_head = field(params.sq_off.head);
+  queues.sq_tail = field(params.sq_off.tail);
+  queues.sq_mask = *field(params.sq_off.ring_mask);
+  queues.sq_entries = params.sq_entries;
+  queues.sq_array = field(params.sq_off.array);
+  queues.cq_head = field(params.cq_off.head);
+  queues.cq_tail = field(params.cq_off.tail);
+  queues.cq_mask = *field(params.cq_off.ring_mask);
+  queues.cqes = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+  sq_tail_ = *queues.sq_tail;
+  return true;
+}
+
+bool PtyUring::add(PtyReader *reader) {
+  return post({Command::ADD, reader});
+}
+
+void PtyUring::remove(PtyReader *reader) {
+  if (!post({Command::REMOVE, reader})) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  removed_.wait(lock, [&] {
+    return stopped_ ||
+           std::find(done_.begin(), done_.end(), reader) != done_.end();
+  });
+  done_.erase(std::remove(done_.begin(), done_.end(), reader), done_.end());
+}
+
+void PtyUring::resume(PtyReader *reader) { post({Command::RESUME, reader}); }
+
+void PtyUring::watch_writable(PtyReader *reader) {
+  post({Command::WRITABLE, reader});
+}
+
+PtyUring::Stats PtyUring::stats() const {
+  return {enters_.load(std::memory_order_relaxed),
+          completions_.load(std::memory_order_relaxed),
+          wakes_.load(std::memory_order_relaxed)};
+}
+
+bool PtyUring::post(Command command) {
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || stopped_) {
+      return false;
+    }
+    // The ring thread takes the whole queue at once, so only the first
+    // command since then needs to wake it
+    wake = commands_.empty();
+    commands_.push_back(command);
+  }
+  if (wake) {
+    uint64_t one = 1;
+    (void)!::write(wake_fd_, &one, sizeof(one));
+    wakes_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void PtyUring::run() {
+  bool ok = arm_wake();
+  std::vector<Command> commands;
+  std::vector<uint32_t> retry;
+
+  while (ok) {
+    reap();
+
+    bool stopping = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      commands.swap(commands_);
+      stopping = stopping_;
+    }
+    for (const Command &command : commands) {
+      apply(command);
+    }
+    commands.clear();
+    if (stopping) {
+      break;
+    }
+
+    retry.swap(retry_);
+    for (uint32_t slot : retry) {
+      if (slot < entries_.size() && entries_[slot].reader) {
+        service(slot);
+      }
+    }
+    retry.clear();
+    if (!wake_armed_) {
+      arm_wake();
+    }
+
+    // Submit everything queued above and sleep until something completes;
+    // without a wake read in flight nothing could interrupt the sleep
+    ok = enter(wake_armed_ ? 1 : 0);
+  }
+
+  // The eventfd read writes into us; let it complete before we go away
+  while (ok && wake_armed_) {
+    ok = enter(1);
+    reap();
+  }
+  if (!ok) {
+    for (Entry &entry : entries_) {
+      if (entry.reader) {
+        close_entry(entry);
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  removed_.notify_all();
+}
+
+bool PtyUring::reap() {
+  unsigned head = *queues_.cq_head; // Only we move it
+  uint64_t count = 0;
+  for (unsigned tail; (tail = load_acquire(queues_.cq_tail)) != head;) {
+    while (head != tail) {
+      // Copy and release the CQE first: handling it may submit and enter
+      io_uring_cqe cqe = queues_.cqes[head & queues_.cq_mask];
+      store_release(queues_.cq_head, ++head);
+      handle(cqe);
+      ++count;
+    }
+  }
+  completions_.fetch_add(count, std::memory_order_relaxed);
+  return count > 0;
+}
+
+void PtyUring::handle(const io_uring_cqe &cqe) {
+  auto op = static_cast<Op>(cqe.user_data & 0xff);
+  auto slot = static_cast<uint32_t>(cqe.user_data >> 8);
+  if (op == Op::WAKE) {
+    wake_armed_ = false; // Commands are picked up by the loop
+    return;
+  }
+
+  Entry &entry = entries_[slot];
+  PtyReader &reader = *entry.reader;
+  switch (op) {
+  case Op::POLL_IN:
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      entry.polling = false; // Ended (cancelled or overflowed); re-armed below
+    }
+    if (cqe.res >= 0) {
+      entry.readable = true;
+      // Wakeups are coalesced: the last output and the hangup can arrive
+      // as one completion, and no further one follows
+      entry.hangup = entry.hangup || (cqe.res & (POLLHUP | POLLERR)) != 0;
+    } else if (cqe.res != -ECANCELED && !entry.closed) {
+      std::cerr << "[tide] PTY io_uring poll failed: "
+                << std::strerror(-cqe.res) << std::endl;
+      close_entry(entry);
+    }
+    break;
+
+  case Op::READ:
+    entry.reading = false;
+    if (cqe.res > 0) {
+      auto n = static_cast<size_t>(cqe.res);
+      reader.ring_.commit(n);
+      reader.bytes_.fetch_add(n, std::memory_order_relaxed);
+      reader.notify();
+      if (n == entry.request) {
+        // More is waiting
+        reader.read_size_ = std::min(reader.read_size_ * 2,
+                                     PtyReader::MAX_READ);
+        entry.readable = true;
+      } else {
+        // Burst is over; the poll reports anything newer
+        reader.read_size_ = std::max(reader.read_size_ / 2,
+                                     PtyReader::MIN_READ);
+        entry.readable = entry.readable || entry.hangup || entry.exiting;
+      }
+    } else if (cqe.res == -EAGAIN) {
+      reader.read_size_ = std::max(reader.read_size_ / 2, PtyReader::MIN_READ);
+    } else if (cqe.res == -EINTR) {
+      entry.readable = true;
+    } else if (cqe.res == -ECANCELED) {
+      // remove(): nothing more to read
+    } else {
+      close_entry(entry); // EOF, or EIO once the child has exited
+    }
+    break;
+
+  case Op::POLL_OUT:
+    entry.watching = false;
+    if (cqe.res > 0 && reader.notify_) {
+      reader.notify_(); // Room to write: the writer flushes again
+    }
+    break;
+
+  case Op::POLL_EXIT:
+    entry.exit_polling = false;
+    if (cqe.res > 0 && entry.closed) {
+      reader.report_exit(); // Exited after its PTY closed
+    } else if (cqe.res > 0) {
+      entry.exiting = true; // Read what it wrote before exiting first
+      entry.readable = true;
+    }
+    break;
+
+  case Op::DRAIN:
+    entry.draining = false;
+    if (cqe.res == -ETIME && entry.exiting) {
+      entry.exiting = false;
+      reader.report_exit(); // Keep reading whatever background jobs print
+    }
+    break;
+
+  case Op::CANCEL:
+    --entry.cancels;
+    break;
+
+  case Op::WAKE:
+    break;
+  }
+  service(slot);
+}
+
+void PtyUring::apply(const Command &command) {
+  if (command.kind == Command::ADD) {
+    uint32_t slot = 0;
+    if (free_slots_.empty()) {
+      slot = static_cast<uint32_t>(entries_.size());
+      entries_.emplace_back();
+    } else {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    }
+    Entry &entry = entries_[slot];
+    entry = Entry{};
+    entry.reader = command.reader;
+    entry.readable = true; // Output may have arrived before registration
+    slots_[command.reader] = slot;
+    service(slot);
+    return;
+  }
+
+  auto found = slots_.find(command.reader);
+  if (found == slots_.end()) {
+    if (command.kind == Command::REMOVE) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_.push_back(command.reader);
+      removed_.notify_all();
+    }
+    return;
+  }
+  Entry &entry = entries_[found->second];
+  if (command.kind == Command::REMOVE) {
+    entry.removing = true;
+  } else if (command.kind == Command::WRITABLE) {
+    entry.want_out = true;
+  }
+  // RESUME: the read that stalled is still wanted
+  service(found->second);
+}
+
+void PtyUring::service(uint32_t slot) {
+  Entry &entry = entries_[slot];
+  bool starved = false;
+  auto tag = [slot](Op op) {
+    return (uint64_t{slot} << 8) | static_cast<uint64_t>(op);
+  };
+  auto poll = [&](int fd, uint32_t events, uint32_t flags, Op op) {
+    io_uring_sqe *sqe = next_sqe();
+    if (!sqe) {
+      starved = true;
+      return false;
+    }
+    prepare(*sqe, IORING_OP_POLL_ADD, fd, 0, flags, tag(op));
+    sqe->poll32_events = events;
+    return true;
+  };
+  auto cancel = [&](uint8_t opcode, Op op) {
+    io_uring_sqe *sqe = next_sqe();
+    if (!sqe) {
+      starved = true;
+      return false;
+    }
+    prepare(*sqe, opcode, -1, tag(op), 0, tag(Op::CANCEL));
+    ++entry.cancels;
+    return true;
+  };
+
+  if (entry.closed || entry.removing) {
+    // Wind down: take back the polls, and a read waiting for output
+    if (entry.polling && !entry.cancel_in) {
+      entry.cancel_in = cancel(IORING_OP_POLL_REMOVE, Op::POLL_IN);
+    }
+    if (entry.watching && !entry.cancel_out) {
+      entry.cancel_out = cancel(IORING_OP_POLL_REMOVE, Op::POLL_OUT);
+    }
+    // A closed PTY still waits for its child's exit (armed before the
+    // first read), which usually follows the hangup
+    if (entry.removing && entry.exit_polling && !entry.cancel_exit) {
+      entry.cancel_exit = cancel(IORING_OP_POLL_REMOVE, Op::POLL_EXIT);
+    }
+    if (entry.draining && !entry.cancel_drain) {
+      entry.cancel_drain = cancel(IORING_OP_TIMEOUT_REMOVE, Op::DRAIN);
+    }
+    if (entry.reading && !entry.cancel_read) {
+      entry.cancel_read = cancel(IORING_OP_ASYNC_CANCEL, Op::READ);
+    }
+    if (entry.removing && !entry.busy()) {
+      finish(slot);
+      return;
+    }
+  } else {
+    PtyReader &reader = *entry.reader;
+    if (!entry.polling) {
+      entry.polling =
+          poll(reader.fd_, POLLIN, IORING_POLL_ADD_MULTI, Op::POLL_IN);
+    }
+    if (entry.want_out && !entry.watching &&
+        poll(reader.fd_, POLLOUT, 0, Op::POLL_OUT)) {
+      entry.want_out = false;
+      entry.watching = true;
+    }
+    if (reader.exit_fd_ >= 0 && !entry.exit_armed &&
+        poll(reader.exit_fd_, POLLIN, 0, Op::POLL_EXIT)) {
+      entry.exit_armed = true; // A child exits once
+      entry.exit_polling = true;
+    }
+    if (entry.exiting && !entry.drain_armed) {
+      if (io_uring_sqe *sqe = next_sqe()) {
+        prepare(*sqe, IORING_OP_TIMEOUT, -1,
+                reinterpret_cast<uint64_t>(&EXIT_DRAIN), 1, tag(Op::DRAIN));
+        entry.drain_armed = true;
+        entry.draining = true;
+      } else {
+        starved = true;
+      }
+    }
+    if (entry.readable && !entry.reading && !starved && !start_read(slot)) {
+      starved = true;
+    }
+  }
+  if (starved) {
+    retry_.push_back(slot);
+  }
+}
+
+bool PtyUring::start_read(uint32_t slot) {
+  Entry &entry = entries_[slot];
+  PtyReader &reader = *entry.reader;
+  size_t room = 0;
+  char *dst = reader.ring_.write_region(room);
+  if (room == 0) {
+    // Stop reading until the consumer drains; signal_space() resumes us.
+    // The fence pairs with the one there: either it sees the flag, or we
+    // see the room it freed.
+    reader.stalled_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    dst = reader.ring_.write_region(room);
+    if (room == 0 ||
+        !reader.stalled_.exchange(false, std::memory_order_acq_rel)) {
+      return true; // Still full, or a resume is already on its way
+    }
+  }
+
+  io_uring_sqe *sqe = next_sqe();
+  if (!sqe) {
+    return false;
+  }
+  entry.request = std::min(room, reader.read_size_);
+  prepare(*sqe, IORING_OP_READ, reader.fd_, reinterpret_cast<uint64_t>(dst),
+          static_cast<uint32_t>(entry.request),
+          (uint64_t{slot} << 8) | static_cast<uint64_t>(Op::READ));
+  sqe->off = UINT64_MAX; // Current position; PTYs are not seekable
+  entry.reading = true;
+  entry.readable = false; // Set again by a full read or the poll
+  reader.reads_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool PtyUring::arm_wake() {
+  io_uring_sqe *sqe = next_sqe();
+  if (!sqe) {
+    return false;
+  }
+  prepare(*sqe, IORING_OP_READ, wake_fd_,
+          reinterpret_cast<uint64_t>(&wake_value_), sizeof(wake_value_),
+          static_cast<uint64_t>(Op::WAKE));
+  sqe->off = UINT64_MAX;
+  wake_armed_ = true;
+  return true;
+}
+
+void PtyUring::close_entry(Entry &entry) {
+  if (entry.closed) {
+    return;
+  }
+  entry.closed = true;
+  entry.reader->closed_.store(true, std::memory_order_release);
+  if (entry.reader->notify_) {
+    entry.reader->notify_(); // Always: the consumer must see finished()
+  }
+  if (entry.exiting) {
+    entry.exiting = false;
+    entry.reader->report_exit();
+  }
+}
+
+void PtyUring::finish(uint32_t slot) {
+  const PtyReader *reader = entries_[slot].reader;
+  slots_.erase(reader);
+  entries_[slot] = Entry{};
+  free_slots_.push_back(slot);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  done_.push_back(reader);
+  removed_.notify_all();
+}
+
+io_uring_sqe *PtyUring::next_sqe() {
+  if (sq_tail_ - load_acquire(queues_.sq_head) == queues_.sq_entries) {
+    enter(0); // Full: submit what is queued to make room
+    if (sq_tail_ - load_acquire(queues_.sq_head) == queues_.sq_entries) {
+      return nullptr;
+    }
+  }
+  unsigned index = sq_tail_ & queues_.sq_mask;
+  queues_.sq_array[index] = index;
+  io_uring_sqe *sqe = &queues_.sqes[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  ++sq_tail_;
+  return sqe;
+}
+
+bool PtyUring::enter(unsigned min_complete) {
+  store_release(queues_.sq_tail, sq_tail_);
+  unsigned submit = sq_tail_ - load_acquire(queues_.sq_head);
+  if (submit == 0 && min_complete == 0) {
+    return true;
+  }
+  unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  long result = syscall(__NR_io_uring_enter, ring_fd_, submit, min_complete,
+                        flags, nullptr, 0);
+  enters_.fetch_add(1, std::memory_order_relaxed);
+  if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+    std::cerr << "[tide] io_uring_enter failed: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace tide::core
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring_params;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace tide::core {
+
+class PtyReader;
+
+/**
+ * Reads every PTY master of the process on one thread through io_uring,
+ * instead of one epoll thread per PtyReader.
+ *
+ * Each master keeps a multishot poll in flight, and a read straight into
+ * its reader's ring whenever the poll fires. (Depending on the kernel, a
+ * read on the non-blocking master either fails with EAGAIN when nothing is
+ * buffered, or stays in flight until output arrives; both work.) Completions
+ * for all masters are reaped in one batch, and the reads and re-arms they
+ * cause are submitted together with the wait for the next batch: one
+ * io_uring_enter() per wakeup, however many masters were busy. Read sizes
+ * adapt and a full ring stops reading, as with the epoll thread.
+ *
+ * create() returns nullptr when io_uring is unavailable (old kernel,
+ * seccomp, io_uring_disabled); callers then fall back to epoll.
+ */
+class PtyUring {
+public:
+  static constexpr unsigned DEFAULT_ENTRIES = 256;
+
+  /**
+   * Counters for judging syscall cost.
+   */
+  struct Stats {
+    uint64_t enters = 0;      // io_uring_enter() calls
+    uint64_t completions = 0; // CQEs reaped
+    uint64_t wakes = 0;       // eventfd writes from other threads
+  };
+
+  /**
+   * Set up a ring and start its thread.
+   * @return nullptr if io_uring is unavailable
+   */
+  static std::unique_ptr<PtyUring> create(unsigned entries = DEFAULT_ENTRIES);
+
+  ~PtyUring();
+
+  // Non-copyable
+  PtyUring(const PtyUring &) = delete;
+  PtyUring &operator=(const PtyUring &) = delete;
+
+  /**
+   * Start reading for `reader` (see PtyReader::start()).
+   * @return false if the thread has stopped
+   */
+  bool add(PtyReader *reader);
+
+  /**
+   * Stop reading for `reader`; returns once nothing is in flight for it.
+   * Every reader must be removed before the PtyUring is destroyed.
+   */
+  void remove(PtyReader *reader);
+
+  /**
+   * `reader` stalled on a full ring and has room again (consumer thread).
+   */
+  void resume(PtyReader *reader);
+
+  /**
+   * Call `reader`'s notify callback once its PTY has room for writing.
+   */
+  void watch_writable(PtyReader *reader);
+
+  [[nodiscard]] Stats stats() const;
+
+private:
+  enum class Op : uint32_t {
+    POLL_IN,
+    READ,
+    POLL_OUT,
+    POLL_EXIT,
+    DRAIN,
+    CANCEL,
+    WAKE
+  };
+
+  struct Command {
+    enum Kind { ADD, REMOVE, RESUME, WRITABLE } kind;
+    PtyReader *reader;
+  };
+
+  /**
+   * Ring thread state for one reader. service() submits whatever the flags
+   * call for.
+   */
+  struct Entry {
+    PtyReader *reader = nullptr;
+    size_t request = 0;     // Length of the read in flight
+    bool polling = false;   // Multishot POLLIN armed
+    bool reading = false;   // A read is in flight
+    bool readable = false;  // Output may be waiting
+    bool hangup = false;    // Child side closed: read on to EOF
+    bool want_out = false;  // watch_writable() asked for POLLOUT
+    bool watching = false;  // One-shot POLLOUT armed
+    bool exit_armed = false;   // Poll on the exit fd submitted (once)
+    bool exit_polling = false; // ... and still in flight
+    bool exiting = false;      // Child exited; report when the drain ends
+    bool drain_armed = false;  // Timeout for the exit drain submitted
+    bool draining = false;     // ... and still in flight
+    int cancels = 0;        // Cancellations in flight
+    bool cancel_in = false; // Cancellation submitted for each request
+    bool cancel_out = false;
+    bool cancel_exit = false;
+    bool cancel_drain = false;
+    bool cancel_read = false;
+    bool closed = false;    // EOF or error; no more reads
+    bool removing = false;  // remove() is waiting
+
+    [[nodiscard]] bool busy() const {
+      return polling || reading || watching || exit_polling || draining ||
+             cancels > 0;
+    }
+  };
+
+  /**
+   * The mapped submission and completion queues.
+   */
+  struct Queues {
+    unsigned *sq_head = nullptr;
+    unsigned *sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned *sq_array = nullptr;
+    io_uring_sqe *sqes = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+    void *ring = nullptr;
+    size_t ring_size = 0;
+    size_t sqes_size = 0;
+  };
+
+  PtyUring() = default;
+
+  int ring_fd_ = -1;
+  int wake_fd_ = -1; // eventfd: other threads post commands through it
+  Queues queues_;
+  std::thread thread_;
+
+  // Ring thread only
+  unsigned sq_tail_ = 0;    // SQEs filled, published by enter()
+  uint64_t wake_value_ = 0; // Target of the eventfd read
+  bool wake_armed_ = false;
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> free_slots_;
+  std::vector<uint32_t> retry_; // Slots that found the SQ full
+  std::unordered_map<const PtyReader *, uint32_t> slots_;
+
+  std::mutex mutex_; // Guards the members below
+  std::condition_variable removed_;
+  std::vector<Command> commands_;
+  std::vector<const PtyReader *> done_; // Removed, not yet collected
+  bool stopping_ = false;
+  bool stopped_ = false; // Thread has exited
+
+  std::atomic<uint64_t> enters_{0};
+  std::atomic<uint64_t> completions_{0};
+  std::atomic<uint64_t> wakes_{0};
+
+  bool map_queues(const io_uring_params &params);
+  bool post(Command command);
+  void run();
+  bool reap();
+  void handle(const io_uring_cqe &cqe);
+  void apply(const Command &command);
+  void service(uint32_t slot);
+  io_uring_sqe *next_sqe();
+  bool enter(unsigned min_complete);
+  bool arm_wake();
+  bool start_read(uint32_t slot);
+  void close_entry(Entry &entry);
+  void finish(uint32_t slot);
+};
+
+} // namespace tide::core
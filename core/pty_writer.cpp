@@ -0,0 +1,150 @@
+#include "core/pty_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/uio.h>
+
+namespace tide::core {
+
+namespace {
+
+constexpr std::string_view PASTE_START = "\x1b[200~";
+constexpr std::string_view PASTE_END = "\x1b[201~";
+
+/**
+ * Remove every occurrence of `marker` from `text`, in one pass.
+ * @return true if any was removed
+ */
+bool strip(std::string &text, std::string_view marker) {
+  size_t found = text.find(marker);
+  if (found == std::string::npos) {
+    return false;
+  }
+
+  // Slide the text between markers down over them
+  size_t out = found;
+  size_t in = found + marker.size();
+  while (true) {
+    found = text.find(marker, in);
+    size_t end = found == std::string::npos ? text.size() : found;
+    std::memmove(text.data() + out, text.data() + in, end - in);
+    out += end - in;
+    if (found == std::string::npos) {
+      break;
+    }
+    in = found + marker.size();
+  }
+  text.resize(out);
+  return true;
+}
+
+} // anonymous namespace
+
+void PtyWriter::write(const char *data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  // Coalesce into the last segment unless that is a large (paste) buffer
+  if (!segments_.empty() && segments_.back().size() < CHUNK_SIZE) {
+    segments_.back().append(data, size);
+    queued_ += size;
+    return;
+  }
+  push(std::string(data, size));
+}
+
+void PtyWriter::paste(std::string text, bool bracketed) {
+  if (!bracketed) {
+    push(std::move(text));
+    return;
+  }
+  while (strip(text, PASTE_END)) {
+    // Removing one can join its neighbours into another
+  }
+  write(PASTE_START);
+  push(std::move(text));
+  push(std::string(PASTE_END)); // Later keystrokes coalesce after this
+}
+
+void PtyWriter::push(std::string segment) {
+  if (segment.empty()) {
+    return;
+  }
+  queued_ += segment.size();
+  segments_.push_back(std::move(segment));
+}
+
+void PtyWriter::consume(size_t n) {
+  queued_ -= n;
+  while (n > 0) {
+    size_t left = segments_.front().size() - offset_;
+    if (n < left) {
+      offset_ += n;
+      return;
+    }
+    n -= left;
+    segments_.pop_front();
+    offset_ = 0;
+  }
+}
+
+void PtyWriter::clear() {
+  segments_.clear();
+  offset_ = 0;
+  queued_ = 0;
+  blocked_ = false;
+}
+
+bool PtyWriter::flush() {
+  blocked_ = false;
+  if (fd_ < 0) {
+    clear();
+    return false;
+  }
+
+  size_t budget = FLUSH_BUDGET;
+  while (queued_ > 0 && budget > 0) {
+    // Gather up to one chunk across segments: a frame's keystrokes, or the
+    // next slice of a paste
+    iovec iov[MAX_IOV];
+    int count = 0;
+    size_t limit = std::min(CHUNK_SIZE, budget);
+    size_t total = 0;
+    size_t skip = offset_;
+    for (const std::string &segment : segments_) {
+      if (count == MAX_IOV || total == limit) {
+        break;
+      }
+      size_t length = std::min(segment.size() - skip, limit - total);
+      iov[count++] = {const_cast<char *>(segment.data() + skip), length};
+      total += length;
+      skip = 0;
+    }
+
+    ssize_t n = ::writev(fd_, iov, count);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Child is not reading: keep the rest until there is room
+        blocked_ = true;
+        if (wait_writable_) {
+          wait_writable_();
+        }
+        return true;
+      }
+      std::cerr << "[tide] PTY write failed: " << std::strerror(errno)
+                << std::endl;
+      clear();
+      return false;
+    }
+    consume(static_cast<size_t>(n));
+    budget -= std::min(budget, static_cast<size_t>(n));
+  }
+  return true;
+}
+
+} // namespace tide::core
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace tide::core {
+
+/**
+ * Queues input for a non-blocking PTY master and writes it without ever
+ * blocking the caller (the UI thread).
+ *
+ * Small writes made between two flush() calls (the keystrokes of one
+ * frame) are coalesced and go out in one writev(). A flush stops at EAGAIN,
+ * keeps the unwritten tail, and asks to be woken once the PTY has room
+ * again (see PtyReader::notify_when_writable()). Pastes keep their own
+ * buffer and stream out in chunks at whatever pace the child reads, so a
+ * huge paste is never copied and never stalls the event loop.
+ */
+class PtyWriter {
+public:
+  using WaitWritable = std::function<void()>;
+
+  static constexpr size_t CHUNK_SIZE = 64 * 1024; // Largest single write
+  static constexpr size_t FLUSH_BUDGET = 1024 * 1024; // Per flush()
+
+  /**
+   * @param fd Non-blocking PTY master (not owned)
+   */
+  explicit PtyWriter(int fd = -1) : fd_(fd) {}
+
+  // Non-copyable
+  PtyWriter(const PtyWriter &) = delete;
+  PtyWriter &operator=(const PtyWriter &) = delete;
+
+  void set_fd(int fd) { fd_ = fd; }
+
+  /**
+   * Called when a flush stops at EAGAIN; it should arrange for flush() to
+   * run again once the PTY is writable.
+   */
+  void set_wait_writable(WaitWritable callback) {
+    wait_writable_ = std::move(callback);
+  }
+
+  /**
+   * Queue bytes, after everything queued before.
+   */
+  void write(const char *data, size_t size);
+  void write(std::string_view data) { write(data.data(), data.size()); }
+
+  /**
+   * Queue pasted text. When `bracketed` (the application enabled DECSET
+   * 2004) the text is wrapped in ESC [200~ ... ESC [201~, and any end
+   * marker inside it is removed so the paste cannot end itself early.
+   */
+  void paste(std::string text, bool bracketed);
+
+  /**
+   * Write as much as the PTY accepts, up to FLUSH_BUDGET bytes.
+   * @return false on a write error (the queue is dropped)
+   */
+  bool flush();
+
+  /**
+   * Drop everything queued, e.g. when the PTY closes.
+   */
+  void clear();
+
+  /**
+   * Check if bytes are waiting to be written.
+   */
+  [[nodiscard]] bool pending() const { return queued_ > 0; }
+
+  /**
+   * Check if the last flush() stopped because the PTY was full; flushing
+   * again before the wait_writable callback fires would be wasted.
+   */
+  [[nodiscard]] bool blocked() const { return blocked_; }
+
+  /**
+   * Number of bytes waiting to be written.
+   */
+  [[nodiscard]] size_t queued() const { return queued_; }
+
+private:
+  static constexpr int MAX_IOV = 64;
+
+  int fd_ = -1;
+  std::deque<std::string> segments_; // Small writes coalesce into the last
+  size_t offset_ = 0;                // Bytes of segments_.front() written
+  size_t queued_ = 0;
+  bool blocked_ = false;
+  WaitWritable wait_writable_;
+
+  void push(std::string segment);
+  void consume(size_t n);
+};
+
+} // namespace tide::core
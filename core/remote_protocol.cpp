@@ -0,0 +1,218 @@
+#include "core/remote_protocol.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace tide::core {
+
+namespace {
+
+bool socket_address(const std::string &path, sockaddr_un &addr) {
+  if (path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "[tide] Socket path too long: " << path << std::endl;
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  addr = {};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+} // anonymous namespace
+
+void put_u16(std::vector<uint8_t> &out, uint16_t value) {
+  out.push_back(static_cast<uint8_t>(value));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void put_u32(std::vector<uint8_t> &out, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void put_varint(std::vector<uint8_t> &out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+void put_string(std::vector<uint8_t> &out, const std::string &value) {
+  put_varint(out, static_cast<uint32_t>(value.size()));
+  out.insert(out.end(), value.begin(), value.end());
+}
+
+bool get_u16(const uint8_t *&p, const uint8_t *end, uint16_t &value) {
+  if (end - p < 2) {
+    return false;
+  }
+  value = static_cast<uint16_t>(p[0] | (p[1] << 8));
+  p += 2;
+  return true;
+}
+
+bool get_u32(const uint8_t *&p, const uint8_t *end, uint32_t &value) {
+  if (end - p < 4) {
+    return false;
+  }
+  value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(p[i]) << (8 * i);
+  }
+  p += 4;
+  return true;
+}
+
+bool get_varint(const uint8_t *&p, const uint8_t *end, uint32_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (p >= end) {
+      return false;
+    }
+    uint8_t b = *p++;
+    value |= static_cast<uint32_t>(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void append_message(std::vector<uint8_t> &out, MessageType type,
+                    const void *payload, size_t size) {
+  put_u32(out, static_cast<uint32_t>(size));
+  out.push_back(static_cast<uint8_t>(type));
+  const auto *bytes = static_cast<const uint8_t *>(payload);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+void MessageReader::feed(const void *data, size_t size) {
+  // Drop what was taken before growing, so the buffer stays one message
+  // or so in size
+  if (offset_ > 0) {
+    buffer_.erase(buffer_.begin(),
+                  buffer_.begin() + static_cast<ptrdiff_t>(offset_));
+    offset_ = 0;
+  }
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+bool MessageReader::next(Message &message) {
+  if (failed_) {
+    return false;
+  }
+  const uint8_t *p = buffer_.data() + offset_;
+  const uint8_t *end = buffer_.data() + buffer_.size();
+  uint32_t size = 0;
+  if (!get_u32(p, end, size) || p == end) {
+    return false;
+  }
+  if (size > MAX_MESSAGE_SIZE) {
+    failed_ = true;
+    return false;
+  }
+  if (static_cast<size_t>(end - p) < 1 + size) {
+    return false;
+  }
+  message.type = static_cast<MessageType>(*p++);
+  message.data = p;
+  message.size = size;
+  offset_ += MESSAGE_HEADER_SIZE + size;
+  return true;
+}
+
+bool get_string(const uint8_t *&p, const uint8_t *end, std::string &value) {
+  uint32_t size = 0;
+  if (!get_varint(p, end, size) || static_cast<size_t>(end - p) < size) {
+    return false;
+  }
+  value.assign(reinterpret_cast<const char *>(p), size);
+  p += size;
+  return true;
+}
+
+std::string default_socket_path(const std::string &name) {
+  if (const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+      runtime && *runtime) {
+    return std::string(runtime) + "/" + name + ".sock";
+  }
+  return "/tmp/" + name + "-" + std::to_string(getuid()) + ".sock";
+}
+
+int listen_socket(const std::string &path) {
+  sockaddr_un addr{};
+  if (!socket_address(path, addr)) {
+    return -1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    std::cerr << "[tide] Failed to create socket: " << std::strerror(errno)
+              << std::endl;
+    return -1;
+  }
+
+  // Only our user may connect: the socket is created without group or
+  // other permissions, and peers are checked again on accept
+  mode_t mask = umask(077);
+  int result = bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  if (result < 0 && errno == EADDRINUSE) {
+    // Left behind by a process that died, unless one still answers
+    int probe = connect_socket(path);
+    if (probe >= 0) {
+      ::close(probe);
+      umask(mask);
+      ::close(fd);
+      std::cerr << "[tide] Another tide is already listening on " << path
+                << std::endl;
+      return -1;
+    }
+    ::unlink(path.c_str());
+    result = bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  }
+  umask(mask);
+  if (result < 0 || ::listen(fd, SOMAXCONN) < 0) {
+    std::cerr << "[tide] Failed to listen on " << path << ": "
+              << std::strerror(errno) << std::endl;
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int connect_socket(const std::string &path) {
+  sockaddr_un addr{};
+  if (!socket_address(path, addr)) {
+    return -1;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    int error = errno;
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
+
+bool same_user(int fd) {
+  ucred peer{};
+  socklen_t length = sizeof(peer);
+  return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &length) == 0 &&
+         peer.uid == getuid();
+}
+
+} // namespace tide::core
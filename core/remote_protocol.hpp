@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Messages between `tide --server` and the windows attached to it, and
+ * between a single-instance tide and later launches, over Unix stream
+ * sockets. Each message is a 5-byte header (payload size as a
+ * little-endian u32, then the type) followed by the payload; integers in
+ * payloads are little-endian too, and strings are a varint length followed
+ * by the bytes.
+ */
+enum class MessageType : uint8_t {
+  // Window to server
+  ATTACH = 1, // u32 session id (see below), u16 cols, u16 rows
+  INPUT = 2,  // Bytes for the child
+  PASTE = 3,  // Text to paste, bracketed if the application asked for it
+  RESIZE = 4, // u16 cols, u16 rows
+
+  // Launch to single instance
+  OPEN_WINDOW = 5, // String working directory, varint count, then that
+                   // many strings "NAME=value" (or "NAME": unset)
+
+  // Server to window
+  ATTACHED = 16, // u32 session id; 0 (then closed) if there is no such one
+  FRAME = 17,    // Screen update (see ScreenEncoder)
+  EXITED = 18,   // i32 exit status; the server then closes the connection
+
+  // Single instance to launch
+  WINDOW_OPENED = 19, // u32 microseconds to the first frame, u32 KB of
+                      // memory the window took; then closed
+};
+
+/**
+ * ATTACH session ids besides real ones.
+ */
+constexpr uint32_t ATTACH_LATEST = 0;         // Newest session, or a new one
+constexpr uint32_t ATTACH_NEW = UINT32_MAX;   // Always a new session
+
+constexpr size_t MESSAGE_HEADER_SIZE = 5;
+constexpr size_t MAX_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+/**
+ * One message taken from a MessageReader.
+ */
+struct Message {
+  MessageType type;
+  const uint8_t *data; // Payload; valid until the reader is next fed
+  size_t size;
+};
+
+/**
+ * Append a message to `out`.
+ */
+void append_message(std::vector<uint8_t> &out, MessageType type,
+                    const void *payload, size_t size);
+
+/**
+ * Splits a byte stream back into messages.
+ */
+class MessageReader {
+public:
+  void feed(const void *data, size_t size);
+
+  /**
+   * Take the next complete message.
+   * @return false if none is complete yet, or the stream is corrupt
+   */
+  bool next(Message &message);
+
+  /**
+   * A message claimed more than MAX_MESSAGE_SIZE bytes.
+   */
+  [[nodiscard]] bool failed() const { return failed_; }
+
+private:
+  std::vector<uint8_t> buffer_;
+  size_t offset_ = 0; // Start of the first message not yet taken
+  bool failed_ = false;
+};
+
+/**
+ * Payload field helpers (little-endian, bounds-checked on read).
+ */
+void put_u16(std::vector<uint8_t> &out, uint16_t value);
+void put_u32(std::vector<uint8_t> &out, uint32_t value);
+void put_varint(std::vector<uint8_t> &out, uint32_t value);
+void put_string(std::vector<uint8_t> &out, const std::string &value);
+bool get_u16(const uint8_t *&p, const uint8_t *end, uint16_t &value);
+bool get_u32(const uint8_t *&p, const uint8_t *end, uint32_t &value);
+bool get_varint(const uint8_t *&p, const uint8_t *end, uint32_t &value);
+bool get_string(const uint8_t *&p, const uint8_t *end, std::string &value);
+
+/**
+ * Where a socket called `name` lives: $XDG_RUNTIME_DIR/<name>.sock, or
+ * /tmp/<name>-<uid>.sock without a runtime directory. The server listens
+ * on "tide", a single instance on "tide-instance".
+ */
+std::string default_socket_path(const std::string &name = "tide");
+
+/**
+ * Listen on a Unix socket at `path` that only our user can connect to,
+ * replacing one left behind by a process that died.
+ * @return The non-blocking listening socket, or -1 (also when a live
+ *         process already listens there)
+ */
+int listen_socket(const std::string &path);
+
+/**
+ * Connect to the Unix socket at `path`.
+ * @return The (blocking) socket, or -1 with errno set
+ */
+int connect_socket(const std::string &path);
+
+/**
+ * Check that the peer of an accepted socket runs as our user.
+ */
+bool same_user(int fd);
+
+} // namespace tide::core
@@ -0,0 +1,127 @@
+#include "core/remote_session.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace tide::core {
+
+RemoteSession::~RemoteSession() { disconnect(); }
+
+void RemoteSession::disconnect() {
+  reader_.stop();
+  writer_.set_fd(-1);
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+bool RemoteSession::connect(const std::string &path, uint32_t id, int cols,
+                            int rows, const PtyReader::Notify &notify) {
+  fd_ = connect_socket(path);
+  if (fd_ < 0) {
+    std::cerr << "[tide] Failed to connect to " << path << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  // Attach first, while the socket still blocks, so the request is out
+  // before anything else
+  std::vector<uint8_t> payload;
+  put_u32(payload, id);
+  put_u16(payload, static_cast<uint16_t>(cols));
+  put_u16(payload, static_cast<uint16_t>(rows));
+  message_.clear();
+  append_message(message_, MessageType::ATTACH, payload.data(),
+                 payload.size());
+  if (::send(fd_, message_.data(), message_.size(), MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(message_.size())) {
+    std::cerr << "[tide] Failed to attach: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+
+  int flags = fcntl(fd_, F_GETFL);
+  fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+  reader_.set_notify(notify);
+  if (!reader_.start(fd_)) {
+    return false;
+  }
+  writer_.set_fd(fd_);
+  writer_.set_wait_writable([this] { reader_.notify_when_writable(); });
+  return true;
+}
+
+bool RemoteSession::poll() {
+  reader_.drain(
+      [this](const char *data, size_t size) {
+        in_.feed(data, size);
+        bytes_received_ += size;
+      });
+
+  bool changed = false;
+  Message message{};
+  while (in_.next(message)) {
+    const uint8_t *p = message.data;
+    const uint8_t *end = message.data + message.size;
+    switch (message.type) {
+    case MessageType::ATTACHED:
+      get_u32(p, end, id_);
+      break;
+    case MessageType::FRAME:
+      if (!screen_.apply(message.data, message.size)) {
+        std::cerr << "[tide] Bad frame from server" << std::endl;
+        shutdown(fd_, SHUT_RDWR); // Ends the session
+        return changed;
+      }
+      changed = true;
+      break;
+    case MessageType::EXITED: {
+      uint32_t status = 0;
+      if (get_u32(p, end, status)) {
+        exit_status_ = static_cast<int32_t>(status);
+      }
+      break;
+    }
+    default:
+      break; // From a newer server
+    }
+  }
+  return changed;
+}
+
+void RemoteSession::send(MessageType type, const void *payload,
+                         size_t size) {
+  message_.clear();
+  append_message(message_, type, payload, size);
+  writer_.write(reinterpret_cast<const char *>(message_.data()),
+                message_.size());
+}
+
+void RemoteSession::write(std::string_view data) {
+  send(MessageType::INPUT, data.data(), data.size());
+}
+
+void RemoteSession::paste(std::string_view text) {
+  // One message, so the server brackets it as one paste
+  if (text.size() > MAX_MESSAGE_SIZE) {
+    std::cerr << "[tide] Paste truncated to " << MAX_MESSAGE_SIZE << " bytes"
+              << std::endl;
+    text = text.substr(0, MAX_MESSAGE_SIZE);
+  }
+  send(MessageType::PASTE, text.data(), text.size());
+}
+
+void RemoteSession::resize(int cols, int rows) {
+  std::vector<uint8_t> payload;
+  put_u16(payload, static_cast<uint16_t>(cols));
+  put_u16(payload, static_cast<uint16_t>(rows));
+  send(MessageType::RESIZE, payload.data(), payload.size());
+}
+
+} // namespace tide::core
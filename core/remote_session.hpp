@@ -0,0 +1,106 @@
+#pragma once
+
+#include "core/pty_reader.hpp"
+#include "core/pty_writer.hpp"
+#include "core/remote_protocol.hpp"
+#include "core/screen_diff.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tide::core {
+
+/**
+ * A window's end of a session living in `tide --server`.
+ *
+ * The socket is read by a PtyReader thread, exactly like a PTY master, so
+ * frames wake the window through the same notify callback; poll() then
+ * applies them to the RemoteScreen on the owner thread. Input is framed
+ * and queued on a PtyWriter, which never blocks the window either; a
+ * write to a server that went away raises SIGPIPE, so callers ignore it.
+ */
+class RemoteSession {
+public:
+  RemoteSession() = default;
+  ~RemoteSession();
+
+  // Non-copyable (the reader thread points into us)
+  RemoteSession(const RemoteSession &) = delete;
+  RemoteSession &operator=(const RemoteSession &) = delete;
+
+  /**
+   * Connect to the server at `path` and attach to session `id` (or
+   * ATTACH_LATEST, ATTACH_NEW) at the window's size.
+   * @param notify See PtyReader::set_notify()
+   */
+  bool connect(const std::string &path, uint32_t id, int cols, int rows,
+               const PtyReader::Notify &notify);
+
+  /**
+   * Apply whatever the server sent.
+   * @return true if the screen changed
+   */
+  bool poll();
+
+  /**
+   * Detach: stop reading and close the socket. The session keeps running
+   * in the server.
+   */
+  void disconnect();
+
+  void write(std::string_view data);
+  void paste(std::string_view text);
+  void resize(int cols, int rows);
+
+  /**
+   * Send queued input (see PtyWriter::flush()).
+   */
+  void flush() { writer_.flush(); }
+
+  [[nodiscard]] bool input_pending() const {
+    return writer_.pending() && !writer_.blocked();
+  }
+
+  /**
+   * True once the server closed the connection and everything it sent has
+   * been applied.
+   */
+  [[nodiscard]] bool finished() const { return reader_.finished(); }
+
+  /**
+   * The session's id once attached, 0 before (or if it did not exist).
+   */
+  [[nodiscard]] uint32_t id() const { return id_; }
+
+  /**
+   * The shell's exit status, once the server reported it.
+   */
+  [[nodiscard]] std::optional<int> exit_status() const {
+    return exit_status_;
+  }
+
+  [[nodiscard]] const RemoteScreen &screen() const { return screen_; }
+
+  /**
+   * Bytes of messages applied by poll() so far.
+   */
+  [[nodiscard]] uint64_t bytes_received() const { return bytes_received_; }
+
+private:
+  int fd_ = -1;
+  PtyReader reader_;
+  PtyWriter writer_;
+  MessageReader in_;
+  RemoteScreen screen_;
+  uint32_t id_ = 0;
+  uint64_t bytes_received_ = 0;
+  std::optional<int> exit_status_;
+  std::vector<uint8_t> message_;
+
+  void send(MessageType type, const void *payload, size_t size);
+};
+
+} // namespace tide::core
@@ -0,0 +1,185 @@
+#include "core/replay_history.hpp"
+
+#include "core/lz4.hpp"
+
+#include <algorithm>
+
+namespace tide::core {
+
+void ReplayHistory::record(const char *data, size_t size) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(data);
+  total_bytes_ += size;
+
+  while (size > 0) {
+    if (chunks_.empty() || chunks_.back().sealed) {
+      chunks_.emplace_back();
+      chunks_.back().data.reserve(CHUNK_SIZE);
+    }
+
+    Chunk &chunk = chunks_.back();
+    size_t n = std::min(size, CHUNK_SIZE - chunk.size);
+    chunk.data.insert(chunk.data.end(), bytes, bytes + n);
+    chunk.size += n;
+    bytes += n;
+    size -= n;
+
+    if (chunk.size == CHUNK_SIZE) {
+      std::vector<uint8_t> compressed;
+      lz4_compress(chunk.data.data(), chunk.size, compressed);
+      compressed.shrink_to_fit();
+      chunk.data = std::move(compressed);
+      chunk.sealed = true;
+    }
+  }
+}
+
+void ReplayHistory::add_checkpoint(const std::vector<uint8_t> &state) {
+  Checkpoint checkpoint;
+  checkpoint.offset = total_bytes_;
+  checkpoint.lines = lines_;
+  checkpoint.state_size = state.size();
+  lz4_compress(state.data(), state.size(), checkpoint.state);
+  checkpoint.state.shrink_to_fit();
+  checkpoints_.push_back(std::move(checkpoint));
+}
+
+void ReplayHistory::read(uint64_t from, uint64_t to, std::string &out) const {
+  to = std::min(to, total_bytes_);
+  std::vector<uint8_t> scratch;
+
+  while (from < to) {
+    size_t index = static_cast<size_t>(from / CHUNK_SIZE - first_chunk_);
+    size_t begin = static_cast<size_t>(from % CHUNK_SIZE);
+    const Chunk &chunk = chunks_[index];
+    size_t end = std::min(chunk.size, begin + static_cast<size_t>(to - from));
+
+    const uint8_t *data = chunk.data.data();
+    if (chunk.sealed) {
+      scratch.resize(chunk.size);
+      if (!lz4_decompress(chunk.data.data(), chunk.data.size(),
+                          scratch.data(), scratch.size())) {
+        return;
+      }
+      data = scratch.data();
+    }
+
+    out.append(reinterpret_cast<const char *>(data) + begin, end - begin);
+    from += end - begin;
+  }
+}
+
+std::vector<uint8_t> ReplayHistory::checkpoint_state(size_t index) const {
+  const Checkpoint &checkpoint = checkpoints_[index];
+  std::vector<uint8_t> state(checkpoint.state_size);
+  if (!lz4_decompress(checkpoint.state.data(), checkpoint.state.size(),
+                      state.data(), state.size())) {
+    state.clear();
+  }
+  return state;
+}
+
+size_t ReplayHistory::checkpoint_for_line(uint64_t line) const {
+  auto it = std::upper_bound(
+      checkpoints_.begin(), checkpoints_.end(), line,
+      [](uint64_t value, const Checkpoint &cp) { return value < cp.lines; });
+  return it == checkpoints_.begin()
+             ? 0
+             : static_cast<size_t>(it - checkpoints_.begin()) - 1;
+}
+
+uint64_t ReplayHistory::segment_end(size_t checkpoint) const {
+  return checkpoint + 1 < checkpoints_.size()
+             ? checkpoints_[checkpoint + 1].offset
+             : total_bytes_;
+}
+
+const ReplayHistory::Segment *
+ReplayHistory::cached_segment(size_t checkpoint) const {
+  for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+    if (it->checkpoint != checkpoint) {
+      continue;
+    }
+    // The newest segment keeps growing; a stale copy must be rebuilt
+    if (it->end_offset != segment_end(checkpoint)) {
+      cache_.erase(it);
+      return nullptr;
+    }
+    cache_.splice(cache_.begin(), cache_, it);
+    return &cache_.front();
+  }
+  return nullptr;
+}
+
+const ReplayHistory::Segment &
+ReplayHistory::cache_segment(Segment segment) const {
+  cache_.push_front(std::move(segment));
+  while (cache_.size() > CACHE_SEGMENTS) {
+    cache_.pop_back();
+  }
+  return cache_.front();
+}
+
+size_t ReplayHistory::memory_usage() const {
+  size_t bytes = 0;
+  for (const Chunk &chunk : chunks_) {
+    bytes += chunk.data.capacity();
+  }
+  for (const Checkpoint &checkpoint : checkpoints_) {
+    bytes += sizeof(Checkpoint) + checkpoint.state.capacity();
+  }
+  for (const Segment &segment : cache_) {
+    for (const CompactLine &line : segment.lines) {
+      bytes += line.memory_usage();
+    }
+  }
+  return bytes;
+}
+
+size_t ReplayHistory::drop_cache() {
+  size_t before = memory_usage();
+  cache_.clear();
+  return before - memory_usage();
+}
+
+size_t ReplayHistory::trim_to(size_t target_bytes) {
+  size_t before = memory_usage();
+  while (checkpoints_.size() > 1 && memory_usage() > target_bytes) {
+    // The second checkpoint becomes the first; the bytes before it go
+    const Checkpoint &next = checkpoints_[1];
+    trimmed_lines_ += next.lines - first_line_;
+    first_line_ = next.lines;
+    while ((first_chunk_ + 1) * CHUNK_SIZE <= next.offset) {
+      chunks_.erase(chunks_.begin());
+      first_chunk_++;
+    }
+    checkpoints_.erase(checkpoints_.begin());
+
+    // Cached segments are keyed by checkpoint index
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->checkpoint == 0) {
+        it = cache_.erase(it);
+      } else {
+        it->checkpoint--;
+        ++it;
+      }
+    }
+  }
+  return before - std::min(before, memory_usage());
+}
+
+void ReplayHistory::report(HistoryBudget::Usage &usage) const {
+  usage.lines = size();
+  usage.trimmed_lines = trimmed_lines_;
+}
+
+void ReplayHistory::clear() {
+  chunks_.clear();
+  first_chunk_ = 0;
+  total_bytes_ = 0;
+  lines_ = 0;
+  first_line_ = 0;
+  checkpoints_.clear();
+  cache_.clear();
+}
+
+} // namespace tide::core
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "core/scrollback.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Experimental history store that keeps the raw PTY byte stream instead of
+ * cells.
+ *
+ * The owning Terminal records every byte it parses and periodically saves a
+ * checkpoint of its parser and grid state. Lines that scrolled off between
+ * two checkpoints are rebuilt on demand by replaying that byte range into a
+ * scratch Terminal; the result is kept in a small segment cache.
+ *
+ * Sealed byte chunks and checkpoint states are LZ4-compressed. To honor the
+ * HistoryBudget, the oldest segments are dropped whole.
+ */
+class ReplayHistory : public BudgetedHistory {
+public:
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+  static constexpr size_t CHECKPOINT_LINES = 1000;
+  static constexpr size_t CACHE_SEGMENTS = 4;
+
+  /**
+   * A saved Terminal state at a byte offset of the stream.
+   */
+  struct Checkpoint {
+    uint64_t offset = 0; // Bytes of the stream consumed before this point
+    uint64_t lines = 0;  // History lines produced before this point
+                         // (absolute: trimmed lines count)
+    std::vector<uint8_t> state; // Compressed Terminal::save_state() blob
+    size_t state_size = 0;      // Uncompressed size of `state`
+  };
+
+  /**
+   * A rebuilt range of history lines.
+   */
+  struct Segment {
+    size_t checkpoint = 0; // Index of the starting checkpoint
+    uint64_t end_offset = 0;
+    std::vector<CompactLine> lines;
+  };
+
+  /**
+   * Append raw bytes to the stream.
+   */
+  void record(const char *data, size_t size);
+
+  /**
+   * Save a checkpoint at the current end of the stream.
+   * @param state Uncompressed Terminal state
+   */
+  void add_checkpoint(const std::vector<uint8_t> &state);
+
+  /**
+   * Note that a line scrolled off the grid.
+   */
+  void add_line() { lines_++; }
+
+  /**
+   * Copy stream bytes in [from, to) into `out`.
+   */
+  void read(uint64_t from, uint64_t to, std::string &out) const;
+
+  /**
+   * Get the decompressed state of a checkpoint.
+   */
+  [[nodiscard]] std::vector<uint8_t> checkpoint_state(size_t index) const;
+
+  /**
+   * Index of the checkpoint an absolute history line is rebuilt from.
+   */
+  [[nodiscard]] size_t checkpoint_for_line(uint64_t line) const;
+
+  /**
+   * Look up a cached segment; nullptr if it must be rebuilt.
+   */
+  [[nodiscard]] const Segment *cached_segment(size_t checkpoint) const;
+
+  /**
+   * Store a rebuilt segment in the cache.
+   */
+  const Segment &cache_segment(Segment segment) const;
+
+  [[nodiscard]] const std::vector<Checkpoint> &checkpoints() const {
+    return checkpoints_;
+  }
+
+  /**
+   * Stream offset where a checkpoint's segment ends.
+   */
+  [[nodiscard]] uint64_t segment_end(size_t checkpoint) const;
+
+  /**
+   * History lines kept, and the absolute number of the oldest.
+   */
+  [[nodiscard]] uint64_t size() const { return lines_ - first_line_; }
+  [[nodiscard]] uint64_t first_line() const { return first_line_; }
+  [[nodiscard]] uint64_t bytes() const { return total_bytes_; }
+  [[nodiscard]] uint64_t lines_since_checkpoint() const {
+    return checkpoints_.empty() ? lines_ : lines_ - checkpoints_.back().lines;
+  }
+
+  /**
+   * Bytes held in memory: stream, checkpoints and segment cache.
+   */
+  [[nodiscard]] size_t memory_usage() const override;
+
+  /**
+   * Free the segment cache.
+   * @return Bytes freed
+   */
+  size_t drop_cache() override;
+
+  /**
+   * Nothing to do: chunks are compressed as they are sealed.
+   */
+  size_t compact() override { return 0; }
+
+  /**
+   * Drop the oldest segments (never the one being written) until resident
+   * memory is at most `target_bytes`.
+   * @return Bytes freed
+   */
+  size_t trim_to(size_t target_bytes) override;
+
+  void report(HistoryBudget::Usage &usage) const override;
+
+  void clear();
+
+private:
+  struct Chunk {
+    std::vector<uint8_t> data; // Compressed once sealed
+    size_t size = 0;           // Uncompressed size
+    bool sealed = false;
+  };
+
+  std::vector<Chunk> chunks_;
+  uint64_t first_chunk_ = 0; // Chunks dropped from the front
+  uint64_t total_bytes_ = 0;
+  uint64_t lines_ = 0;
+  uint64_t first_line_ = 0;
+  uint64_t trimmed_lines_ = 0;
+  std::vector<Checkpoint> checkpoints_;
+  mutable std::list<Segment> cache_; // Most recently used first
+};
+
+} // namespace tide::core
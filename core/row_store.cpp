@@ -0,0 +1,103 @@
+#include "core/row_store.hpp"
+
+#include "core/scrollback.hpp"
+
+namespace tide::core {
+
+namespace {
+
+// Rough per-row cost of the hash index (node plus bucket slot)
+constexpr size_t INDEX_OVERHEAD = 4 * sizeof(void *);
+
+} // anonymous namespace
+
+struct RowStore::Entry {
+  CompactLine line;
+  uint64_t hash = 0;
+  uint32_t refs = 0;
+};
+
+RowStore::RowStore() = default;
+
+RowStore::~RowStore() = default;
+
+RowStore::RowId RowStore::intern(const CompactLine &line) {
+  uint64_t hash = line.hash();
+
+  auto found = index_.find(hash);
+  if (found != index_.end()) {
+    Entry &entry = entries_[found->second];
+    if (entry.line != line) {
+      return NO_ROW; // Hash collision: the row is simply not shared
+    }
+    entry.refs++;
+    references_++;
+    return found->second;
+  }
+
+  // Only the second sighting is stored; the first stays inline
+  if (recent_.empty()) {
+    recent_.resize(RECENT_SLOTS);
+  }
+  uint64_t &slot = recent_[hash % RECENT_SLOTS];
+  if (slot != hash) {
+    slot = hash;
+    return NO_ROW;
+  }
+
+  RowId id;
+  if (!free_.empty()) {
+    id = free_.back();
+    free_.pop_back();
+  } else {
+    id = static_cast<RowId>(entries_.size());
+    entries_.emplace_back();
+  }
+
+  Entry &entry = entries_[id];
+  entry.line = line;
+  entry.hash = hash;
+  entry.refs = 1;
+  index_.emplace(hash, id);
+
+  live_++;
+  references_++;
+  bytes_ += entry.line.memory_usage() + INDEX_OVERHEAD;
+  return id;
+}
+
+void RowStore::release(RowId id) {
+  if (id >= entries_.size()) {
+    return; // NO_ROW
+  }
+
+  Entry &entry = entries_[id];
+  references_--;
+  if (--entry.refs > 0) {
+    return;
+  }
+
+  index_.erase(entry.hash);
+  bytes_ -= entry.line.memory_usage() + INDEX_OVERHEAD;
+  live_--;
+
+  entry.line = CompactLine{};
+  free_.push_back(id);
+}
+
+const CompactLine &RowStore::get(RowId id) const {
+  static const CompactLine empty_line;
+  return id < entries_.size() ? entries_[id].line : empty_line;
+}
+
+void RowStore::clear() {
+  entries_.clear();
+  free_.clear();
+  index_.clear();
+  std::vector<uint64_t>().swap(recent_);
+  live_ = 0;
+  references_ = 0;
+  bytes_ = 0;
+}
+
+} // namespace tide::core
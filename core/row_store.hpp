@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace tide::core {
+
+class CompactLine;
+
+/**
+ * Content-addressed, refcounted store of repeated history rows.
+ *
+ * A row is stored once it repeats: a small table of recently pushed row
+ * hashes spots the second copy, so rows seen only once (most of a build
+ * log) stay inline in their page and cost nothing here. Pages refer to
+ * stored rows by 32-bit id whether they are hot, compressed or spilled,
+ * and a row is freed when the last page referring to it goes.
+ */
+class RowStore {
+public:
+  using RowId = uint32_t;
+  static constexpr RowId NO_ROW = UINT32_MAX;
+  static constexpr size_t RECENT_SLOTS = 4096; // Hashes kept to spot repeats
+
+  RowStore();
+  ~RowStore();
+
+  // Non-copyable
+  RowStore(const RowStore &) = delete;
+  RowStore &operator=(const RowStore &) = delete;
+
+  /**
+   * Get the id of a stored row with this content, storing it if it was
+   * pushed recently.
+   * @return An id holding one reference, or NO_ROW if the row is not a
+   *         repeat (the caller keeps it inline)
+   */
+  RowId intern(const CompactLine &line);
+
+  /**
+   * Drop one reference; the row is freed when none remain.
+   */
+  void release(RowId id);
+
+  /**
+   * Get the content of a live row (an empty line for NO_ROW).
+   */
+  [[nodiscard]] const CompactLine &get(RowId id) const;
+
+  /**
+   * Remove all rows and forget recent hashes.
+   */
+  void clear();
+
+  /**
+   * Distinct rows stored.
+   */
+  [[nodiscard]] size_t unique_rows() const { return live_; }
+
+  /**
+   * References held on stored rows, one per history line sharing one.
+   */
+  [[nodiscard]] size_t references() const { return references_; }
+
+  /**
+   * Bytes used by stored rows, the index and the recent-hash table.
+   */
+  [[nodiscard]] size_t memory_usage() const {
+    return bytes_ + recent_.capacity() * sizeof(uint64_t);
+  }
+
+private:
+  struct Entry;
+
+  std::vector<Entry> entries_;
+  std::vector<RowId> free_;
+  std::unordered_map<uint64_t, RowId> index_; // Content hash -> row
+  std::vector<uint64_t> recent_; // Hashes of rows pushed once, by slot
+  size_t live_ = 0;
+  size_t references_ = 0;
+  size_t bytes_ = 0;
+};
+
+} // namespace tide::core
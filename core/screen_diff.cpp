@@ -0,0 +1,403 @@
+#include "core/screen_diff.hpp"
+
+#include "core/lz4.hpp"
+#include "core/remote_protocol.hpp"
+#include "core/terminal.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace tide::core {
+
+namespace {
+
+struct Move {
+  int dst;
+  int src;
+  int count;
+};
+
+struct Span {
+  int row;
+  int start;
+  int count;
+};
+
+} // anonymous namespace
+
+bool ScreenEncoder::encode(const Terminal &terminal,
+                           std::vector<uint8_t> &out) {
+  terminal.view(view_);
+  int cols = view_.cols();
+  int rows = view_.rows();
+  auto width = static_cast<size_t>(cols);
+  bool full = cols != cols_ || keys_.size() != static_cast<size_t>(rows) ||
+              palette_.size() > MAX_PALETTE;
+  if (full) {
+    palette_.clear();
+    cells_.assign(width * static_cast<size_t>(rows), Cell{});
+  }
+
+  // Sort rows into unchanged, moved (their content is on the window's
+  // screen already, in another row) and changed; a changed row may turn
+  // out to hold what it held before (a repaint)
+  std::vector<Move> moves;
+  std::vector<Span> spans;
+  bool rekeyed = false;
+  bool indexed = false;
+  for (int row = 0; row < rows; ++row) {
+    uint64_t key = view_.key(row);
+    if (full) {
+      spans.push_back({row, 0, cols});
+      continue;
+    }
+    if (key == keys_[static_cast<size_t>(row)]) {
+      continue;
+    }
+    if (!indexed) {
+      rows_by_key_.clear();
+      for (int old = 0; old < rows; ++old) {
+        rows_by_key_[keys_[static_cast<size_t>(old)]] = old;
+      }
+      indexed = true;
+    }
+    if (auto it = rows_by_key_.find(key); it != rows_by_key_.end()) {
+      int src = it->second;
+      if (!moves.empty() && moves.back().dst + moves.back().count == row &&
+          moves.back().src + moves.back().count == src) {
+        ++moves.back().count; // A scroll moves whole runs
+      } else {
+        moves.push_back({row, src, 1});
+      }
+      continue;
+    }
+
+    // Not a move target, so the mirror row is what the window shows
+    const Cell *now = view_.row(row);
+    const Cell *was = &cells_[static_cast<size_t>(row) * width];
+    int start = 0;
+    while (start < cols && now[start] == was[start]) {
+      ++start;
+    }
+    if (start == cols) {
+      rekeyed = true;
+      continue;
+    }
+    int stop = cols;
+    while (now[stop - 1] == was[stop - 1]) {
+      --stop;
+    }
+    spans.push_back({row, start, stop - start});
+  }
+
+  int cursor_col = terminal.cursor_col();
+  int cursor_row = terminal.cursor_row();
+  bool send = full || !moves.empty() || !spans.empty() ||
+              cursor_col != cursor_col_ || cursor_row != cursor_row_;
+  if (!send && !rekeyed) {
+    return false;
+  }
+
+  if (send) {
+    raw_.clear();
+    put_varint(raw_, static_cast<uint32_t>(cols));
+    put_varint(raw_, static_cast<uint32_t>(rows));
+    put_varint(raw_, static_cast<uint32_t>(cursor_col));
+    put_varint(raw_, static_cast<uint32_t>(cursor_row));
+    put_varint(raw_, static_cast<uint32_t>(moves.size()));
+    for (const Move &move : moves) {
+      put_varint(raw_, static_cast<uint32_t>(move.dst));
+      put_varint(raw_, static_cast<uint32_t>(move.src));
+      put_varint(raw_, static_cast<uint32_t>(move.count));
+      rows_moved_ += static_cast<uint64_t>(move.count);
+    }
+    put_varint(raw_, static_cast<uint32_t>(spans.size()));
+    for (const Span &span : spans) {
+      put_varint(raw_, static_cast<uint32_t>(span.row));
+      put_varint(raw_, static_cast<uint32_t>(span.start));
+      put_span(view_.row(span.row) + span.start, span.count);
+      cells_sent_ += static_cast<uint64_t>(span.count);
+    }
+
+    uint8_t flags = full ? FULL : 0;
+    const std::vector<uint8_t> *body = &raw_;
+    if (raw_.size() >= COMPRESS_THRESHOLD) {
+      lz4_compress(raw_.data(), raw_.size(), packed_);
+      if (packed_.size() + 4 < raw_.size()) {
+        flags |= LZ4;
+        body = &packed_;
+      }
+    }
+    size_t payload = 1 + ((flags & LZ4) ? 4 : 0) + body->size();
+    put_u32(out, static_cast<uint32_t>(payload));
+    out.push_back(static_cast<uint8_t>(MessageType::FRAME));
+    out.push_back(flags);
+    if (flags & LZ4) {
+      put_u32(out, static_cast<uint32_t>(raw_.size()));
+    }
+    out.insert(out.end(), body->begin(), body->end());
+  }
+
+  // Mirror what the window does with the frame: moves read the rows as
+  // they were, so their sources are set aside first (a lone move, a
+  // scroll, is done in place)
+  if (moves.size() == 1) {
+    const Move &move = moves.front();
+    auto from = cells_.begin() + static_cast<ptrdiff_t>(move.src * cols);
+    auto size = static_cast<ptrdiff_t>(move.count * cols);
+    auto to = cells_.begin() + static_cast<ptrdiff_t>(move.dst * cols);
+    if (move.dst < move.src) {
+      std::copy(from, from + size, to);
+    } else {
+      std::copy_backward(from, from + size, to + size);
+    }
+  } else if (!moves.empty()) {
+    previous_.clear();
+    for (const Move &move : moves) {
+      auto from = cells_.begin() + static_cast<ptrdiff_t>(move.src * cols);
+      previous_.insert(previous_.end(), from,
+                       from + static_cast<ptrdiff_t>(move.count * cols));
+    }
+    auto source = previous_.begin();
+    for (const Move &move : moves) {
+      auto size = static_cast<ptrdiff_t>(move.count * cols);
+      std::copy(source, source + size,
+                cells_.begin() + static_cast<ptrdiff_t>(move.dst * cols));
+      source += size;
+    }
+  }
+  for (const Span &span : spans) {
+    std::copy_n(view_.row(span.row) + span.start, span.count,
+                cells_.begin() +
+                    static_cast<ptrdiff_t>(span.row * cols + span.start));
+  }
+  keys_.resize(static_cast<size_t>(rows));
+  for (int row = 0; row < rows; ++row) {
+    keys_[static_cast<size_t>(row)] = view_.key(row);
+  }
+  cols_ = cols;
+  cursor_col_ = cursor_col;
+  cursor_row_ = cursor_row;
+  return send;
+}
+
+void ScreenEncoder::put_span(const Cell *cells, int count) {
+  // Blanks after the last character are implied
+  int text = count;
+  while (text > 0 && cells[text - 1].codepoint == U' ') {
+    --text;
+  }
+  put_varint(raw_, static_cast<uint32_t>(text));
+  for (int col = 0; col < text; ++col) {
+    put_varint(raw_, static_cast<uint32_t>(cells[col].codepoint));
+  }
+
+  uint32_t runs = 0;
+  for (int col = 0; col < count; ++col) {
+    runs += col == 0 || cells[col].foreground != cells[col - 1].foreground ||
+            cells[col].background != cells[col - 1].background;
+  }
+  put_varint(raw_, runs);
+  for (int col = 0; col < count;) {
+    int end = col + 1;
+    while (end < count && cells[end].foreground == cells[col].foreground &&
+           cells[end].background == cells[col].background) {
+      ++end;
+    }
+    put_varint(raw_, static_cast<uint32_t>(end - col));
+    put_color(cells[col].foreground);
+    put_color(cells[col].background);
+    col = end;
+  }
+}
+
+void ScreenEncoder::put_color(const theme::Color &color) {
+  ColorBits bits{};
+  static_assert(sizeof(bits) == sizeof(theme::Color));
+  std::memcpy(bits.data(), &color, sizeof(bits));
+  auto [it, added] =
+      palette_.emplace(bits, static_cast<uint32_t>(palette_.size()));
+  put_varint(raw_, it->second);
+  if (added) {
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&color);
+    raw_.insert(raw_.end(), bytes, bytes + sizeof(theme::Color));
+  }
+}
+
+bool RemoteScreen::apply(const uint8_t *data, size_t size) {
+  const uint8_t *p = data;
+  const uint8_t *end = data + size;
+  if (p == end) {
+    return false;
+  }
+  uint8_t flags = *p++;
+  bool full = (flags & ScreenEncoder::FULL) != 0;
+  if (!(flags & ScreenEncoder::LZ4)) {
+    return apply_raw(p, end, full);
+  }
+
+  uint32_t raw_size = 0;
+  if (!get_u32(p, end, raw_size) || raw_size > MAX_MESSAGE_SIZE) {
+    return false;
+  }
+  raw_.resize(raw_size);
+  if (!lz4_decompress(p, static_cast<size_t>(end - p), raw_.data(),
+                      raw_size)) {
+    return false;
+  }
+  return apply_raw(raw_.data(), raw_.data() + raw_size, full);
+}
+
+bool RemoteScreen::apply_raw(const uint8_t *p, const uint8_t *end,
+                             bool full) {
+  uint32_t cols = 0, rows = 0, cursor_col = 0, cursor_row = 0;
+  if (!get_varint(p, end, cols) || !get_varint(p, end, rows) ||
+      !get_varint(p, end, cursor_col) || !get_varint(p, end, cursor_row) ||
+      cols == 0 || rows == 0 || cols > UINT16_MAX || rows > UINT16_MAX) {
+    return false;
+  }
+  if (full) {
+    cols_ = static_cast<int>(cols);
+    rows_ = static_cast<int>(rows);
+    cells_.assign(static_cast<size_t>(cols) * rows, Cell{});
+    keys_.resize(rows);
+    for (uint64_t &key : keys_) {
+      key = ++next_key_;
+    }
+    palette_.clear();
+  } else if (static_cast<int>(cols) != cols_ ||
+             static_cast<int>(rows) != rows_) {
+    return false;
+  }
+  cursor_col_ = static_cast<int>(cursor_col);
+  cursor_row_ = static_cast<int>(cursor_row);
+
+  size_t width = cols;
+  uint32_t count = 0;
+  if (!get_varint(p, end, count)) {
+    return false;
+  }
+  // Moves read the rows as they were: set their sources aside first,
+  // unless there is only one (a scroll)
+  std::vector<uint32_t> moves;
+  previous_.clear();
+  previous_keys_.clear();
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t dst = 0, src = 0, length = 0;
+    if (!get_varint(p, end, dst) || !get_varint(p, end, src) ||
+        !get_varint(p, end, length) || dst > rows || length > rows - dst ||
+        src > rows || length > rows - src) {
+      return false;
+    }
+    if (count == 1) {
+      auto from = cells_.begin() + static_cast<ptrdiff_t>(src * width);
+      auto size = static_cast<ptrdiff_t>(length * width);
+      auto to = cells_.begin() + static_cast<ptrdiff_t>(dst * width);
+      if (dst < src) {
+        std::copy(from, from + size, to);
+        std::copy_n(keys_.begin() + src, length, keys_.begin() + dst);
+      } else {
+        std::copy_backward(from, from + size, to + size);
+        std::copy_backward(keys_.begin() + src, keys_.begin() + src + length,
+                           keys_.begin() + dst + length);
+      }
+      break;
+    }
+    moves.insert(moves.end(), {dst, length});
+    auto from = cells_.begin() + static_cast<ptrdiff_t>(src * width);
+    previous_.insert(previous_.end(), from,
+                     from + static_cast<ptrdiff_t>(length * width));
+    previous_keys_.insert(previous_keys_.end(), keys_.begin() + src,
+                          keys_.begin() + src + length);
+  }
+  size_t source = 0;
+  for (size_t i = 0; i < moves.size(); i += 2) {
+    uint32_t dst = moves[i];
+    uint32_t length = moves[i + 1];
+    std::copy_n(previous_.begin() + static_cast<ptrdiff_t>(source * width),
+                length * width,
+                cells_.begin() + static_cast<ptrdiff_t>(dst * width));
+    std::copy_n(previous_keys_.begin() + static_cast<ptrdiff_t>(source),
+                length, keys_.begin() + dst);
+    source += length;
+  }
+
+  if (!get_varint(p, end, count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t row = 0, start = 0;
+    if (!get_varint(p, end, row) || !get_varint(p, end, start) ||
+        row >= rows || start >= cols ||
+        !get_span(p, end, &cells_[row * width + start], cols - start)) {
+      return false;
+    }
+    keys_[row] = ++next_key_;
+  }
+  return p == end;
+}
+
+bool RemoteScreen::get_span(const uint8_t *&p, const uint8_t *end,
+                            Cell *cells, uint32_t room) {
+  uint32_t text = 0;
+  if (!get_varint(p, end, text) || text > room) {
+    return false;
+  }
+  for (uint32_t col = 0; col < text; ++col) {
+    uint32_t codepoint = 0;
+    if (!get_varint(p, end, codepoint)) {
+      return false;
+    }
+    cells[col].codepoint = static_cast<char32_t>(codepoint);
+  }
+
+  uint32_t runs = 0;
+  if (!get_varint(p, end, runs)) {
+    return false;
+  }
+  uint32_t col = 0;
+  for (uint32_t i = 0; i < runs; ++i) {
+    uint32_t length = 0;
+    theme::Color foreground, background;
+    if (!get_varint(p, end, length) || length > room - col ||
+        !get_color(p, end, foreground) || !get_color(p, end, background)) {
+      return false;
+    }
+    for (uint32_t stop = col + length; col < stop; ++col) {
+      if (col >= text) {
+        cells[col].codepoint = U' ';
+      }
+      cells[col].foreground = foreground;
+      cells[col].background = background;
+    }
+  }
+  return col >= text;
+}
+
+bool RemoteScreen::get_color(const uint8_t *&p, const uint8_t *end,
+                             theme::Color &color) {
+  uint32_t index = 0;
+  if (!get_varint(p, end, index) || index > palette_.size()) {
+    return false;
+  }
+  if (index < palette_.size()) {
+    color = palette_[index];
+    return true;
+  }
+  if (static_cast<size_t>(end - p) < sizeof(theme::Color)) {
+    return false;
+  }
+  std::memcpy(&color, p, sizeof(theme::Color));
+  p += sizeof(theme::Color);
+  palette_.push_back(color);
+  return true;
+}
+
+void RemoteScreen::view(ScreenView &out) const {
+  out.reset(cols_, rows_, 0);
+  for (int row = 0; row < rows_; ++row) {
+    out.set_row(row, this->row(row), keys_[static_cast<size_t>(row)]);
+  }
+}
+
+} // namespace tide::core
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "core/screen_view.hpp"
+#include "theme/theme.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace tide::core {
+
+class Terminal;
+
+/**
+ * Encodes a terminal's screen as FRAME payloads for one attached window:
+ * a snapshot first, then only what changed since the last frame.
+ *
+ * Rows are compared by content key (Terminal::visible_row_key()) first, so
+ * rows that did not change cost nothing. A row whose key sits elsewhere on
+ * the window's screen (it scrolled) is sent as part of a run of moved rows.
+ * The rest are compared cell by cell with a mirror of the window's screen,
+ * and only the span between the first and last changed cell is sent
+ * (full-screen programs repaint whole rows to change a few cells). Colors
+ * go through a palette both ends build up, so a style run costs a few
+ * bytes, and large frames are LZ4-compressed.
+ *
+ * Payload: u8 flags (FULL, LZ4; with LZ4 a u32 raw size and the compressed
+ * rest follow), then varints: cols, rows, cursor col, cursor row, move
+ * count and (dst, src, count) each, span count and (row, start col, cells)
+ * each. Spans are: text length (blanks follow), codepoints, run count and
+ * (length, fg, bg) each, the runs covering the span; a color is a palette
+ * index, or the palette size followed by the new color's bytes. Moves read
+ * the screen as it was before the frame. FULL clears the palette.
+ */
+class ScreenEncoder {
+public:
+  static constexpr uint8_t FULL = 1; // Start from a blank screen
+  static constexpr uint8_t LZ4 = 2;
+  static constexpr size_t COMPRESS_THRESHOLD = 512; // Raw bytes
+  static constexpr size_t MAX_PALETTE = 4096; // Then start over with FULL
+
+  /**
+   * Append a FRAME message for what changed since the last one (everything
+   * after construction or reset()).
+   * @return false, appending nothing, if nothing changed
+   */
+  bool encode(const Terminal &terminal, std::vector<uint8_t> &out);
+
+  /**
+   * Send a full snapshot next (a new client, or one that lost track).
+   */
+  void reset() { keys_.clear(); }
+
+  /**
+   * Cells sent and rows sent as moves, over all frames.
+   */
+  [[nodiscard]] uint64_t cells_sent() const { return cells_sent_; }
+  [[nodiscard]] uint64_t rows_moved() const { return rows_moved_; }
+
+private:
+  using ColorBits = std::array<uint32_t, 4>;
+
+  struct ColorHash {
+    size_t operator()(const ColorBits &bits) const {
+      uint64_t hash = 0;
+      for (uint32_t word : bits) {
+        hash = (hash ^ word) * 0x100000001b3ULL;
+      }
+      return static_cast<size_t>(hash);
+    }
+  };
+
+  std::vector<uint64_t> keys_; // Of each row on the window's screen
+  std::vector<Cell> cells_;    // ... and its cells
+  std::vector<Cell> previous_; // Rows moves read from
+  int cols_ = 0;
+  int cursor_col_ = -1;
+  int cursor_row_ = -1;
+  std::unordered_map<ColorBits, uint32_t, ColorHash> palette_;
+  ScreenView view_;
+  std::unordered_map<uint64_t, int> rows_by_key_;
+  std::vector<uint8_t> raw_;
+  std::vector<uint8_t> packed_;
+  uint64_t cells_sent_ = 0;
+  uint64_t rows_moved_ = 0;
+
+  void put_span(const Cell *cells, int count);
+  void put_color(const theme::Color &color);
+};
+
+/**
+ * A window's copy of a remote screen, kept up to date from FRAME payloads.
+ * Row keys are local: each row gets a new one when its content changes and
+ * keeps it when it moves, so renderer caches work as with a Terminal.
+ */
+class RemoteScreen {
+public:
+  /**
+   * Apply one frame.
+   * @return false if it was malformed (the screen is then undefined)
+   */
+  bool apply(const uint8_t *data, size_t size);
+
+  /**
+   * Show the whole screen (see Terminal::view()).
+   */
+  void view(ScreenView &out) const;
+
+  [[nodiscard]] int cols() const { return cols_; }
+  [[nodiscard]] int rows() const { return rows_; }
+  [[nodiscard]] int cursor_col() const { return cursor_col_; }
+  [[nodiscard]] int cursor_row() const { return cursor_row_; }
+
+  [[nodiscard]] const Cell *row(int row) const {
+    return &cells_[static_cast<size_t>(row) * static_cast<size_t>(cols_)];
+  }
+
+private:
+  int cols_ = 0;
+  int rows_ = 0;
+  int cursor_col_ = 0;
+  int cursor_row_ = 0;
+  std::vector<Cell> cells_;
+  std::vector<Cell> previous_; // Rows moves read from
+  std::vector<uint64_t> keys_;
+  std::vector<uint64_t> previous_keys_;
+  std::vector<theme::Color> palette_;
+  uint64_t next_key_ = 0;
+  std::vector<uint8_t> raw_;
+
+  bool apply_raw(const uint8_t *p, const uint8_t *end, bool full);
+  bool get_span(const uint8_t *&p, const uint8_t *end, Cell *cells,
+                uint32_t room);
+  bool get_color(const uint8_t *&p, const uint8_t *end, theme::Color &color);
+};
+
+} // namespace tide::core
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core/grid_buffer.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * The rows currently on screen, as pointers into the live grid or into
+ * expanded history rows (see Terminal::view()). Nothing is copied; the view
+ * is valid until the terminal next changes or scrolls.
+ *
+ * Each row carries its absolute line and a content key (see
+ * Terminal::visible_row_key()), so consumers can tell which rows merely
+ * moved. The line just above the view is included when it exists, for
+ * drawing a partially scrolled top row.
+ */
+class ScreenView {
+public:
+  ScreenView() = default;
+
+  /**
+   * View of a grid with no history shown.
+   */
+  explicit ScreenView(const GridBuffer &grid) { show(grid); }
+
+  // Non-copyable (rows may point at our own blank row)
+  ScreenView(const ScreenView &) = delete;
+  ScreenView &operator=(const ScreenView &) = delete;
+  ScreenView(ScreenView &&) = default;
+  ScreenView &operator=(ScreenView &&) = default;
+
+  void show(const GridBuffer &grid) {
+    reset(grid.cols(), grid.rows(), 0);
+    for (int row = 0; row < grid.rows(); ++row) {
+      set_row(row, &grid.at(0, row), grid.generation(row));
+    }
+  }
+
+  /**
+   * Resize to `rows` blank rows of `cols` cells, the first showing
+   * `top_line`, with no line above.
+   */
+  void reset(int cols, int rows, uint64_t top_line) {
+    cols_ = cols;
+    top_line_ = top_line;
+    blank_.resize(static_cast<size_t>(cols));
+    rows_.assign(static_cast<size_t>(rows), blank_.data());
+    keys_.assign(static_cast<size_t>(rows), 0);
+    above_ = nullptr;
+    above_key_ = 0;
+  }
+
+  /**
+   * Point a row at `cols()` cells; nullptr shows a blank row.
+   */
+  void set_row(int row, const Cell *cells, uint64_t key) {
+    rows_[static_cast<size_t>(row)] = cells ? cells : blank_.data();
+    keys_[static_cast<size_t>(row)] = key;
+  }
+
+  /**
+   * Set the line before top_line().
+   */
+  void set_above(const Cell *cells, uint64_t key) {
+    above_ = cells;
+    above_key_ = key;
+  }
+
+  [[nodiscard]] int cols() const { return cols_; }
+  [[nodiscard]] int rows() const { return static_cast<int>(rows_.size()); }
+  [[nodiscard]] uint64_t top_line() const { return top_line_; }
+
+  [[nodiscard]] const Cell *row(int row) const {
+    return rows_[static_cast<size_t>(row)];
+  }
+  [[nodiscard]] const Cell &at(int col, int row) const {
+    return rows_[static_cast<size_t>(row)][col];
+  }
+  [[nodiscard]] uint64_t key(int row) const {
+    return keys_[static_cast<size_t>(row)];
+  }
+
+  /**
+   * The line before top_line(), or nullptr at the top of history.
+   */
+  [[nodiscard]] const Cell *above() const { return above_; }
+  [[nodiscard]] uint64_t above_key() const { return above_key_; }
+
+private:
+  int cols_ = 0;
+  uint64_t top_line_ = 0;
+  std::vector<const Cell *> rows_;
+  std::vector<uint64_t> keys_;
+  const Cell *above_ = nullptr;
+  uint64_t above_key_ = 0;
+  std::vector<Cell> blank_;
+};
+
+} // namespace tide::core
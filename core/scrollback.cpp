@@ -0,0 +1,832 @@
+#include "core/scrollback.hpp"
+
+#include "core/history_budget.hpp"
+#include "core/lz4.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace tide::core {
+
+namespace {
+
+/**
+ * Single background thread shared by all scrollbacks for page compression.
+ */
+class BackgroundWorker {
+public:
+  static BackgroundWorker &instance() {
+    static BackgroundWorker worker;
+    return worker;
+  }
+
+  ~BackgroundWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!thread_.joinable()) {
+        thread_ = std::thread(&BackgroundWorker::run, this);
+      }
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  std::thread thread_;
+  bool stop_ = false;
+
+  void run() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (stop_) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+};
+
+void put_varint(std::vector<uint8_t> &out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+bool get_varint(const uint8_t *&p, const uint8_t *end, uint32_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (p >= end) {
+      return false;
+    }
+    uint8_t b = *p++;
+    value |= static_cast<uint32_t>(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void put_color(std::vector<uint8_t> &out, const theme::Color &color) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&color);
+  out.insert(out.end(), bytes, bytes + sizeof(theme::Color));
+}
+
+bool get_color(const uint8_t *&p, const uint8_t *end, theme::Color &color) {
+  if (static_cast<size_t>(end - p) < sizeof(theme::Color)) {
+    return false;
+  }
+  std::memcpy(&color, p, sizeof(theme::Color));
+  p += sizeof(theme::Color);
+  return true;
+}
+
+bool is_blank(const Cell &cell) {
+  return cell.codepoint == U' ' || cell.codepoint == 0;
+}
+
+bool same_style(const Cell &cell, const StyleRun &run) {
+  return cell.foreground == run.foreground &&
+         cell.background == run.background;
+}
+
+} // anonymous namespace
+
+CompactLine CompactLine::encode(const Cell *cells, int cols, bool wrapped) {
+  CompactLine line;
+  line.wrapped_ = wrapped;
+  if (cols <= 0) {
+    return line;
+  }
+
+  // Trim trailing blanks; their colors survive in the style runs. A wrapped
+  // row keeps them, since joined with the next row they are real spaces.
+  int text_len = cols;
+  while (!wrapped && text_len > 0 && is_blank(cells[text_len - 1])) {
+    --text_len;
+  }
+
+  // Count runs first so both vectors are allocated exactly once
+  size_t run_count = 1;
+  for (int col = 1; col < cols; ++col) {
+    if (cells[col].foreground != cells[col - 1].foreground ||
+        cells[col].background != cells[col - 1].background) {
+      ++run_count;
+    }
+  }
+
+  line.text_.reserve(static_cast<size_t>(text_len));
+  for (int col = 0; col < text_len; ++col) {
+    line.text_.push_back(cells[col].codepoint);
+  }
+
+  line.runs_.reserve(run_count);
+  line.runs_.push_back({1, cells[0].foreground, cells[0].background});
+  for (int col = 1; col < cols; ++col) {
+    StyleRun &last = line.runs_.back();
+    if (same_style(cells[col], last)) {
+      last.length++;
+    } else {
+      line.runs_.push_back({1, cells[col].foreground, cells[col].background});
+    }
+  }
+
+  return line;
+}
+
+void CompactLine::decode(Cell *out, int cols) const {
+  int col = 0;
+  size_t text_len = text_.size();
+
+  for (size_t i = 0; i < runs_.size() && col < cols; ++i) {
+    const StyleRun &run = runs_[i];
+    // The last run covers the rest of the line
+    int end = (i + 1 == runs_.size())
+                  ? cols
+                  : std::min(cols, col + static_cast<int>(run.length));
+
+    for (; col < end; ++col) {
+      char32_t cp =
+          static_cast<size_t>(col) < text_len ? text_[col] : U' ';
+      out[col] = Cell(cp, run.foreground, run.background);
+    }
+  }
+
+  // Lines encoded from an empty row have no runs
+  for (; col < cols; ++col) {
+    out[col] = Cell{};
+  }
+}
+
+void CompactLine::serialize(std::vector<uint8_t> &out) const {
+  // The wrapped flag rides in the low bit of the text length
+  put_varint(out, static_cast<uint32_t>(text_.size() << 1) |
+                      (wrapped_ ? 1u : 0u));
+  for (char32_t cp : text_) {
+    put_varint(out, static_cast<uint32_t>(cp));
+  }
+  put_varint(out, static_cast<uint32_t>(runs_.size()));
+  for (const StyleRun &run : runs_) {
+    put_varint(out, run.length);
+    put_color(out, run.foreground);
+    put_color(out, run.background);
+  }
+}
+
+bool CompactLine::deserialize(const uint8_t *&p, const uint8_t *end,
+                              CompactLine &line) {
+  uint32_t count;
+  if (!get_varint(p, end, count)) {
+    return false;
+  }
+  line.wrapped_ = count & 1;
+  count >>= 1;
+  if (count > static_cast<size_t>(end - p)) {
+    return false;
+  }
+  line.text_.resize(count);
+  for (char32_t &cp : line.text_) {
+    uint32_t value;
+    if (!get_varint(p, end, value)) {
+      return false;
+    }
+    cp = static_cast<char32_t>(value);
+  }
+
+  if (!get_varint(p, end, count) ||
+      count > static_cast<size_t>(end - p)) {
+    return false;
+  }
+  line.runs_.resize(count);
+  for (StyleRun &run : line.runs_) {
+    if (!get_varint(p, end, run.length) ||
+        !get_color(p, end, run.foreground) ||
+        !get_color(p, end, run.background)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t CompactLine::hash() const {
+  static_assert(sizeof(StyleRun) ==
+                sizeof(uint32_t) + 2 * sizeof(theme::Color)); // No padding
+  std::hash<std::string_view> hasher;
+  uint64_t text = hasher(std::string_view(
+      reinterpret_cast<const char *>(text_.data()),
+      text_.size() * sizeof(char32_t)));
+  uint64_t runs = hasher(
+      std::string_view(reinterpret_cast<const char *>(runs_.data()),
+                       runs_.size() * sizeof(StyleRun)));
+  return (text * 0x9E3779B97F4A7C15ull ^ runs) + (wrapped_ ? 1 : 0);
+}
+
+size_t CompactLine::memory_usage() const {
+  return sizeof(CompactLine) + text_.capacity() * sizeof(char32_t) +
+         runs_.capacity() * sizeof(StyleRun);
+}
+
+/**
+ * Background compression or decompression of one page.
+ */
+struct Scrollback::Job {
+  enum class Kind { Compress, Decompress };
+
+  Kind kind = Kind::Compress;
+  uint64_t seq = 0;
+  std::shared_ptr<const void> owner; // Keeps `input` alive
+  const uint8_t *input = nullptr;
+  size_t input_size = 0;
+  size_t raw_size = 0; // Decompressed size (Decompress only)
+  std::vector<uint8_t> output;
+  bool ok = false;
+  std::atomic<bool> done{false};
+
+  void run() {
+    if (kind == Kind::Compress) {
+      lz4_compress(input, input_size, output);
+      output.shrink_to_fit(); // Drop the worst-case bound reservation
+      ok = true;
+    } else {
+      output.resize(raw_size);
+      ok = lz4_decompress(input, input_size, output.data(), raw_size);
+    }
+    done.store(true, std::memory_order_release);
+  }
+
+  [[nodiscard]] bool finished() const {
+    return done.load(std::memory_order_acquire);
+  }
+};
+
+Scrollback::Scrollback(size_t max_lines) : max_lines_(max_lines) {}
+
+void Scrollback::push(const Cell *cells, int cols, bool wrapped) {
+  if (max_lines_ == 0) {
+    return;
+  }
+
+  reap_jobs();
+
+  if (pages_.empty() || pages_.back().lines.size() == PAGE_LINES) {
+    pages_.emplace_back();
+    pages_.back().lines.reserve(PAGE_LINES);
+    pages_.back().rows.reserve(PAGE_LINES);
+
+    // The page falling out of the hot window goes cold, unless compact()
+    // got there first
+    if (pages_.size() > HOT_PAGES) {
+      size_t idx = pages_.size() - 1 - HOT_PAGES;
+      Page &old = pages_[idx];
+      if (!old.cold() && !old.job) {
+        compress_page(old, first_seq_ + idx);
+      }
+    }
+  }
+
+  Page &page = pages_.back();
+  CompactLine line = CompactLine::encode(cells, cols, wrapped);
+  page.trigrams.add(line.text().data(), line.text().size());
+
+  // A repeated row is stored once; the page keeps its id
+  RowStore::RowId id = shared_rows_.intern(line);
+  size_t bytes = sizeof(RowStore::RowId);
+  if (id == RowStore::NO_ROW) {
+    bytes += line.memory_usage();
+    page.lines.push_back(std::move(line));
+  } else {
+    bytes += sizeof(CompactLine);
+    page.lines.emplace_back();
+  }
+  page.rows.push_back(id);
+  page.hot_bytes += bytes;
+  hot_bytes_ += bytes;
+  size_++;
+
+  while (size_ > max_lines_) {
+    drop_front_line();
+  }
+}
+
+void Scrollback::drop_front_line() {
+  Page &front = pages_.front();
+  size_t page_lines = pages_.size() == 1 ? front.lines.size() : PAGE_LINES;
+
+  if (!front.cold()) {
+    // Release the line now rather than when the whole page goes
+    CompactLine &line = front.lines[front_skip_];
+    size_t bytes = line.memory_usage() - sizeof(CompactLine);
+    front.hot_bytes -= bytes;
+    hot_bytes_ -= bytes;
+    line = CompactLine{};
+
+    RowStore::RowId &id = front.rows[front_skip_];
+    shared_rows_.release(id);
+    id = RowStore::NO_ROW;
+  }
+
+  front_skip_++;
+  size_--;
+  dropped_lines_++;
+
+  if (front_skip_ < page_lines) {
+    return;
+  }
+
+  hot_bytes_ -= front.hot_bytes;
+  for (RowStore::RowId id : front.rows) {
+    shared_rows_.release(id);
+  }
+  if (front.cold()) {
+    cold_row_bytes_ -= front.rows.size() * sizeof(RowStore::RowId);
+  }
+  if (front.compressed) {
+    compressed_bytes_ -= front.compressed_size;
+  } else if (front.spill_offset >= 0) {
+    spilled_bytes_ -= front.compressed_size;
+    spilled_pages_--;
+  }
+  raw_cold_bytes_ -= front.raw_size;
+  pages_.pop_front();
+  first_seq_++;
+  front_skip_ = 0;
+
+  cache_.remove_if(
+      [this](const CachedPage &cached) { return cached.seq < first_seq_; });
+}
+
+void Scrollback::serialize_page(const Page &page,
+                                std::vector<uint8_t> &out) const {
+  // Each line is 0 followed by the line, or a shared row's id plus one
+  for (size_t i = 0; i < page.lines.size(); ++i) {
+    RowStore::RowId id = page.rows[i];
+    if (id == RowStore::NO_ROW) {
+      put_varint(out, 0);
+      page.lines[i].serialize(out);
+    } else {
+      put_varint(out, id + 1);
+    }
+  }
+}
+
+bool Scrollback::read_line(const uint8_t *&p, const uint8_t *end,
+                           CompactLine &line) const {
+  uint32_t tag;
+  if (!get_varint(p, end, tag)) {
+    return false;
+  }
+  if (tag == 0) {
+    return CompactLine::deserialize(p, end, line);
+  }
+  line = shared_rows_.get(tag - 1);
+  return true;
+}
+
+void Scrollback::compress_page(Page &page, uint64_t seq) {
+  auto raw = std::make_shared<std::vector<uint8_t>>();
+  serialize_page(page, *raw);
+
+  auto job = std::make_shared<Job>();
+  job->kind = Job::Kind::Compress;
+  job->seq = seq;
+  job->input = raw->data();
+  job->input_size = raw->size();
+  job->owner = std::move(raw);
+  page.job = job;
+  pending_.push_back(seq);
+
+  BackgroundWorker::instance().submit([job] { job->run(); });
+}
+
+void Scrollback::reap_jobs() {
+  // The worker is FIFO, so jobs complete in submission order
+  while (!pending_.empty()) {
+    uint64_t seq = pending_.front();
+    if (seq < first_seq_) {
+      pending_.pop_front(); // Page was dropped before it went cold
+      continue;
+    }
+
+    Page &page = pages_[seq - first_seq_];
+    if (page.job && !page.job->finished()) {
+      break;
+    }
+
+    // A page without a job was already compressed by compact()
+    if (page.job) {
+      std::shared_ptr<Job> job = std::move(page.job);
+      make_cold(page, std::move(job->output), job->input_size);
+    }
+    pending_.pop_front();
+  }
+
+  spill_pages(resident_limit_);
+}
+
+void Scrollback::make_cold(Page &page, std::vector<uint8_t> compressed,
+                           size_t raw_size) {
+  // Replacing an earlier result must not count it twice
+  if (page.compressed) {
+    compressed_bytes_ -= page.compressed_size;
+  }
+  raw_cold_bytes_ -= page.raw_size;
+
+  page.raw_size = raw_size;
+  page.compressed =
+      std::make_shared<const std::vector<uint8_t>>(std::move(compressed));
+  page.compressed_size = page.compressed->size();
+  compressed_bytes_ += page.compressed_size;
+  raw_cold_bytes_ += page.raw_size;
+
+  hot_bytes_ -= page.hot_bytes;
+  page.hot_bytes = 0;
+  std::vector<CompactLine>().swap(page.lines);
+
+  // Only the shared rows' ids stay, to release them when the page goes
+  std::erase(page.rows, RowStore::NO_ROW);
+  page.rows.shrink_to_fit();
+  cold_row_bytes_ += page.rows.size() * sizeof(RowStore::RowId);
+}
+
+size_t Scrollback::drop_cache() {
+  size_t before = memory_usage();
+  cache_.clear();
+  prefetches_.clear();
+  return before - memory_usage();
+}
+
+size_t Scrollback::compact() {
+  size_t before = memory_usage();
+  reap_jobs();
+
+  // Everything but the page still being filled goes cold right away
+  for (size_t i = 0; i + 1 < pages_.size(); ++i) {
+    Page &page = pages_[i];
+    if (page.cold()) {
+      continue;
+    }
+
+    std::vector<uint8_t> raw;
+    if (page.job) {
+      raw = *std::static_pointer_cast<const std::vector<uint8_t>>(
+          page.job->owner);
+      page.job.reset(); // Let the background result be discarded
+    } else {
+      serialize_page(page, raw);
+    }
+
+    std::vector<uint8_t> compressed;
+    lz4_compress(raw.data(), raw.size(), compressed);
+    compressed.shrink_to_fit();
+    make_cold(page, std::move(compressed), raw.size());
+  }
+
+  spill_pages(resident_limit_);
+  return before - std::min(before, memory_usage());
+}
+
+size_t Scrollback::trim_to(size_t target_bytes) {
+  size_t before = memory_usage();
+  if (spill_) {
+    // The file keeps history for almost nothing: move everything cold
+    // there rather than lose it, and drop only what is still resident
+    compact();
+    spill_pages(target_bytes);
+  }
+  while (size_ > 0 && memory_usage() > target_bytes &&
+         pages_.front().spill_offset < 0) {
+    drop_front_line();
+    trimmed_lines_++;
+  }
+  return before - std::min(before, memory_usage());
+}
+
+void Scrollback::spill_pages(size_t resident_limit) {
+  if (!spill_) {
+    return;
+  }
+
+  // Pages go cold oldest-first, so spilling proceeds in sequence order
+  spill_seq_ = std::max(spill_seq_, first_seq_);
+  while (memory_usage() > resident_limit &&
+         spill_seq_ < first_seq_ + pages_.size()) {
+    Page &page = pages_[spill_seq_ - first_seq_];
+    if (!page.compressed) {
+      break; // Not cold yet
+    }
+
+    int64_t offset =
+        spill_->append(page.compressed->data(), page.compressed_size);
+    if (offset < 0) {
+      break; // Keep the page in memory; retry on the next push
+    }
+
+    page.spill_offset = offset;
+    page.compressed.reset();
+    compressed_bytes_ -= page.compressed_size;
+    spilled_bytes_ += page.compressed_size;
+    spilled_pages_++;
+    spill_seq_++;
+  }
+}
+
+const uint8_t *Scrollback::compressed_data(const Page &page) const {
+  if (page.compressed) {
+    return page.compressed->data();
+  }
+  return spill_ ? spill_->data(page.spill_offset, page.compressed_size)
+                : nullptr;
+}
+
+void Scrollback::decode(size_t index, Cell *out, int cols) const {
+  if (index >= size_) {
+    std::fill(out, out + cols, Cell{});
+    return;
+  }
+  line(index).decode(out, cols);
+}
+
+const CompactLine &Scrollback::line(size_t index) const {
+  static const CompactLine empty_line;
+  if (index >= size_) {
+    return empty_line;
+  }
+
+  size_t global = index + front_skip_;
+  size_t page_idx = global / PAGE_LINES;
+  size_t offset = global % PAGE_LINES;
+
+  const Page &page = pages_[page_idx];
+  if (!page.cold()) {
+    RowStore::RowId id = page.rows[offset];
+    return id == RowStore::NO_ROW ? page.lines[offset]
+                                  : shared_rows_.get(id);
+  }
+
+  const CachedPage &cached = cached_page(first_seq_ + page_idx);
+  return offset < cached.lines.size() ? cached.lines[offset] : empty_line;
+}
+
+const Scrollback::CachedPage &Scrollback::cached_page(uint64_t seq) const {
+  for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+    if (it->seq == seq) {
+      cache_.splice(cache_.begin(), cache_, it);
+      return cache_.front();
+    }
+  }
+
+  std::vector<uint8_t> raw;
+  bool ok = false;
+
+  auto prefetched =
+      std::find_if(prefetches_.begin(), prefetches_.end(),
+                   [seq](const auto &job) { return job->seq == seq; });
+  if (prefetched != prefetches_.end() && (*prefetched)->finished()) {
+    ok = (*prefetched)->ok;
+    raw = std::move((*prefetched)->output);
+  }
+  if (prefetched != prefetches_.end()) {
+    prefetches_.erase(prefetched);
+  }
+
+  if (!ok) {
+    const Page &page = pages_[seq - first_seq_];
+    const uint8_t *data = compressed_data(page);
+    raw.resize(page.raw_size);
+    ok = data && lz4_decompress(data, page.compressed_size, raw.data(),
+                                raw.size());
+  }
+
+  CachedPage cached;
+  cached.seq = seq;
+  cached.lines.reserve(PAGE_LINES);
+  if (ok) {
+    const uint8_t *p = raw.data();
+    const uint8_t *end = p + raw.size();
+    CompactLine line;
+    while (p < end && read_line(p, end, line)) {
+      cached.bytes += line.memory_usage();
+      cached.lines.push_back(std::move(line));
+    }
+  }
+
+  insert_cache(std::move(cached));
+  return cache_.front();
+}
+
+bool Scrollback::read_page(size_t page_idx,
+                           std::vector<CompactLine> &lines) const {
+  if (page_idx >= pages_.size()) {
+    lines.clear();
+    return false;
+  }
+
+  // Lines are assigned over the previous contents so that repeated reads
+  // reuse their buffers instead of allocating per line
+  size_t count = 0;
+  auto next = [&lines, &count]() -> CompactLine & {
+    if (count == lines.size()) {
+      lines.emplace_back();
+    }
+    return lines[count++];
+  };
+
+  const Page &page = pages_[page_idx];
+  size_t skip = page_idx == 0 ? front_skip_ : 0;
+  bool ok = true;
+
+  if (!page.cold()) {
+    for (size_t i = skip; i < page.lines.size(); ++i) {
+      RowStore::RowId id = page.rows[i];
+      next() = id == RowStore::NO_ROW ? page.lines[i] : shared_rows_.get(id);
+    }
+  } else {
+    const uint8_t *data = compressed_data(page);
+    std::vector<uint8_t> raw(page.raw_size);
+    ok = data &&
+         lz4_decompress(data, page.compressed_size, raw.data(), raw.size());
+
+    const uint8_t *p = raw.data();
+    const uint8_t *end = ok ? p + raw.size() : p;
+    CompactLine dropped; // Lines already trimmed from the front page
+    for (size_t i = 0; p < end; ++i) {
+      CompactLine &line = i >= skip ? next() : dropped;
+      if (!read_line(p, end, line)) {
+        count -= i >= skip ? 1 : 0;
+        break;
+      }
+    }
+  }
+
+  lines.resize(count);
+  return ok;
+}
+
+void Scrollback::insert_cache(CachedPage page) const {
+  cache_.push_front(std::move(page));
+  while (cache_.size() > CACHE_PAGES) {
+    cache_.pop_back();
+  }
+}
+
+void Scrollback::prefetch(size_t first, size_t last) const {
+  if (size_ == 0 || first >= size_) {
+    return;
+  }
+  last = std::min(last, size_ - 1);
+
+  // Forget prefetches for pages that have since been dropped
+  std::erase_if(prefetches_,
+                [this](const auto &job) { return job->seq < first_seq_; });
+
+  size_t first_page = (first + front_skip_) / PAGE_LINES;
+  size_t last_page = (last + front_skip_) / PAGE_LINES;
+
+  for (size_t p = first_page; p <= last_page; ++p) {
+    const Page &page = pages_[p];
+    uint64_t seq = first_seq_ + p;
+    if (!page.cold()) {
+      continue;
+    }
+
+    bool cached = std::any_of(cache_.begin(), cache_.end(),
+                              [seq](const auto &c) { return c.seq == seq; });
+    bool queued = std::any_of(prefetches_.begin(), prefetches_.end(),
+                              [seq](const auto &j) { return j->seq == seq; });
+    if (cached || queued) {
+      continue;
+    }
+
+    const uint8_t *data = compressed_data(page);
+    if (!data) {
+      continue;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->kind = Job::Kind::Decompress;
+    job->seq = seq;
+    job->input = data;
+    job->input_size = page.compressed_size;
+    job->raw_size = page.raw_size;
+    if (page.compressed) {
+      job->owner = page.compressed;
+    } else {
+      job->owner = spill_; // Mapping stays valid while the file is alive
+    }
+    prefetches_.push_back(job);
+
+    BackgroundWorker::instance().submit([job] { job->run(); });
+  }
+}
+
+void Scrollback::set_max_lines(size_t max_lines) {
+  max_lines_ = max_lines;
+  while (size_ > max_lines_) {
+    drop_front_line();
+  }
+}
+
+bool Scrollback::enable_spill(size_t resident_limit) {
+  if (!spill_) {
+    auto file = std::make_shared<SpillFile>();
+    if (!file->open()) {
+      return false;
+    }
+    spill_ = std::move(file);
+  }
+  resident_limit_ = resident_limit;
+  spill_pages(resident_limit_);
+  return true;
+}
+
+void Scrollback::clear() {
+  // Keep sequence numbers moving so stale jobs can never match a new page
+  first_seq_ += pages_.size();
+  dropped_lines_ += size_;
+  pages_.clear();
+  pending_.clear();
+  cache_.clear();
+  prefetches_.clear();
+  size_ = 0;
+  front_skip_ = 0;
+  hot_bytes_ = 0;
+  shared_rows_.clear();
+  cold_row_bytes_ = 0;
+  compressed_bytes_ = 0;
+  raw_cold_bytes_ = 0;
+  spilled_bytes_ = 0;
+  spilled_pages_ = 0;
+}
+
+size_t Scrollback::memory_usage() const {
+  size_t cache_bytes = 0;
+  for (const CachedPage &cached : cache_) {
+    cache_bytes += cached.bytes;
+  }
+  return hot_bytes_ + shared_rows_.memory_usage() + cold_row_bytes_ +
+         compressed_bytes_ + cache_bytes + pages_.size() * sizeof(TrigramSet);
+}
+
+Scrollback::Stats Scrollback::stats() const {
+  Stats stats;
+  stats.lines = size_;
+  stats.pages = pages_.size();
+  for (const Page &page : pages_) {
+    if (page.cold()) {
+      stats.cold_pages++;
+      continue;
+    }
+    stats.hot_rows += page.lines.size();
+  }
+  stats.hot_rows -= pages_.empty() || pages_.front().cold() ? 0 : front_skip_;
+  stats.hot_bytes = hot_bytes_;
+  stats.compressed_bytes = compressed_bytes_;
+  stats.raw_cold_bytes = raw_cold_bytes_;
+  for (const CachedPage &cached : cache_) {
+    stats.cache_bytes += cached.bytes;
+  }
+  stats.index_bytes = pages_.size() * sizeof(TrigramSet);
+  stats.trimmed_lines = trimmed_lines_;
+  stats.spilled_pages = spilled_pages_;
+  stats.spilled_bytes = spilled_bytes_;
+  stats.shared_rows = shared_rows_.unique_rows();
+  stats.shared_lines = shared_rows_.references();
+  stats.shared_bytes = shared_rows_.memory_usage() + cold_row_bytes_;
+  return stats;
+}
+
+void Scrollback::report(HistoryBudget::Usage &usage) const {
+  usage.lines = size_;
+  usage.spilled_bytes = spilled_bytes_;
+  usage.trimmed_lines = trimmed_lines_;
+}
+
+} // namespace tide::core
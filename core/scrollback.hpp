@@ -0,0 +1,351 @@
+#pragma once
+
+#include "core/grid_buffer.hpp"
+#include "core/history_budget.hpp"
+#include "core/row_store.hpp"
+#include "core/spill_file.hpp"
+#include "core/trigram.hpp"
+#include "theme/theme.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * A run of consecutive cells sharing the same colors.
+ */
+struct StyleRun {
+  uint32_t length = 0; // Number of cells covered by this run
+  theme::Color foreground;
+  theme::Color background;
+
+  bool operator==(const StyleRun &other) const = default;
+};
+
+/**
+ * Compact representation of a line that has left the live grid.
+ *
+ * Only the codepoints up to the last non-blank cell are kept, and colors are
+ * stored as run-length encoded spans. The last run extends to the end of the
+ * line, so trailing blanks cost nothing regardless of the column count.
+ */
+class CompactLine {
+public:
+  CompactLine() = default;
+
+  /**
+   * Encode a row of cells.
+   * @param cells Pointer to the first cell of the row
+   * @param cols Number of cells in the row
+   * @param wrapped Row was ended by autowrap (its blanks are kept)
+   */
+  static CompactLine encode(const Cell *cells, int cols, bool wrapped = false);
+
+  /**
+   * Expand the line back into cells.
+   * Cells past the stored text are filled with blanks in the trailing style.
+   * @param out Destination for exactly `cols` cells
+   * @param cols Number of cells to produce
+   */
+  void decode(Cell *out, int cols) const;
+
+  /**
+   * Append a byte serialization of the line (used for page compression).
+   */
+  void serialize(std::vector<uint8_t> &out) const;
+
+  /**
+   * Read a line written by serialize().
+   * @param p Read cursor, advanced past the line
+   * @param end End of the input
+   * @return false if the input is truncated or malformed
+   */
+  static bool deserialize(const uint8_t *&p, const uint8_t *end,
+                          CompactLine &line);
+
+  /**
+   * Get the stored codepoints (trailing blanks trimmed).
+   */
+  [[nodiscard]] const std::vector<char32_t> &text() const { return text_; }
+
+  /**
+   * Get the style runs covering the line.
+   */
+  [[nodiscard]] const std::vector<StyleRun> &runs() const { return runs_; }
+
+  /**
+   * Whether the line continues on the next one (autowrap).
+   */
+  [[nodiscard]] bool wrapped() const { return wrapped_; }
+
+  /**
+   * Content hash used for row deduplication.
+   */
+  [[nodiscard]] uint64_t hash() const;
+
+  /**
+   * Approximate heap plus inline footprint in bytes.
+   */
+  [[nodiscard]] size_t memory_usage() const;
+
+  bool operator==(const CompactLine &other) const = default;
+
+private:
+  std::vector<char32_t> text_;
+  std::vector<StyleRun> runs_;
+  bool wrapped_ = false;
+};
+
+/**
+ * Scrollback history made of compact lines.
+ * Index 0 is the oldest retained line.
+ *
+ * Lines are grouped into fixed-size pages. Pages more than HOT_PAGES behind
+ * the newest one are serialized and compressed on a background thread; a
+ * small LRU of decompressed pages serves reads into cold history.
+ *
+ * Repeated rows (blank separators, the same warning, the same prompt) are
+ * stored once in a RowStore. Pages hold their id instead of the line, and
+ * keep holding it once compressed or spilled.
+ *
+ * Every page keeps a TrigramSet of the text pushed into it, so searches can
+ * skip pages without decompressing them.
+ *
+ * With spilling enabled, the oldest compressed pages are appended to a
+ * SpillFile whenever resident memory exceeds the configured cap, and are
+ * mapped back on demand. Combined with UNLIMITED this keeps all output.
+ */
+class Scrollback : public BudgetedHistory {
+public:
+  static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+  static constexpr size_t PAGE_LINES = 256;
+  static constexpr size_t HOT_PAGES = 4;   // Newest pages left uncompressed
+  static constexpr size_t CACHE_PAGES = 4; // Decompressed cold pages kept
+
+  /**
+   * Memory breakdown of the history.
+   */
+  struct Stats {
+    size_t lines = 0;
+    size_t pages = 0;
+    size_t cold_pages = 0;
+    size_t hot_bytes = 0;        // Uncompressed compact lines
+    size_t hot_rows = 0;         // Lines held by hot pages
+    size_t compressed_bytes = 0; // Compressed cold pages
+    size_t raw_cold_bytes = 0;   // Cold pages before compression
+    size_t cache_bytes = 0;      // Decompressed page cache
+    size_t index_bytes = 0;      // Per-page trigram bitmaps
+    size_t spilled_pages = 0;
+    size_t spilled_bytes = 0; // Compressed bytes living in the spill file
+    uint64_t trimmed_lines = 0; // Lines dropped by trim_to()
+    size_t shared_rows = 0;     // Distinct rows in the row store
+    size_t shared_lines = 0;    // Lines referring to a stored row
+    size_t shared_bytes = 0;    // Row store plus cold pages' row ids
+
+    /**
+     * History lines per row kept in memory (1.0 = nothing shared).
+     */
+    [[nodiscard]] double dedup_ratio() const {
+      size_t stored = (lines > shared_lines ? lines - shared_lines : 0) +
+                      shared_rows;
+      return stored ? static_cast<double>(lines) / stored : 1.0;
+    }
+  };
+
+  /**
+   * @param max_lines Maximum number of lines to retain
+   */
+  explicit Scrollback(size_t max_lines);
+
+  // Non-copyable (pages may be shared with the background worker)
+  Scrollback(const Scrollback &) = delete;
+  Scrollback &operator=(const Scrollback &) = delete;
+
+  /**
+   * Append a row leaving the top of the grid.
+   * Drops the oldest line when the limit is reached.
+   */
+  void push(const Cell *cells, int cols, bool wrapped = false);
+
+  /**
+   * Expand a stored line into cells.
+   * @param index Line index (0 = oldest)
+   * @param out Destination for exactly `cols` cells
+   * @param cols Number of cells to produce
+   */
+  void decode(size_t index, Cell *out, int cols) const;
+
+  /**
+   * Get a stored line, decompressing its page if needed.
+   * The reference is valid until the next call into the scrollback.
+   */
+  [[nodiscard]] const CompactLine &line(size_t index) const;
+
+  /**
+   * Start decompressing cold pages covering [first, last] in the background
+   * so a following read does not stall.
+   */
+  void prefetch(size_t first, size_t last) const;
+
+  /**
+   * Change the line limit, dropping the oldest lines if needed.
+   */
+  void set_max_lines(size_t max_lines);
+
+  /**
+   * Spill compressed pages to a temporary file once resident memory exceeds
+   * `resident_limit` bytes.
+   * @return false if the spill file could not be created
+   */
+  bool enable_spill(size_t resident_limit);
+
+  [[nodiscard]] bool spilling() const { return spill_ != nullptr; }
+
+  /**
+   * Free the decompressed page cache.
+   * @return Bytes freed
+   */
+  size_t drop_cache() override;
+
+  /**
+   * Compress every complete hot page now instead of waiting for it to age.
+   * @return Bytes freed
+   */
+  size_t compact() override;
+
+  /**
+   * Drop the oldest lines until resident memory is at most `target_bytes`.
+   * With spilling, cold pages go to the file first, and spilled lines
+   * (which cost almost no memory) are never dropped.
+   * @return Bytes freed
+   */
+  size_t trim_to(size_t target_bytes) override;
+
+  /**
+   * Remove all lines.
+   */
+  void clear();
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+
+  /**
+   * Absolute number of line 0 (lines dropped from the front so far).
+   */
+  [[nodiscard]] uint64_t first_line() const { return dropped_lines_; }
+
+  // Page-level access for search
+  [[nodiscard]] size_t page_count() const { return pages_.size(); }
+
+  /**
+   * Index of the first retained line of a page.
+   */
+  [[nodiscard]] size_t page_start(size_t page) const {
+    return page == 0 ? 0 : page * PAGE_LINES - front_skip_;
+  }
+
+  /**
+   * Page holding a line index.
+   */
+  [[nodiscard]] size_t page_of(size_t index) const {
+    return (index + front_skip_) / PAGE_LINES;
+  }
+
+  /**
+   * Check a page's trigram index (false = the page cannot match).
+   */
+  [[nodiscard]] bool page_may_contain(size_t page,
+                                      const std::vector<uint32_t> &keys) const {
+    return pages_[page].trigrams.contains_all(keys);
+  }
+
+  /**
+   * Copy out the retained lines of a page, starting at page_start(page).
+   * Bypasses the page cache, so several threads may read at once as long as
+   * the scrollback is not modified meanwhile.
+   * @return false if a cold page could not be decompressed
+   */
+  bool read_page(size_t page, std::vector<CompactLine> &lines) const;
+  [[nodiscard]] size_t max_lines() const { return max_lines_; }
+
+  /**
+   * Bytes of history held in memory, including the page cache.
+   * Spilled pages are not counted.
+   */
+  [[nodiscard]] size_t memory_usage() const override;
+
+  [[nodiscard]] Stats stats() const;
+
+  void report(HistoryBudget::Usage &usage) const override;
+
+private:
+  struct Job;
+
+  struct Page {
+    std::vector<CompactLine> lines; // Empty once the page is cold
+    // Hot: one per line, NO_ROW if the line is inline (a shared one leaves
+    // an empty line). Cold: the shared rows only, held until the page goes.
+    std::vector<RowStore::RowId> rows;
+    size_t hot_bytes = 0;
+    std::shared_ptr<const std::vector<uint8_t>> compressed;
+    size_t compressed_size = 0;
+    size_t raw_size = 0;
+    int64_t spill_offset = -1; // Set once `compressed` moved to the file
+    std::shared_ptr<Job> job; // Pending background compression
+    TrigramSet trigrams;      // Search index, kept after the page goes cold
+
+    [[nodiscard]] bool cold() const { return lines.empty(); }
+  };
+
+  struct CachedPage {
+    uint64_t seq = 0;
+    std::vector<CompactLine> lines;
+    size_t bytes = 0;
+  };
+
+  size_t max_lines_;
+  size_t size_ = 0;
+  size_t front_skip_ = 0; // Lines already dropped from the front page
+  uint64_t dropped_lines_ = 0;
+  uint64_t first_seq_ = 0; // Sequence number of pages_.front()
+  std::deque<Page> pages_;
+  size_t hot_bytes_ = 0;
+  RowStore shared_rows_;
+  size_t cold_row_bytes_ = 0; // Row ids held by cold pages
+  size_t compressed_bytes_ = 0;
+  size_t raw_cold_bytes_ = 0;
+  std::deque<uint64_t> pending_; // Pages waiting on background compression
+
+  std::shared_ptr<SpillFile> spill_; // Shared with in-flight prefetches
+  size_t resident_limit_ = 0;
+  uint64_t spill_seq_ = 0; // Next page to consider for spilling
+  size_t spilled_bytes_ = 0;
+  size_t spilled_pages_ = 0;
+
+  uint64_t trimmed_lines_ = 0;
+
+  mutable std::list<CachedPage> cache_; // Most recently used first
+  mutable std::vector<std::shared_ptr<Job>> prefetches_;
+
+  void drop_front_line();
+  void serialize_page(const Page &page, std::vector<uint8_t> &out) const;
+  bool read_line(const uint8_t *&p, const uint8_t *end,
+                 CompactLine &line) const;
+  void compress_page(Page &page, uint64_t seq);
+  void reap_jobs();
+  void spill_pages(size_t resident_limit);
+  void make_cold(Page &page, std::vector<uint8_t> compressed,
+                 size_t raw_size);
+  const uint8_t *compressed_data(const Page &page) const;
+  const CachedPage &cached_page(uint64_t seq) const;
+  void insert_cache(CachedPage page) const;
+};
+
+} // namespace tide::core
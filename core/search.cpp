@@ -0,0 +1,341 @@
+#include "core/search.hpp"
+
+#include "core/terminal.hpp"
+#include "core/trigram.hpp"
+#include "core/utf8.hpp"
+#include "core/worker_pool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <regex>
+
+namespace tide::core {
+
+namespace {
+
+/**
+ * Literal runs every match of a regex must contain.
+ * Conservative: anything inside groups, classes or optional atoms is left
+ * out, and alternation anywhere means nothing is required.
+ */
+std::vector<std::string> required_literals(const std::string &pattern) {
+  std::vector<std::string> runs;
+  std::string run;
+  int depth = 0;
+
+  auto flush = [&] {
+    if (run.size() >= 3) {
+      runs.push_back(run);
+    }
+    run.clear();
+  };
+  // The atom before an optional quantifier is not required
+  auto drop_last = [&] {
+    while (!run.empty() && (static_cast<uint8_t>(run.back()) & 0xC0) == 0x80) {
+      run.pop_back();
+    }
+    if (!run.empty()) {
+      run.pop_back();
+    }
+    flush();
+  };
+
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    char c = pattern[i];
+    switch (c) {
+    case '|':
+      return {};
+    case '\\':
+      if (i + 1 < pattern.size() &&
+          !std::isalnum(static_cast<unsigned char>(pattern[i + 1]))) {
+        if (depth == 0) {
+          run += pattern[i + 1];
+        }
+        ++i;
+        break;
+      }
+      // Class escapes such as \d, and escapes with an operand (\x41, \u0041,
+      // \cJ, \1) end the run; the operand is not literal text
+      flush();
+      if (++i < pattern.size()) {
+        switch (pattern[i]) {
+        case 'x':
+          i += 2;
+          break;
+        case 'u':
+          i += 4;
+          break;
+        case 'c':
+          i += 1;
+          break;
+        default:
+          while (std::isdigit(static_cast<unsigned char>(pattern[i])) &&
+                 i + 1 < pattern.size() &&
+                 std::isdigit(static_cast<unsigned char>(pattern[i + 1]))) {
+            ++i;
+          }
+        }
+      }
+      break;
+    case '(':
+      depth++;
+      flush();
+      break;
+    case ')':
+      depth = std::max(0, depth - 1);
+      flush();
+      break;
+    case '[':
+      flush();
+      for (++i; i < pattern.size() && pattern[i] != ']'; ++i) {
+        if (pattern[i] == '\\') {
+          ++i;
+        }
+      }
+      break;
+    case '*':
+    case '?':
+      drop_last();
+      break;
+    case '{':
+      drop_last();
+      while (i < pattern.size() && pattern[i] != '}') {
+        ++i;
+      }
+      break;
+    case '+':
+    case '.':
+    case '^':
+    case '$':
+      flush();
+      break;
+    default:
+      if (depth == 0) {
+        run += c;
+      } else {
+        flush();
+      }
+    }
+  }
+  flush();
+  return runs;
+}
+
+/**
+ * Compiled query shared read-only by the scanning threads.
+ */
+class Matcher {
+public:
+  bool compile(const SearchQuery &query) {
+    if (query.pattern.empty()) {
+      return false;
+    }
+    ignore_case_ = query.ignore_case;
+
+    if (!query.regex) {
+      literal_ = decode_utf8(query.pattern);
+      if (ignore_case_) {
+        std::transform(literal_.begin(), literal_.end(), literal_.begin(),
+                       fold_case);
+      }
+      TrigramSet::keys(literal_.data(), literal_.size(), keys_);
+      return true;
+    }
+
+    auto flags = std::regex::ECMAScript | std::regex::optimize;
+    if (ignore_case_) {
+      flags |= std::regex::icase;
+    }
+    try {
+      regex_.assign(query.pattern, flags);
+    } catch (const std::regex_error &) {
+      return false;
+    }
+    regex_mode_ = true;
+
+    for (const std::string &run : required_literals(query.pattern)) {
+      // The index only folds ASCII, regex icase may fold more
+      if (ignore_case_ && std::any_of(run.begin(), run.end(),
+                                      [](char c) { return c & 0x80; })) {
+        continue;
+      }
+      std::u32string text = decode_utf8(run);
+      TrigramSet::keys(text.data(), text.size(), keys_);
+    }
+    return true;
+  }
+
+  /**
+   * Trigram keys every matching line must contain.
+   */
+  [[nodiscard]] const std::vector<uint32_t> &keys() const { return keys_; }
+
+  /**
+   * Append the matches in one line, right to left.
+   */
+  void find(const char32_t *text, size_t size, uint64_t line,
+            std::vector<SearchMatch> &out) const {
+    size_t first = out.size();
+    if (regex_mode_) {
+      find_regex(text, size, line, out);
+    } else {
+      find_literal(text, size, line, out);
+    }
+    std::reverse(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+  }
+
+private:
+  std::u32string literal_;
+  std::regex regex_;
+  std::vector<uint32_t> keys_;
+  bool regex_mode_ = false;
+  bool ignore_case_ = false;
+
+  void find_literal(const char32_t *text, size_t size, uint64_t line,
+                    std::vector<SearchMatch> &out) const {
+    if (size < literal_.size()) {
+      return;
+    }
+
+    auto equal = [this](char32_t a, char32_t b) {
+      return (ignore_case_ ? fold_case(a) : a) == b;
+    };
+    const char32_t *end = text + size;
+    for (const char32_t *p = text;;) {
+      p = std::search(p, end, literal_.begin(), literal_.end(), equal);
+      if (p == end) {
+        break;
+      }
+      int col = static_cast<int>(p - text);
+      out.push_back({line, col, col + static_cast<int>(literal_.size())});
+      p += literal_.size();
+    }
+  }
+
+  void find_regex(const char32_t *text, size_t size, uint64_t line,
+                  std::vector<SearchMatch> &out) const {
+    // Match on UTF-8, mapping byte offsets back to columns
+    std::string utf8;
+    std::vector<int> col_of;
+    utf8.reserve(size);
+    col_of.reserve(size + 1);
+    for (size_t col = 0; col < size; ++col) {
+      size_t before = utf8.size();
+      append_utf8(utf8, text[col]);
+      col_of.insert(col_of.end(), utf8.size() - before, static_cast<int>(col));
+    }
+    col_of.push_back(static_cast<int>(size));
+
+    auto begin = std::sregex_iterator(utf8.begin(), utf8.end(), regex_);
+    for (auto it = begin; it != std::sregex_iterator(); ++it) {
+      if (it->length() == 0) {
+        continue; // Empty matches are not useful hits
+      }
+      auto pos = static_cast<size_t>(it->position());
+      auto len = static_cast<size_t>(it->length());
+      out.push_back({line, col_of[pos], col_of[pos + len]});
+    }
+  }
+};
+
+void row_text(const GridBuffer &grid, int row, std::vector<char32_t> &text) {
+  text.clear();
+  int len = grid.cols();
+  while (len > 0 && (grid.at(len - 1, row).codepoint == U' ' ||
+                     grid.at(len - 1, row).codepoint == 0)) {
+    --len;
+  }
+  for (int col = 0; col < len; ++col) {
+    text.push_back(grid.at(col, row).codepoint);
+  }
+}
+
+void search_pages(const Scrollback &scrollback, const Matcher &matcher,
+                  size_t max_results, WorkerPool *pool,
+                  std::vector<SearchMatch> &results) {
+  std::vector<size_t> candidates;
+  for (size_t page = scrollback.page_count(); page-- > 0;) {
+    if (scrollback.page_may_contain(page, matcher.keys())) {
+      candidates.push_back(page);
+    }
+  }
+
+  // Batches double in size: the first result arrives after a handful of
+  // pages, while a full scan wakes the pool only a few times
+  size_t batch = pool ? pool->concurrency() : 1;
+
+  for (size_t next = 0;
+       next < candidates.size() && results.size() < max_results;
+       next += batch, batch *= 2) {
+    size_t count = std::min(batch, candidates.size() - next);
+    std::vector<std::vector<SearchMatch>> found(count);
+
+    auto scan = [&](size_t i) {
+      std::vector<CompactLine> lines;
+      size_t page = candidates[next + i];
+      if (!scrollback.read_page(page, lines)) {
+        return;
+      }
+      uint64_t first = scrollback.first_line() + scrollback.page_start(page);
+      for (size_t j = lines.size(); j-- > 0;) {
+        const std::vector<char32_t> &text = lines[j].text();
+        matcher.find(text.data(), text.size(), first + j, found[i]);
+      }
+    };
+    if (pool) {
+      pool->parallel_for(count, scan);
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        scan(i);
+      }
+    }
+
+    for (const auto &page_matches : found) {
+      results.insert(results.end(), page_matches.begin(), page_matches.end());
+    }
+  }
+}
+
+} // anonymous namespace
+
+std::vector<SearchMatch> search(const Terminal &terminal,
+                                const SearchQuery &query, size_t max_results,
+                                WorkerPool *pool) {
+  Matcher matcher;
+  if (max_results == 0 || !matcher.compile(query)) {
+    return {};
+  }
+
+  std::vector<SearchMatch> results;
+  uint64_t base = terminal.history_base();
+  size_t history = terminal.history_size();
+
+  const GridBuffer &grid = terminal.grid();
+  std::vector<char32_t> text;
+  for (int row = grid.rows() - 1; row >= 0 && results.size() < max_results;
+       --row) {
+    row_text(grid, row, text);
+    matcher.find(text.data(), text.size(),
+                 base + history + static_cast<uint64_t>(row), results);
+  }
+
+  if (results.size() < max_results) {
+    if (terminal.history_mode() == HistoryMode::Cells) {
+      search_pages(terminal.scrollback(), matcher, max_results, pool,
+                   results);
+    } else {
+      // Replay history has no index; segments are rebuilt one at a time
+      for (size_t i = history; i-- > 0 && results.size() < max_results;) {
+        const std::vector<char32_t> &line = terminal.history_line(i).text();
+        matcher.find(line.data(), line.size(), base + i, results);
+      }
+    }
+  }
+
+  if (results.size() > max_results) {
+    results.resize(max_results);
+  }
+  return results;
+}
+
+} // namespace tide::core
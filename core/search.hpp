@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+class Terminal;
+class WorkerPool;
+
+/**
+ * What to look for.
+ */
+struct SearchQuery {
+  std::string pattern; // UTF-8
+  bool regex = false;  // ECMAScript regex instead of a literal
+  bool ignore_case = false;
+};
+
+/**
+ * A match as an absolute line and a half-open column range.
+ *
+ * Absolute lines count every line the terminal has produced: history line i
+ * is Terminal::history_base() + i and grid row r follows the history. They
+ * stay valid while history grows, until the line itself is trimmed away.
+ */
+struct SearchMatch {
+  uint64_t line = 0;
+  int start_col = 0;
+  int end_col = 0; // Exclusive
+
+  bool operator==(const SearchMatch &other) const = default;
+};
+
+/**
+ * Search the grid and history of a terminal.
+ *
+ * Matches are returned from the bottom up (grid first, then history newest
+ * to oldest, right to left within a line), so the first results are the
+ * ones nearest the live view and the scan stops after `max_results`.
+ *
+ * In Cells history mode, pages whose trigram index rules the pattern out are
+ * skipped, and candidate pages are decompressed and scanned in growing
+ * batches, in parallel on `pool` if one is given. Matches do not span
+ * wrapped rows.
+ *
+ * @param pool Threads to scan pages on (nullptr = the caller only); must
+ *             not be running other work
+ * @return Matches, or empty if there are none or the regex is invalid
+ */
+std::vector<SearchMatch>
+search(const Terminal &terminal, const SearchQuery &query,
+       size_t max_results = std::numeric_limits<size_t>::max(),
+       WorkerPool *pool = nullptr);
+
+} // namespace tide::core
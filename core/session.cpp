@@ -0,0 +1,62 @@
+#include "core/session.hpp"
+
+namespace tide::core {
+
+Session::Session(int id, int cols, int rows)
+    : id_(id), terminal_(cols, rows) {
+  terminal_.set_name("session " + std::to_string(id));
+}
+
+Session::~Session() {
+  reader_.stop();
+  pty_.close();
+}
+
+bool Session::start(const PtyReader::Notify &notify,
+                    const std::vector<std::string> &command,
+                    PtyUring *uring, const SpawnContext &context) {
+  bool spawned =
+      command.empty() ? pty_.spawn(context) : pty_.spawn(command, context);
+  if (!spawned) {
+    return false;
+  }
+  pty_.resize(terminal_.cols(), terminal_.rows());
+
+  // Output is buffered on the reader thread and parsed when asked; input
+  // is queued and flushed without blocking
+  reader_.set_notify(notify);
+  reader_.set_exit_fd(pty_.pid_fd()); // Exit arrives like output
+  if (!reader_.start(pty_.master_fd(), uring)) {
+    pty_.close();
+    return false;
+  }
+  writer_.set_fd(pty_.master_fd());
+  writer_.set_wait_writable([this] { reader_.notify_when_writable(); });
+  return true;
+}
+
+size_t Session::parse(size_t limit) {
+  parsed_ = reader_.drain(
+      [this](const char *data, size_t size) { terminal_.feed(data, size); },
+      limit);
+  return parsed_;
+}
+
+std::optional<int> Session::exit_status() {
+  // Without a pidfd, EOF on the master is the only sign of exit
+  if (pty_.exited() ||
+      ((reader_.child_exited() || reader_.finished()) && pty_.reap())) {
+    return pty_.exit_status();
+  }
+  return std::nullopt;
+}
+
+void Session::resize(int cols, int rows) {
+  if (cols == terminal_.cols() && rows == terminal_.rows()) {
+    return;
+  }
+  terminal_.resize(cols, rows);
+  pty_.resize(cols, rows);
+}
+
+} // namespace tide::core
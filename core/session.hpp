@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/pty.hpp"
+#include "core/pty_reader.hpp"
+#include "core/pty_writer.hpp"
+#include "core/terminal.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * One shell and its terminal: the Terminal, the Pty it runs on, and the
+ * reader and writer moving bytes between them.
+ *
+ * parse() may run on any thread (SessionManager spreads sessions over a
+ * worker pool), but only one at a time and never while the owner thread
+ * touches the terminal. Everything else belongs to the owner thread.
+ */
+class Session {
+public:
+  Session(int id, int cols, int rows);
+  ~Session();
+
+  // Non-copyable (the reader thread points into us)
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  /**
+   * Spawn the shell (or `command`) and start reading its output.
+   * @param notify See PtyReader::set_notify()
+   * @param uring Read through this instead of a reader thread (optional)
+   * @param context Directory and environment to start in (optional)
+   * @return true if the child is running
+   */
+  bool start(const PtyReader::Notify &notify,
+             const std::vector<std::string> &command = {},
+             PtyUring *uring = nullptr, const SpawnContext &context = {});
+
+  /**
+   * Feed up to `limit` buffered bytes into the terminal.
+   * @return Number of bytes parsed (also kept as parsed())
+   */
+  size_t parse(size_t limit);
+
+  /**
+   * Bytes parsed by the last parse() call.
+   */
+  [[nodiscard]] size_t parsed() const { return parsed_; }
+
+  /**
+   * Resize the terminal and tell the child.
+   */
+  void resize(int cols, int rows);
+
+  /**
+   * True once the child has exited and all its output has been parsed.
+   */
+  [[nodiscard]] bool finished() const { return reader_.finished(); }
+
+  /**
+   * The child's exit status (see Pty::exit_status()), reaping it without
+   * waiting; std::nullopt while it runs.
+   */
+  std::optional<int> exit_status();
+
+  [[nodiscard]] int id() const { return id_; }
+  Terminal &terminal() { return terminal_; }
+  [[nodiscard]] const Terminal &terminal() const { return terminal_; }
+  Pty &pty() { return pty_; }
+  PtyReader &reader() { return reader_; }
+  [[nodiscard]] const PtyReader &reader() const { return reader_; }
+  PtyWriter &writer() { return writer_; }
+  [[nodiscard]] const PtyWriter &writer() const { return writer_; }
+
+private:
+  int id_;
+  Terminal terminal_;
+  Pty pty_;
+  PtyReader reader_;
+  PtyWriter writer_;
+  size_t parsed_ = 0;
+};
+
+} // namespace tide::core
@@ -0,0 +1,97 @@
+#include "core/session_manager.hpp"
+
+#include <iostream>
+
+namespace tide::core {
+
+bool SessionManager::use_io_uring() {
+  if (!uring_) {
+    uring_ = PtyUring::create();
+  }
+  return uring_ != nullptr;
+}
+
+Session *SessionManager::create(int cols, int rows,
+                                const std::vector<std::string> &command,
+                                const SpawnContext &context) {
+  auto session = std::make_unique<Session>(next_id_, cols, rows);
+  if (!session->start(notify_, command, uring_.get(), context)) {
+    std::cerr << "[tide] Failed to start session " << next_id_ << std::endl;
+    return nullptr;
+  }
+  ++next_id_;
+  sessions_.push_back(std::move(session));
+  return sessions_.back().get();
+}
+
+void SessionManager::close(Session *session) {
+  size_t index = index_of(session);
+  if (index < sessions_.size()) {
+    sessions_.erase(sessions_.begin() + static_cast<ptrdiff_t>(index));
+  }
+}
+
+size_t SessionManager::index_of(const Session *session) const {
+  for (size_t i = 0; i < sessions_.size(); ++i) {
+    if (sessions_[i].get() == session) {
+      return i;
+    }
+  }
+  return sessions_.size();
+}
+
+bool SessionManager::parse(size_t slice) {
+  busy_.clear();
+  for (auto &session : sessions_) {
+    if (session->reader().buffered() > 0) {
+      busy_.push_back(session.get());
+    } else {
+      session->parse(0); // Nothing this round
+    }
+  }
+
+  pool_.parallel_for(busy_.size(),
+                     [this, slice](size_t i) { busy_[i]->parse(slice); });
+
+  for (Session *session : busy_) {
+    if (session->reader().buffered() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SessionManager::output_pending() const {
+  for (const auto &session : sessions_) {
+    if (session->reader().buffered() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SessionManager::flush_input() {
+  for (auto &session : sessions_) {
+    if (session->writer().pending()) {
+      session->writer().flush();
+    }
+  }
+}
+
+bool SessionManager::input_pending() const {
+  for (const auto &session : sessions_) {
+    const PtyWriter &writer = session->writer();
+    if (writer.pending() && !writer.blocked()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SessionManager::resize(int cols, int rows) {
+  for (auto &session : sessions_) {
+    session->resize(cols, rows);
+  }
+}
+
+} // namespace tide::core
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "core/pty_uring.hpp"
+#include "core/session.hpp"
+#include "core/worker_pool.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Owns every session in the process (tabs, splits) and parses their output
+ * in parallel.
+ *
+ * parse() runs one round: each session with buffered output parses at most
+ * one slice, spread over a WorkerPool. A flooding session therefore gets
+ * one slice per round like everyone else and cannot starve a quiet one,
+ * and busy sessions scale across cores. The owner thread is blocked for
+ * the round, so between rounds it may use any terminal freely.
+ */
+class SessionManager {
+public:
+  /**
+   * @param workers Parse threads besides the caller
+   */
+  explicit SessionManager(size_t workers = WorkerPool::default_threads())
+      : pool_(workers) {}
+
+  // Non-copyable
+  SessionManager(const SessionManager &) = delete;
+  SessionManager &operator=(const SessionManager &) = delete;
+
+  /**
+   * Called on a reader thread whenever some session has output to parse
+   * (see PtyReader::set_notify()). Set before create().
+   */
+  void set_notify(PtyReader::Notify notify) { notify_ = std::move(notify); }
+
+  /**
+   * Read every session's PTY on one io_uring thread instead of a reader
+   * thread each. Call before create().
+   * @return false if io_uring is unavailable; epoll readers are kept
+   */
+  bool use_io_uring();
+
+  /**
+   * The shared io_uring, or nullptr when reading with epoll.
+   */
+  [[nodiscard]] const PtyUring *uring() const { return uring_.get(); }
+
+  /**
+   * Start a session running the shell (or `command`), in `context` if
+   * given.
+   * @return The new session, or nullptr if it could not start
+   */
+  Session *create(int cols, int rows,
+                  const std::vector<std::string> &command = {},
+                  const SpawnContext &context = {});
+
+  /**
+   * Stop a session's child and destroy it.
+   */
+  void close(Session *session);
+
+  /**
+   * Close every session (before the notify target goes away).
+   */
+  void close_all() { sessions_.clear(); }
+
+  [[nodiscard]] size_t size() const { return sessions_.size(); }
+  [[nodiscard]] bool empty() const { return sessions_.empty(); }
+  Session *at(size_t index) { return sessions_[index].get(); }
+
+  /**
+   * Position of `session`, or size() if it is not ours.
+   */
+  [[nodiscard]] size_t index_of(const Session *session) const;
+
+  /**
+   * Parse one slice of every session with buffered output, in parallel.
+   * @return true if output is left over for another round
+   */
+  bool parse(size_t slice);
+
+  /**
+   * Check if any session has output waiting to be parsed.
+   */
+  [[nodiscard]] bool output_pending() const;
+
+  /**
+   * Flush every session's queued input (see PtyWriter::flush()).
+   */
+  void flush_input();
+
+  /**
+   * Check if any session has queued input that could be written now.
+   */
+  [[nodiscard]] bool input_pending() const;
+
+  /**
+   * Resize every session.
+   */
+  void resize(int cols, int rows);
+
+  /**
+   * Threads parse() can use, including the caller.
+   */
+  [[nodiscard]] size_t concurrency() const { return pool_.concurrency(); }
+
+  /**
+   * The parse threads, for other fork-join work between rounds.
+   */
+  WorkerPool &pool() { return pool_; }
+
+private:
+  WorkerPool pool_;
+  PtyReader::Notify notify_;
+  std::unique_ptr<PtyUring> uring_; // Outlives the sessions reading on it
+  std::vector<std::unique_ptr<Session>> sessions_;
+  std::vector<Session *> busy_; // Sessions in the current round
+  int next_id_ = 1;
+};
+
+} // namespace tide::core
@@ -0,0 +1,110 @@
+#include "core/spill_file.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace tide::core {
+
+SpillFile::~SpillFile() { close(); }
+
+bool SpillFile::open() {
+  if (fd_ >= 0) {
+    return true;
+  }
+
+  const char *dir = std::getenv("TMPDIR");
+  if (!dir || dir[0] == '\0') {
+    dir = "/tmp";
+  }
+
+  std::string path = std::string(dir) + "/tide-scrollback-XXXXXX";
+  fd_ = mkstemp(path.data());
+  if (fd_ < 0) {
+    std::cerr << "[tide] Failed to create scrollback spill file: "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  // Unlink immediately so the file goes away with the process
+  unlink(path.c_str());
+  return true;
+}
+
+void SpillFile::close() {
+  for (uint8_t *segment : segments_) {
+    if (segment) {
+      munmap(segment, SEGMENT_SIZE);
+    }
+  }
+  segments_.clear();
+
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+}
+
+int64_t SpillFile::append(const uint8_t *data, size_t size) {
+  if (fd_ < 0 || size == 0 || size > SEGMENT_SIZE) {
+    return -1;
+  }
+
+  // Start a new segment rather than split the blob across two mappings
+  size_t used = size_ % SEGMENT_SIZE;
+  if (used + size > SEGMENT_SIZE) {
+    size_ += SEGMENT_SIZE - used;
+  }
+
+  size_t offset = size_;
+  size_t written = 0;
+  while (written < size) {
+    ssize_t n = pwrite(fd_, data + written, size - written,
+                       static_cast<off_t>(offset + written));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "[tide] Scrollback spill write failed: "
+                << std::strerror(errno) << std::endl;
+      return -1;
+    }
+    written += static_cast<size_t>(n);
+  }
+
+  size_ = offset + size;
+  return static_cast<int64_t>(offset);
+}
+
+const uint8_t *SpillFile::data(int64_t offset, size_t size) {
+  if (fd_ < 0 || offset < 0 ||
+      static_cast<size_t>(offset) + size > size_) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(map_mutex_);
+  size_t index = static_cast<size_t>(offset) / SEGMENT_SIZE;
+  if (index >= segments_.size()) {
+    segments_.resize(index + 1, nullptr);
+  }
+
+  if (!segments_[index]) {
+    void *map = mmap(nullptr, SEGMENT_SIZE, PROT_READ, MAP_SHARED, fd_,
+                     static_cast<off_t>(index * SEGMENT_SIZE));
+    if (map == MAP_FAILED) {
+      std::cerr << "[tide] Scrollback spill mmap failed: "
+                << std::strerror(errno) << std::endl;
+      return nullptr;
+    }
+    segments_[index] = static_cast<uint8_t *>(map);
+  }
+
+  return segments_[index] + (static_cast<size_t>(offset) % SEGMENT_SIZE);
+}
+
+} // namespace tide::core
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Append-only temporary file that scrollback pages are spilled to.
+ *
+ * The file is unlinked right after creation, so it disappears when the
+ * process exits (or crashes). Data is read back through read-only mmap
+ * segments that are mapped on first access; the kernel can drop those pages
+ * under memory pressure since they are file-backed.
+ */
+class SpillFile {
+public:
+  static constexpr size_t SEGMENT_SIZE = 64 * 1024 * 1024;
+
+  SpillFile() = default;
+  ~SpillFile();
+
+  // Non-copyable
+  SpillFile(const SpillFile &) = delete;
+  SpillFile &operator=(const SpillFile &) = delete;
+
+  /**
+   * Create the backing file in $TMPDIR (or /tmp).
+   * @return true if the file was created
+   */
+  bool open();
+
+  /**
+   * Append a blob. Blobs never straddle a mapping segment.
+   * @return File offset of the blob, or -1 on error
+   */
+  int64_t append(const uint8_t *data, size_t size);
+
+  /**
+   * Get a pointer to a previously appended blob.
+   * Safe to call from several reader threads while nothing is appended.
+   * @return Pointer valid for the lifetime of the file, or nullptr on error
+   */
+  [[nodiscard]] const uint8_t *data(int64_t offset, size_t size);
+
+  [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+
+  /**
+   * Bytes written to the file so far (including segment padding).
+   */
+  [[nodiscard]] size_t size() const { return size_; }
+
+private:
+  int fd_ = -1;
+  size_t size_ = 0;
+  std::vector<uint8_t *> segments_; // nullptr until mapped
+  std::mutex map_mutex_;            // Guards lazy mapping of segments_
+
+  void close();
+};
+
+} // namespace tide::core
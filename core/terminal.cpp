@@ -1,10 +1,36 @@
 #include "core/terminal.hpp"
 
+#include "core/text_export.hpp"
+
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <optional>
+#include <type_traits>
 
 namespace tide::core {
 
+namespace {
+
+template <typename T> void put(std::vector<uint8_t> &out, const T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T> bool get(const uint8_t *&p, const uint8_t *end, T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  if (static_cast<size_t>(end - p) < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(&value, p, sizeof(T));
+  p += sizeof(T);
+  return true;
+}
+
+} // anonymous namespace
+
 Terminal::Terminal(int cols, int rows)
     : grid_(cols, rows), theme_(theme::get_default_theme()),
       current_attrs_(theme_) {}
@@ -13,9 +39,15 @@ void Terminal::set_theme(const theme::Theme &theme) {
   theme_ = theme;
   current_attrs_.foreground = theme.foreground;
   current_attrs_.background = theme.background;
+  add_replay_checkpoint();
 }
 
 void Terminal::feed(const char *data, size_t size) {
+  if (history_mode_ == HistoryMode::Replay && !capture_) {
+    feed_recorded(data, size);
+    return;
+  }
+
   for (size_t i = 0; i < size; ++i) {
     process_byte(static_cast<uint8_t>(data[i]));
   }
@@ -24,6 +56,10 @@ void Terminal::feed(const char *data, size_t size) {
 void Terminal::resize(int cols, int rows) {
   grid_.resize(cols, rows);
   clamp_cursor();
+  // Decoded at the old width, even where the slot count comes out the same
+  view_lines_.assign(view_lines_.size(), NO_VIEW_LINE);
+  // Replays must switch size at exactly this point in the stream
+  add_replay_checkpoint();
 }
 
 void Terminal::process_byte(uint8_t byte) {
@@ -49,6 +85,9 @@ void Terminal::process_byte(uint8_t byte) {
   case State::OSC_String:
     state_osc_string(byte);
     break;
+  case State::OSC_Escape:
+    state_osc_escape(byte);
+    break;
   }
 }
 
@@ -161,17 +200,70 @@ void Terminal::state_csi_param(uint8_t byte) {
 void Terminal::state_osc_string(uint8_t byte) {
   if (byte == 0x07) {
     // BEL terminates OSC
-    // TODO: Process OSC command (e.g., set window title)
+    osc_dispatch();
     state_ = State::Ground;
   } else if (byte == 0x1B) {
     // Might be ESC \ (ST)
-    // TODO: Handle properly
-    state_ = State::Ground;
-  } else {
+    state_ = State::OSC_Escape;
+  } else if (osc_buffer_.size() < MAX_OSC_LENGTH) {
     osc_buffer_ += static_cast<char>(byte);
   }
 }
 
+void Terminal::state_osc_escape(uint8_t byte) {
+  if (byte == '\\') {
+    osc_dispatch();
+    state_ = State::Ground;
+    return;
+  }
+
+  // Any other ESC sequence aborts the OSC string
+  state_ = State::Escape;
+  state_escape(byte);
+}
+
+void Terminal::osc_dispatch() {
+  // OSC 0 / 2 ; <text> - icon name and window title / window title
+  if (osc_buffer_.size() >= 2 &&
+      (osc_buffer_[0] == '0' || osc_buffer_[0] == '2') &&
+      osc_buffer_[1] == ';') {
+    title_.assign(osc_buffer_, 2);
+    return;
+  }
+
+  // OSC 133 ; <kind> [; <exit code>] - semantic prompt marks
+  if (capture_ || osc_buffer_.size() < 5 ||
+      osc_buffer_.compare(0, 4, "133;") != 0) {
+    return;
+  }
+
+  PromptMark mark;
+  mark.line = history_base() + history_size() +
+              static_cast<uint64_t>(cursor_row_);
+  mark.col = std::min(cursor_col_, grid_.cols() - 1);
+
+  switch (osc_buffer_[4]) {
+  case 'A':
+    mark.kind = MarkKind::PromptStart;
+    break;
+  case 'B':
+    mark.kind = MarkKind::CommandStart;
+    break;
+  case 'C':
+    mark.kind = MarkKind::OutputStart;
+    break;
+  case 'D':
+    mark.kind = MarkKind::CommandEnd;
+    if (osc_buffer_.size() > 6 && osc_buffer_[5] == ';') {
+      mark.exit_code = std::atoi(osc_buffer_.c_str() + 6);
+    }
+    break;
+  default:
+    return;
+  }
+  prompt_marks_.add(mark);
+}
+
 void Terminal::execute(uint8_t byte) {
   switch (byte) {
   case 0x07: // BEL - Bell
@@ -190,6 +282,9 @@ void Terminal::execute(uint8_t byte) {
   case 0x0B: // VT - Vertical Tab
   case 0x0C: // FF - Form Feed
     linefeed();
+    if (newline_mode_) {
+      carriage_return();
+    }
     break;
   case 0x0D: // CR - Carriage Return
     carriage_return();
@@ -264,10 +359,10 @@ void Terminal::csi_dispatch(uint8_t final_byte) {
     select_graphic_rendition();
     break;
   case 'h': // SM / DECSET - Set Mode
-    // TODO: Handle modes
+    set_modes(true);
     break;
   case 'l': // RM / DECRST - Reset Mode
-    // TODO: Handle modes
+    set_modes(false);
     break;
   case 'r': // DECSTBM - Set Top and Bottom Margins
     // TODO: Scrolling region
@@ -286,11 +381,19 @@ void Terminal::csi_dispatch(uint8_t final_byte) {
 
 void Terminal::print(char32_t codepoint) {
   if (cursor_col_ >= grid_.cols()) {
-    // Line wrap
-    carriage_return();
-    linefeed();
+    if (autowrap_) {
+      // Line wrap; remember it so copies can join the rows again
+      grid_.set_wrapped(cursor_row_, true);
+      carriage_return();
+      linefeed();
+    } else {
+      cursor_col_ = grid_.cols() - 1; // Overwrite the last column
+    }
   }
 
+  if (insert_mode_) {
+    insert_chars(1);
+  }
   grid_.set(cursor_col_, cursor_row_, make_cell(codepoint));
   cursor_col_++;
 }
@@ -367,6 +470,7 @@ void Terminal::erase_line(int mode) {
     for (int col = cursor_col_; col < grid_.cols(); ++col) {
       grid_.set(col, cursor_row_, blank);
     }
+    grid_.set_wrapped(cursor_row_, false);
     break;
   case 1: // Erase from start of line to cursor
     for (int col = 0; col <= cursor_col_; ++col) {
@@ -420,52 +524,57 @@ void Terminal::insert_chars(int n) {
 }
 
 void Terminal::scroll_up(int n) {
-  Cell blank = make_cell(U' ');
   int rows = grid_.rows();
   int cols = grid_.cols();
 
-  // Save top lines to scrollback before discarding
+  // Save top lines to history before discarding (rows are contiguous)
   for (int i = 0; i < n && i < rows; ++i) {
-    std::vector<Cell> line(cols);
-    for (int col = 0; col < cols; ++col) {
-      line[col] = grid_.at(col, i);
-    }
-    scrollback_.push_back(std::move(line));
-
-    // Trim scrollback if too large
-    if (static_cast<int>(scrollback_.size()) > MAX_SCROLLBACK) {
-      scrollback_.erase(scrollback_.begin());
-    }
-  }
-
-  // Move lines up
-  for (int row = 0; row < rows - n; ++row) {
-    for (int col = 0; col < cols; ++col) {
-      grid_.set(col, row, grid_.at(col, row + n));
-    }
+    push_history(&grid_.at(0, i), cols, grid_.wrapped(i));
   }
 
-  // Clear bottom lines
-  for (int row = rows - n; row < rows; ++row) {
-    grid_.clear_row(row, blank);
-  }
+  grid_.scroll_up(n, make_cell(U' '));
 }
 
 void Terminal::scroll_down(int n) {
-  Cell blank = make_cell(U' ');
-  int rows = grid_.rows();
-  int cols = grid_.cols();
+  grid_.scroll_down(n, make_cell(U' '));
+}
 
-  // Move lines down
-  for (int row = rows - 1; row >= n; --row) {
-    for (int col = 0; col < cols; ++col) {
-      grid_.set(col, row, grid_.at(col, row - n));
+void Terminal::set_modes(bool enable) {
+  if (intermediate_ != '?') {
+    for (int i = 0; i < param_count_; ++i) {
+      switch (params_[i]) {
+      case 4: // IRM - Insert mode
+        insert_mode_ = enable;
+        break;
+      case 20: // LNM - Line feed / new line mode
+        newline_mode_ = enable;
+        break;
+      default:
+        break; // Not settable here
+      }
     }
+    return;
   }
 
-  // Clear top lines
-  for (int row = 0; row < n; ++row) {
-    grid_.clear_row(row, blank);
+  for (int i = 0; i < param_count_; ++i) {
+    switch (params_[i]) {
+    case 7: // DECAWM - Autowrap
+      autowrap_ = enable;
+      break;
+    case 25: // DECTCEM - Cursor visible
+      cursor_shown_ = enable;
+      break;
+    case 47:
+    case 1047:
+    case 1049: // Alternate screen
+      alternate_screen_ = enable;
+      break;
+    case 2004: // Bracketed paste
+      bracketed_paste_ = enable;
+      break;
+    default:
+      break; // Mouse reporting, application keys etc. are not supported
+    }
   }
 }
 
@@ -666,14 +775,215 @@ void Terminal::scroll_view(int lines) {
   scroll_offset_ += lines;
 
   // Clamp to valid range
-  int max_offset = static_cast<int>(scrollback_.size());
+  int max_offset = max_scroll();
   scroll_offset_ = std::clamp(scroll_offset_, 0, max_offset);
+
+  // Decompress the screen above the view so continued scrolling never stalls
+  if (scroll_offset_ > 0 && history_mode_ == HistoryMode::Cells) {
+    int top = max_offset - scroll_offset_;
+    int rows = grid_.rows();
+    scrollback_.prefetch(static_cast<size_t>(std::max(0, top - rows)),
+                         static_cast<size_t>(top + rows));
+  }
 }
 
 void Terminal::scroll_to_bottom() { scroll_offset_ = 0; }
 
+void Terminal::scroll_to_line(uint64_t line) {
+  uint64_t live_top = history_base() + history_size();
+  int offset = line >= live_top
+                   ? 0
+                   : static_cast<int>(std::min<uint64_t>(
+                         live_top - line, static_cast<uint64_t>(max_scroll())));
+  scroll_view(offset - scroll_offset_);
+}
+
+bool Terminal::jump_to_prompt(int direction) {
+  uint64_t top = line_at_row(0);
+  std::optional<PromptMark> mark =
+      direction < 0 ? prompt_marks_.previous(MarkKind::PromptStart, top)
+                    : prompt_marks_.next(MarkKind::PromptStart, top);
+  if (!mark && direction > 0 && scroll_offset_ > 0) {
+    scroll_to_bottom(); // Past the last prompt
+    return true;
+  }
+  if (!mark || mark->line < history_base()) {
+    return false;
+  }
+  int before = scroll_offset_;
+  scroll_to_line(mark->line);
+  return scroll_offset_ != before;
+}
+
+bool Terminal::last_command_output(TextRange &range) const {
+  uint64_t cursor_line = history_base() + history_size() +
+                         static_cast<uint64_t>(cursor_row_);
+  return prompt_marks_.last_output(cursor_line, range) &&
+         range.start_line >= history_base();
+}
+
+void Terminal::set_history_mode(HistoryMode mode) {
+  history_mode_ = mode;
+  scrollback_.clear();
+  replay_.clear();
+  prompt_marks_.clear();
+  view_lines_.assign(view_lines_.size(), NO_VIEW_LINE); // Numbers restart
+  scroll_offset_ = 0;
+  add_replay_checkpoint();
+}
+
+void Terminal::push_history(const Cell *row, int cols, bool wrapped) {
+  if (capture_) {
+    capture_->push_back(CompactLine::encode(row, cols, wrapped));
+  } else {
+    if (history_mode_ == HistoryMode::Replay) {
+      replay_.add_line();
+    } else {
+      scrollback_.push(row, cols, wrapped);
+    }
+    // Either store may have dropped its oldest lines (the budget trims
+    // them between feeds); their marks go with them
+    prompt_marks_.trim(history_base());
+  }
+}
+
+void Terminal::feed_recorded(const char *data, size_t size) {
+  size_t recorded = 0;
+  for (size_t i = 0; i < size; ++i) {
+    process_byte(static_cast<uint8_t>(data[i]));
+
+    if (replay_.lines_since_checkpoint() >= ReplayHistory::CHECKPOINT_LINES) {
+      replay_.record(data + recorded, i + 1 - recorded);
+      recorded = i + 1;
+      add_replay_checkpoint();
+    }
+  }
+  replay_.record(data + recorded, size - recorded);
+}
+
+void Terminal::add_replay_checkpoint() {
+  if (history_mode_ == HistoryMode::Replay && !capture_) {
+    replay_.add_checkpoint(save_state());
+  }
+}
+
+const CompactLine &Terminal::history_line(size_t index) const {
+  if (history_mode_ == HistoryMode::Cells) {
+    return scrollback_.line(index);
+  }
+
+  static const CompactLine empty_line;
+  if (index >= replay_.size() || replay_.checkpoints().empty()) {
+    return empty_line;
+  }
+
+  uint64_t line = replay_.first_line() + index;
+  size_t checkpoint = replay_.checkpoint_for_line(line);
+  const ReplayHistory::Segment *segment = replay_.cached_segment(checkpoint);
+  if (!segment) {
+    segment = &rebuild_segment(checkpoint);
+  }
+
+  size_t offset =
+      static_cast<size_t>(line - replay_.checkpoints()[checkpoint].lines);
+  return offset < segment->lines.size() ? segment->lines[offset] : empty_line;
+}
+
+const ReplayHistory::Segment &
+Terminal::rebuild_segment(size_t checkpoint) const {
+  ReplayHistory::Segment segment;
+  segment.checkpoint = checkpoint;
+  segment.end_offset = replay_.segment_end(checkpoint);
+
+  // Re-run a scratch terminal over the segment's bytes, capturing every line
+  // that scrolls off. Parsing is deterministic, so this reproduces history.
+  Terminal scratch(grid_.cols(), grid_.rows());
+  scratch.theme_ = theme_;
+  scratch.capture_ = &segment.lines;
+
+  std::vector<uint8_t> state = replay_.checkpoint_state(checkpoint);
+  if (scratch.restore_state(state.data(), state.size())) {
+    std::string bytes;
+    replay_.read(replay_.checkpoints()[checkpoint].offset, segment.end_offset,
+                 bytes);
+    scratch.feed(bytes.data(), bytes.size());
+  }
+
+  scratch.capture_ = nullptr;
+  return replay_.cache_segment(std::move(segment));
+}
+
+std::vector<uint8_t> Terminal::save_state() const {
+  std::vector<uint8_t> out;
+  int cols = grid_.cols();
+  int rows = grid_.rows();
+
+  put(out, cols);
+  put(out, rows);
+  put(out, cursor_col_);
+  put(out, cursor_row_);
+  put(out, state_);
+  put(out, current_attrs_);
+  put(out, params_);
+  put(out, param_count_);
+  put(out, current_param_);
+  put(out, has_param_);
+  put(out, intermediate_);
+  put(out, insert_mode_);
+  put(out, newline_mode_);
+  put(out, autowrap_);
+  put(out, static_cast<uint32_t>(osc_buffer_.size()));
+  out.insert(out.end(), osc_buffer_.begin(), osc_buffer_.end());
+
+  for (int row = 0; row < rows; ++row) {
+    CompactLine::encode(&grid_.at(0, row), cols, grid_.wrapped(row))
+        .serialize(out);
+  }
+  return out;
+}
+
+bool Terminal::restore_state(const uint8_t *data, size_t size) {
+  const uint8_t *p = data;
+  const uint8_t *end = data + size;
+
+  int cols = 0, rows = 0;
+  uint32_t osc_len = 0;
+  if (!get(p, end, cols) || !get(p, end, rows) || cols <= 0 || rows <= 0 ||
+      !get(p, end, cursor_col_) || !get(p, end, cursor_row_) ||
+      !get(p, end, state_) || !get(p, end, current_attrs_) ||
+      !get(p, end, params_) || !get(p, end, param_count_) ||
+      !get(p, end, current_param_) || !get(p, end, has_param_) ||
+      !get(p, end, intermediate_) || !get(p, end, insert_mode_) ||
+      !get(p, end, newline_mode_) || !get(p, end, autowrap_) ||
+      !get(p, end, osc_len) ||
+      osc_len > static_cast<size_t>(end - p)) {
+    return false;
+  }
+  osc_buffer_.assign(reinterpret_cast<const char *>(p), osc_len);
+  p += osc_len;
+
+  grid_ = GridBuffer(cols, rows);
+  for (int row = 0; row < rows; ++row) {
+    CompactLine line;
+    if (!CompactLine::deserialize(p, end, line)) {
+      return false;
+    }
+    line.decode(&grid_.at(0, row), cols);
+    grid_.set_wrapped(row, line.wrapped());
+  }
+  return true;
+}
+
+bool Terminal::set_unlimited_scrollback(size_t resident_limit) {
+  if (!scrollback_.enable_spill(resident_limit)) {
+    return false;
+  }
+  scrollback_.set_max_lines(Scrollback::UNLIMITED);
+  return true;
+}
+
 const Cell *Terminal::get_visible_row(int visual_row) const {
-  int scrollback_size = static_cast<int>(scrollback_.size());
+  int scrollback_size = max_scroll();
   int rows = grid_.rows();
 
   // Calculate which row to display
@@ -698,7 +1008,7 @@ const Cell *Terminal::get_visible_row(int visual_row) const {
     // This row comes from scrollback
     int scrollback_idx = scrollback_start + visual_row;
     if (scrollback_idx >= 0 && scrollback_idx < scrollback_size) {
-      return scrollback_[scrollback_idx].data();
+      return history_row(static_cast<size_t>(scrollback_idx));
     }
     return nullptr;
   } else {
@@ -711,56 +1021,85 @@ const Cell *Terminal::get_visible_row(int visual_row) const {
   }
 }
 
+const Cell *Terminal::history_row(size_t index) const {
+  // Line n lives in slot n % (rows + 1), so lines still on screen after a
+  // scroll keep their slot and are not decoded again. The extra slot holds
+  // the line above the view.
+  int cols = grid_.cols();
+  auto slots = static_cast<size_t>(grid_.rows() + 1);
+  if (view_cells_.size() != slots * static_cast<size_t>(cols)) {
+    view_cells_.resize(slots * static_cast<size_t>(cols));
+    view_lines_.assign(slots, NO_VIEW_LINE);
+  }
+  uint64_t line = history_base() + index;
+  auto slot = static_cast<size_t>(line % slots);
+  Cell *out = view_cells_.data() + slot * static_cast<size_t>(cols);
+  if (view_lines_[slot] != line) {
+    history_line(index).decode(out, cols);
+    view_lines_[slot] = line;
+  }
+  return out;
+}
+
+void Terminal::view(ScreenView &out) const {
+  uint64_t top = line_at_row(0);
+  out.reset(grid_.cols(), grid_.rows(), top);
+  for (int row = 0; row < grid_.rows(); ++row) {
+    out.set_row(row, get_visible_row(row), visible_row_key(row));
+  }
+
+  // Lines above the grid are always history
+  uint64_t base = history_base();
+  if (top > base) {
+    out.set_above(history_row(static_cast<size_t>(top - 1 - base)),
+                  HISTORY_ROW_KEY | (top - 1));
+  }
+}
+
 // Selection methods
-void Terminal::start_selection(int col, int row) {
+void Terminal::start_selection(int col, int visual_row) {
   selection_.start_col = col;
-  selection_.start_row = row;
+  selection_.start_line = line_at_row(visual_row);
   selection_.end_col = col;
-  selection_.end_row = row;
+  selection_.end_line = selection_.start_line;
   selection_.active = true;
 }
 
-void Terminal::update_selection(int col, int row) {
+void Terminal::update_selection(int col, int visual_row) {
   if (!selection_.active)
     return;
   selection_.end_col = col;
-  selection_.end_row = row;
+  selection_.end_line = line_at_row(visual_row);
 }
 
 void Terminal::clear_selection() {
   selection_.active = false;
-  selection_.start_col = selection_.start_row = 0;
-  selection_.end_col = selection_.end_row = 0;
+  selection_.start_col = selection_.end_col = 0;
+  selection_.start_line = selection_.end_line = 0;
 }
 
-bool Terminal::is_selected(int col, int row) const {
+void Terminal::selection_spans(std::vector<ColumnSpan> &spans) const {
+  int rows = grid_.rows();
+  spans.assign(static_cast<size_t>(rows), ColumnSpan{});
   if (!selection_.active)
-    return false;
+    return;
 
   Selection sel = selection_;
   sel.normalize();
 
-  // Check if row is within selection range
-  if (row < sel.start_row || row > sel.end_row)
-    return false;
-
-  if (sel.start_row == sel.end_row) {
-    // Single line selection
-    return col >= sel.start_col && col <= sel.end_col;
-  }
-
-  if (row == sel.start_row) {
-    // First line: from start_col to end of line
-    return col >= sel.start_col;
-  }
+  uint64_t top = line_at_row(0);
+  if (sel.end_line < top || sel.start_line >= top + static_cast<uint64_t>(rows))
+    return;
 
-  if (row == sel.end_row) {
-    // Last line: from start to end_col
-    return col <= sel.end_col;
+  // Only rows inside the selection are visited
+  int first = sel.start_line > top ? static_cast<int>(sel.start_line - top) : 0;
+  int last = std::min(rows - 1, static_cast<int>(sel.end_line - top));
+  for (int row = first; row <= last; ++row) {
+    uint64_t line = top + static_cast<uint64_t>(row);
+    ColumnSpan &span = spans[static_cast<size_t>(row)];
+    span.start = line == sel.start_line ? sel.start_col : 0;
+    span.end = line == sel.end_line ? sel.end_col + 1 : grid_.cols();
   }
-
-  // Middle lines: fully selected
-  return true;
 }
 
 std::string Terminal::get_selected_text() const {
@@ -770,33 +1109,15 @@ std::string Terminal::get_selected_text() const {
   Selection sel = selection_;
   sel.normalize();
 
-  std::string result;
-  int cols = grid_.cols();
-
-  for (int row = sel.start_row; row <= sel.end_row; ++row) {
-    int start_col = (row == sel.start_row) ? sel.start_col : 0;
-    int end_col = (row == sel.end_row) ? sel.end_col : cols - 1;
-
-    for (int col = start_col; col <= end_col; ++col) {
-      const Cell &cell = grid_.at(col, row);
-      // Simple ASCII conversion for now
-      if (cell.codepoint < 128 && cell.codepoint >= 32) {
-        result += static_cast<char>(cell.codepoint);
-      } else if (cell.codepoint == U' ' || cell.codepoint == 0) {
-        result += ' ';
-      }
-    }
-
-    // Add newline between lines (but not after last)
-    if (row < sel.end_row) {
-      // Trim trailing spaces before newline
-      while (!result.empty() && result.back() == ' ') {
-        result.pop_back();
-      }
-      result += '\n';
-    }
-  }
+  TextRange range;
+  range.start_line = sel.start_line;
+  range.start_col = sel.start_col;
+  range.end_line = sel.end_line;
+  range.end_col = sel.end_col + 1; // Selection end is inclusive
 
+  std::string result;
+  StringSink sink(result);
+  export_text(*this, range, sink);
   return result;
 }
 
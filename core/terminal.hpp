@@ -1,6 +1,10 @@
 #pragma once
 
 #include "core/grid_buffer.hpp"
+#include "core/prompt_marks.hpp"
+#include "core/replay_history.hpp"
+#include "core/screen_view.hpp"
+#include "core/scrollback.hpp"
 #include "theme/theme.hpp"
 
 #include <cstdint>
@@ -31,6 +35,14 @@ struct Attributes {
       : foreground(theme.foreground), background(theme.background) {}
 };
 
+/**
+ * How lines that scroll off the grid are stored.
+ */
+enum class HistoryMode {
+  Cells,  // Compact cell lines in a Scrollback
+  Replay, // Raw PTY bytes re-parsed on demand (experimental)
+};
+
 /**
  * Terminal emulator - manages grid, cursor, and processes parsed commands.
  */
@@ -84,6 +96,11 @@ public:
    */
   void scroll_to_bottom();
 
+  /**
+   * Scroll so an absolute line is at the top of the view (clamped).
+   */
+  void scroll_to_line(uint64_t line);
+
   /**
    * Get current scroll offset (0 = at bottom/live).
    */
@@ -93,7 +110,7 @@ public:
    * Get maximum scroll offset (scrollback size).
    */
   [[nodiscard]] int max_scroll() const {
-    return static_cast<int>(scrollback_.size());
+    return static_cast<int>(history_size());
   }
 
   /**
@@ -101,38 +118,210 @@ public:
    */
   [[nodiscard]] bool is_scrolled() const { return scroll_offset_ > 0; }
 
+  /**
+   * Check if the application asked for pastes wrapped in
+   * ESC [200~ ... ESC [201~ (DECSET 2004).
+   */
+  [[nodiscard]] bool bracketed_paste() const { return bracketed_paste_; }
+
+  /**
+   * Check if the application left the cursor visible (DECTCEM).
+   */
+  [[nodiscard]] bool cursor_shown() const { return cursor_shown_; }
+
+  /**
+   * Check if a full-screen application has the terminal: it asked for the
+   * alternate screen (DECSET 47/1047/1049), as editors and pagers do. Their
+   * keys are commands rather than text, so typing is not echoed where it
+   * would be at a prompt. Application cursor keys (DECSET 1) say nothing
+   * here: shells with readline turn them on at every prompt.
+   */
+  [[nodiscard]] bool full_screen_app() const { return alternate_screen_; }
+
+  /**
+   * Get the title the application set (OSC 0/2), empty if none.
+   */
+  [[nodiscard]] const std::string &title() const { return title_; }
+
+  /**
+   * Set the maximum number of history lines kept.
+   */
+  void set_scrollback_limit(size_t lines) { scrollback_.set_max_lines(lines); }
+
+  /**
+   * Keep all history, spilling old pages to a temporary file once more than
+   * `resident_limit` bytes of history are held in memory.
+   * @return false if the spill file could not be created
+   */
+  bool set_unlimited_scrollback(size_t resident_limit);
+
+  /**
+   * Label and foreground state reported to the process-wide HistoryBudget.
+   * Background terminals give up history memory first.
+   */
+  void set_name(const std::string &name) {
+    scrollback_.set_name(name);
+    replay_.set_name(name);
+  }
+  void set_active(bool active) {
+    scrollback_.set_active(active);
+    replay_.set_active(active);
+  }
+
+  /**
+   * Select the history store. Switching discards existing history.
+   */
+  void set_history_mode(HistoryMode mode);
+
+  [[nodiscard]] HistoryMode history_mode() const { return history_mode_; }
+
+  /**
+   * Get the scrollback history (Cells mode).
+   */
+  [[nodiscard]] const Scrollback &scrollback() const { return scrollback_; }
+
+  /**
+   * Get the raw-byte history (Replay mode).
+   */
+  [[nodiscard]] const ReplayHistory &replay_history() const {
+    return replay_;
+  }
+
+  /**
+   * Number of history lines, whichever store is active.
+   */
+  [[nodiscard]] size_t history_size() const {
+    return history_mode_ == HistoryMode::Replay
+               ? static_cast<size_t>(replay_.size())
+               : scrollback_.size();
+  }
+
+  /**
+   * Absolute line number of history line 0 (lines trimmed so far).
+   * Grid row r is line history_base() + history_size() + r.
+   */
+  [[nodiscard]] uint64_t history_base() const {
+    return history_mode_ == HistoryMode::Replay ? replay_.first_line()
+                                                : scrollback_.first_line();
+  }
+
+  /**
+   * Get a history line (0 = oldest), whichever store is active.
+   * The reference is valid until the next history access.
+   */
+  [[nodiscard]] const CompactLine &history_line(size_t index) const;
+
+  /**
+   * Bytes of history held in memory, whichever store is active.
+   */
+  [[nodiscard]] size_t history_memory_usage() const {
+    return history_mode_ == HistoryMode::Replay ? replay_.memory_usage()
+                                                : scrollback_.memory_usage();
+  }
+
+  /**
+   * Serialize parser, cursor and grid state (not history or theme).
+   */
+  [[nodiscard]] std::vector<uint8_t> save_state() const;
+
+  /**
+   * Restore state written by save_state(), resizing the grid to match.
+   * @return false if the data is malformed
+   */
+  bool restore_state(const uint8_t *data, size_t size);
+
   /**
    * Get a line for rendering (handles scrollback).
+   * History lines are expanded from their compact form into a ring of
+   * rows + 1 slots and reused while they stay on screen, so pointers to every
+   * row of one view (and the line above it) are valid together, until the
+   * view scrolls or the terminal changes.
    * @param visual_row Row on screen (0 = top)
    * @return Pointer to cells for that row
    */
   [[nodiscard]] const Cell *get_visible_row(int visual_row) const;
 
+  /**
+   * Point `out` at the rows on screen at the current scroll offset.
+   */
+  void view(ScreenView &out) const;
+
+  /**
+   * Absolute line shown on a screen row at the current scroll offset.
+   */
+  [[nodiscard]] uint64_t line_at_row(int visual_row) const {
+    return history_base() + history_size() -
+           static_cast<uint64_t>(scroll_offset_) +
+           static_cast<uint64_t>(visual_row);
+  }
+
+  /**
+   * Key identifying the content of a screen row, for per-row caches.
+   * History lines never change once pushed and are keyed by line number;
+   * grid rows by GridBuffer::generation(). Keys are only meaningful within
+   * one history mode.
+   */
+  [[nodiscard]] uint64_t visible_row_key(int visual_row) const {
+    uint64_t line = line_at_row(visual_row);
+    uint64_t grid_start = history_base() + history_size();
+    if (line < grid_start) {
+      return HISTORY_ROW_KEY | line;
+    }
+    return grid_.generation(static_cast<int>(line - grid_start));
+  }
+
+  // Shell integration (OSC 133)
+  /**
+   * Semantic prompt marks reported by the shell.
+   */
+  [[nodiscard]] const PromptMarks &prompt_marks() const {
+    return prompt_marks_;
+  }
+
+  /**
+   * Scroll the previous (direction < 0) or next prompt to the top of the
+   * view. Moving past the last prompt returns to the live view.
+   * @return false if the view did not move
+   */
+  bool jump_to_prompt(int direction);
+
+  /**
+   * Range of the most recent command's output.
+   * @return false if the shell has not marked any output
+   */
+  bool last_command_output(TextRange &range) const;
+
   // Selection interface
+  /**
+   * Selection anchored to absolute lines (see history_base()), so it stays
+   * on the same text while output scrolls. Both end columns are inclusive.
+   */
   struct Selection {
-    int start_col = 0, start_row = 0;
-    int end_col = 0, end_row = 0;
+    uint64_t start_line = 0;
+    int start_col = 0;
+    uint64_t end_line = 0;
+    int end_col = 0;
     bool active = false;
 
     // Normalize so start <= end
     void normalize() {
-      if (start_row > end_row ||
-          (start_row == end_row && start_col > end_col)) {
+      if (start_line > end_line ||
+          (start_line == end_line && start_col > end_col)) {
         std::swap(start_col, end_col);
-        std::swap(start_row, end_row);
+        std::swap(start_line, end_line);
       }
     }
   };
 
   /**
-   * Start a new selection at given position.
+   * Start a new selection at a screen position.
    */
-  void start_selection(int col, int row);
+  void start_selection(int col, int visual_row);
 
   /**
-   * Update selection end position.
+   * Update selection end to a screen position.
    */
-  void update_selection(int col, int row);
+  void update_selection(int col, int visual_row);
 
   /**
    * Clear current selection.
@@ -145,9 +334,10 @@ public:
   [[nodiscard]] const Selection &selection() const { return selection_; }
 
   /**
-   * Check if a cell is selected.
+   * Compute the selected columns of every screen row at the current scroll
+   * offset, one span per row (empty if the row is not selected).
    */
-  [[nodiscard]] bool is_selected(int col, int row) const;
+  void selection_spans(std::vector<ColumnSpan> &spans) const;
 
   /**
    * Get selected text.
@@ -163,6 +353,7 @@ private:
     CSI_Param,  // Collecting CSI parameters
     CSI_Ignore, // Ignoring until final byte
     OSC_String, // Operating System Command
+    OSC_Escape, // ESC inside an OSC string, awaiting the ST backslash
   };
 
   // Grid and state
@@ -175,10 +366,27 @@ private:
   int cursor_col_ = 0;
   int cursor_row_ = 0;
 
+  // ANSI modes
+  bool insert_mode_ = false;  // IRM: printing shifts the rest of the row
+  bool newline_mode_ = false; // LNM: line feed also returns the carriage
+
+  // DEC private modes
+  bool autowrap_ = true;
+  bool cursor_shown_ = true;
+  bool bracketed_paste_ = false;
+  bool alternate_screen_ = false; // Requested; the screen is not switched
+
   // Scrollback buffer
   static constexpr int MAX_SCROLLBACK = 10000;
-  std::vector<std::vector<Cell>> scrollback_;
+  Scrollback scrollback_{MAX_SCROLLBACK};
+  HistoryMode history_mode_ = HistoryMode::Cells;
+  ReplayHistory replay_;
+  std::vector<CompactLine> *capture_ = nullptr; // Replay target, if scratch
   int scroll_offset_ = 0; // 0 = at bottom (live view)
+  mutable std::vector<Cell> view_cells_; // Expanded history rows on screen
+  mutable std::vector<uint64_t> view_lines_; // Line held by each view slot
+  static constexpr uint64_t NO_VIEW_LINE = UINT64_MAX;
+  static constexpr uint64_t HISTORY_ROW_KEY = 1ULL << 63; // Above generations
 
   // Selection
   Selection selection_;
@@ -192,7 +400,19 @@ private:
   char intermediate_ = 0; // For '?' in CSI sequences
 
   // OSC buffer
+  static constexpr size_t MAX_OSC_LENGTH = 4096; // Longer strings are cut
   std::string osc_buffer_;
+  std::string title_;
+
+  // Shell integration
+  PromptMarks prompt_marks_;
+
+  // History
+  void push_history(const Cell *row, int cols, bool wrapped);
+  void feed_recorded(const char *data, size_t size);
+  void add_replay_checkpoint();
+  const ReplayHistory::Segment &rebuild_segment(size_t checkpoint) const;
+  const Cell *history_row(size_t index) const; // Via the view ring
 
   // State machine handlers
   void process_byte(uint8_t byte);
@@ -201,11 +421,13 @@ private:
   void state_csi_entry(uint8_t byte);
   void state_csi_param(uint8_t byte);
   void state_osc_string(uint8_t byte);
+  void state_osc_escape(uint8_t byte);
 
   // Terminal operations
   void print(char32_t codepoint);
   void execute(uint8_t byte); // Control characters
   void csi_dispatch(uint8_t final_byte);
+  void osc_dispatch();
 
   // Cursor movement
   void cursor_up(int n = 1);
@@ -231,6 +453,9 @@ private:
   // SGR (Select Graphic Rendition)
   void select_graphic_rendition();
 
+  // SM/RM and DECSET/DECRST
+  void set_modes(bool enable);
+
   // Helpers
   void reset_params();
   int get_param(int index, int default_value = 0) const;
@@ -0,0 +1,452 @@
+#include "core/terminal_server.hpp"
+
+#include "core/history_budget.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace tide::core {
+
+namespace {
+
+constexpr uint64_t LISTEN_EVENT = 0;
+constexpr uint64_t WAKE_EVENT = 1;
+
+} // anonymous namespace
+
+TerminalServer::TerminalServer() {
+  sessions_.set_notify([this] { wake(); });
+}
+
+TerminalServer::~TerminalServer() {
+  // Readers notify through wake_fd_ until they stop
+  sessions_.close_all();
+  for (auto &client : clients_) {
+    if (client->fd >= 0) {
+      ::close(client->fd);
+    }
+  }
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    ::unlink(path_.c_str());
+  }
+  if (wake_fd_ >= 0) {
+    ::close(wake_fd_);
+  }
+  if (epoll_fd_ >= 0) {
+    ::close(epoll_fd_);
+  }
+}
+
+bool TerminalServer::listen(const std::string &path) {
+  int fd = listen_socket(path);
+  if (fd < 0) {
+    return false;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  epoll_event listen_event{};
+  listen_event.events = EPOLLIN;
+  listen_event.data.u64 = LISTEN_EVENT;
+  epoll_event wake_event{};
+  wake_event.events = EPOLLIN;
+  wake_event.data.u64 = WAKE_EVENT;
+  if (epoll_fd_ < 0 || wake_fd_ < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &listen_event) < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event) < 0) {
+    std::cerr << "[tide] Failed to set up server polling: "
+              << std::strerror(errno) << std::endl;
+    ::close(fd);
+    ::unlink(path.c_str());
+    return false;
+  }
+  listen_fd_ = fd;
+  path_ = path;
+  return true;
+}
+
+void TerminalServer::wake() {
+  uint64_t one = 1;
+  (void)!::write(wake_fd_, &one, sizeof(one));
+}
+
+void TerminalServer::stop() {
+  stopping_.store(true);
+  wake();
+}
+
+void TerminalServer::run() {
+  using Clock = std::chrono::steady_clock;
+  int timeout = -1;
+
+  while (!stopping_.load()) {
+    epoll_event events[32];
+    int count = epoll_wait(epoll_fd_, events, 32, timeout);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "[tide] Server epoll_wait failed: " << std::strerror(errno)
+                << std::endl;
+      break;
+    }
+
+    for (int i = 0; i < count; ++i) {
+      uint64_t data = events[i].data.u64;
+      if (data == LISTEN_EVENT) {
+        accept_clients();
+        continue;
+      }
+      if (data == WAKE_EVENT) {
+        uint64_t value = 0;
+        (void)!::read(wake_fd_, &value, sizeof(value));
+        continue;
+      }
+      auto &client = *static_cast<Client *>(events[i].data.ptr);
+      if (client.fd >= 0 && (events[i].events & EPOLLOUT)) {
+        send(client);
+      }
+      if (client.fd >= 0 &&
+          (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        read_client(client);
+      }
+    }
+    remove_closed();
+
+    // Same rounds as the window: one slice per busy session, in parallel
+    sessions_.flush_input();
+    auto deadline = Clock::now() + PARSE_BUDGET;
+    while (true) {
+      bool more = sessions_.parse(PARSE_SLICE);
+      for (size_t i = 0; i < sessions_.size(); ++i) {
+        stats_.output_bytes += sessions_.at(i)->parsed();
+      }
+      for (auto &client : clients_) {
+        if (client->session && client->session->parsed() > 0) {
+          client->dirty = true;
+        }
+      }
+      if (!more || Clock::now() >= deadline) {
+        break;
+      }
+    }
+    close_finished();
+    HistoryBudget::instance().enforce();
+
+    auto now = Clock::now();
+    auto next = Clock::time_point::max();
+    send_frames(now, next);
+    remove_closed();
+    if (started_ && sessions_.empty()) {
+      std::cout << "[tide] Last session exited, stopping server" << std::endl;
+      break;
+    }
+
+    // Sleep until a socket or reader wakes us, or a held frame is due
+    if (sessions_.output_pending() || sessions_.input_pending()) {
+      timeout = 0;
+    } else if (next != Clock::time_point::max()) {
+      timeout = static_cast<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(next - now).count());
+    } else {
+      timeout = -1;
+    }
+  }
+
+  // Let clients see their EXITED before the sockets close
+  for (auto &client : clients_) {
+    if (client->fd >= 0) {
+      send(*client);
+    }
+  }
+}
+
+void TerminalServer::accept_clients() {
+  while (true) {
+    int fd = accept4(listen_fd_, nullptr, nullptr,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        std::cerr << "[tide] Server accept failed: " << std::strerror(errno)
+                  << std::endl;
+      }
+      return;
+    }
+
+    if (!same_user(fd)) {
+      std::cerr << "[tide] Refused a client of another user" << std::endl;
+      ::close(fd);
+      continue;
+    }
+
+    auto client = std::make_unique<Client>();
+    client->fd = fd;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = client.get();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      ::close(fd);
+      continue;
+    }
+    clients_.push_back(std::move(client));
+  }
+}
+
+void TerminalServer::read_client(Client &client) {
+  char buffer[64 * 1024];
+  while (client.fd >= 0) {
+    ssize_t n = ::read(client.fd, buffer, sizeof(buffer));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (n <= 0) {
+      close_client(client); // Detached; the session keeps running
+      return;
+    }
+
+    client.in.feed(buffer, static_cast<size_t>(n));
+    Message message{};
+    while (client.fd >= 0 && client.in.next(message)) {
+      if (!client.closing && !handle(client, message)) {
+        std::cerr << "[tide] Dropping a client after a bad message"
+                  << std::endl;
+        close_client(client);
+      }
+    }
+    if (client.in.failed()) {
+      close_client(client);
+    }
+  }
+}
+
+bool TerminalServer::handle(Client &client, const Message &message) {
+  const uint8_t *p = message.data;
+  const uint8_t *end = message.data + message.size;
+
+  if (message.type == MessageType::ATTACH) {
+    uint32_t id = 0;
+    uint16_t cols = 0, rows = 0;
+    if (!get_u32(p, end, id) || !get_u16(p, end, cols) ||
+        !get_u16(p, end, rows) || cols == 0 || rows == 0) {
+      return false;
+    }
+    attach(client, id, cols, rows);
+    return true;
+  }
+
+  Session *session = client.session;
+  if (!session) {
+    return false; // Everything else needs a session
+  }
+  switch (message.type) {
+  case MessageType::INPUT:
+    session->writer().write(reinterpret_cast<const char *>(p),
+                            message.size);
+    return true;
+  case MessageType::PASTE:
+    session->writer().paste(
+        std::string(reinterpret_cast<const char *>(p), message.size),
+        session->terminal().bracketed_paste());
+    return true;
+  case MessageType::RESIZE: {
+    uint16_t cols = 0, rows = 0;
+    if (!get_u16(p, end, cols) || !get_u16(p, end, rows) || cols == 0 ||
+        rows == 0) {
+      return false;
+    }
+    // The last window to resize wins; the others get full frames
+    session->resize(cols, rows);
+    for (auto &other : clients_) {
+      if (other->session == session) {
+        other->dirty = true;
+      }
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+Session *TerminalServer::create(int cols, int rows) {
+  Session *session = sessions_.create(cols, rows);
+  if (session) {
+    started_ = true;
+    if (setup_) {
+      setup_(*session);
+    }
+    std::cout << "[tide] Session " << session->id() << " started"
+              << std::endl;
+  }
+  return session;
+}
+
+void TerminalServer::attach(Client &client, uint32_t id, int cols,
+                            int rows) {
+  Session *session = nullptr;
+  if (id == ATTACH_NEW || (id == ATTACH_LATEST && sessions_.empty())) {
+    session = create(cols, rows);
+  } else if (id == ATTACH_LATEST) {
+    session = sessions_.at(sessions_.size() - 1);
+  } else {
+    for (size_t i = 0; i < sessions_.size(); ++i) {
+      if (static_cast<uint32_t>(sessions_.at(i)->id()) == id) {
+        session = sessions_.at(i);
+      }
+    }
+  }
+
+  std::vector<uint8_t> payload;
+  if (!session) {
+    put_u32(payload, 0);
+    append_message(client.out, MessageType::ATTACHED, payload.data(),
+                   payload.size());
+    client.closing = true;
+    send(client);
+    return;
+  }
+
+  session->resize(cols, rows);
+  for (auto &other : clients_) {
+    if (other->session == session) {
+      other->dirty = true; // Possibly a new size
+    }
+  }
+  client.session = session;
+  client.encoder.reset(); // Snapshot first
+  client.dirty = true;
+  put_u32(payload, static_cast<uint32_t>(session->id()));
+  append_message(client.out, MessageType::ATTACHED, payload.data(),
+                 payload.size());
+  send(client);
+}
+
+void TerminalServer::send_frames(std::chrono::steady_clock::time_point now,
+                                 std::chrono::steady_clock::time_point &next) {
+  for (auto &client : clients_) {
+    // A client still receiving the last frame gets the next one once it
+    // has caught up, covering everything in between
+    if (client->fd < 0 || !client->session || !client->dirty ||
+        client->out_offset < client->out.size()) {
+      continue;
+    }
+    auto due = client->last_frame + FRAME_INTERVAL;
+    if (now < due) {
+      next = std::min(next, due);
+      continue;
+    }
+    size_t before = client->out.size();
+    if (client->encoder.encode(client->session->terminal(), client->out)) {
+      stats_.frame_bytes += client->out.size() - before;
+      ++stats_.frames;
+      client->last_frame = now;
+    }
+    client->dirty = false;
+    send(*client);
+  }
+}
+
+void TerminalServer::close_finished() {
+  for (size_t i = sessions_.size(); i-- > 0;) {
+    Session *session = sessions_.at(i);
+    if (!session->finished()) {
+      continue;
+    }
+    // The PTY usually closes just before the child exits; the pidfd
+    // wakes us again once it has
+    std::optional<int> exit_status = session->exit_status();
+    if (!exit_status && session->pty().pid_fd() >= 0 &&
+        !session->reader().child_exited()) {
+      continue;
+    }
+    int32_t status = exit_status.value_or(-1);
+    std::cout << "[tide] Session " << session->id() << " exited with status "
+              << status << std::endl;
+
+    std::vector<uint8_t> payload;
+    put_u32(payload, static_cast<uint32_t>(status));
+    for (auto &client : clients_) {
+      if (client->session != session) {
+        continue;
+      }
+      // Show the last output before the exit
+      client->encoder.encode(session->terminal(), client->out);
+      append_message(client->out, MessageType::EXITED, payload.data(),
+                     payload.size());
+      client->session = nullptr;
+      client->closing = true;
+      send(*client);
+    }
+    sessions_.close(session);
+  }
+}
+
+void TerminalServer::send(Client &client) {
+  while (client.out_offset < client.out.size()) {
+    ssize_t n = ::send(client.fd, client.out.data() + client.out_offset,
+                       client.out.size() - client.out_offset, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      watch(client, true); // Finish once the client reads
+      return;
+    }
+    if (n < 0) {
+      close_client(client);
+      return;
+    }
+    client.out_offset += static_cast<size_t>(n);
+  }
+  client.out.clear();
+  client.out_offset = 0;
+  watch(client, false);
+  if (client.closing) {
+    close_client(client);
+  }
+}
+
+void TerminalServer::watch(Client &client, bool writing) {
+  if (client.writing == writing) {
+    return;
+  }
+  epoll_event event{};
+  event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  event.data.ptr = &client;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client.fd, &event);
+  client.writing = writing;
+}
+
+void TerminalServer::close_client(Client &client) {
+  if (client.fd < 0) {
+    return;
+  }
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client.fd, nullptr);
+  ::close(client.fd);
+  client.fd = -1;
+  client.session = nullptr;
+}
+
+void TerminalServer::remove_closed() {
+  clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                [](const std::unique_ptr<Client> &client) {
+                                  return client->fd < 0;
+                                }),
+                 clients_.end());
+}
+
+} // namespace tide::core
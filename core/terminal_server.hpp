@@ -0,0 +1,121 @@
+#pragma once
+
+#include "core/remote_protocol.hpp"
+#include "core/screen_diff.hpp"
+#include "core/session_manager.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Headless host for `tide --server`: owns the sessions and keeps their
+ * terminals and shells alive without any window. Windows attach over a
+ * Unix socket (see remote_protocol.hpp), get a snapshot of one session's
+ * screen and then compact damage frames (see ScreenEncoder), and may close
+ * and attach again later.
+ *
+ * Everything runs on the thread calling run(): one epoll loop over the
+ * listening socket, the clients, and an eventfd the session readers
+ * notify. Output is parsed in rounds as in the window. Each client gets at
+ * most one frame per FRAME_INTERVAL, and none while its socket still holds
+ * the last one, so a slow client sees one frame covering many screens of
+ * output instead of a queue of stale ones.
+ */
+class TerminalServer {
+public:
+  using SessionSetup = std::function<void(Session &)>;
+
+  static constexpr auto FRAME_INTERVAL = std::chrono::milliseconds(8);
+  static constexpr auto PARSE_BUDGET = std::chrono::milliseconds(8);
+  static constexpr size_t PARSE_SLICE = 64 * 1024;
+
+  /**
+   * Bytes parsed and bytes sent as frames, for judging diff bandwidth.
+   */
+  struct Stats {
+    uint64_t output_bytes = 0;
+    uint64_t frame_bytes = 0;
+    uint64_t frames = 0;
+  };
+
+  TerminalServer();
+  ~TerminalServer();
+
+  // Non-copyable
+  TerminalServer(const TerminalServer &) = delete;
+  TerminalServer &operator=(const TerminalServer &) = delete;
+
+  SessionManager &sessions() { return sessions_; }
+
+  /**
+   * Configure each new session (theme, scrollback) before it is shown.
+   */
+  void set_session_setup(SessionSetup setup) { setup_ = std::move(setup); }
+
+  /**
+   * Bind the socket; a stale one left by a dead server is replaced.
+   * @return false if another server is running or binding failed
+   */
+  bool listen(const std::string &path);
+
+  /**
+   * Serve until stop(), or until the last session exits.
+   */
+  void run();
+
+  /**
+   * Make run() return. Safe from other threads and signal handlers.
+   */
+  void stop();
+
+  [[nodiscard]] Stats stats() const { return stats_; }
+
+private:
+  struct Client {
+    int fd = -1;
+    MessageReader in;
+    std::vector<uint8_t> out;
+    size_t out_offset = 0; // Bytes of `out` already sent
+    bool writing = false;  // EPOLLOUT armed
+    Session *session = nullptr;
+    ScreenEncoder encoder;
+    bool dirty = false;   // Session changed since the last frame
+    bool closing = false; // Close once `out` is sent
+    std::chrono::steady_clock::time_point last_frame;
+  };
+
+  SessionManager sessions_;
+  SessionSetup setup_;
+  std::vector<std::unique_ptr<Client>> clients_;
+  std::string path_;
+  int listen_fd_ = -1;
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1; // eventfd: session output, stop()
+  std::atomic<bool> stopping_{false};
+  bool started_ = false; // A session has existed
+  Stats stats_;
+
+  void wake();
+  void accept_clients();
+  void read_client(Client &client);
+  bool handle(Client &client, const Message &message);
+  void attach(Client &client, uint32_t id, int cols, int rows);
+  Session *create(int cols, int rows);
+  void send(Client &client);
+  void close_client(Client &client);
+  void watch(Client &client, bool writing);
+  void send_frames(std::chrono::steady_clock::time_point now,
+                   std::chrono::steady_clock::time_point &next);
+  void close_finished();
+  void remove_closed();
+};
+
+} // namespace tide::core
@@ -0,0 +1,212 @@
+#include "core/text_export.hpp"
+
+#include "core/terminal.hpp"
+#include "core/utf8.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <vector>
+
+namespace tide::core {
+
+namespace {
+
+/**
+ * Encodes into a fixed buffer and hands full buffers to the sink.
+ */
+class Writer {
+public:
+  explicit Writer(TextSink &sink) : sink_(sink), buffer_(BUFFER_SIZE) {}
+
+  bool put(const char32_t *text, size_t count) {
+    while (count > 0) {
+      size_t n = std::min(count, CHUNK);
+      if (!reserve(n * UTF8_MAX_BYTES)) {
+        return false;
+      }
+      used_ += encode_utf8(text, n, buffer_.data() + used_);
+      text += n;
+      count -= n;
+    }
+    return true;
+  }
+
+  bool newline() {
+    if (!reserve(1)) {
+      return false;
+    }
+    buffer_[used_++] = '\n';
+    return true;
+  }
+
+  bool flush() {
+    if (used_ == 0) {
+      return true;
+    }
+    bool ok = sink_.write(buffer_.data(), used_);
+    used_ = 0;
+    return ok;
+  }
+
+private:
+  static constexpr size_t BUFFER_SIZE = 256 * 1024;
+  static constexpr size_t CHUNK = 4096; // Codepoints encoded per step
+
+  TextSink &sink_;
+  std::vector<char> buffer_;
+  size_t used_ = 0;
+
+  bool reserve(size_t bytes) {
+    return used_ + bytes <= buffer_.size() || flush();
+  }
+};
+
+bool is_blank(char32_t cp) { return cp == U' ' || cp == 0; }
+
+} // anonymous namespace
+
+bool FdSink::write(const char *data, size_t size) {
+  if (fd_ < 0) {
+    return false;
+  }
+
+  while (size > 0) {
+    ssize_t n = ::write(fd_, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Non-blocking pipe to a slow reader: wait for room
+        pollfd pfd{fd_, POLLOUT, 0};
+        poll(&pfd, 1, -1);
+        continue;
+      }
+      std::cerr << "[tide] Export write failed: " << std::strerror(errno)
+                << std::endl;
+      return false;
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+FileSink::FileSink(const std::string &path)
+    : FdSink(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644)) {
+  if (fd_ < 0) {
+    std::cerr << "[tide] Failed to open " << path << ": "
+              << std::strerror(errno) << std::endl;
+  }
+}
+
+FileSink::~FileSink() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool export_text(const Terminal &terminal, const TextRange &range,
+                 TextSink &sink, const ExportOptions &options) {
+  const GridBuffer &grid = terminal.grid();
+  uint64_t base = terminal.history_base();
+  size_t history = terminal.history_size();
+  uint64_t grid_start = base + history;
+  uint64_t total_end = grid_start + static_cast<uint64_t>(grid.rows());
+
+  uint64_t first = std::max(range.start_line, base);
+  uint64_t last = std::min(range.end_line, total_end - 1);
+  if (total_end == base || first > last) {
+    return true;
+  }
+
+  Writer out(sink);
+
+  auto emit = [&](uint64_t line, const char32_t *text, size_t size,
+                  bool wrapped) {
+    size_t from = 0;
+    size_t to = size;
+    if (line == range.start_line) {
+      from = std::min(static_cast<size_t>(std::max(range.start_col, 0)), size);
+    }
+    if (line == range.end_line) {
+      to = std::clamp(static_cast<size_t>(std::max(range.end_col, 0)), from,
+                      size);
+    }
+
+    bool joined = wrapped && options.join_wrapped && line != last;
+    if (!joined) {
+      while (to > from && is_blank(text[to - 1])) {
+        --to;
+      }
+    }
+
+    if (!out.put(text + from, to - from)) {
+      return false;
+    }
+    return line == last || joined || out.newline();
+  };
+
+  uint64_t line = first;
+
+  // History
+  if (line < grid_start) {
+    size_t index = static_cast<size_t>(line - base);
+
+    if (terminal.history_mode() == HistoryMode::Cells) {
+      // Whole pages at a time, bypassing the scrollback's view cache
+      const Scrollback &scrollback = terminal.scrollback();
+      std::vector<CompactLine> lines;
+      static const CompactLine empty_line;
+
+      while (index < history && line <= last) {
+        size_t page = scrollback.page_of(index);
+        size_t start = scrollback.page_start(page);
+        size_t end = page + 1 < scrollback.page_count()
+                         ? scrollback.page_start(page + 1)
+                         : history;
+        if (!scrollback.read_page(page, lines)) {
+          lines.clear(); // Unreadable page exports as blank lines
+        }
+
+        for (; index < end && line <= last; ++index, ++line) {
+          size_t offset = index - start;
+          const CompactLine &l =
+              offset < lines.size() ? lines[offset] : empty_line;
+          if (!emit(line, l.text().data(), l.text().size(), l.wrapped())) {
+            return false;
+          }
+        }
+      }
+    } else {
+      for (; index < history && line <= last; ++index, ++line) {
+        const CompactLine &l = terminal.history_line(index);
+        if (!emit(line, l.text().data(), l.text().size(), l.wrapped())) {
+          return false;
+        }
+      }
+    }
+  }
+
+  // Grid
+  std::vector<char32_t> text(static_cast<size_t>(grid.cols()));
+  for (; line <= last; ++line) {
+    int row = static_cast<int>(line - grid_start);
+    for (int col = 0; col < grid.cols(); ++col) {
+      text[static_cast<size_t>(col)] = grid.at(col, row).codepoint;
+    }
+    if (!emit(line, text.data(), text.size(), grid.wrapped(row))) {
+      return false;
+    }
+  }
+
+  return out.flush();
+}
+
+} // namespace tide::core
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tide::core {
+
+class Terminal;
+
+/**
+ * Destination for exported text.
+ */
+class TextSink {
+public:
+  virtual ~TextSink() = default;
+
+  /**
+   * Consume a chunk of UTF-8.
+   * @return false to abort the export
+   */
+  virtual bool write(const char *data, size_t size) = 0;
+};
+
+/**
+ * Appends to a caller-owned string.
+ */
+class StringSink final : public TextSink {
+public:
+  explicit StringSink(std::string &out) : out_(out) {}
+
+  bool write(const char *data, size_t size) override {
+    out_.append(data, size);
+    return true;
+  }
+
+private:
+  std::string &out_;
+};
+
+/**
+ * Writes to a file descriptor (pipe, pager, socket), retrying partial
+ * writes. The descriptor is not closed.
+ */
+class FdSink : public TextSink {
+public:
+  explicit FdSink(int fd) : fd_(fd) {}
+
+  bool write(const char *data, size_t size) override;
+
+protected:
+  int fd_;
+};
+
+/**
+ * Creates or truncates a file and writes to it.
+ */
+class FileSink final : public FdSink {
+public:
+  explicit FileSink(const std::string &path);
+  ~FileSink() override;
+
+  // Non-copyable
+  FileSink(const FileSink &) = delete;
+  FileSink &operator=(const FileSink &) = delete;
+
+  [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+};
+
+/**
+ * Range of absolute lines (see Terminal::history_base()).
+ * Lines are inclusive; columns are half-open and only apply to the first and
+ * last line.
+ */
+struct TextRange {
+  uint64_t start_line = 0;
+  int start_col = 0;
+  uint64_t end_line = UINT64_MAX;
+  int end_col = INT_MAX;
+};
+
+struct ExportOptions {
+  bool join_wrapped = true; // Rows ended by autowrap get no newline
+};
+
+/**
+ * Stream a range of the terminal's history and grid to a sink as UTF-8.
+ *
+ * Text is encoded into a fixed buffer and handed to the sink in chunks, so
+ * the whole range is never held in memory. Trailing blanks are trimmed from
+ * every line that ends with a newline. The range is clamped to the lines
+ * that still exist.
+ * @return false if the sink failed
+ */
+bool export_text(const Terminal &terminal, const TextRange &range,
+                 TextSink &sink, const ExportOptions &options = {});
+
+} // namespace tide::core
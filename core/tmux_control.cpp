@@ -0,0 +1,508 @@
+#include "core/tmux_control.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+namespace tide::core {
+
+namespace {
+
+constexpr std::string_view CONTROL_START = "\x1bP1000p"; // DCS tmux prints
+constexpr size_t SEND_KEYS_CHUNK = 256; // Bytes per send-keys command
+
+// Leaf of a window layout: a pane and its size
+struct LayoutPane {
+  int id;
+  int cols;
+  int rows;
+};
+
+bool starts_with(std::string_view s, std::string_view prefix) {
+  return s.substr(0, prefix.size()) == prefix;
+}
+
+// Consume a decimal number
+bool take_int(std::string_view &s, int &value) {
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  if (ec != std::errc()) {
+    return false;
+  }
+  s.remove_prefix(static_cast<size_t>(end - s.data()));
+  return true;
+}
+
+// Consume `c`
+bool take_char(std::string_view &s, char c) {
+  if (s.empty() || s.front() != c) {
+    return false;
+  }
+  s.remove_prefix(1);
+  return true;
+}
+
+// Consume an id such as %3, @1 or $0, and the space after it
+bool take_id(std::string_view &s, char sigil, int &id) {
+  if (!take_char(s, sigil) || !take_int(s, id)) {
+    return false;
+  }
+  take_char(s, ' ');
+  return true;
+}
+
+// A cell is "WxH,X,Y,ID" for a pane, or "WxH,X,Y{...}" / "WxH,X,Y[...]"
+// around cells side by side / stacked
+bool parse_cell(std::string_view &s, std::vector<LayoutPane> &panes) {
+  int cols, rows, x, y;
+  if (!take_int(s, cols) || !take_char(s, 'x') || !take_int(s, rows) ||
+      !take_char(s, ',') || !take_int(s, x) || !take_char(s, ',') ||
+      !take_int(s, y)) {
+    return false;
+  }
+  if (take_char(s, ',')) {
+    int id;
+    if (!take_int(s, id)) {
+      return false;
+    }
+    panes.push_back({id, cols, rows});
+    return true;
+  }
+  char close = take_char(s, '{') ? '}' : take_char(s, '[') ? ']' : '\0';
+  if (close == '\0') {
+    return false;
+  }
+  do {
+    if (!parse_cell(s, panes)) {
+      return false;
+    }
+  } while (take_char(s, ','));
+  return take_char(s, close);
+}
+
+// Layouts start with a checksum: "b25f,80x24,0,0,2"
+bool parse_layout(std::string_view layout, std::vector<LayoutPane> &panes) {
+  size_t comma = layout.find(',');
+  if (comma == std::string_view::npos) {
+    return false;
+  }
+  layout.remove_prefix(comma + 1);
+  return parse_cell(layout, panes);
+}
+
+// %output escapes control characters and backslashes as \ooo
+void unescape(std::string_view s, std::string &out) {
+  out.clear();
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (s[i] == '\\' && i + 3 < s.size()) {
+      int value = 0;
+      for (size_t k = 1; k <= 3; ++k) {
+        value = value * 8 + (s[i + k] - '0');
+      }
+      out.push_back(static_cast<char>(value));
+      i += 3;
+    } else {
+      out.push_back(s[i]);
+    }
+  }
+}
+
+} // anonymous namespace
+
+TmuxControl::~TmuxControl() { stop(); }
+
+bool TmuxControl::start(int cols, int rows, const PtyReader::Notify &notify,
+                        const std::vector<std::string> &args) {
+  std::vector<std::string> command = {"tmux", "-CC"};
+  command.insert(command.end(), args.begin(), args.end());
+  if (!pty_.spawn(command)) {
+    return false;
+  }
+  cols_ = cols;
+  rows_ = rows;
+  pty_.resize(cols, rows);
+
+  // Commands wait for the DCS: tmux reads none before control mode starts
+  reader_.set_notify(notify);
+  reader_.set_exit_fd(pty_.pid_fd());
+  if (!reader_.start(pty_.master_fd())) {
+    pty_.close();
+    return false;
+  }
+  writer_.set_fd(pty_.master_fd());
+  writer_.set_wait_writable([this] { reader_.notify_when_writable(); });
+  return true;
+}
+
+void TmuxControl::stop() {
+  reader_.stop();
+  writer_.set_fd(-1);
+  pty_.close();
+}
+
+bool TmuxControl::poll() {
+  changed_ = false;
+  stats_.control_bytes += reader_.drain(
+      [this](const char *data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+          if (data[i] != '\n') {
+            line_.push_back(data[i]);
+            continue;
+          }
+          if (!line_.empty() && line_.back() == '\r') {
+            line_.pop_back();
+          }
+          on_line(line_);
+          line_.clear();
+        }
+      },
+      POLL_SLICE);
+  return changed_;
+}
+
+void TmuxControl::send(std::string_view line, Reply reply, int pane) {
+  writer_.write(line);
+  writer_.write("\n", 1);
+  pending_.push_back({reply, pane});
+}
+
+void TmuxControl::command(std::string_view line) { send(line, Reply::None); }
+
+void TmuxControl::write(int pane, std::string_view data) {
+  // Hex, so no byte needs quoting
+  static constexpr char HEX[] = "0123456789abcdef";
+  while (!data.empty()) {
+    std::string line = "send-keys -t %" + std::to_string(pane) + " -H";
+    std::string_view chunk = data.substr(0, SEND_KEYS_CHUNK);
+    for (char c : chunk) {
+      auto byte = static_cast<uint8_t>(c);
+      line += ' ';
+      line += HEX[byte >> 4];
+      line += HEX[byte & 0xf];
+    }
+    send(line, Reply::None);
+    data.remove_prefix(chunk.size());
+  }
+}
+
+void TmuxControl::paste(int pane, std::string_view text) {
+  Pane *target = find_pane(pane);
+  if (!target || !target->terminal.bracketed_paste()) {
+    write(pane, text);
+    return;
+  }
+  // Drop end markers inside the text so it cannot end the paste early
+  constexpr std::string_view END = "\x1b[201~";
+  std::string bracketed = "\x1b[200~";
+  for (size_t at; (at = text.find(END)) != std::string_view::npos;) {
+    bracketed += text.substr(0, at);
+    text.remove_prefix(at + END.size());
+  }
+  bracketed += text;
+  bracketed += END;
+  write(pane, bracketed);
+}
+
+void TmuxControl::select(int pane) {
+  Pane *target = find_pane(pane);
+  if (!target) {
+    return;
+  }
+  // Known at once, so active_pane() does not flip back until tmux agrees
+  active_window_ = target->window;
+  window(target->window).active_pane = pane;
+  send("select-window -t @" + std::to_string(target->window), Reply::None);
+  send("select-pane -t %" + std::to_string(pane), Reply::None);
+}
+
+void TmuxControl::resize(int cols, int rows) {
+  cols_ = cols;
+  rows_ = rows;
+  if (control_) {
+    send("refresh-client -C " + std::to_string(cols) + "," +
+             std::to_string(rows),
+         Reply::None);
+  }
+}
+
+int TmuxControl::active_pane() const {
+  for (const Window &window : windows_) {
+    if (window.id == active_window_) {
+      return window.active_pane;
+    }
+  }
+  return -1;
+}
+
+TmuxControl::Pane *TmuxControl::find_pane(int id) {
+  size_t index = index_of(id);
+  return index < panes_.size() ? panes_[index].get() : nullptr;
+}
+
+size_t TmuxControl::index_of(int id) const {
+  for (size_t i = 0; i < panes_.size(); ++i) {
+    if (panes_[i]->id == id) {
+      return i;
+    }
+  }
+  return panes_.size();
+}
+
+TmuxControl::Window &TmuxControl::window(int id) {
+  for (Window &window : windows_) {
+    if (window.id == id) {
+      return window;
+    }
+  }
+  windows_.push_back({id, -1});
+  return windows_.back();
+}
+
+void TmuxControl::request_windows() {
+  // The pane of a window format is its current one
+  send("list-windows -F \"#{window_id} #{window_active} #{pane_id} "
+       "#{window_layout}\"",
+       Reply::Windows);
+}
+
+void TmuxControl::request_capture(int pane) {
+  // One line, so tmux runs both before reading the pane again: the
+  // capture and the cursor describe the same moment
+  std::string target = "-t %" + std::to_string(pane);
+  writer_.write("capture-pane -p -e -S - " + target +
+                " ; display-message -p " + target +
+                " \"#{cursor_x} #{cursor_y}\"\n");
+  pending_.push_back({Reply::Capture, pane});
+  pending_.push_back({Reply::Cursor, pane});
+}
+
+void TmuxControl::on_line(std::string_view line) {
+  if (!control_) {
+    size_t start = line.find(CONTROL_START);
+    if (start == std::string_view::npos) {
+      if (!line.empty()) {
+        std::cerr << "[tide] tmux: " << line << std::endl; // e.g. no sessions
+      }
+      return;
+    }
+    control_ = true;
+    line.remove_prefix(start + CONTROL_START.size());
+    resize(cols_, rows_);
+    request_windows();
+  }
+
+  if (in_block_) {
+    bool end = starts_with(line, "%end ");
+    bool error = starts_with(line, "%error ");
+    if ((end || error) && line.substr(line.find(' ') + 1) == block_tag_) {
+      in_block_ = false;
+      // Flags 1: a command of ours rather than the one tmux started with
+      // (whose errors, such as "no sessions", are still worth logging)
+      Pending pending{Reply::None, -1};
+      if (!block_tag_.empty() && block_tag_.back() == '1' &&
+          !pending_.empty()) {
+        pending = pending_.front();
+        pending_.pop_front();
+      }
+      on_reply(pending, error);
+      block_.clear();
+      return;
+    }
+    block_.emplace_back(line);
+    return;
+  }
+
+  if (starts_with(line, "%begin ")) {
+    in_block_ = true;
+    block_tag_ = line.substr(7);
+    return;
+  }
+  on_notification(line);
+}
+
+void TmuxControl::on_notification(std::string_view line) {
+  int id = 0;
+  if (starts_with(line, "%output ")) {
+    line.remove_prefix(8);
+    Pane *pane = take_id(line, '%', id) ? find_pane(id) : nullptr;
+    // Until its capture arrives, a pane's output is part of the capture
+    if (pane && pane->synced) {
+      std::string data;
+      unescape(line, data);
+      pane->terminal.feed(data.data(), data.size());
+      stats_.output_bytes += data.size();
+      changed_ = true;
+    }
+  } else if (starts_with(line, "%layout-change ")) {
+    line.remove_prefix(15);
+    if (take_id(line, '@', id)) {
+      sync_layout(id, line.substr(0, line.find(' ')));
+    }
+  } else if (starts_with(line, "%window-pane-changed ")) {
+    line.remove_prefix(21);
+    int pane = 0;
+    if (take_id(line, '@', id) && take_id(line, '%', pane)) {
+      window(id).active_pane = pane;
+    }
+  } else if (starts_with(line, "%session-window-changed ")) {
+    line.remove_prefix(24);
+    int session = 0;
+    if (take_id(line, '$', session) && take_id(line, '@', id)) {
+      active_window_ = id;
+    }
+  } else if (starts_with(line, "%window-close ") ||
+             starts_with(line, "%unlinked-window-close ")) {
+    // A window of ours is already unlinked when it closes, sometimes
+    line.remove_prefix(line.find(' ') + 1);
+    if (take_id(line, '@', id)) {
+      remove_window(id);
+    }
+  } else if (starts_with(line, "%window-add ") ||
+             starts_with(line, "%session-changed ")) {
+    request_windows(); // New panes, or a whole other session
+  } else if (starts_with(line, "%exit")) {
+    exit_reason_ = line.size() > 6 ? line.substr(6) : std::string_view();
+  }
+}
+
+void TmuxControl::on_reply(const Pending &pending, bool error) {
+  if (error) {
+    for (const std::string &line : block_) {
+      std::cerr << "[tide] tmux: " << line << std::endl;
+    }
+    return;
+  }
+  switch (pending.reply) {
+  case Reply::Windows:
+    sync_windows();
+    break;
+  case Reply::Capture:
+    apply_capture(pending.pane);
+    break;
+  case Reply::Cursor:
+    apply_cursor(pending.pane);
+    break;
+  case Reply::None:
+    break;
+  }
+}
+
+void TmuxControl::sync_windows() {
+  // "@id active %pane layout" per window of the session; panes of windows
+  // no longer listed went away while we were not looking
+  std::vector<int> listed;
+  for (const std::string &entry : block_) {
+    std::string_view line = entry;
+    int id = 0;
+    int active = 0;
+    int pane = 0;
+    if (!take_id(line, '@', id) || !take_int(line, active) ||
+        !take_char(line, ' ') || !take_id(line, '%', pane)) {
+      continue;
+    }
+    listed.push_back(id);
+    window(id).active_pane = pane;
+    if (active) {
+      active_window_ = id;
+    }
+    sync_layout(id, line);
+  }
+  for (size_t i = windows_.size(); i-- > 0;) {
+    if (std::find(listed.begin(), listed.end(), windows_[i].id) ==
+        listed.end()) {
+      remove_window(windows_[i].id);
+    }
+  }
+}
+
+void TmuxControl::sync_layout(int window_id, std::string_view layout) {
+  std::vector<LayoutPane> layout_panes;
+  if (!parse_layout(layout, layout_panes)) {
+    std::cerr << "[tide] tmux: Unknown layout " << layout << std::endl;
+    return;
+  }
+  window(window_id);
+
+  // Panes split off or closed, and the new size of every other
+  for (size_t i = panes_.size(); i-- > 0;) {
+    Pane &pane = *panes_[i];
+    if (pane.window == window_id &&
+        std::none_of(layout_panes.begin(), layout_panes.end(),
+                     [&](const LayoutPane &p) { return p.id == pane.id; })) {
+      panes_.erase(panes_.begin() + static_cast<ptrdiff_t>(i));
+      changed_ = true;
+    }
+  }
+  for (const LayoutPane &entry : layout_panes) {
+    if (Pane *pane = find_pane(entry.id)) {
+      pane->window = window_id; // Panes can move between windows
+      if (pane->terminal.cols() != entry.cols ||
+          pane->terminal.rows() != entry.rows) {
+        pane->terminal.resize(entry.cols, entry.rows);
+        changed_ = true;
+      }
+      continue;
+    }
+    auto pane =
+        std::make_unique<Pane>(entry.id, window_id, entry.cols, entry.rows);
+    pane->terminal.set_name("tmux pane %" + std::to_string(entry.id));
+    if (setup_) {
+      setup_(pane->terminal);
+    }
+    panes_.push_back(std::move(pane));
+    request_capture(entry.id);
+    changed_ = true;
+  }
+}
+
+void TmuxControl::apply_capture(int id) {
+  Pane *pane = find_pane(id);
+  if (!pane) {
+    return;
+  }
+  // History first, so it scrolls into our scrollback, then the screen;
+  // the rows keep their attributes (-e)
+  std::string data = "\x1b[H\x1b[2J";
+  for (size_t i = 0; i < block_.size(); ++i) {
+    if (i > 0) {
+      data += "\r\n";
+    }
+    data += block_[i];
+  }
+  data += "\x1b[0m";
+  pane->terminal.feed(data.data(), data.size());
+  stats_.capture_bytes += data.size();
+  changed_ = true;
+}
+
+void TmuxControl::apply_cursor(int id) {
+  Pane *pane = find_pane(id);
+  if (!pane || block_.empty()) {
+    return;
+  }
+  std::string_view line = block_.front();
+  int col = 0;
+  int row = 0;
+  if (take_int(line, col) && take_char(line, ' ') && take_int(line, row)) {
+    std::string move = "\x1b[" + std::to_string(row + 1) + ";" +
+                       std::to_string(col + 1) + "H";
+    pane->terminal.feed(move.data(), move.size());
+  }
+  pane->synced = true;
+  changed_ = true;
+}
+
+void TmuxControl::remove_window(int window_id) {
+  for (size_t i = panes_.size(); i-- > 0;) {
+    if (panes_[i]->window == window_id) {
+      panes_.erase(panes_.begin() + static_cast<ptrdiff_t>(i));
+      changed_ = true;
+    }
+  }
+  windows_.erase(std::remove_if(windows_.begin(), windows_.end(),
+                                [&](const Window &window) {
+                                  return window.id == window_id;
+                                }),
+                 windows_.end());
+}
+
+} // namespace tide::core
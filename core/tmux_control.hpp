@@ -0,0 +1,216 @@
+#pragma once
+
+#include "core/pty.hpp"
+#include "core/pty_reader.hpp"
+#include "core/pty_writer.hpp"
+#include "core/terminal.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * tmux control mode (tmux -CC): tmux keeps the sessions, windows and
+ * panes, and tide draws them natively instead of parsing a tmux client's
+ * rendering of them.
+ *
+ * tmux runs on a Pty like a shell, but what it prints is a line protocol:
+ * command replies in %begin/%end blocks, and notifications such as
+ * %output (a pane's bytes, octal-escaped) and %layout-change. Each pane
+ * gets a Terminal of its own, fed its %output directly, so its scrollback
+ * is ours and showing another pane costs tmux nothing but a select
+ * command. Panes seen for the first time (on attach, new windows, splits)
+ * are filled from capture-pane, history included, and take %output from
+ * there on.
+ *
+ * Everything runs on the owner thread: poll() applies what the reader
+ * buffered, and input goes out as send-keys commands on a PtyWriter.
+ */
+class TmuxControl {
+public:
+  using PaneSetup = std::function<void(Terminal &)>;
+
+  static constexpr size_t POLL_SLICE = 256 * 1024; // Bytes per poll()
+
+  /**
+   * A tmux pane (%id) and the terminal showing it.
+   */
+  struct Pane {
+    int id;
+    int window; // @id
+    Terminal terminal;
+    bool synced = false; // Its capture arrived; %output applies from now
+
+    Pane(int id, int window, int cols, int rows)
+        : id(id), window(window), terminal(cols, rows) {}
+  };
+
+  /**
+   * What tmux sent, for judging redraw cost.
+   */
+  struct Stats {
+    uint64_t control_bytes = 0; // Everything read from tmux
+    uint64_t output_bytes = 0;  // Pane output, decoded
+    uint64_t capture_bytes = 0; // Pane contents from capture-pane
+  };
+
+  TmuxControl() = default;
+  ~TmuxControl();
+
+  // Non-copyable (the reader thread points into us)
+  TmuxControl(const TmuxControl &) = delete;
+  TmuxControl &operator=(const TmuxControl &) = delete;
+
+  /**
+   * Configure each new pane's terminal (theme, scrollback).
+   */
+  void set_pane_setup(PaneSetup setup) { setup_ = std::move(setup); }
+
+  /**
+   * Run `tmux -CC <args>` (e.g. new-session, attach) at the window's size.
+   * @param notify See PtyReader::set_notify()
+   */
+  bool start(int cols, int rows, const PtyReader::Notify &notify,
+             const std::vector<std::string> &args);
+
+  /**
+   * Detach: hang up on the tmux client. The tmux session keeps running.
+   */
+  void stop();
+
+  /**
+   * Apply up to POLL_SLICE bytes of what tmux sent.
+   * @return true if a pane's contents or the set of panes changed
+   */
+  bool poll();
+
+  /**
+   * Check if tmux sent more than the last poll() applied.
+   */
+  [[nodiscard]] bool output_pending() const { return reader_.buffered() > 0; }
+
+  /**
+   * Run a tmux command, ignoring its reply (errors are logged).
+   */
+  void command(std::string_view line);
+
+  /**
+   * Type `data` into a pane.
+   */
+  void write(int pane, std::string_view data);
+
+  /**
+   * Paste into a pane, bracketed if its application asked for that.
+   */
+  void paste(int pane, std::string_view text);
+
+  /**
+   * Make `pane` (and its window) tmux's current one.
+   */
+  void select(int pane);
+
+  /**
+   * Resize the client; tmux answers with new layouts.
+   */
+  void resize(int cols, int rows);
+
+  /**
+   * Send queued commands (see PtyWriter::flush()).
+   */
+  void flush() { writer_.flush(); }
+
+  [[nodiscard]] bool input_pending() const {
+    return writer_.pending() && !writer_.blocked();
+  }
+
+  /**
+   * True once tmux exited (or detached) and everything it sent has been
+   * applied.
+   */
+  [[nodiscard]] bool finished() const { return reader_.finished(); }
+
+  /**
+   * Why tmux left control mode (from %exit), if it said.
+   */
+  [[nodiscard]] const std::string &exit_reason() const {
+    return exit_reason_;
+  }
+
+  /**
+   * The current pane of tmux's current window, or -1 before it is known.
+   */
+  [[nodiscard]] int active_pane() const;
+
+  [[nodiscard]] size_t pane_count() const { return panes_.size(); }
+  Pane &pane(size_t index) { return *panes_[index]; }
+  [[nodiscard]] const Pane &pane(size_t index) const { return *panes_[index]; }
+
+  /**
+   * The pane with tmux id `id`, or nullptr.
+   */
+  Pane *find_pane(int id);
+
+  /**
+   * Position of pane `id`, or pane_count() if there is none.
+   */
+  [[nodiscard]] size_t index_of(int id) const;
+
+  [[nodiscard]] Stats stats() const { return stats_; }
+
+private:
+  // What a command's %begin/%end block holds
+  enum class Reply : uint8_t { None, Windows, Capture, Cursor };
+
+  struct Pending {
+    Reply reply;
+    int pane;
+  };
+
+  struct Window {
+    int id;
+    int active_pane;
+  };
+
+  Pty pty_;
+  PtyReader reader_;
+  PtyWriter writer_;
+  PaneSetup setup_;
+  int cols_ = 0;
+  int rows_ = 0;
+
+  std::string line_;       // Partial line
+  bool control_ = false;   // The DCS that starts control mode was seen
+  std::deque<Pending> pending_; // Our commands without a reply yet
+  bool in_block_ = false;
+  std::string block_tag_;  // "time number flags" of the open block
+  std::vector<std::string> block_;
+  bool changed_ = false;
+
+  std::vector<std::unique_ptr<Pane>> panes_;
+  std::vector<Window> windows_;
+  int active_window_ = -1;
+  std::string exit_reason_;
+  Stats stats_;
+
+  void send(std::string_view line, Reply reply, int pane = -1);
+  void request_windows();
+  void request_capture(int pane);
+  void on_line(std::string_view line);
+  void on_notification(std::string_view line);
+  void on_reply(const Pending &pending, bool error);
+  void sync_windows();
+  void sync_layout(int window, std::string_view layout);
+  void apply_capture(int pane);
+  void apply_cursor(int pane);
+  void remove_window(int window);
+  Window &window(int id);
+};
+
+} // namespace tide::core
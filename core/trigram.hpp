@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * ASCII case folding used by the search index and by case-insensitive
+ * matching.
+ */
+constexpr char32_t fold_case(char32_t cp) {
+  return (cp >= U'A' && cp <= U'Z') ? cp + (U'a' - U'A') : cp;
+}
+
+/**
+ * Fixed-size bitmap of the case-folded trigrams seen in a block of text.
+ *
+ * Each trigram sets one bit, so a lookup can report false positives but
+ * never false negatives: if any trigram of a pattern is missing, the block
+ * cannot contain the pattern.
+ */
+class TrigramSet {
+public:
+  static constexpr size_t BITS = 8192;
+
+  /**
+   * Bit index of a trigram.
+   */
+  static uint32_t key(char32_t a, char32_t b, char32_t c) {
+    uint32_t h = static_cast<uint32_t>(fold_case(a)) * 0x9E3779B1u;
+    h ^= static_cast<uint32_t>(fold_case(b)) * 0x85EBCA77u;
+    h = (h << 13 | h >> 19) ^ static_cast<uint32_t>(fold_case(c)) * 0xC2B2AE3Du;
+    return (h ^ h >> 16) % BITS;
+  }
+
+  /**
+   * Append the keys of every trigram in `text`.
+   */
+  static void keys(const char32_t *text, size_t size,
+                   std::vector<uint32_t> &out) {
+    for (size_t i = 0; i + 2 < size; ++i) {
+      out.push_back(key(text[i], text[i + 1], text[i + 2]));
+    }
+  }
+
+  void add(const char32_t *text, size_t size) {
+    for (size_t i = 0; i + 2 < size; ++i) {
+      uint32_t k = key(text[i], text[i + 1], text[i + 2]);
+      bits_[k / 64] |= uint64_t{1} << (k % 64);
+    }
+  }
+
+  /**
+   * Check whether every key may be present.
+   */
+  [[nodiscard]] bool contains_all(const std::vector<uint32_t> &keys) const {
+    for (uint32_t k : keys) {
+      if (!(bits_[k / 64] & (uint64_t{1} << (k % 64)))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::array<uint64_t, BITS / 64> bits_{};
+};
+
+} // namespace tide::core
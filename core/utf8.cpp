@@ -0,0 +1,114 @@
+#include "core/utf8.hpp"
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tide::core {
+
+namespace {
+
+char *put_codepoint(char *out, char32_t cp) {
+  if (cp == 0) {
+    cp = U' ';
+  } else if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+    cp = U'\uFFFD';
+  }
+
+  if (cp < 0x80) {
+    *out++ = static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    *out++ = static_cast<char>(0xC0 | (cp >> 6));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    *out++ = static_cast<char>(0xE0 | (cp >> 12));
+    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    *out++ = static_cast<char>(0xF0 | (cp >> 18));
+    *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+  }
+  return out;
+}
+
+} // anonymous namespace
+
+size_t encode_utf8(const char32_t *src, size_t count, char *dst) {
+  char *out = dst;
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i non_ascii = _mm_set1_epi32(~0x7F);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i space = _mm_set1_epi8(' ');
+
+  while (i + 16 <= count) {
+    const auto *p = reinterpret_cast<const __m128i *>(src + i);
+    __m128i a = _mm_loadu_si128(p);
+    __m128i b = _mm_loadu_si128(p + 1);
+    __m128i c = _mm_loadu_si128(p + 2);
+    __m128i d = _mm_loadu_si128(p + 3);
+
+    __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+    __m128i high = _mm_and_si128(any, non_ascii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xFFFF) {
+      for (size_t end = i + 16; i < end; ++i) {
+        out = put_codepoint(out, src[i]);
+      }
+      continue;
+    }
+
+    // All 16 are ASCII: narrow 32 -> 16 -> 8 bits, then map NUL to space
+    __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                     _mm_packs_epi32(c, d));
+    bytes = _mm_or_si128(bytes,
+                         _mm_and_si128(_mm_cmpeq_epi8(bytes, zero), space));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), bytes);
+    out += 16;
+    i += 16;
+  }
+#endif
+
+  for (; i < count; ++i) {
+    out = put_codepoint(out, src[i]);
+  }
+  return static_cast<size_t>(out - dst);
+}
+
+void append_utf8(std::string &out, char32_t cp) {
+  char buf[UTF8_MAX_BYTES];
+  out.append(buf, static_cast<size_t>(put_codepoint(buf, cp) - buf));
+}
+
+std::u32string decode_utf8(const std::string &str) {
+  std::u32string out;
+  out.reserve(str.size());
+
+  for (size_t i = 0; i < str.size();) {
+    auto b = static_cast<uint8_t>(str[i]);
+    size_t len = b < 0x80 ? 1 : (b >> 5) == 0x6 ? 2 : (b >> 4) == 0xE ? 3
+                 : (b >> 3) == 0x1E ? 4 : 0;
+    if (len == 0 || i + len > str.size()) {
+      out.push_back(U'\uFFFD');
+      ++i;
+      continue;
+    }
+
+    char32_t cp = len == 1 ? b : b & (0x3F >> (len - 1));
+    bool valid = true;
+    for (size_t k = 1; k < len; ++k) {
+      auto c = static_cast<uint8_t>(str[i + k]);
+      valid = valid && (c & 0xC0) == 0x80;
+      cp = (cp << 6) | (c & 0x3F);
+    }
+    out.push_back(valid ? cp : U'\uFFFD');
+    i += valid ? len : 1;
+  }
+  return out;
+}
+
+} // namespace tide::core
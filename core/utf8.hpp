@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace tide::core {
+
+/**
+ * Worst-case UTF-8 bytes per codepoint.
+ */
+constexpr size_t UTF8_MAX_BYTES = 4;
+
+/**
+ * Encode codepoints as UTF-8.
+ * NUL (never-written cells) becomes a space and invalid codepoints become
+ * U+FFFD. Runs of ASCII are converted 16 at a time with SSE2 when available.
+ * @param dst Buffer with room for count * UTF8_MAX_BYTES bytes
+ * @return Number of bytes written
+ */
+size_t encode_utf8(const char32_t *src, size_t count, char *dst);
+
+/**
+ * Append one codepoint as UTF-8.
+ */
+void append_utf8(std::string &out, char32_t cp);
+
+/**
+ * Decode UTF-8, replacing malformed sequences with U+FFFD.
+ */
+std::u32string decode_utf8(const std::string &str);
+
+} // namespace tide::core
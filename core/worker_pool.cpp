@@ -0,0 +1,81 @@
+#include "core/worker_pool.hpp"
+
+namespace tide::core {
+
+size_t WorkerPool::default_threads() {
+  unsigned hardware = std::thread::hardware_concurrency();
+  return hardware > 1 ? hardware - 1 : 0;
+}
+
+WorkerPool::WorkerPool(size_t threads) {
+  threads_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&WorkerPool::run, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::parallel_for(size_t count,
+                              const std::function<void(size_t)> &task) {
+  if (count == 0) {
+    return;
+  }
+  if (count == 1 || threads_.empty()) {
+    for (size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_ = &task;
+  count_ = count;
+  next_ = 0;
+  done_ = 0;
+  work_cv_.notify_all();
+
+  // Take a share of the work instead of idling
+  while (next_ < count_) {
+    size_t index = next_++;
+    lock.unlock();
+    task(index);
+    lock.lock();
+    ++done_;
+  }
+  done_cv_.wait(lock, [this] { return done_ == count_; });
+
+  // Workers claim nothing until the next batch
+  task_ = nullptr;
+  count_ = 0;
+  next_ = 0;
+}
+
+void WorkerPool::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    work_cv_.wait(lock, [this] { return stop_ || next_ < count_; });
+    if (stop_) {
+      return;
+    }
+    size_t index = next_++;
+    const std::function<void(size_t)> *task = task_;
+    lock.unlock();
+    (*task)(index);
+    lock.lock();
+    if (++done_ == count_) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+} // namespace tide::core
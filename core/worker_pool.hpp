@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tide::core {
+
+/**
+ * Fixed set of threads for fork-join work from a single owner thread.
+ *
+ * parallel_for() hands out indices one at a time, to the workers and to the
+ * calling thread, and returns once every index has run. Items are expected
+ * to be coarse (one terminal's parse slice), so claiming an index under the
+ * lock costs nothing that matters.
+ */
+class WorkerPool {
+public:
+  /**
+   * @param threads Worker threads besides the caller (0 = the caller
+   *                runs everything)
+   */
+  explicit WorkerPool(size_t threads = default_threads());
+  ~WorkerPool();
+
+  // Non-copyable
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  /**
+   * Run task(i) for every i in [0, count), in parallel, and wait for all.
+   * Not reentrant; call from one thread at a time.
+   */
+  void parallel_for(size_t count, const std::function<void(size_t)> &task);
+
+  /**
+   * Threads that run tasks, including the caller.
+   */
+  [[nodiscard]] size_t concurrency() const { return threads_.size() + 1; }
+
+  /**
+   * One worker per hardware thread besides the caller's.
+   */
+  static size_t default_threads();
+
+private:
+  std::mutex mutex_;
+  std::condition_variable work_cv_; // Workers: indices to claim, or stop
+  std::condition_variable done_cv_; // Caller: every index finished
+  std::vector<std::thread> threads_;
+  const std::function<void(size_t)> *task_ = nullptr;
+  size_t count_ = 0; // Indices in the current batch
+  size_t next_ = 0;  // Next index to claim
+  size_t done_ = 0;  // Indices finished
+  bool stop_ = false;
+
+  void run();
+};
+
+} // namespace tide::core
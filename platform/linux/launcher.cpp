@@ -0,0 +1,44 @@
+#include "platform/linux/launcher.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace tide::platform::linux {
+
+bool open_external(const std::string &target) {
+  // Fork twice so the handler is reparented to init and never left a zombie
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::cerr << "[tide] Failed to fork: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+
+  if (pid == 0) {
+    setsid();
+    pid_t handler = fork();
+    if (handler == 0) {
+      sigset_t none; // Undo tide's blocked SIGCHLD
+      sigemptyset(&none);
+      sigprocmask(SIG_SETMASK, &none, nullptr);
+      execlp("xdg-open", "xdg-open", target.c_str(), nullptr);
+      _exit(127);
+    }
+    _exit(handler < 0 ? 1 : 0);
+  }
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::cerr << "[tide] Failed to start xdg-open for " << target << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace tide::platform::linux
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+namespace tide::platform::linux {
+
+/**
+ * Open a URL or file with the desktop's default handler (xdg-open).
+ * The handler runs detached; this returns once it has been started.
+ * @return false if the handler could not be started
+ */
+bool open_external(const std::string &target);
+
+} // namespace tide::platform::linux
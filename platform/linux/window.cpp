@@ -8,12 +8,15 @@
 
 namespace tide::platform::linux {
 
+int Window::open_windows_ = 0;
+
 Window::Window() = default;
 
 Window::~Window() { destroy(); }
 
-bool Window::create(int width, int height, const std::string &title) {
-  // Initialize GLFW
+bool Window::create(int width, int height, const std::string &title,
+                    const Window *share) {
+  // Initialize GLFW (again a no-op while other windows are open)
   if (!glfwInit()) {
     std::cerr << "[tide::Window] Failed to initialize GLFW" << std::endl;
     return false;
@@ -26,12 +29,16 @@ bool Window::create(int width, int height, const std::string &title) {
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
   // Create window
-  window_ = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+  window_ = glfwCreateWindow(width, height, title.c_str(), nullptr,
+                             share ? share->window_ : nullptr);
   if (!window_) {
     std::cerr << "[tide::Window] Failed to create GLFW window" << std::endl;
-    glfwTerminate();
+    if (open_windows_ == 0) {
+      glfwTerminate();
+    }
     return false;
   }
+  ++open_windows_;
 
   // Make OpenGL context current
   glfwMakeContextCurrent(window_);
@@ -39,9 +46,7 @@ bool Window::create(int width, int height, const std::string &title) {
   // Load OpenGL functions via GLAD
   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
     std::cerr << "[tide::Window] Failed to initialize GLAD" << std::endl;
-    glfwDestroyWindow(window_);
-    glfwTerminate();
-    window_ = nullptr;
+    destroy();
     return false;
   }
 
@@ -58,6 +63,8 @@ bool Window::create(int width, int height, const std::string &title) {
   glfwSetMouseButtonCallback(window_, mouse_button_callback);
   glfwSetCursorPosCallback(window_, cursor_pos_callback);
   glfwSetScrollCallback(window_, scroll_callback);
+  glfwSetWindowFocusCallback(window_, focus_callback);
+  glfwSetWindowRefreshCallback(window_, refresh_callback);
 
   // Enable vsync
   glfwSwapInterval(1);
@@ -73,12 +80,30 @@ void Window::destroy() {
   if (window_) {
     glfwDestroyWindow(window_);
     window_ = nullptr;
+    if (--open_windows_ == 0) {
+      glfwTerminate();
+    }
+  }
+}
+
+void Window::make_current() {
+  if (window_ && glfwGetCurrentContext() != window_) {
+    glfwMakeContextCurrent(window_);
   }
-  glfwTerminate();
 }
 
 void Window::poll_events() { glfwPollEvents(); }
 
+void Window::wait_events(double timeout) {
+  if (timeout > 0.0) {
+    glfwWaitEventsTimeout(timeout);
+  } else {
+    glfwPollEvents();
+  }
+}
+
+void Window::post_empty_event() { glfwPostEmptyEvent(); }
+
 void Window::swap_buffers() {
   if (window_) {
     glfwSwapBuffers(window_);
@@ -95,6 +120,12 @@ void Window::request_close() {
   }
 }
 
+void Window::set_title(const std::string &title) {
+  if (window_) {
+    glfwSetWindowTitle(window_, title.c_str());
+  }
+}
+
 // Static GLFW callbacks
 
 void Window::framebuffer_size_callback(GLFWwindow *window, int width,
@@ -147,4 +178,18 @@ void Window::scroll_callback(GLFWwindow *window, double xoffset,
   }
 }
 
+void Window::focus_callback(GLFWwindow *window, int focused) {
+  auto *self = static_cast<Window *>(glfwGetWindowUserPointer(window));
+  if (self && self->focus_callback_) {
+    self->focus_callback_(focused == GLFW_TRUE);
+  }
+}
+
+void Window::refresh_callback(GLFWwindow *window) {
+  auto *self = static_cast<Window *>(glfwGetWindowUserPointer(window));
+  if (self && self->refresh_callback_) {
+    self->refresh_callback_();
+  }
+}
+
 } // namespace tide::platform::linux
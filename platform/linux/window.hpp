@@ -19,6 +19,8 @@ class Window {
 public:
   using ResizeCallback = std::function<void(int width, int height)>;
   using CloseCallback = std::function<void()>;
+  using FocusCallback = std::function<void(bool focused)>;
+  using RefreshCallback = std::function<void()>;
 
   Window();
   ~Window();
@@ -32,21 +34,42 @@ public:
    * @param width Window width in pixels
    * @param height Window height in pixels
    * @param title Window title
+   * @param share Window whose OpenGL context shares objects (textures,
+   *              buffers, programs) with the new one (optional)
    * @return true if window created successfully
    */
-  bool create(int width, int height, const std::string &title);
+  bool create(int width, int height, const std::string &title,
+              const Window *share = nullptr);
 
   /**
-   * Destroy the window and clean up resources.
+   * Destroy the window and clean up resources. GLFW is shut down with
+   * the last window.
    */
   void destroy();
 
+  /**
+   * Make the window's OpenGL context current on this thread.
+   */
+  void make_current();
+
   /**
    * Process pending window events.
    * Should be called once per frame.
    */
   void poll_events();
 
+  /**
+   * Sleep until an event arrives or `timeout` seconds pass, then process
+   * pending events of every window. A timeout of 0 just polls.
+   */
+  static void wait_events(double timeout);
+
+  /**
+   * Wake a thread blocked in wait_events(). Safe to call from any thread
+   * between create() and destroy().
+   */
+  static void post_empty_event();
+
   /**
    * Swap front and back buffers.
    */
@@ -62,6 +85,11 @@ public:
    */
   void request_close();
 
+  /**
+   * Change the title bar text (UTF-8).
+   */
+  void set_title(const std::string &title);
+
   /**
    * Get current window dimensions.
    */
@@ -87,6 +115,21 @@ public:
     close_callback_ = std::move(callback);
   }
 
+  /**
+   * Set focus change callback.
+   */
+  void set_focus_callback(FocusCallback callback) {
+    focus_callback_ = std::move(callback);
+  }
+
+  /**
+   * Set callback for when the window contents are damaged and must be
+   * redrawn (e.g. uncovered).
+   */
+  void set_refresh_callback(RefreshCallback callback) {
+    refresh_callback_ = std::move(callback);
+  }
+
   /**
    * Get the keyboard input handler.
    */
@@ -107,6 +150,10 @@ private:
 
   ResizeCallback resize_callback_;
   CloseCallback close_callback_;
+  FocusCallback focus_callback_;
+  RefreshCallback refresh_callback_;
+
+  static int open_windows_; // GLFW is initialized while this is nonzero
 
   // Static callbacks for GLFW (bridge to instance methods)
   static void framebuffer_size_callback(GLFWwindow *window, int width,
@@ -119,6 +166,8 @@ private:
   static void cursor_pos_callback(GLFWwindow *window, double xpos, double ypos);
   static void scroll_callback(GLFWwindow *window, double xoffset,
                               double yoffset);
+  static void focus_callback(GLFWwindow *window, int focused);
+  static void refresh_callback(GLFWwindow *window);
 };
 
 } // namespace tide::platform::linux
@@ -23,36 +23,51 @@ layout (location = 3) in vec2 a_glyph_offset;
 layout (location = 4) in vec2 a_glyph_size;
 layout (location = 5) in vec4 a_fg_color;
 layout (location = 6) in vec4 a_bg_color;
+layout (location = 7) in float a_underline;
 
 uniform mat4 u_projection;
 uniform vec2 u_cell_size;
+uniform float u_ring_rows; // Row slots in the instance buffer
+uniform float u_top_slot;  // Slot of the line just above the view
+uniform float u_scroll_px; // Smooth-scroll shift, 0 to one row
 
 out vec2 v_tex_coord;
 out vec4 v_fg_color;
 out vec4 v_bg_color;
 out float v_is_background;
+out float v_underline;
+out float v_cell_y; // Pixels from the top of the cell (background only)
 
 void main() {
     // Determine if this is background quad (vertex.x < 0.5) or glyph quad
     v_is_background = step(a_vertex.x, 0.25);
-    
+
+    // a_cell_pos.y is a ring slot: rows are placed relative to the top slot,
+    // so scrolling only changes uniforms
+    float visual = mod(a_cell_pos.y - u_top_slot + u_ring_rows, u_ring_rows);
+    vec2 cell_pos = vec2(a_cell_pos.x,
+                         (visual - 1.0) * u_cell_size.y + u_scroll_px);
+
     vec2 pos;
     if (v_is_background > 0.5) {
         // Background quad: fill entire cell
-        pos = a_cell_pos + a_vertex * u_cell_size;
+        pos = cell_pos + a_vertex * u_cell_size;
         v_tex_coord = vec2(0.0);
+        v_cell_y = a_vertex.y * u_cell_size.y;
     } else {
         // Glyph quad: offset within cell
         vec2 local_vert = a_vertex - vec2(0.5, 0.0);  // Shift glyph verts
-        pos = a_cell_pos + a_glyph_offset + local_vert * a_glyph_size;
+        pos = cell_pos + a_glyph_offset + local_vert * a_glyph_size;
         
         // Interpolate texture coordinates
         v_tex_coord = mix(a_tex_coords.xy, a_tex_coords.zw, local_vert);
+        v_cell_y = 0.0;
     }
     
     gl_Position = u_projection * vec4(pos, 0.0, 1.0);
     v_fg_color = a_fg_color;
     v_bg_color = a_bg_color;
+    v_underline = a_underline;
 }
 )";
 
@@ -64,15 +79,19 @@ in vec2 v_tex_coord;
 in vec4 v_fg_color;
 in vec4 v_bg_color;
 in float v_is_background;
+in float v_underline;
+in float v_cell_y;
 
 uniform sampler2D u_atlas;
+uniform vec2 u_cell_size;
 
 out vec4 frag_color;
 
 void main() {
     if (v_is_background > 0.5) {
-        // Background: solid color
-        frag_color = v_bg_color;
+        // Background: solid color, underline in the bottom pixel row
+        bool line = v_underline > 0.5 && v_cell_y > u_cell_size.y - 1.0;
+        frag_color = line ? v_fg_color : v_bg_color;
     } else {
         // Glyph: sample atlas and apply foreground color
         float alpha = texture(u_atlas, v_tex_coord).r;
@@ -85,7 +104,16 @@ Renderer::Renderer() : current_theme_(theme::get_default_theme()) {}
 
 Renderer::~Renderer() { shutdown(); }
 
-bool Renderer::init(Font *font) {
+Renderer::SharedObjects::~SharedObjects() {
+  if (vbo_quad) {
+    glDeleteBuffers(1, &vbo_quad);
+  }
+  if (shader_program) {
+    glDeleteProgram(shader_program);
+  }
+}
+
+bool Renderer::init(Font *font, const Renderer *share) {
   if (initialized_) {
     return true;
   }
@@ -96,8 +124,13 @@ bool Renderer::init(Font *font) {
     return false;
   }
 
-  // Create shaders
-  if (!create_shaders()) {
+  // Vertex arrays are per context, so only they are built for a shared
+  // renderer
+  if (share && share->shared_) {
+    shared_ = share->shared_;
+    shader_program_ = shared_->shader_program;
+    vbo_quad_ = shared_->vbo_quad;
+  } else if (!create_shaders()) {
     return false;
   }
 
@@ -136,10 +169,16 @@ bool Renderer::init(Font *font) {
       1.0f,
   };
 
-  glGenBuffers(1, &vbo_quad_);
+  if (!shared_) {
+    glGenBuffers(1, &vbo_quad_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_quad_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices,
+                 GL_STATIC_DRAW);
+    shared_ = std::make_shared<SharedObjects>();
+    shared_->shader_program = shader_program_;
+    shared_->vbo_quad = vbo_quad_;
+  }
   glBindBuffer(GL_ARRAY_BUFFER, vbo_quad_);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices,
-               GL_STATIC_DRAW);
 
   // Vertex attribute (location 0)
   glEnableVertexAttribArray(0);
@@ -189,12 +228,21 @@ bool Renderer::init(Font *font) {
                         (void *)offsetof(CellInstance, bg_r));
   glVertexAttribDivisor(6, 1);
 
+  // a_underline (location 7)
+  glEnableVertexAttribArray(7);
+  glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(CellInstance, underline));
+  glVertexAttribDivisor(7, 1);
+
   glBindVertexArray(0);
 
   // Get uniform locations
   loc_projection_ = glGetUniformLocation(shader_program_, "u_projection");
   loc_cell_size_ = glGetUniformLocation(shader_program_, "u_cell_size");
   loc_atlas_texture_ = glGetUniformLocation(shader_program_, "u_atlas");
+  loc_ring_rows_ = glGetUniformLocation(shader_program_, "u_ring_rows");
+  loc_top_slot_ = glGetUniformLocation(shader_program_, "u_top_slot");
+  loc_scroll_px_ = glGetUniformLocation(shader_program_, "u_scroll_px");
 
   // Enable blending for text
   glEnable(GL_BLEND);
@@ -258,18 +306,20 @@ void Renderer::shutdown() {
     glDeleteBuffers(1, &vbo_instances_);
     vbo_instances_ = 0;
   }
-  if (vbo_quad_) {
-    glDeleteBuffers(1, &vbo_quad_);
-    vbo_quad_ = 0;
-  }
   if (vao_) {
     glDeleteVertexArrays(1, &vao_);
     vao_ = 0;
   }
-  if (shader_program_) {
-    glDeleteProgram(shader_program_);
-    shader_program_ = 0;
+  if (shared_) {
+    shared_.reset(); // Deletes the program and quad if we were the last
+  } else if (shader_program_) {
+    glDeleteProgram(shader_program_); // init() failed before sharing it
   }
+  shader_program_ = 0;
+  vbo_quad_ = 0;
+  ring_rows_ = 0;
+  ring_cols_ = 0;
+  slots_.clear();
 
   initialized_ = false;
 }
@@ -277,7 +327,6 @@ void Renderer::shutdown() {
 void Renderer::resize(int width, int height) {
   viewport_width_ = width;
   viewport_height_ = height;
-  glViewport(0, 0, width, height);
 }
 
 int Renderer::grid_cols() const {
@@ -292,12 +341,14 @@ int Renderer::grid_rows() const {
   return viewport_height_ / font_->cell_height();
 }
 
-void Renderer::render(const core::GridBuffer &grid, const theme::Theme &theme,
+void Renderer::render(const core::ScreenView &view, const theme::Theme &theme,
                       int cursor_col, int cursor_row, bool show_cursor) {
   if (!initialized_ || !font_) {
     return;
   }
 
+  glViewport(0, 0, viewport_width_, viewport_height_);
+
   // Clear with background color
   const auto &bg = theme.background;
   glClearColor(bg.r, bg.g, bg.b, bg.a);
@@ -334,13 +385,18 @@ void Renderer::render(const core::GridBuffer &grid, const theme::Theme &theme,
   glBindTexture(GL_TEXTURE_2D, font_->atlas_texture());
   glUniform1i(loc_atlas_texture_, 0);
 
-  // Build instance data
-  update_instances(grid, theme, cursor_col, cursor_row, show_cursor);
+  // Upload rows that changed since the last frame
+  update_instances(view, cursor_col, cursor_row, show_cursor);
+
+  // Place the ring: the line above the view sits in top_slot_
+  glUniform1f(loc_ring_rows_, static_cast<float>(ring_rows_));
+  glUniform1f(loc_top_slot_, static_cast<float>(top_slot_));
+  glUniform1f(loc_scroll_px_, view.above() ? scroll_pixels_ : 0.0f);
 
   // Draw all cells
   glBindVertexArray(vao_);
 
-  int num_cells = grid.cols() * grid.rows();
+  int num_cells = ring_rows_ * ring_cols_;
 
   // Draw backgrounds first (6 vertices per cell, using first 6 verts of quad)
   glDrawArraysInstanced(GL_TRIANGLES, 0, 6, num_cells);
@@ -351,69 +407,156 @@ void Renderer::render(const core::GridBuffer &grid, const theme::Theme &theme,
   glBindVertexArray(0);
 }
 
-void Renderer::update_instances(const core::GridBuffer &grid,
-                                const theme::Theme &theme, int cursor_col,
+void Renderer::update_instances(const core::ScreenView &view, int cursor_col,
                                 int cursor_row, bool show_cursor) {
-  int cols = grid.cols();
-  int rows = grid.rows();
-  int cell_w = font_->cell_width();
-  int cell_h = font_->cell_height();
-  int baseline = font_->baseline();
+  int cols = view.cols();
+  int rows = view.rows();
+
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_instances_);
+
+  // One slot per screen row plus one for the line above the view
+  int ring = rows + 1;
+  if (ring != ring_rows_ || cols != ring_cols_) {
+    ring_rows_ = ring;
+    ring_cols_ = cols;
+    slots_.assign(static_cast<size_t>(ring), RowSlot{});
+    glBufferData(GL_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(ring * cols) *
+                     static_cast<GLsizeiptr>(sizeof(CellInstance)),
+                 nullptr, GL_DYNAMIC_DRAW);
+  }
+
+  // Row v of the ring order (0 = line above the view) shows line
+  // top_line - 1 + v, kept in slot (top_line - 1 + v) % ring
+  uint64_t first = view.top_line() + static_cast<uint64_t>(ring) - 1;
+  top_slot_ = static_cast<int>(first % static_cast<uint64_t>(ring));
+
+  static const std::vector<core::ColumnSpan> no_links;
 
-  std::vector<CellInstance> instances;
-  instances.reserve(cols * rows);
-
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
-      const core::Cell &cell = grid.at(col, row);
-
-      CellInstance inst;
-      inst.pos_x = static_cast<float>(col * cell_w);
-      inst.pos_y = static_cast<float>(row * cell_h);
-
-      // Get glyph info
-      const GlyphInfo &glyph = font_->get_glyph(cell.codepoint);
-      inst.tex_x0 = glyph.tex_x0;
-      inst.tex_y0 = glyph.tex_y0;
-      inst.tex_x1 = glyph.tex_x1;
-      inst.tex_y1 = glyph.tex_y1;
-
-      // Glyph positioning within cell
-      inst.glyph_offset_x = static_cast<float>(glyph.bearing_x);
-      inst.glyph_offset_y = static_cast<float>(baseline - glyph.bearing_y);
-      inst.glyph_size_x = static_cast<float>(glyph.width);
-      inst.glyph_size_y = static_cast<float>(glyph.height);
-
-      // Colors
-      theme::Color fg = cell.foreground;
-      theme::Color bg = cell.background;
-
-      // Selection: invert colors (check before cursor)
-      if (selection_check_ && selection_check_(col, row)) {
-        std::swap(fg, bg);
+  for (int v = 0; v < ring; ++v) {
+    int row = v - 1;
+    const core::Cell *cells = row < 0 ? view.above() : view.row(row);
+    if (cells == nullptr) {
+      continue; // No line above; that slot is never on screen
+    }
+
+    core::ColumnSpan selected;
+    const std::vector<core::ColumnSpan> *links = &no_links;
+    int cursor = -1;
+    if (row >= 0) {
+      auto index = static_cast<size_t>(row);
+      if (index < selection_.size()) {
+        selected = selection_[index];
+      }
+      if (index < links_.size()) {
+        links = &links_[index];
       }
-      // Cursor: invert colors
-      else if (show_cursor && col == cursor_col && row == cursor_row) {
-        std::swap(fg, bg);
+      if (show_cursor && row == cursor_row) {
+        cursor = cursor_col;
       }
+    }
 
-      inst.fg_r = fg.r;
-      inst.fg_g = fg.g;
-      inst.fg_b = fg.b;
-      inst.fg_a = fg.a;
-      inst.bg_r = bg.r;
-      inst.bg_g = bg.g;
-      inst.bg_b = bg.b;
-      inst.bg_a = bg.a;
+    RowSlot want;
+    want.line = view.top_line() - 1 + static_cast<uint64_t>(v);
+    want.key = row < 0 ? view.above_key() : view.key(row);
+    want.decoration = decoration_hash(selected, *links, cursor);
 
-      instances.push_back(inst);
+    auto slot = static_cast<size_t>((first + static_cast<uint64_t>(v)) %
+                                    static_cast<uint64_t>(ring));
+    if (slots_[slot] == want) {
+      continue; // Only moved: the shader repositions it
     }
+
+    build_row(cells, cols, static_cast<int>(slot), selected, *links, cursor);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    static_cast<GLintptr>(slot) * cols *
+                        static_cast<GLintptr>(sizeof(CellInstance)),
+                    static_cast<GLsizeiptr>(row_instances_.size() *
+                                            sizeof(CellInstance)),
+                    row_instances_.data());
+    slots_[slot] = want;
   }
+}
 
-  // Upload instance data
-  glBindBuffer(GL_ARRAY_BUFFER, vbo_instances_);
-  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(CellInstance),
-               instances.data(), GL_DYNAMIC_DRAW);
+uint64_t Renderer::decoration_hash(const core::ColumnSpan &selected,
+                                   const std::vector<core::ColumnSpan> &links,
+                                   int cursor_col) {
+  uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+  auto mix = [&hash](int value) {
+    hash ^= static_cast<uint32_t>(value);
+    hash *= 0x100000001b3ULL;
+  };
+  mix(selected.start);
+  mix(selected.end);
+  mix(cursor_col);
+  for (const core::ColumnSpan &link : links) {
+    mix(link.start);
+    mix(link.end);
+  }
+  return hash;
+}
+
+void Renderer::build_row(const core::Cell *cells, int cols, int slot,
+                         const core::ColumnSpan &selected,
+                         const std::vector<core::ColumnSpan> &links,
+                         int cursor_col) {
+  int cell_w = font_->cell_width();
+  int baseline = font_->baseline();
+
+  row_instances_.clear();
+  row_instances_.reserve(static_cast<size_t>(cols));
+
+  for (int col = 0; col < cols; ++col) {
+    const core::Cell &cell = cells[col];
+
+    CellInstance inst;
+    inst.pos_x = static_cast<float>(col * cell_w);
+    inst.pos_y = static_cast<float>(slot);
+
+    // Get glyph info
+    const GlyphInfo &glyph = font_->get_glyph(cell.codepoint);
+    inst.tex_x0 = glyph.tex_x0;
+    inst.tex_y0 = glyph.tex_y0;
+    inst.tex_x1 = glyph.tex_x1;
+    inst.tex_y1 = glyph.tex_y1;
+
+    // Glyph positioning within cell
+    inst.glyph_offset_x = static_cast<float>(glyph.bearing_x);
+    inst.glyph_offset_y = static_cast<float>(baseline - glyph.bearing_y);
+    inst.glyph_size_x = static_cast<float>(glyph.width);
+    inst.glyph_size_y = static_cast<float>(glyph.height);
+
+    // Colors
+    theme::Color fg = cell.foreground;
+    theme::Color bg = cell.background;
+
+    // Selection: invert colors (check before cursor)
+    if (selected.contains(col)) {
+      std::swap(fg, bg);
+    }
+    // Cursor: invert colors
+    else if (col == cursor_col) {
+      std::swap(fg, bg);
+    }
+
+    inst.fg_r = fg.r;
+    inst.fg_g = fg.g;
+    inst.fg_b = fg.b;
+    inst.fg_a = fg.a;
+    inst.bg_r = bg.r;
+    inst.bg_g = bg.g;
+    inst.bg_b = bg.b;
+    inst.bg_a = bg.a;
+    inst.underline = 0.0f;
+    for (const core::ColumnSpan &link : links) {
+      if (link.contains(col)) {
+        inst.underline = 1.0f;
+        break;
+      }
+    }
+
+    row_instances_.push_back(inst);
+  }
 }
 
 void Renderer::set_theme(const theme::Theme &theme) { current_theme_ = theme; }
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "core/grid_buffer.hpp"
+#include "core/screen_view.hpp"
 #include "render/font.hpp"
 #include "theme/theme.hpp"
 
 #include <cstdint>
-#include <functional>
+#include <memory>
+#include <vector>
 
 namespace tide::render {
 
@@ -26,31 +28,35 @@ public:
    * Initialize OpenGL resources.
    * Must be called after OpenGL context is created.
    * @param font The font to use for rendering
+   * @param share Renderer of another window whose context shares objects
+   *              with this one: its shader program and quad vertices are
+   *              reused instead of built again (optional)
    * @return true if initialization succeeded
    */
-  bool init(Font *font);
+  bool init(Font *font, const Renderer *share = nullptr);
 
   /**
-   * Clean up OpenGL resources.
+   * Clean up OpenGL resources. The renderer's context must be current.
    */
   void shutdown();
 
   /**
-   * Update viewport dimensions.
+   * Update viewport dimensions (applied by the next render(), so any
+   * context may be current).
    * @param width Viewport width in pixels
    * @param height Viewport height in pixels
    */
   void resize(int width, int height);
 
   /**
-   * Render a frame.
-   * @param grid The terminal grid to render
+   * Render a frame. The renderer's context must be current.
+   * @param view The rows on screen (live grid and/or history)
    * @param theme The color theme to use
    * @param cursor_col Cursor column position
    * @param cursor_row Cursor row position
    * @param show_cursor Whether to show cursor
    */
-  void render(const core::GridBuffer &grid, const theme::Theme &theme,
+  void render(const core::ScreenView &view, const theme::Theme &theme,
               int cursor_col = -1, int cursor_row = -1,
               bool show_cursor = true);
 
@@ -65,13 +71,34 @@ public:
   [[nodiscard]] int grid_cols() const;
   [[nodiscard]] int grid_rows() const;
 
-  // Selection callback type
-  using SelectionCheck = std::function<bool(int col, int row)>;
+  /**
+   * Set the selected columns of each row for highlighting (one span per
+   * row, as produced by Terminal::selection_spans).
+   */
+  void set_selection(const std::vector<core::ColumnSpan> &spans) {
+    selection_ = spans;
+  }
+
+  /**
+   * Set the underlined link columns of each row (see
+   * core::LinkDetector::spans).
+   */
+  void set_links(const std::vector<std::vector<core::ColumnSpan>> &spans) {
+    links_ = spans;
+  }
 
   /**
-   * Set selection check function for highlighting.
+   * Shift the view down by part of a row for smooth scrolling, revealing
+   * the line above it (0 to one cell height, in pixels).
    */
-  void set_selection_check(SelectionCheck check) { selection_check_ = check; }
+  void set_scroll_pixels(float pixels) { scroll_pixels_ = pixels; }
+
+  /**
+   * Forget which rows the GPU holds, so the next frame uploads every row.
+   * Needed before showing another terminal: row keys are only unique
+   * within one terminal.
+   */
+  void invalidate() { slots_.assign(slots_.size(), RowSlot{}); }
 
 private:
   Font *font_ = nullptr;
@@ -79,9 +106,23 @@ private:
   int viewport_height_ = 0;
   theme::Theme current_theme_;
   bool initialized_ = false;
-  SelectionCheck selection_check_ = nullptr;
+  std::vector<core::ColumnSpan> selection_;
+  std::vector<std::vector<core::ColumnSpan>> links_;
+  float scroll_pixels_ = 0.0f;
+
+  /**
+   * Objects every renderer of a share group uses; the last renderer to
+   * shut down deletes them.
+   */
+  struct SharedObjects {
+    uint32_t shader_program = 0;
+    uint32_t vbo_quad = 0;
 
-  // OpenGL resources
+    ~SharedObjects();
+  };
+  std::shared_ptr<SharedObjects> shared_;
+
+  // OpenGL resources (the program and quad buffer are shared_'s)
   uint32_t shader_program_ = 0;
   uint32_t vao_ = 0;
   uint32_t vbo_quad_ = 0;
@@ -91,10 +132,13 @@ private:
   int loc_projection_ = -1;
   int loc_cell_size_ = -1;
   int loc_atlas_texture_ = -1;
+  int loc_ring_rows_ = -1;
+  int loc_top_slot_ = -1;
+  int loc_scroll_px_ = -1;
 
   // Instance data for batch rendering
   struct CellInstance {
-    float pos_x, pos_y;   // Cell position in pixels
+    float pos_x, pos_y;   // X in pixels, Y as a row slot of the ring
     float tex_x0, tex_y0; // Glyph texture coords
     float tex_x1, tex_y1;
     float glyph_offset_x; // Offset within cell
@@ -103,11 +147,36 @@ private:
     float glyph_size_y;
     float fg_r, fg_g, fg_b, fg_a; // Foreground color
     float bg_r, bg_g, bg_b, bg_a; // Background color
+    float underline;              // 1 if underlined (links)
+  };
+
+  /**
+   * Screen lines live in a ring of rows + 1 slots in the instance buffer
+   * (line n in slot n % slots); the shader places slots from the top slot
+   * and scroll offset, so rows that only moved are not uploaded again.
+   */
+  struct RowSlot {
+    uint64_t line = UINT64_MAX;
+    uint64_t key = 0;        // Content key (ScreenView::key)
+    uint64_t decoration = 0; // Selection, links and cursor on the row
+
+    bool operator==(const RowSlot &) const = default;
   };
+  std::vector<RowSlot> slots_;
+  std::vector<CellInstance> row_instances_; // Staging for one row
+  int ring_rows_ = 0;
+  int ring_cols_ = 0;
+  int top_slot_ = 0;
 
   bool create_shaders();
-  void update_instances(const core::GridBuffer &grid, const theme::Theme &theme,
-                        int cursor_col, int cursor_row, bool show_cursor);
+  void update_instances(const core::ScreenView &view, int cursor_col,
+                        int cursor_row, bool show_cursor);
+  void build_row(const core::Cell *cells, int cols, int slot,
+                 const core::ColumnSpan &selected,
+                 const std::vector<core::ColumnSpan> &links, int cursor_col);
+  static uint64_t decoration_hash(const core::ColumnSpan &selected,
+                                  const std::vector<core::ColumnSpan> &links,
+                                  int cursor_col);
 };
 
 } // namespace tide::render
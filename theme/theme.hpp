@@ -28,6 +28,8 @@ struct Color {
                  static_cast<float>((hex >> 8) & 0xFF) / 255.0f,
                  static_cast<float>(hex & 0xFF) / 255.0f, alpha};
   }
+
+  constexpr bool operator==(const Color &other) const = default;
 };
 
 /**